@@ -13,17 +13,22 @@
 //------------------------------------------------------------------------------
 #include <new>
 #include <sstream>
+#include <stdlib.h>
 
 #include "App.h"
 #include "Backdrop.h"
 #include "Camera.h"
-#include "ChaseCam.h"
 #include "Light.h"
+#include "OcclusionBuffer.h"
 #include "ParticleSystem.h"
+#include "Replay.h"
 #include "Scene.h"
+#include "Simulation.h"
 #include "Sky.h"
+#include "Stability.h"
 #include "Terrain.h"
 #include "Vehicle.h"
+#include "WorkerPool.h"
 
 //used for memory-leak checking in debug builds
 #if defined(_DEBUG) || defined(DEBUG)
@@ -47,9 +52,6 @@ const float FAR_PLANE			= 350.0f;
 const float FOG_START			= FAR_PLANE / 1.5f;
 const float FOG_START_BG		= FAR_PLANE - 200.0f;
 const float FOG_END				= FAR_PLANE;
-const float CAMERA_NEAR			= 10.0f;
-const float CAMERA_FAR			= 30.0f;
-const float CAMERA_HEIGHT		= 8.0f;
 
 
 //------------------------------------------------------------------------------
@@ -82,9 +84,11 @@ App::App()
 	m_pSky			= NULL;
 	m_pBackdrop		= NULL;
 	m_pVehicle		= NULL;
+	m_pOcclusionBuffer	= NULL;
 	m_pScene		= NULL;
 	m_pCamera		= NULL;
-	m_pChaseCam		= NULL;
+	m_pSimulation	= NULL;
+	m_pWorkerPool	= NULL;
 	m_pDI			= NULL;
 	m_pDIDKeyboard	= NULL;
 	memset( m_diksOld, 0, sizeof( m_diksOld ) );
@@ -98,7 +102,15 @@ App::App()
 	m_showShadowVolumes	= false;
 	m_cameraNear		= false;
 
+	m_vehicleVisible	= true;
+	m_shadowVisible		= true;
+	m_particlesVisible	= true;
+
 	m_engineFrequency	= 22050;
+
+	m_recordFile[ 0 ] = '\0';
+	m_stepsPerSecond = Simulation::DEFAULT_STEPS_PER_SECOND;
+	m_cullThreads = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -123,66 +135,71 @@ HRESULT App::OneTimeSceneInit()
 		return E_OUTOFMEMORY;
 	}
 
-	try{ m_pParticles = new ParticleSystem( 10000, 2.0f ); }
+	try{ m_pSky = new Sky(); }
 	catch( std::bad_alloc& error )
 	{
 		MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
 		return E_OUTOFMEMORY;
 	}
 
-	try{ m_pSky = new Sky(); }
+	//the simulated objects, with a seed that is kept if this run is recorded
+	try{ m_pSimulation = new Simulation(); }
 	catch( std::bad_alloc& error )
 	{
 		MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
 		return E_OUTOFMEMORY;
 	}
 
-	try{ m_pTerrain = new Terrain(); }
-	catch( std::bad_alloc& error )
+	const unsigned int seed = GetTickCount();
+	if( FAILED( m_pSimulation->Create( seed, m_stepsPerSecond ) ) )
 	{
-		MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
-		return E_OUTOFMEMORY;
+		MessageBox( NULL, "Could not create the simulation", "Error",
+					MB_ICONEXCLAMATION | MB_OK );
+		return E_FAIL;
 	}
+	m_pParticles	= m_pSimulation->GetParticles();
+	m_pTerrain		= m_pSimulation->GetTerrain();
+	m_pVehicle		= m_pSimulation->GetVehicle();
 
-	try{ m_pVehicle = new Vehicle(); }
-	catch( std::bad_alloc& error )
+	//cull the terrain on a pool of threads, if asked to
+	if( m_cullThreads > 0 )
 	{
-		MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
-		return E_OUTOFMEMORY;
+		try{ m_pWorkerPool = new WorkerPool( m_cullThreads ); }
+		catch( std::bad_alloc& error )
+		{
+			MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
+			return E_OUTOFMEMORY;
+		}
+		m_pTerrain->SetWorkerPool( m_pWorkerPool );
 	}
 
-	//set the initial vehicle parameters
-	const float centerPoint = m_pTerrain->GetTerrainSize() / 2.0f;
-	const float centerHeight = m_pTerrain->GetHeightMapPoint( centerPoint, centerPoint );
-	m_pVehicle->SetPosition( D3DXVECTOR3( centerPoint, centerHeight + 2.0f, centerPoint ) );
+	if( m_recordFile[ 0 ] != '\0' && ! m_recorder.Open( m_recordFile, seed, m_stepsPerSecond ) )
+	{
+		MessageBox( NULL, "Could not create the recording", "Error",
+					MB_ICONEXCLAMATION | MB_OK );
+	}
 
-	//set up the camera
-	try{ m_pChaseCam = new ChaseCam( CAMERA_FAR, CAMERA_HEIGHT, 100.0f ); }
+	try{ m_pOcclusionBuffer = new OcclusionBuffer(); }
 	catch( std::bad_alloc& error )
 	{
 		MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
 		return E_OUTOFMEMORY;
 	}
-	D3DXVECTOR3 vPosition = m_pVehicle->GetPosition();
-	m_pChaseCam->SetChasePosition( vPosition );
-	vPosition[ 0 ] -= 30.0f;
-	vPosition[ 1 ] += 10.0f;
-	vPosition[ 2 ] -= 30.0f;
-	m_pChaseCam->SetCameraPosition( vPosition );
 
+	//set up the camera
 	try{ m_pCamera = new Camera(); }
 	catch( std::bad_alloc& error )
 	{
 		MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
 		return E_OUTOFMEMORY;
 	}
-	m_pCamera->SetCamera( m_pChaseCam->GetCameraPosition(),
-						  m_pChaseCam->GetChasePosition(),
-						  D3DXVECTOR3( 0.0f, 1.0f, 0.0f ) );
+	m_pCamera->SetCamera( m_pSimulation->GetCameraPosition(),
+						  m_pSimulation->GetCameraTarget(),
+						  Vector3( 0.0f, 1.0f, 0.0f ) );
 
-	D3DXMATRIX matProj;
+	Matrix4 matProj;
 	float fAspect = m_d3dsdBackBuffer.Width / float(m_d3dsdBackBuffer.Height);
-	D3DXMatrixPerspectiveFovLH( &matProj, D3DX_PI/4, fAspect, 1.0f, FAR_PLANE );
+	Mat4PerspectiveFovLH( matProj, MATHS_PI/4, fAspect, 1.0f, FAR_PLANE );
 	m_pCamera->SetProjection( matProj );
 
 	//create lights
@@ -361,9 +378,9 @@ HRESULT App::RestoreDeviceObjects()
 	m_pd3dDevice->SetSamplerState( 1, D3DSAMP_MIPFILTER, D3DTEXF_LINEAR );
 
 	//store the new screen size in the camera
-	D3DXMATRIX matProj;
+	Matrix4 matProj;
 	float fAspect = m_d3dsdBackBuffer.Width / float(m_d3dsdBackBuffer.Height);
-	D3DXMatrixPerspectiveFovLH( &matProj, D3DX_PI/4, fAspect, 1.0f, FAR_PLANE );
+	Mat4PerspectiveFovLH( matProj, MATHS_PI/4, fAspect, 1.0f, FAR_PLANE );
 	m_pCamera->SetProjection( matProj );
 	m_pScene->SetCamera( *m_pCamera );
     
@@ -404,7 +421,8 @@ HRESULT App::Render()
 
 		//do ambient lighting pass, with shadow volumes where appropriate
 		m_pTerrain->Render( *m_pScene, false );
-		m_pVehicle->Render( *m_pScene, false, true );
+		if( m_vehicleVisible || m_shadowVisible )
+			m_pVehicle->Render( *m_pScene, false, m_vehicleVisible, m_shadowVisible );
 
 		//do diffuse lighting pass (additive blending)
 		m_pd3dDevice->SetRenderState( D3DRS_ALPHABLENDENABLE, TRUE );
@@ -418,7 +436,8 @@ HRESULT App::Render()
 		m_pd3dDevice->SetRenderState( D3DRS_ZFUNC, D3DCMP_EQUAL );
 
 		m_pTerrain->Render( *m_pScene, true );
-		m_pVehicle->Render( *m_pScene, true, false );
+		if( m_vehicleVisible )
+			m_pVehicle->Render( *m_pScene, true, true, false );
 
 		m_pd3dDevice->SetRenderState( D3DRS_ALPHABLENDENABLE, FALSE );
 		m_pd3dDevice->SetRenderState( D3DRS_STENCILENABLE, FALSE );
@@ -426,16 +445,42 @@ HRESULT App::Render()
 		m_pd3dDevice->SetRenderState( D3DRS_ZFUNC, D3DCMP_LESSEQUAL );
 
 		//render the dust trail
-		m_pParticles->Render( *m_pScene );
+		if( m_particlesVisible )
+			m_pParticles->Render( *m_pScene );
 
 		//render the statistics
 		m_pFont->DrawText( 5.0f, 5.0f, 0xccffff00, m_strDeviceStats );
 		m_pFont->DrawText( 5.0f, 25.0f, 0xccffff00, m_strFrameStats );
 
 		std::stringstream ss;
-		ss << "Visible terrain cells: " << m_pTerrain->GetVisibleCells();
+		ss << "Visible terrain cells: " << m_pTerrain->GetVisibleCells()
+		   << " in " << m_pTerrain->GetCellDraws() << " draws"
+		   << " (" << m_pTerrain->GetOccludedCells() << " occluded)"
+		   << "  Occluder triangles: " << m_pOcclusionBuffer->GetOccluderTriangles()
+		   << ( m_pVehicle->IsAsleep() ? "  [vehicle asleep]" : "" )
+		   << ( m_vehicleVisible ? "" : "  [vehicle hidden]" )
+		   << ( m_shadowVisible ? "" : "  [shadow hidden]" )
+		   << ( m_particlesVisible ? "" : "  [dust hidden]" );
 		m_pFont->DrawText( 5.0f, 45.0f, 0xccffff00, ss.str().c_str() );
 
+		#ifdef CULLSTATS_ENABLED
+		const CullStats& stats = m_pTerrain->GetCullStats();
+		std::stringstream cullStats;
+		cullStats.setf( std::ios::fixed );
+		cullStats.precision( 3 );
+		cullStats << "Cull: " << stats.cullTime << "ms (tree " << stats.traversalTime
+				  << "ms)  Nodes visited: " << stats.nodesVisited
+				  << "  Plane tests: " << stats.planeTests
+				  << " (" << stats.planeTestsSaved << " saved)"
+				  << "  Accepted whole: " << stats.nodesAcceptedWhole
+				  << " (" << stats.leavesAcceptedWhole << " leaves)"
+				  << "  Rejected L/R/T/B/N/F: " << stats.leavesRejected[ 0 ]
+				  << "/" << stats.leavesRejected[ 1 ] << "/" << stats.leavesRejected[ 2 ]
+				  << "/" << stats.leavesRejected[ 3 ] << "/" << stats.leavesRejected[ 4 ]
+				  << "/" << stats.leavesRejected[ 5 ];
+		m_pFont->DrawText( 5.0f, 85.0f, 0xccffff00, cullStats.str().c_str() );
+		#endif
+
 		//render the help
 		if( ! m_showHelp )
 		{
@@ -474,12 +519,6 @@ HRESULT App::Render()
 //------------------------------------------------------------------------------
 HRESULT App::FrameMove()
 {
-	//HACK: cap time interval to stop calculation errors at startup
-	//warning - if the framerate drops below 10fps the camera will no longer follow
-	if( m_fElapsedTime > 0.1f )
-		m_fElapsedTime = 0.1f;
-	//END HACK
-
 	//set the time for the procedural sky
 	m_pSky->SetTime( m_fTime );
 
@@ -524,10 +563,6 @@ HRESULT App::FrameMove()
 		if( ( diks[ DIK_C ] & 0x80 ) && !( m_diksOld[ DIK_C ] & 0x80 ) )
 		{
 			m_cameraNear = ! m_cameraNear;
-			if( m_cameraNear )
-				m_pChaseCam->SetParameters( CAMERA_NEAR, CAMERA_HEIGHT );
-			else
-				m_pChaseCam->SetParameters( CAMERA_FAR, CAMERA_HEIGHT );
 		}
 
 		//wireframe mode
@@ -558,56 +593,32 @@ HRESULT App::FrameMove()
 
 	if( ! m_pausePhysics )
 	{
-		//run the physics simulation on the vehicle
-		m_pVehicle->DoPhysics( m_fElapsedTime, m_pTerrain, forwardThrust, reverseThrust,
-							leftThrust, rightThrust );
-
-		const D3DXVECTOR3 vVehiclePosition	= m_pVehicle->GetPosition();
-		const D3DXVECTOR3 vVehicleDirection	= m_pVehicle->GetDirection();
-		const D3DXVECTOR3 vVehicleVelocity	= m_pVehicle->GetVelocity();
-
-		//update the vehicle's dust trail...
-		//particle generation position
-		D3DXVECTOR3 particlePosition = vVehiclePosition;
-		particlePosition.y -= 1.8f;
-		m_pParticles->SetPosition( particlePosition );
-
-		//particle velocity
-		if( m_pVehicle->IsOnGround() )
-		{
-			m_pParticles->SetVelocity( - vVehicleVelocity );
-			m_pParticles->UpdateParticles( m_fElapsedTime );
-		}
-		else
-		{
-			m_pParticles->SetVelocity( D3DXVECTOR3( 0.0f, 0.0f, 0.0f ) );
-		}
+		//run the simulation, recording what drives it if asked to
+		unsigned char controls = 0;
+		if( forwardThrust )	controls |= Simulation::CONTROL_FORWARD;
+		if( reverseThrust )	controls |= Simulation::CONTROL_REVERSE;
+		if( leftThrust )	controls |= Simulation::CONTROL_LEFT;
+		if( rightThrust )	controls |= Simulation::CONTROL_RIGHT;
+		if( centerCam )		controls |= Simulation::CONTROL_CENTRE_CAMERA;
+		if( m_cameraNear )	controls |= Simulation::CONTROL_CAMERA_NEAR;
+
+		if( m_recorder.IsOpen() )
+			m_recorder.RecordFrame( m_fElapsedTime, controls );
+		m_pSimulation->Advance( m_fElapsedTime, controls );
+
+		const Vector3 vVehiclePosition = m_pVehicle->GetRenderPosition();
+		const Vector3 vPos = m_pSimulation->GetCameraPosition();
 
-		//update the chasecam
-		m_pChaseCam->SetChasePosition( vVehiclePosition );
-		m_pChaseCam->SetChaseDirection( vVehicleDirection );
-		m_pChaseCam->SetChaseVelocity( vVehicleVelocity );
-		m_pChaseCam->SetCameraVelocity( vVehicleVelocity );
-		m_pChaseCam->UpdatePosition( m_fElapsedTime, centerCam );
-
-		//adjust height to make sure the camera follows the terrain
-		D3DXVECTOR3 vPos = m_pChaseCam->GetCameraPosition();
-		float height = m_pTerrain->GetHeightMapPoint( vPos[ 0 ], vPos[ 2 ] );
-		height = vPos[ 1 ] - ( height + 3.0f );
-		if( height < 0.0f )
-			vPos[ 1 ] -= height;
-		
 		//update the camera position
-		m_pCamera->SetCamera( vPos, m_pChaseCam->GetChasePosition(),
- 							  D3DXVECTOR3( 0.0f, 1.0f, 0.0f ) );
+		m_pCamera->SetCamera( vPos, m_pSimulation->GetCameraTarget(),
+ 							  Vector3( 0.0f, 1.0f, 0.0f ) );
 		m_pScene->SetCamera( *m_pCamera );
 
 		//camera has moved so cull terrain
-		m_pTerrain->CullQuadtree( *m_pScene );
+		m_pTerrain->CullQuadtree( m_pScene->GetCamera() );
 
 		//vary the engine volume to match the vehicle distance
-		D3DXVECTOR3 viewVector = vVehiclePosition - vPos;
-		float vehicleDistance = D3DXVec3Length( &viewVector );
+		float vehicleDistance = Vec3Length( vVehiclePosition - vPos );
 		const int volume = 0 - int( vehicleDistance * 30.0f );
 		m_pSNDEngine->GetBuffer( 0 )->SetVolume( volume );
 
@@ -647,18 +658,65 @@ HRESULT App::FrameMove()
 		}
 
 		m_pSNDEngine->GetBuffer( 0 )->SetFrequency( m_engineFrequency );
+
+		//keep the simulation close to the origin, where floats are accurate
+		RebaseOrigin();
 	}
 
-	//update vehicle shadow volume
-	m_pVehicle->UpdateShadowVolume( *m_pScene, m_showShadowVolumes );
+	//find out what the terrain hides, then update the vehicle shadow volume
+	//only if it can be seen
+	UpdateOcclusion();
+	if( m_shadowVisible )
+		m_pVehicle->UpdateShadowVolume( Vector3( m_pScene->GetLight( 0 ).GetPosition() ),
+										 m_showShadowVolumes );
 		
 	//store the view projection matrix - needed for correct fog
-	D3DXMATRIX matProj = m_pCamera->GetProjection();
+	D3DXMATRIX matProj( m_pCamera->GetProjection() );
 	m_pd3dDevice->SetTransform( D3DTS_PROJECTION, &matProj );
 
     return S_OK;
 }
 
+//------------------------------------------------------------------------------
+// Name: RebaseOrigin()
+// Desc: Moves the floating origin once the camera strays too far from it, and
+//		 the drawing camera with it
+//------------------------------------------------------------------------------
+void App::RebaseOrigin()
+{
+	Vector3 vShift;
+	if( ! m_pSimulation->RebaseOrigin( vShift ) )
+		return;
+
+	m_pCamera->SetCamera( m_pCamera->GetPosition() - vShift,
+						  m_pCamera->GetLookAtPt() - vShift,
+						  m_pCamera->GetUp() );
+	m_pScene->SetCamera( *m_pCamera );
+}
+
+//------------------------------------------------------------------------------
+// Name: UpdateOcclusion()
+// Desc: Draws the visible terrain into the occlusion buffer, and tests the
+//		 vehicle, its shadow volume and the dust trail against it
+//------------------------------------------------------------------------------
+void App::UpdateOcclusion()
+{
+	const Camera& camera = m_pScene->GetCamera();
+	m_pOcclusionBuffer->Begin( camera.GetViewProj(), camera.GetPosition() );
+	m_pTerrain->AddOccluders( *m_pOcclusionBuffer );
+	m_pOcclusionBuffer->Rasterise();
+
+	Vector3 vMin, vMax;
+	m_pVehicle->GetBounds( vMin, vMax );
+	m_vehicleVisible = m_pOcclusionBuffer->IsVisible( vMin, vMax );
+
+	m_pVehicle->GetShadowBounds( Vector3( m_pScene->GetLight( 0 ).GetPosition() ), vMin, vMax );
+	m_shadowVisible = m_pOcclusionBuffer->IsVisible( vMin, vMax );
+
+	m_particlesVisible = m_pParticles->GetBounds( vMin, vMax ) &&
+						 m_pOcclusionBuffer->IsVisible( vMin, vMax );
+}
+
 //------------------------------------------------------------------------------
 // Name: InvalidateDeviceObjects
 // Desc: Tidies up device-specific data on res change
@@ -720,13 +778,21 @@ HRESULT App::FinalCleanup()
 {
 	//tidy up the scene geometry
 	SAFE_DELETE( m_pBackdrop );
-	SAFE_DELETE( m_pParticles );
 	SAFE_DELETE( m_pSky );
-	SAFE_DELETE( m_pTerrain );
-	SAFE_DELETE( m_pVehicle );
+	SAFE_DELETE( m_pOcclusionBuffer );
 	SAFE_DELETE( m_pScene );
 	SAFE_DELETE( m_pCamera );
-	SAFE_DELETE( m_pChaseCam );
+
+	//finish any recording with the state the simulation ended in
+	if( m_pSimulation != NULL )
+		m_recorder.Close( m_pSimulation->GetChecksum() );
+	SAFE_DELETE( m_pSimulation );
+	m_pParticles	= NULL;
+	m_pTerrain		= NULL;
+	m_pVehicle		= NULL;
+
+	//the terrain does not own the pool
+	SAFE_DELETE( m_pWorkerPool );
 
 	//tidy up the font
 	SAFE_DELETE( m_pFont );
@@ -777,11 +843,45 @@ HRESULT App::ConfirmDevice( D3DCAPS9* pCaps, DWORD behavior, D3DFORMAT, D3DFORMA
 	return S_OK;
 }
 
+//------------------------------------------------------------------------------
+// Name: SetRecordFile()
+// Desc: Sets the file the run is recorded to
+//------------------------------------------------------------------------------
+void App::SetRecordFile( const char* fileName )
+{
+	strncpy( m_recordFile, fileName, MAX_PATH - 1 );
+	m_recordFile[ MAX_PATH - 1 ] = '\0';
+}
+
+//------------------------------------------------------------------------------
+// Name: SetStepsPerSecond()
+// Desc: Sets how many times a second the simulation is stepped
+//------------------------------------------------------------------------------
+void App::SetStepsPerSecond( const int stepsPerSecond )
+{
+	m_stepsPerSecond = stepsPerSecond;
+}
+
+//------------------------------------------------------------------------------
+// Name: SetCullThreads()
+// Desc: Sets how many threads besides the main one cull the terrain
+//------------------------------------------------------------------------------
+void App::SetCullThreads( const int numThreads )
+{
+	m_cullThreads = numThreads;
+}
+
 //------------------------------------------------------------------------------
 // Name: WinMain()
-// Desc: Entry point for the application
+// Desc: Entry point for the application. "-steps <n>" steps the physics that
+//		 many times a second, "-threads <n>" culls the terrain on that many
+//		 worker threads as well, "-record <file>" records the run, and
+//		 "-replay <file>" plays a recording back at its own step rate with
+//		 nothing drawn, then reports how fast it ran and whether it ended in
+//		 the recorded state. "-stability" reports the largest step the
+//		 integrator stays stable at.
 //------------------------------------------------------------------------------
-INT WINAPI WinMain( HINSTANCE hInstance, HINSTANCE, LPSTR, INT )
+INT WINAPI WinMain( HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, INT )
 {
 	//enable memory-leak checking in debug builds
 	#if defined(_DEBUG) || defined(DEBUG)
@@ -790,7 +890,77 @@ INT WINAPI WinMain( HINSTANCE hInstance, HINSTANCE, LPSTR, INT )
 	_CrtSetDbgFlag( flag );
 	#endif
 
+	if( strncmp( lpCmdLine, "-replay ", 8 ) == 0 )
+	{
+		ReplayResult result;
+		if( ! PlayReplay( lpCmdLine + 8, result ) )
+		{
+			MessageBox( NULL, "Could not read the recording", "Replay",
+						MB_ICONEXCLAMATION | MB_OK );
+			return 1;
+		}
+
+		const bool matched = result.checksum == result.expectedChecksum;
+		std::ostringstream report;
+		report << result.numFrames << " frames, " << result.numSteps << " steps in "
+			   << result.seconds << "s - "
+			   << ( result.seconds > 0.0 ? result.numSteps / result.seconds : 0.0 )
+			   << " steps per second\n"
+			   << result.occludedCells << " of " << result.frustumCells
+			   << " cells in the frustum behind the horizon, at most "
+			   << result.maxOccludedCells << " in a frame\n"
+			   << "checksum " << std::hex << result.checksum << ", recorded "
+			   << result.expectedChecksum << ( matched ? " - matched" : " - MISMATCH" );
+		MessageBox( NULL, report.str().c_str(), "Replay",
+					matched ? MB_ICONINFORMATION | MB_OK : MB_ICONEXCLAMATION | MB_OK );
+		return matched ? 0 : 1;
+	}
+
+	if( strcmp( lpCmdLine, "-stability" ) == 0 )
+	{
+		//every integrator, side by side
+		std::ostringstream report;
+		for( int integrator = 0; integrator < NUM_INTEGRATORS; ++integrator )
+		{
+			StabilityResult result;
+			if( ! FindStableStep( Integrator( integrator ), result ) )
+			{
+				MessageBox( NULL, "The reference run failed", "Stability",
+							MB_ICONEXCLAMATION | MB_OK );
+				return 1;
+			}
+
+			report << result.integrator << ": stable down to " << result.stepsPerSecond
+				   << " steps per second, " << result.secondsPerSecond * 1000000.0
+				   << "us per simulated second, "
+				   << result.secondsPerSecondAtReference * 1000000.0 << "us at "
+				   << result.referenceStepsPerSecond << " steps per second\n";
+		}
+		MessageBox( NULL, report.str().c_str(), "Stability", MB_ICONINFORMATION | MB_OK );
+		return 0;
+	}
+
 	App theApp;
+
+	//the numbered options come first, in either order
+	const char* pOption = lpCmdLine;
+	for( ;; )
+	{
+		char* pEnd = NULL;
+		if( strncmp( pOption, "-steps ", 7 ) == 0 )
+			theApp.SetStepsPerSecond( int( strtol( pOption + 7, &pEnd, 10 ) ) );
+		else if( strncmp( pOption, "-threads ", 9 ) == 0 )
+			theApp.SetCullThreads( int( strtol( pOption + 9, &pEnd, 10 ) ) );
+		else
+			break;
+
+		pOption = pEnd;
+		while( *pOption == ' ' )
+			++pOption;
+	}
+	if( strncmp( pOption, "-record ", 8 ) == 0 )
+		theApp.SetRecordFile( pOption + 8 );
+
 	theApp.Create( hInstance );
 	return theApp.Run();
 }
@@ -29,6 +29,7 @@
 #include "D3DApp.h"
 #include "D3DRes.h"
 #include "D3DFont.h"
+#include "Replay.h"
 #include "Resource.h"
 
 
@@ -37,12 +38,14 @@
 //------------------------------------------------------------------------------
 class Backdrop;
 class Camera;
-class ChaseCam;
+class OcclusionBuffer;
 class Scene;
+class Simulation;
 class Sky;
 class Terrain;
 class Vehicle;
 class ParticleSystem;
+class WorkerPool;
 
 //------------------------------------------------------------------------------
 // Name: class App
@@ -64,7 +67,20 @@ public:
 	HRESULT ConfirmDevice( D3DCAPS9* pCaps, DWORD behavior,
 						   D3DFORMAT adaptorFormat, D3DFORMAT backBufferFormat );
 
+	//records the run to a file - called before Create()
+	void SetRecordFile( const char* fileName );
+
+	//the physics steps a second - called before Create()
+	void SetStepsPerSecond( const int stepsPerSecond );
+
+	//culls the terrain on a pool of that many threads as well as the main
+	//one, or on the main thread alone if none - called before Create()
+	void SetCullThreads( const int numThreads );
+
 private:
+	void RebaseOrigin();
+	void UpdateOcclusion();
+
 	CD3DFont*			m_pFont;
 	LPDIRECT3DTEXTURE9	m_pShadowTexture;
 
@@ -88,16 +104,32 @@ private:
 	bool m_showShadowVolumes;
 	bool m_cameraNear;
 
-	//scene geometry
+	//scene geometry - the simulation owns the dust trail, the terrain and the
+	//vehicle
 	Backdrop*		m_pBackdrop;
 	ParticleSystem*	m_pParticles;
 	Sky*			m_pSky;
 	Terrain*		m_pTerrain;	
 	Vehicle*		m_pVehicle;
+	Simulation*		m_pSimulation;
+
+	//threads the terrain is culled on, if any
+	WorkerPool*		m_pWorkerPool;
+	int				m_cullThreads;
+
+	//recording of what drives the simulation, for replaying it
+	ReplayRecorder	m_recorder;
+	char			m_recordFile[ MAX_PATH ];
+	int				m_stepsPerSecond;
+
+	//occlusion of the dynamic objects by the terrain
+	OcclusionBuffer*	m_pOcclusionBuffer;
+	bool				m_vehicleVisible;
+	bool				m_shadowVisible;
+	bool				m_particlesVisible;
 
 	//selection of cameras for the scene
 	Scene*		m_pScene;
-	ChaseCam*	m_pChaseCam;
 	Camera*		m_pCamera;
 
 };
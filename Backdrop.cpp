@@ -181,16 +181,17 @@ HRESULT Backdrop::Render( const Scene& scene )
 {
 	//set vertex shader constants...
 	//transform matrix
-	D3DXMATRIX matViewProj = scene.GetCamera().GetViewProj();	
+	const Matrix4& matViewProj = scene.GetCamera().GetViewProj();
 
 	//camera should be at the center of the backdrop
-	D3DXMATRIX matWorld;
-	const D3DXVECTOR3& vCamPosition = scene.GetCamera().GetPosition();
-	D3DXMatrixTranslation( &matWorld, vCamPosition[0], vCamPosition[1], vCamPosition[2] );
+	Affine matWorld;
+	const Vector3& vCamPosition = scene.GetCamera().GetPosition();
+	AffineTranslation( matWorld, vCamPosition[0], vCamPosition[1], vCamPosition[2] );
 
 	//set the transform matrix
-	D3DXMATRIX matResult;
-	D3DXMatrixMultiplyTranspose( &matResult, &matWorld, &matViewProj );
+	Matrix4 matResult;
+	Mat4MultiplyAffine( matResult, matWorld, matViewProj );
+	Mat4Transpose( matResult, matResult );
 	m_pd3dDevice->SetVertexShaderConstantF( 0, (float*)&matResult, 4 );
 
 	//set device parameters
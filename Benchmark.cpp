@@ -0,0 +1,182 @@
+//------------------------------------------------------------------------------
+// File: Benchmark.cpp
+// Desc: What the headless benchmarks share - timings of a stage, and a
+//		 stand-in for the hovercraft mesh, which they cannot load
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <math.h>
+
+#include "Benchmark.h"
+
+
+//------------------------------------------------------------------------------
+// Constants:
+//------------------------------------------------------------------------------
+
+//half the size of hovercraft.x along each axis, and the quads along each edge
+//of a side - six sides of 6x6 quads is 432 faces, against the mesh's 412
+const Vector3	HULL_HALF_SIZE( 4.5f, 1.2f, 5.0f );
+const int		HULL_QUADS_PER_EDGE = 6;
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: SumSamples()
+// Desc: Adds up a list of samples
+//------------------------------------------------------------------------------
+static double SumSamples( const std::vector<double>& samples )
+{
+	double total = 0.0;
+	for( unsigned int i = 0; i < samples.size(); ++i )
+		total += samples[ i ];
+	return total;
+}
+
+//------------------------------------------------------------------------------
+// Name: FindPercentile()
+// Desc: Finds a percentile of a list of samples by nearest rank, so it is
+//		 always one of the samples
+//------------------------------------------------------------------------------
+static double FindPercentile( const std::vector<double>& samples, const double fraction )
+{
+	if( samples.empty() )
+		return 0.0;
+
+	std::vector<double> sorted( samples );
+	std::sort( sorted.begin(), sorted.end() );
+
+	int rank = int( ceil( fraction * double( sorted.size() ) ) ) - 1;
+	if( rank < 0 ) rank = 0;
+	if( rank >= int( sorted.size() ) ) rank = int( sorted.size() ) - 1;
+	return sorted[ rank ];
+}
+
+//------------------------------------------------------------------------------
+// Name: GetTotal()
+// Desc: Adds up the time taken by every run
+//------------------------------------------------------------------------------
+double StageTimes::GetTotal() const
+{
+	return SumSamples( m_samples );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetMean()
+// Desc: Finds the average time of a run
+//------------------------------------------------------------------------------
+double StageTimes::GetMean() const
+{
+	if( m_samples.empty() )
+		return 0.0;
+	return GetTotal() / double( m_samples.size() );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetPercentile()
+// Desc: Finds a percentile by nearest rank, so it is always one of the times
+//		 that was measured
+//------------------------------------------------------------------------------
+double StageTimes::GetPercentile( const double fraction ) const
+{
+	return FindPercentile( m_samples, fraction );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetThroughput()
+// Desc: Finds the items got through in a second of running the stage
+//------------------------------------------------------------------------------
+double StageTimes::GetThroughput() const
+{
+	const double total = GetTotal();
+	return ( total > 0.0 ) ? m_numItems / total : 0.0;
+}
+
+//------------------------------------------------------------------------------
+// Name: GetTotal()
+// Desc: Adds up the counts of every frame
+//------------------------------------------------------------------------------
+double FrameCounts::GetTotal() const
+{
+	return SumSamples( m_samples );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetPercentile()
+// Desc: Finds a percentile by nearest rank, so it is always one of the counts
+//------------------------------------------------------------------------------
+double FrameCounts::GetPercentile( const double fraction ) const
+{
+	return FindPercentile( m_samples, fraction );
+}
+
+//------------------------------------------------------------------------------
+// Name: BuildStandInHull()
+// Desc: Builds each side from its outward normal and an axis across it. The
+//		 shadow volume takes cross( v2 - v1, v1 - v0 ) as a face's normal, so
+//		 the second axis is picked to make that point out of the box.
+//------------------------------------------------------------------------------
+void BuildStandInHull( std::vector<Vector3>& vertices, std::vector<WORD>& indices )
+{
+	const int vertsPerEdge = HULL_QUADS_PER_EDGE + 1;
+	vertices.clear();
+	indices.clear();
+
+	for( int side = 0; side < 6; ++side )
+	{
+		const int axis = side / 2;
+		const float sign = ( side & 1 ) ? -1.0f : 1.0f;
+
+		Vector3 vNormal( 0.0f, 0.0f, 0.0f );
+		Vector3 vAcross( 0.0f, 0.0f, 0.0f );
+		vNormal[ axis ] = sign;
+		vAcross[ ( axis + 1 ) % 3 ] = 1.0f;
+		const Vector3 vDown = Vec3Cross( vAcross, vNormal );
+
+		const Vector3 vCentre = vNormal * HULL_HALF_SIZE[ axis ];
+		const float acrossSize = HULL_HALF_SIZE[ ( axis + 1 ) % 3 ];
+		const float downSize = HULL_HALF_SIZE[ ( axis + 2 ) % 3 ];
+
+		const WORD firstVertex = WORD( vertices.size() );
+		for( int i = 0; i < vertsPerEdge; ++i )
+		{
+			for( int j = 0; j < vertsPerEdge; ++j )
+			{
+				const float u = ( 2.0f * float( i ) / HULL_QUADS_PER_EDGE ) - 1.0f;
+				const float v = ( 2.0f * float( j ) / HULL_QUADS_PER_EDGE ) - 1.0f;
+				vertices.push_back( vCentre + ( vAcross * ( u * acrossSize ) ) +
+									( vDown * ( v * downSize ) ) );
+			}
+		}
+
+		for( int i = 0; i < HULL_QUADS_PER_EDGE; ++i )
+		{
+			for( int j = 0; j < HULL_QUADS_PER_EDGE; ++j )
+			{
+				const WORD v00 = WORD( firstVertex + ( i * vertsPerEdge ) + j );
+				const WORD v10 = WORD( v00 + vertsPerEdge );
+				const WORD v01 = WORD( v00 + 1 );
+				const WORD v11 = WORD( v10 + 1 );
+
+				indices.push_back( v00 );
+				indices.push_back( v10 );
+				indices.push_back( v11 );
+
+				indices.push_back( v00 );
+				indices.push_back( v11 );
+				indices.push_back( v01 );
+			}
+		}
+	}
+}
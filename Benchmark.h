@@ -0,0 +1,97 @@
+//------------------------------------------------------------------------------
+// File: Benchmark.h
+// Desc: What the headless benchmarks share - timings of a stage, and a
+//		 stand-in for the hovercraft mesh, which they cannot load
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_BENCHMARK_H
+#define INCLUSIONGUARD_BENCHMARK_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <vector>
+
+#include "Platform.h"
+#include "VectorMath.h"
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: class StageTimes
+// Desc: The time a stage took each time it ran, and the items it got through
+//------------------------------------------------------------------------------
+class StageTimes
+{
+public:
+	StageTimes() : m_start( 0.0 ), m_numItems( 0.0 ) {}
+
+	inline void Start() { m_start = GetTimerSeconds(); }
+	inline void Stop( const double numItems )
+	{
+		m_samples.push_back( GetTimerSeconds() - m_start );
+		m_numItems += numItems;
+	}
+	inline void Add( const double seconds, const double numItems )
+	{
+		m_samples.push_back( seconds );
+		m_numItems += numItems;
+	}
+
+	inline int GetNumSamples() const { return int( m_samples.size() ); }
+	inline double GetNumItems() const { return m_numItems; }
+	double GetTotal() const;
+	double GetMean() const;
+
+	//the time that the given fraction of the runs took no longer than
+	double GetPercentile( const double fraction ) const;
+
+	//items a second, over all the runs
+	double GetThroughput() const;
+
+private:
+	std::vector<double> m_samples;
+	double m_start;
+	double m_numItems;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: class FrameCounts
+// Desc: How many of something there were each frame
+//------------------------------------------------------------------------------
+class FrameCounts
+{
+public:
+	inline void Add( const unsigned int count ) { m_samples.push_back( double( count ) ); }
+
+	inline int GetNumSamples() const { return int( m_samples.size() ); }
+	double GetTotal() const;
+
+	//the count that the given fraction of the frames had no more than
+	double GetPercentile( const double fraction ) const;
+
+private:
+	std::vector<double> m_samples;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: BuildStandInHull()
+// Desc: Builds a closed box the size of the hovercraft mesh, in mesh space,
+//		 with about as many faces - each side is a grid of quads, facing out
+//		 the way the shadow volume expects
+//------------------------------------------------------------------------------
+void BuildStandInHull( std::vector<Vector3>& vertices, std::vector<WORD>& indices );
+
+
+#endif //INCLUSIONGUARD_BENCHMARK_H
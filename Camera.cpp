@@ -24,32 +24,32 @@
 //------------------------------------------------------------------------------
 Camera::Camera()
 {
-	D3DXMatrixIdentity( &m_matView );
-	D3DXMatrixIdentity( &m_matProjection );
-	D3DXMatrixIdentity( &m_matViewProj );
+	AffineIdentity( m_matView );
+	Mat4Identity( m_matProjection );
+	Mat4Identity( m_matViewProj );
 }
 
 //------------------------------------------------------------------------------
 // Name: SetCamera()
 // Desc: Creates the view transformation matrix for the camera
 //------------------------------------------------------------------------------
-void Camera::SetCamera( const D3DXVECTOR3& vPos, const D3DXVECTOR3& vLookAt,
-					    const D3DXVECTOR3& vUp )
+void Camera::SetCamera( const Vector3& vPos, const Vector3& vLookAt,
+					    const Vector3& vUp )
 {
 	m_vPosition	= vPos;
 	m_vLookAt	= vLookAt;
 	m_vUp		= vUp;
 
-	D3DXMatrixLookAtLH( &m_matView, &m_vPosition, &m_vLookAt, &m_vUp );
-	D3DXMatrixMultiply( &m_matViewProj, &m_matView, &m_matProjection );	
+	AffineLookAtLH( m_matView, m_vPosition, m_vLookAt, m_vUp );
+	Mat4MultiplyAffine( m_matViewProj, m_matView, m_matProjection );
 }
 
 //------------------------------------------------------------------------------
 // Name: SetProjection()
 // Desc: Stores a projection transformation matrix for the screen
 //------------------------------------------------------------------------------
-void Camera::SetProjection( const D3DXMATRIX& matProjection )
+void Camera::SetProjection( const Matrix4& matProjection )
 {
 	m_matProjection = matProjection;
-	D3DXMatrixMultiply( &m_matViewProj, &m_matView, &m_matProjection );
+	Mat4MultiplyAffine( m_matViewProj, m_matView, m_matProjection );
 }
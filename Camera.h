@@ -15,7 +15,7 @@
 //------------------------------------------------------------------------------
 // Included files:
 //------------------------------------------------------------------------------
-#include <d3dx9.h>
+#include "VectorMath.h"
 
 
 //------------------------------------------------------------------------------
@@ -31,25 +31,27 @@ class Camera
 public:
 	Camera();
 
-	void SetCamera( const D3DXVECTOR3& vPos, const D3DXVECTOR3& vLookAt,
-					const D3DXVECTOR3& vUp );
-	inline const D3DXVECTOR3& GetPosition() const { return m_vPosition; }
-	inline const D3DXVECTOR3& GetLookAtPt() const { return m_vLookAt; }
-	inline const D3DXVECTOR3& GetUp() const { return m_vUp; }
+	void SetCamera( const Vector3& vPos, const Vector3& vLookAt,
+					const Vector3& vUp );
+	inline const Vector3& GetPosition() const { return m_vPosition; }
+	inline const Vector3& GetLookAtPt() const { return m_vLookAt; }
+	inline const Vector3& GetUp() const { return m_vUp; }
 
-	void SetProjection( const D3DXMATRIX& matProjection );
-	inline const D3DXMATRIX& GetProjection() const { return m_matProjection; }
+	void SetProjection( const Matrix4& matProjection );
+	inline const Matrix4& GetProjection() const { return m_matProjection; }
 
-	inline const D3DXMATRIX& GetViewProj() const { return m_matViewProj; }
+	//the view is a rigid transform, so it is kept as one
+	inline const Affine& GetView() const { return m_matView; }
+	inline const Matrix4& GetViewProj() const { return m_matViewProj; }
 
 private:
-	D3DXMATRIX m_matProjection;
-	D3DXMATRIX m_matView;
-	D3DXMATRIX m_matViewProj;
+	Matrix4 m_matProjection;
+	Affine m_matView;
+	Matrix4 m_matViewProj;
 
-	D3DXVECTOR3 m_vPosition;
-	D3DXVECTOR3 m_vLookAt;
-	D3DXVECTOR3 m_vUp;
+	Vector3 m_vPosition;
+	Vector3 m_vLookAt;
+	Vector3 m_vUp;
 
 };
 
@@ -15,9 +15,10 @@
 //------------------------------------------------------------------------------
 // Included files:
 //------------------------------------------------------------------------------
-#include <d3dx9.h>
 #include <sstream>
 
+#include "VectorMath.h"
+
 
 //------------------------------------------------------------------------------
 // Prototypes and declarations:
@@ -42,7 +43,8 @@ public:
 
     void UpdatePosition( const float timeInterval, const bool useDirection )
 	{
-		D3DXVECTOR3 a;
+		//no horizontal pull when the camera is right above a stopped target
+		Vector3 a( 0.0f, 0.0f, 0.0f );
 
 		//compute the position-dependent acceleration
 		if( useDirection )
@@ -70,7 +72,7 @@ public:
 			}
 			else
 			{
-				D3DXVECTOR3 offset = m_vCameraPosition - m_vChasePosition;
+				Vector3 offset = m_vCameraPosition - m_vChasePosition;
 				r = float( sqrt( offset[ 0 ] * offset[ 0 ] + offset[ 2 ] * offset[ 2 ] ) );
 				if( r > 0.001f ) // > 1mm
 				{
@@ -90,46 +92,53 @@ public:
 		m_vCameraPosition += m_vCameraVelocity * timeInterval;
 	}
 
-	void SetChasePosition( const D3DXVECTOR3& vChasePosition )
+	void SetChasePosition( const Vector3& vChasePosition )
 	{
 		m_vChasePosition = vChasePosition;
 	}
 
-	void SetChaseVelocity( const D3DXVECTOR3& vChaseVelocity )
+	void SetChaseVelocity( const Vector3& vChaseVelocity )
 	{
 		m_vChaseVelocity = vChaseVelocity;
 	}
 
-	void SetChaseDirection( const D3DXVECTOR3& vChaseDirection )
+	void SetChaseDirection( const Vector3& vChaseDirection )
 	{
 		m_vChaseDirection = vChaseDirection;
 	}
 	
-	void SetCameraPosition( const D3DXVECTOR3& vCameraPosition )
+	void SetCameraPosition( const Vector3& vCameraPosition )
 	{
 		m_vCameraPosition = vCameraPosition;
 	}
 
-	void SetCameraVelocity( const D3DXVECTOR3& vCameraVelocity )
+	void SetCameraVelocity( const Vector3& vCameraVelocity )
 	{
 		m_vCameraVelocity = vCameraVelocity;
 	}
 
-	const D3DXVECTOR3 GetChasePosition() const { return m_vChasePosition; }
-	const D3DXVECTOR3 GetCameraPosition() const { return m_vCameraPosition; }
+	const Vector3 GetChasePosition() const { return m_vChasePosition; }
+	const Vector3 GetCameraPosition() const { return m_vCameraPosition; }
 
 	void SetParameters( const float followDistance, const float followHeight )
 	{
 		m_followDistance	= followDistance;
 		m_followHeight		= followHeight;
 	}
+
+	//called when the floating origin moves by vShift
+	void Rebase( const Vector3& vShift )
+	{
+		m_vChasePosition	-= vShift;
+		m_vCameraPosition	-= vShift;
+	}
 	
 private:
-	D3DXVECTOR3 m_vChasePosition;
-	D3DXVECTOR3 m_vChaseVelocity;
-	D3DXVECTOR3 m_vChaseDirection;
-	D3DXVECTOR3 m_vCameraPosition;
-	D3DXVECTOR3 m_vCameraVelocity;
+	Vector3 m_vChasePosition;
+	Vector3 m_vChaseVelocity;
+	Vector3 m_vChaseDirection;
+	Vector3 m_vCameraPosition;
+	Vector3 m_vCameraVelocity;
 
 	float m_followDistance;
 	float m_followHeight;
@@ -0,0 +1,1893 @@
+//------------------------------------------------------------------------------
+// File: Checks.cpp
+// Desc: Headless checks - runs the simulation and culling code on cases whose
+//		 results are known, and fails if any of them comes out wrong
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <new>
+
+#include "Benchmark.h"
+#include "Camera.h"
+#include "Frustum.h"
+#include "LooseQuadtree.h"
+#include "Replay.h"
+#include "Simulation.h"
+#include "Stability.h"
+#include "Terrain.h"
+#include "Vehicle.h"
+#include "VehicleFleet.h"
+#include "WorkerPool.h"
+
+
+//------------------------------------------------------------------------------
+// Constants:
+//------------------------------------------------------------------------------
+
+//how far a point may be outside a box before it counts, for rounding
+const float BOUNDS_EPSILON = 1e-3f;
+
+//the app's projection
+const float ASPECT_RATIO	= 4.0f / 3.0f;
+const float FAR_PLANE		= 350.0f;
+
+//the poses the culls are checked from - all over the area and a little past
+//its edges, low and high, and looking every way from nearly straight down to
+//above the horizon
+const int		CULL_POSES			= 64;
+
+//further than the app sees, so there are more cells in each view
+const float		CULL_FAR_PLANE		= 2000.0f;
+
+//the quadtree the frustum kernels are checked on covers the terrain's area in
+//finer cells, so more of them cross the edges of the views
+const int		CULL_CELLS_DIM		= 64;
+const float		CULL_CELL_SIZE		= 80.0f;
+
+//the slow camera path the coherent cull is checked over, at a height above
+//the terrain, moving and turning far enough each frame to have to cull again
+//every few dozen frames
+const int		COHERENT_FRAMES		= 1200;
+const float		COHERENT_HEIGHT		= 30.0f;
+const float		COHERENT_SPEED		= 0.6f;		//per frame
+const float		COHERENT_TURN		= 0.003f;	//radians per frame
+
+//the parallel cull is checked on pools of up to this many threads, or one
+//for each processor if there are more, each culling every pose a few times
+//over so that the threads finish in different orders
+const int		PARALLEL_THREADS	= 4;
+const int		PARALLEL_REPEATS	= 4;
+
+//the rate the app steps the physics at
+const int	APP_STEPS_PER_SECOND = Simulation::DEFAULT_STEPS_PER_SECOND;
+
+//the drive the floating origin is checked over, straight ahead across the
+//tiled terrain, in long frames so the dust trail is moved less often
+const double	DRIFT_DISTANCE		= 100000.0;		//100km
+const float		DRIFT_FRAME_TIME	= 0.1f;
+const int		DRIFT_MAX_FRAMES	= 100000;
+
+//the same drive is run again with the origin this many cells further out in
+//each direction, about 100km - a whole number of pairs of tiles, so the
+//heights are the same - and must stay this close to the first
+const int		FAR_ORIGIN_CELLS	= 640;
+const float		FAR_ORIGIN_TOLERANCE = 0.01f;
+
+//the camera is kept within two cells of the origin, and the vehicle is never
+//far from the camera
+const float		MAX_ORIGIN_CELLS	= 3.0f;
+
+//the vehicle is fired at the steepest rise on the terrain, and dropped onto
+//it, for this long at each speed and step - the collision grid must never end
+//a step deeper in the terrain than the hover height
+const float		IMPACT_SECONDS		= 0.5f;
+const float		IMPACT_SPEEDS[]		= { 50.0f, 400.0f, 1000.0f };
+const int		IMPACT_STEP_RATES[]	= { 240, 60, 30 };
+const float		RISE_RUN			= 24.0f;
+const float		MAX_TERRAIN_DEPTH	= 1.0f;
+
+//a one vehicle fleet and a Vehicle driven side by side through a script of
+//FLEET_SEGMENT_STEPS steps for each set of controls - forward, turns either
+//way, reverse and coasting - must stay this close in position, and in each
+//element of their rotations. They agree to rounding until a collision point
+//of one ends up just the other side of a contact height from the other's,
+//and part by a few centimetres from there on - 0.085m and 0.015 at most
+//with sse.
+const int		FLEET_SEGMENT_STEPS		= 240;
+const unsigned char FLEET_SCRIPT[]		=
+{
+	VehicleFleet::CONTROL_FORWARD,
+	VehicleFleet::CONTROL_FORWARD | VehicleFleet::CONTROL_LEFT,
+	VehicleFleet::CONTROL_FORWARD | VehicleFleet::CONTROL_RIGHT,
+	VehicleFleet::CONTROL_REVERSE,
+	0,
+};
+const int		FLEET_SCRIPT_SEGMENTS	= sizeof( FLEET_SCRIPT ) / sizeof( FLEET_SCRIPT[ 0 ] );
+const float		FLEET_POSITION_TOLERANCE	= 0.12f;
+const float		FLEET_ROTATION_TOLERANCE	= 0.025f;
+
+//the fleet the sleeping is checked on - a grid of idle vehicles around the
+//centre the tiers are measured from, all in the near tier, and drivers going
+//round in circles across the tiers further out. A vehicle that has not been
+//still for FLEET_SLEEP_STEPS in a row must not sleep. The idle ones slide
+//down into a wide hollow, where only a few come to rest within
+//FLEET_SETTLE_STEPS - two must, to be woken by their controls and by a box,
+//which may wake others up to FLEET_WAKE_REACH outside it, half a vehicle's
+//diagonal and a little more, but none further.
+const int		FLEET_IDLE_DIM			= 5;
+const float		FLEET_IDLE_SPACING		= 30.0f;
+const float		FLEET_DRIVER_DISTANCES[]	= { 150.0f, 240.0f, 260.0f, 400.0f };
+const int		FLEET_DRIVERS			= sizeof( FLEET_DRIVER_DISTANCES ) /
+										  sizeof( FLEET_DRIVER_DISTANCES[ 0 ] );
+const int		FLEET_SLEEP_STEPS		= 120;
+const float		FLEET_SLEEP_SPEED		= 0.25f;
+const int		FLEET_SETTLE_STEPS		= 30 * APP_STEPS_PER_SECOND;
+const int		FLEET_WAKE_DRIVE_STEPS	= 60;
+const float		FLEET_WAKE_DRIVE_DISTANCE	= 1.0f;
+const float		FLEET_WAKE_BOX_SIZE		= 1.0f;
+const float		FLEET_WAKE_REACH		= 5.0f;
+
+//the vehicle driven round in circles with the centre the tiers are measured
+//from held above it at each height for FLEET_TIER_SEGMENT_STEPS, putting it
+//in each tier in turn and back near. How far its reported position jumps is
+//the largest second difference of it, which FLEET_TIER_MAX_JUMPS bounds for
+//each tier - the longer steps of the mid and far tiers let it sink further
+//into a slope before it is pushed back out, by up to 0.25m and 0.88m on this
+//drive, against 0.07m kept near. Over the first FLEET_TIER_CHANGE_STEPS in a
+//tier, it may jump no more than the bound of either tier - without the fleet
+//fading the push a vehicle's first step in a nearer tier gives it, it jumps
+//5m moving from far to near here.
+const float		FLEET_TIER_HEIGHTS[]	= { 0.0f, 175.0f, 400.0f, 0.0f };
+const int		FLEET_TIER_TIERS[]		=
+{
+	VehicleFleet::TIER_NEAR,
+	VehicleFleet::TIER_MID,
+	VehicleFleet::TIER_FAR,
+	VehicleFleet::TIER_NEAR,
+};
+const float		FLEET_TIER_MAX_JUMPS[ VehicleFleet::NUM_TIERS ]	= { 0.1f, 0.4f, 1.2f };
+const int		FLEET_TIER_SEGMENTS		= sizeof( FLEET_TIER_HEIGHTS ) /
+										  sizeof( FLEET_TIER_HEIGHTS[ 0 ] );
+const int		FLEET_TIER_SEGMENT_STEPS	= 480;
+const int		FLEET_TIER_CHANGE_STEPS	= 8;
+
+//the grid of vehicles stepped on the worker pools, the same ones that the
+//parallel cull is checked on, each given the controls of one segment of the
+//script in turn
+const int		FLEET_POOL_DIM			= 20;
+const float		FLEET_POOL_SPACING		= 24.0f;
+const int		FLEET_POOL_STEPS		= 960;
+
+//the run recorded and played back, and rolled back, in uneven frames with
+//the controls changing every REPLAY_CONTROL_FRAMES - the recording is written
+//to a file in the current directory that is removed afterwards
+const char		REPLAY_FILE[]			= "checks.replay";
+const int		REPLAY_FRAMES			= 1200;
+const int		REPLAY_CONTROL_FRAMES	= 90;
+const unsigned int REPLAY_SEED			= 7;
+const unsigned char REPLAY_SCRIPT[]		=
+{
+	Simulation::CONTROL_FORWARD,
+	Simulation::CONTROL_FORWARD | Simulation::CONTROL_LEFT,
+	Simulation::CONTROL_FORWARD | Simulation::CONTROL_CAMERA_NEAR,
+	0,
+	Simulation::CONTROL_REVERSE | Simulation::CONTROL_RIGHT,
+	Simulation::CONTROL_FORWARD | Simulation::CONTROL_RIGHT,
+	Simulation::CONTROL_CENTRE_CAMERA,
+};
+const int		REPLAY_SCRIPT_LENGTH	= sizeof( REPLAY_SCRIPT ) / sizeof( REPLAY_SCRIPT[ 0 ] );
+
+//where the controls of a frame are in a recording - after the 24 byte header,
+//and the frame's elapsed time
+const long		REPLAY_FRAME_OFFSET		= 24;
+const long		REPLAY_FRAME_SIZE		= 5;
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: struct Check
+// Desc: A check to run - it prints what went wrong, and returns false, if it
+//		 fails
+//------------------------------------------------------------------------------
+struct Check
+{
+	const char* name;
+	bool ( *pFunction )();
+};
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: IsInside()
+// Desc: Tests a point against a box, allowing for rounding
+//------------------------------------------------------------------------------
+static bool IsInside( const Vector3& vPoint, const Vector3& vMin, const Vector3& vMax )
+{
+	for( int axis = 0; axis < 3; ++axis )
+	{
+		if( vPoint[ axis ] < vMin[ axis ] - BOUNDS_EPSILON ||
+			vPoint[ axis ] > vMax[ axis ] + BOUNDS_EPSILON )
+			return false;
+	}
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: SetCullPose()
+// Desc: Puts a camera at one of the poses the culls are checked from, over an
+//		 area areaSize across - with its height above the terrain, if given
+//		 one, rather than above zero
+//------------------------------------------------------------------------------
+static void SetCullPose( const int pose, const float areaSize, const Terrain* pTerrain,
+						 Camera& camera )
+{
+	Matrix4 matProj;
+	Mat4PerspectiveFovLH( matProj, MATHS_PI/4, ASPECT_RATIO, 1.0f, CULL_FAR_PLANE );
+	camera.SetProjection( matProj );
+
+	//spread over the area by the golden ratio, turned by the golden angle
+	const float u = float( pose ) * 0.618034f;
+	const float v = float( pose ) * 0.381966f + 0.5f;
+	const float x = ( u - floorf( u ) ) * 1.4f - 0.2f;
+	const float z = ( v - floorf( v ) ) * 1.4f - 0.2f;
+	const float yaw = float( pose ) * 2.399963f;
+	const float pitch = -1.4f + float( pose % 9 ) * 0.22f;
+
+	Vector3 vEye( x * areaSize, 5.0f + float( pose % 5 ) * 70.0f, z * areaSize );
+	if( pTerrain )
+		vEye.y += pTerrain->GetHeightMapPoint( vEye.x, vEye.z );
+	const Vector3 vLook( sinf( yaw ) * cosf( pitch ), sinf( pitch ), cosf( yaw ) * cosf( pitch ) );
+	camera.SetCamera( vEye, vEye + vLook, Vector3( 0.0f, 1.0f, 0.0f ) );
+}
+
+//------------------------------------------------------------------------------
+// Name: SetCullHills()
+// Desc: Gives a quadtree CULL_CELLS_DIM cells across made up hills, as the
+//		 culls do not care where the heights come from. Each leaf's item is
+//		 its cell number.
+//------------------------------------------------------------------------------
+static void SetCullHills( Quadtree& quadtree )
+{
+	for( int cellZ = 0; cellZ < CULL_CELLS_DIM; ++cellZ )
+	{
+		for( int cellX = 0; cellX < CULL_CELLS_DIM; ++cellX )
+		{
+			const float minY = 40.0f * ( sinf( float( cellX ) * 0.35f ) + 1.0f );
+			const float maxY = minY + 20.0f + 30.0f * ( cosf( float( cellZ ) * 0.2f ) + 1.0f );
+			quadtree.SetLeaf( cellX, cellZ, minY, maxY, cellX + ( cellZ * CULL_CELLS_DIM ) );
+		}
+	}
+	quadtree.FitBounds();
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckShadowBounds()
+// Desc: Builds the stand-in hull's shadow volume from a spread of lights and
+//		 orientations, and checks that every vertex of it is inside the box
+//		 the occlusion buffer tests for it
+//------------------------------------------------------------------------------
+static bool CheckShadowBounds()
+{
+	const Vector3 LIGHTS[] =
+	{
+		Vector3( 5.0f, -5.0f, 5.0f ),
+		Vector3( -1.0f, -0.2f, 0.3f ),
+		Vector3( 0.0f, -1.0f, 0.0f ),
+		Vector3( 0.4f, 0.1f, -2.0f ),
+	};
+	const int NUM_LIGHTS = sizeof( LIGHTS ) / sizeof( LIGHTS[ 0 ] );
+	const int NUM_ORIENTATIONS = 8;
+
+	Vehicle* pVehicle = NULL;
+	try{ pVehicle = new Vehicle(); }
+	catch( std::bad_alloc& )
+	{
+		printf( "  out of memory\n" );
+		return false;
+	}
+
+	std::vector<Vector3> hullVertices;
+	std::vector<WORD> hullIndices;
+	BuildStandInHull( hullVertices, hullIndices );
+	pVehicle->SetMesh( &hullVertices[ 0 ], int( hullVertices.size() ), &hullIndices[ 0 ],
+					   int( hullIndices.size() / 3 ) );
+	pVehicle->SetPosition( Vector3( 120.0f, 35.0f, -40.0f ) );
+
+	bool passed = true;
+	for( int orientation = 0; orientation < NUM_ORIENTATIONS && passed; ++orientation )
+	{
+		//turned about an axis that is neither flat nor upright
+		const float angle = float( orientation ) * 0.8f;
+		const Vector3 vAxis = Vec3Normalize( Vector3( 0.3f, 1.0f, 0.5f ) ) * sinf( angle * 0.5f );
+		VehiclePhysicsState state = pVehicle->GetPhysicsState();
+		state.qOrientation = Quaternion( vAxis.x, vAxis.y, vAxis.z, cosf( angle * 0.5f ) );
+		state.qPreviousOrientation = state.qOrientation;
+		Mat3RotationQuaternion( state.matRotation, state.qOrientation );
+		pVehicle->SetPhysicsState( state );
+
+		Affine matWorld;
+		pVehicle->GetWorldMatrix( matWorld );
+
+		for( int light = 0; light < NUM_LIGHTS && passed; ++light )
+		{
+			pVehicle->UpdateShadowVolume( LIGHTS[ light ], false );
+			Vector3 vMin, vMax;
+			pVehicle->GetShadowBounds( LIGHTS[ light ], vMin, vMax );
+
+			const ShadowVolume& shadowVolume = pVehicle->GetShadowVolume();
+			if( shadowVolume.GetNumVertices() == 0 )
+			{
+				printf( "  light %d, orientation %d: no shadow volume was built\n", light,
+						orientation );
+				passed = false;
+			}
+
+			for( DWORD vertex = 0; vertex < shadowVolume.GetNumVertices(); ++vertex )
+			{
+				const Vector3 vWorld = Vec3TransformCoord( shadowVolume.GetVertex( vertex ),
+														   matWorld );
+				if( ! IsInside( vWorld, vMin, vMax ) )
+				{
+					printf( "  light %d, orientation %d: vertex (%.2f, %.2f, %.2f) is outside "
+							"(%.2f, %.2f, %.2f) - (%.2f, %.2f, %.2f)\n", light, orientation,
+							vWorld.x, vWorld.y, vWorld.z, vMin.x, vMin.y, vMin.z,
+							vMax.x, vMax.y, vMax.z );
+					passed = false;
+					break;
+				}
+			}
+		}
+	}
+
+	delete pVehicle;
+	return passed;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckCullViews()
+// Desc: Culls more views than the quadtree takes in one walk, all together and
+//		 then one at a time, and checks that each view finds the same cells in
+//		 the same order both ways. Then culls the cull poses in walks of as
+//		 many views as a walk takes, and checks that each view finds the same
+//		 cells in the same order as the single view cull of its frustum.
+//------------------------------------------------------------------------------
+static bool CheckCullViews()
+{
+	const int NUM_VIEWS = Quadtree::MAX_VIEWS + 8;
+
+	Terrain* pTerrain = NULL;
+	try{ pTerrain = new Terrain(); }
+	catch( std::bad_alloc& )
+	{
+		printf( "  out of memory\n" );
+		return false;
+	}
+
+	//looking out from above the middle of the terrain, turned further round
+	//and tipped further down for each view
+	const float centre = pTerrain->GetTerrainSize() / 2.0f;
+	const Vector3 vEye( centre, pTerrain->GetHeightMapPoint( centre, centre ) + 40.0f, centre );
+	Matrix4 matProj;
+	Mat4PerspectiveFovLH( matProj, MATHS_PI/4, ASPECT_RATIO, 1.0f, FAR_PLANE );
+
+	std::vector<Matrix4> viewProjections( NUM_VIEWS );
+	for( int view = 0; view < NUM_VIEWS; ++view )
+	{
+		const float angle = float( view ) * 0.7f;
+		const float drop = 0.1f + float( view % 5 ) * 0.2f;
+		Camera camera;
+		camera.SetProjection( matProj );
+		camera.SetCamera( vEye, vEye + Vector3( sinf( angle ), -drop, cosf( angle ) ),
+						  Vector3( 0.0f, 1.0f, 0.0f ) );
+		viewProjections[ view ] = camera.GetViewProj();
+	}
+
+	std::vector< std::vector<unsigned int> > together( NUM_VIEWS );
+	pTerrain->CullViews( &viewProjections[ 0 ], NUM_VIEWS, vEye, &together[ 0 ] );
+
+	bool passed = true;
+	int numSeen = 0;
+	for( int view = 0; view < NUM_VIEWS && passed; ++view )
+	{
+		std::vector<unsigned int> alone;
+		pTerrain->CullViews( &viewProjections[ view ], 1, vEye, &alone );
+		if( alone != together[ view ] )
+		{
+			printf( "  view %d: %u cells alone, %u culled with the others\n", view,
+					unsigned( alone.size() ), unsigned( together[ view ].size() ) );
+			passed = false;
+		}
+		numSeen += alone.empty() ? 0 : 1;
+	}
+	if( passed && numSeen == 0 )
+	{
+		printf( "  no view saw any cells\n" );
+		passed = false;
+	}
+	delete pTerrain;
+
+	//the frusta as CullViews() extracts them
+	Quadtree quadtree( CULL_CELLS_DIM, CULL_CELL_SIZE );
+	SetCullHills( quadtree );
+	const float areaSize = float( CULL_CELLS_DIM ) * CULL_CELL_SIZE;
+	std::vector<Frustum> frusta( CULL_POSES );
+	for( int pose = 0; pose < CULL_POSES; ++pose )
+	{
+		Camera camera;
+		SetCullPose( pose, areaSize, NULL, camera );
+		frusta[ pose ] = ExtractFrustum( camera.GetViewProj(), false );
+	}
+
+	//the eye only orders the cells, so one for all the views will do
+	const Vector3 vHillsEye( areaSize / 2.0f, 100.0f, areaSize / 2.0f );
+	std::vector< std::vector<unsigned int> > multi( CULL_POSES );
+	std::vector<unsigned int> single;
+	unsigned int numCells = 0;
+	for( int first = 0; first < CULL_POSES && passed; first += Quadtree::MAX_VIEWS )
+	{
+		const int numViews = min( Quadtree::MAX_VIEWS, CULL_POSES - first );
+		quadtree.AddVisibleNodesMulti( &frusta[ first ], numViews, vHillsEye, &multi[ first ] );
+
+		for( int pose = first; pose < first + numViews && passed; ++pose )
+		{
+			single.clear();
+			quadtree.AddVisibleNodes( frusta[ pose ], vHillsEye, single );
+			if( multi[ pose ] != single )
+			{
+				printf( "  pose %d: %u cells culled on its own, %u in a walk of %d views\n",
+						pose, unsigned( single.size() ), unsigned( multi[ pose ].size() ),
+						numViews );
+				passed = false;
+			}
+			numCells += unsigned( single.size() );
+		}
+	}
+	if( passed )
+	{
+		printf( "  %d views alone and together, %d poses in walks of %d with %u cells\n",
+				NUM_VIEWS, CULL_POSES, Quadtree::MAX_VIEWS, numCells );
+	}
+
+	return passed && numCells > 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckFrustumKernels()
+// Desc: Tests the cells of a quadtree against the view from each pose with the
+//		 four-at-a-time and batch kernels, and checks that they give the same
+//		 masks as the reference kernel, for the frustum both as the terrain
+//		 cull and as CullViews() extract it. Then checks that the quadtree
+//		 cull finds exactly the cells the reference puts outside no plane.
+//------------------------------------------------------------------------------
+static bool CheckFrustumKernels()
+{
+	const int NUM_CELLS = CULL_CELLS_DIM * CULL_CELLS_DIM;
+	const float areaSize = float( CULL_CELLS_DIM ) * CULL_CELL_SIZE;
+
+	Quadtree quadtree( CULL_CELLS_DIM, CULL_CELL_SIZE );
+	SetCullHills( quadtree );
+
+	std::vector<float> minX( NUM_CELLS ), minY( NUM_CELLS ), minZ( NUM_CELLS );
+	std::vector<float> maxX( NUM_CELLS ), maxY( NUM_CELLS ), maxZ( NUM_CELLS );
+	for( int cell = 0; cell < NUM_CELLS; ++cell )
+	{
+		Vector3 vMin, vMax;
+		quadtree.GetCellBounds( cell % CULL_CELLS_DIM, cell / CULL_CELLS_DIM, vMin, vMax );
+		minX[ cell ] = vMin.x;
+		minY[ cell ] = vMin.y;
+		minZ[ cell ] = vMin.z;
+		maxX[ cell ] = vMax.x;
+		maxY[ cell ] = vMax.y;
+		maxZ[ cell ] = vMax.z;
+	}
+
+	std::vector<CullMasks> batch( NUM_CELLS / 4 );
+	std::vector<unsigned int> nodeList;
+	std::vector<bool> found( NUM_CELLS );
+	int numGroups = 0;
+	int numVisible = 0;
+	for( int pose = 0; pose < CULL_POSES; ++pose )
+	{
+		Camera camera;
+		SetCullPose( pose, areaSize, NULL, camera );
+		Frustum frusta[ 2 ];
+		frusta[ 0 ] = ExtractFrustum( camera.GetView(), camera.GetProjection() );
+		frusta[ 1 ] = ExtractFrustum( camera.GetViewProj(), false );
+
+		for( int extraction = 0; extraction < 2; ++extraction )
+		{
+			const Frustum& frustum = frusta[ extraction ];
+
+			//leave a different part of a group over at the end each time
+			const int count = NUM_CELLS - ( pose % 4 );
+			IntersectFrustumBatch( frustum, count, &minX[ 0 ], &minY[ 0 ], &minZ[ 0 ],
+								   &maxX[ 0 ], &maxY[ 0 ], &maxZ[ 0 ], &batch[ 0 ] );
+
+			for( int first = 0; first < count; first += 4 )
+			{
+				const int groupSize = min( 4, count - first );
+				const CullMasks reference = IntersectFrustumReference( frustum, groupSize,
+					&minX[ first ], &minY[ first ], &minZ[ first ],
+					&maxX[ first ], &maxY[ first ], &maxZ[ first ] );
+				CullMasks four = reference;
+				if( groupSize == 4 )
+				{
+					four = IntersectFrustum4( frustum, &minX[ first ], &minY[ first ],
+											  &minZ[ first ], &maxX[ first ], &maxY[ first ],
+											  &maxZ[ first ] );
+				}
+				const CullMasks& batched = batch[ first / 4 ];
+
+				if( four.inside != reference.inside || four.outside != reference.outside ||
+					four.intersecting != reference.intersecting ||
+					batched.inside != reference.inside || batched.outside != reference.outside ||
+					batched.intersecting != reference.intersecting )
+				{
+					printf( "  pose %d, cells %d-%d: inside/outside/intersecting %x/%x/%x, "
+							"four at a time %x/%x/%x, batched %x/%x/%x\n", pose, first,
+							first + groupSize - 1, reference.inside, reference.outside,
+							reference.intersecting, four.inside, four.outside, four.intersecting,
+							batched.inside, batched.outside, batched.intersecting );
+					return false;
+				}
+				++numGroups;
+			}
+		}
+
+		//the cull finds every cell outside no plane, and nothing else
+		nodeList.clear();
+		quadtree.AddVisibleNodes( frusta[ 0 ], camera.GetPosition(), nodeList );
+		found.assign( NUM_CELLS, false );
+		for( unsigned int i = 0; i < nodeList.size(); ++i )
+			found[ nodeList[ i ] ] = true;
+
+		for( int cell = 0; cell < NUM_CELLS; ++cell )
+		{
+			const CullMasks reference = IntersectFrustumReference( frusta[ 0 ], 1,
+				&minX[ cell ], &minY[ cell ], &minZ[ cell ],
+				&maxX[ cell ], &maxY[ cell ], &maxZ[ cell ] );
+			if( found[ cell ] != ( reference.outside == 0 ) )
+			{
+				printf( "  pose %d: cell %d is %s by the cull but %s by the reference\n", pose,
+						cell, found[ cell ] ? "found" : "not found",
+						reference.outside ? "outside" : "not outside" );
+				return false;
+			}
+		}
+		if( nodeList.size() != (unsigned int)( std::count( found.begin(), found.end(), true ) ) )
+		{
+			printf( "  pose %d: the cull found a cell more than once\n", pose );
+			return false;
+		}
+		numVisible += int( nodeList.size() );
+	}
+
+	printf( "  %d groups of four matched, %d cells found from %d poses\n", numGroups,
+			numVisible, CULL_POSES );
+	return numVisible > 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckCoherentCull()
+// Desc: Moves the camera slowly over the terrain, culling each frame with the
+//		 coherent cull and then again with the plain one, and checks that the
+//		 two find the same cells in the same order
+//------------------------------------------------------------------------------
+static bool CheckCoherentCull()
+{
+	Terrain* pTerrain = NULL;
+	try{ pTerrain = new Terrain(); }
+	catch( std::bad_alloc& )
+	{
+		printf( "  out of memory\n" );
+		return false;
+	}
+
+	Matrix4 matProj;
+	Mat4PerspectiveFovLH( matProj, MATHS_PI/4, ASPECT_RATIO, 1.0f, CULL_FAR_PLANE );
+	Camera camera;
+	camera.SetProjection( matProj );
+
+	const float centre = pTerrain->GetTerrainSize() / 2.0f;
+	float x = centre;
+	float z = centre;
+	float heading = 0.0f;
+	unsigned int numCells = 0;
+	bool passed = true;
+	std::vector<unsigned int> coherentCells;
+	for( int frame = 0; frame < COHERENT_FRAMES && passed; ++frame )
+	{
+		//round in a wide circle, nodding up and down
+		heading += COHERENT_TURN;
+		x += sinf( heading ) * COHERENT_SPEED;
+		z += cosf( heading ) * COHERENT_SPEED;
+		const float pitch = -0.3f + 0.2f * sinf( float( frame ) * 0.01f );
+		const Vector3 vEye( x, pTerrain->GetHeightMapPoint( x, z ) + COHERENT_HEIGHT, z );
+		const Vector3 vLook( sinf( heading ) * cosf( pitch ), sinf( pitch ),
+							 cosf( heading ) * cosf( pitch ) );
+		camera.SetCamera( vEye, vEye + vLook, Vector3( 0.0f, 1.0f, 0.0f ) );
+
+		pTerrain->SetCoherentCulling( true );
+		pTerrain->CullQuadtree( camera );
+		coherentCells = pTerrain->GetFrustumCellList();
+
+		pTerrain->SetCoherentCulling( false );
+		pTerrain->CullQuadtree( camera );
+		if( coherentCells != pTerrain->GetFrustumCellList() )
+		{
+			printf( "  frame %d: %u cells culled coherently, %u culled afresh\n", frame,
+					unsigned( coherentCells.size() ),
+					unsigned( pTerrain->GetFrustumCellList().size() ) );
+			passed = false;
+		}
+		numCells += unsigned( coherentCells.size() );
+	}
+
+	if( passed )
+		printf( "  %d frames, %u cells in the frustum\n", COHERENT_FRAMES, numCells );
+
+	delete pTerrain;
+	return passed && numCells > 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckParallelCull()
+// Desc: Culls the terrain from each pose on its own, then on worker pools with
+//		 one thread up to several, and checks that each pool finds the same
+//		 cells in the same order
+//------------------------------------------------------------------------------
+static bool CheckParallelCull()
+{
+	const int maxThreads = min( max( PARALLEL_THREADS, WorkerPool::GetNumProcessors() ),
+								WorkerPool::MAX_THREADS + 1 );
+
+	Terrain* pTerrain = NULL;
+	std::vector<WorkerPool*> pools;
+	try
+	{
+		pTerrain = new Terrain();
+
+		//the calling thread takes items too
+		for( int numThreads = 1; numThreads <= maxThreads; ++numThreads )
+			pools.push_back( new WorkerPool( numThreads - 1 ) );
+	}
+	catch( std::bad_alloc& )
+	{
+		printf( "  out of memory\n" );
+		for( unsigned int pool = 0; pool < pools.size(); ++pool )
+			delete pools[ pool ];
+		delete pTerrain;
+		return false;
+	}
+
+	bool passed = true;
+	unsigned int numCells = 0;
+	std::vector<unsigned int> serialCells;
+	for( int pose = 0; pose < CULL_POSES && passed; ++pose )
+	{
+		Camera camera;
+		SetCullPose( pose, pTerrain->GetTerrainSize(), pTerrain, camera );
+
+		pTerrain->SetWorkerPool( NULL );
+		pTerrain->CullQuadtree( camera );
+		serialCells = pTerrain->GetFrustumCellList();
+		numCells += unsigned( serialCells.size() );
+
+		for( unsigned int pool = 0; pool < pools.size() && passed; ++pool )
+		{
+			pTerrain->SetWorkerPool( pools[ pool ] );
+			for( int repeat = 0; repeat < PARALLEL_REPEATS && passed; ++repeat )
+			{
+				pTerrain->CullQuadtree( camera );
+				if( pTerrain->GetFrustumCellList() != serialCells )
+				{
+					printf( "  pose %d: %u cells culled by %u threads, %u by the caller alone\n",
+							pose, unsigned( pTerrain->GetFrustumCellList().size() ), pool + 1,
+							unsigned( serialCells.size() ) );
+					passed = false;
+				}
+			}
+		}
+	}
+
+	if( passed )
+	{
+		printf( "  %d poses on 1 to %d threads, %u cells in the frustum\n", CULL_POSES,
+				maxThreads, numCells );
+	}
+
+	//the terrain does not own the pools
+	pTerrain->SetWorkerPool( NULL );
+	for( unsigned int pool = 0; pool < pools.size(); ++pool )
+		delete pools[ pool ];
+	delete pTerrain;
+	return passed && numCells > 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckCellDraws()
+// Desc: Culls the terrain from each pose with the draws merged and then not,
+//		 and checks that each way the draw calls cover every visible cell
+//		 exactly once and nothing else
+//------------------------------------------------------------------------------
+static bool CheckCellDraws()
+{
+	Terrain* pTerrain = NULL;
+	try{ pTerrain = new Terrain(); }
+	catch( std::bad_alloc& )
+	{
+		printf( "  out of memory\n" );
+		return false;
+	}
+
+	bool passed = true;
+	unsigned int numVisible = 0;
+	unsigned int numDraws[ 2 ] = { 0, 0 };
+	std::vector<unsigned int> visibleCells;
+	std::vector<unsigned int> drawnCells;
+	for( int pose = 0; pose < CULL_POSES && passed; ++pose )
+	{
+		Camera camera;
+		SetCullPose( pose, pTerrain->GetTerrainSize(), pTerrain, camera );
+
+		for( int merged = 0; merged < 2 && passed; ++merged )
+		{
+			pTerrain->SetMergedDraws( merged != 0 );
+			pTerrain->CullQuadtree( camera );
+
+			visibleCells = pTerrain->GetVisibleCellList();
+			pTerrain->GetDrawnCells( drawnCells );
+			std::sort( visibleCells.begin(), visibleCells.end() );
+			std::sort( drawnCells.begin(), drawnCells.end() );
+			if( std::adjacent_find( visibleCells.begin(), visibleCells.end() ) !=
+					visibleCells.end() ||
+				drawnCells != visibleCells )
+			{
+				printf( "  pose %d, %s: %u visible cells, %u cells in %u draws\n", pose,
+						merged ? "merged" : "unmerged", unsigned( visibleCells.size() ),
+						unsigned( drawnCells.size() ), pTerrain->GetCellDraws() );
+				passed = false;
+			}
+			numDraws[ merged ] += pTerrain->GetCellDraws();
+		}
+		numVisible += pTerrain->GetVisibleCells();
+	}
+
+	if( passed )
+	{
+		printf( "  %u visible cells from %d poses, in %u draws merged and %u not\n",
+				numVisible, CULL_POSES, numDraws[ 1 ], numDraws[ 0 ] );
+	}
+
+	delete pTerrain;
+	return passed && numDraws[ 1 ] < numDraws[ 0 ];
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckLooseQuadtreeRemove()
+// Desc: Removes an object from a loose quadtree twice, then adds two more, and
+//		 checks they get handles of their own and are both found - a handle
+//		 freed twice would be given out to both
+//------------------------------------------------------------------------------
+static bool CheckLooseQuadtreeRemove()
+{
+	LooseQuadtree tree( 32, 160.0f );
+	const Vector3 vSize( 6.0f, 3.0f, 6.0f );
+	const Vector3 vFirst( 100.0f, 20.0f, 100.0f );
+	const Vector3 vSecond( 3000.0f, 20.0f, 3000.0f );
+
+	const int handle = tree.Insert( vFirst, vFirst + vSize, 1 );
+	tree.Remove( handle );
+	tree.Remove( handle );
+	tree.Update( handle, vSecond, vSecond + vSize );
+
+	const int first = tree.Insert( vFirst, vFirst + vSize, 2 );
+	const int second = tree.Insert( vSecond, vSecond + vSize, 3 );
+	if( first == second )
+	{
+		printf( "  both objects were given handle %d\n", first );
+		return false;
+	}
+
+	std::vector<unsigned int> idList;
+	tree.QueryBox( Vector3( 0.0f, 0.0f, 0.0f ), Vector3( 5120.0f, 100.0f, 5120.0f ), idList );
+	if( tree.GetNumObjects() != 2 || idList.size() != 2 )
+	{
+		printf( "  %u objects in the tree, %u found - expected 2\n", tree.GetNumObjects(),
+				unsigned( idList.size() ) );
+		return false;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckFloatingOrigin()
+// Desc: Drives the simulation across the tiled terrain until the vehicle has
+//		 covered 100km, rebasing the origin after each frame as the app does,
+//		 and checks that the vehicle stays close to the origin, finite and
+//		 above the terrain all the way. The same drive is run alongside with
+//		 the origin 100km further out, and the vehicle must follow the same
+//		 path relative to it.
+//------------------------------------------------------------------------------
+static bool CheckFloatingOrigin()
+{
+	Simulation simulation;
+	Simulation farSimulation;
+	if( FAILED( simulation.Create( 1, APP_STEPS_PER_SECOND ) ) ||
+		FAILED( farSimulation.Create( 1, APP_STEPS_PER_SECOND ) ) )
+	{
+		printf( "  could not create the simulation\n" );
+		return false;
+	}
+	Terrain* pTerrain = simulation.GetTerrain();
+	Terrain* pFarTerrain = farSimulation.GetTerrain();
+	const Vehicle* pVehicle = simulation.GetVehicle();
+	const Vehicle* pFarVehicle = farSimulation.GetVehicle();
+	const float maxLocal = MAX_ORIGIN_CELLS * pTerrain->GetCellSize();
+
+	pTerrain->SetTiled( true );
+	pFarTerrain->SetTiled( true );
+	pFarTerrain->SetOrigin( pTerrain->GetOriginX() + FAR_ORIGIN_CELLS,
+							pTerrain->GetOriginZ() + FAR_ORIGIN_CELLS );
+	const int startX = pTerrain->GetOriginX();
+	const int startZ = pTerrain->GetOriginZ();
+
+	double distance = 0.0;
+	int numRebases = 0;
+	int frame = 0;
+	int maxOriginCells = 0;
+	float maxPositionError = 0.0f;
+	float maxOrientationError = 0.0f;
+	Vector3 vPrevious = pVehicle->GetPosition();
+	for( ; frame < DRIFT_MAX_FRAMES && distance < DRIFT_DISTANCE; ++frame )
+	{
+		const unsigned char controls = Simulation::CONTROL_FORWARD;
+		simulation.Advance( DRIFT_FRAME_TIME, controls );
+		farSimulation.Advance( DRIFT_FRAME_TIME, controls );
+
+		const Vector3 vMove = pVehicle->GetPosition() - vPrevious;
+		distance += sqrt( double( vMove.x * vMove.x ) + double( vMove.z * vMove.z ) );
+
+		Vector3 vShift;
+		if( simulation.RebaseOrigin( vShift ) )
+			++numRebases;
+		farSimulation.RebaseOrigin( vShift );
+
+		const Vector3 vPosition = pVehicle->GetPosition();
+		const float clearance = vPosition.y - pTerrain->GetHeightMapPoint( vPosition.x,
+																		   vPosition.z );
+		if( ! ( fabsf( vPosition.x ) <= maxLocal ) || ! ( fabsf( vPosition.z ) <= maxLocal ) ||
+			! ( clearance >= 0.0f ) )
+		{
+			printf( "  after %.0fm the vehicle is at (%.2f, %.2f, %.2f) from origin cell "
+					"(%d, %d), %.2f above the terrain\n", distance, vPosition.x, vPosition.y,
+					vPosition.z, pTerrain->GetOriginX(), pTerrain->GetOriginZ(), clearance );
+			return false;
+		}
+		vPrevious = vPosition;
+
+		//the far run must be the same, relative to its origin
+		const Quaternion& q = pVehicle->GetPhysicsState().qOrientation;
+		const Quaternion& qFar = pFarVehicle->GetPhysicsState().qOrientation;
+		const float positionError = Vec3Length( pFarVehicle->GetPosition() - vPosition );
+		const float orientationError = 1.0f - fabsf( QuaternionDot( q, qFar ) );
+		maxPositionError = max( maxPositionError, positionError );
+		maxOrientationError = max( maxOrientationError, orientationError );
+		if( pFarTerrain->GetOriginX() - pTerrain->GetOriginX() != FAR_ORIGIN_CELLS ||
+			pFarTerrain->GetOriginZ() - pTerrain->GetOriginZ() != FAR_ORIGIN_CELLS ||
+			! ( positionError <= FAR_ORIGIN_TOLERANCE ) ||
+			! ( orientationError <= FAR_ORIGIN_TOLERANCE ) )
+		{
+			printf( "  after %.0fm the run from origin cell (%d, %d) is %.4f away and %.6f "
+					"turned from the run from (%d, %d)\n", distance, pFarTerrain->GetOriginX(),
+					pFarTerrain->GetOriginZ(), positionError, orientationError,
+					pTerrain->GetOriginX(), pTerrain->GetOriginZ() );
+			return false;
+		}
+
+		maxOriginCells = max( maxOriginCells, max( abs( pTerrain->GetOriginX() - startX ),
+												   abs( pTerrain->GetOriginZ() - startZ ) ) );
+	}
+
+	printf( "  %.0fm in %d frames, the origin moved %d times, up to %d cells out - the run "
+			"%d cells further out was within %.4f and %.6f\n", distance, frame, numRebases,
+			maxOriginCells, FAR_ORIGIN_CELLS, maxPositionError, maxOrientationError );
+	if( distance < DRIFT_DISTANCE )
+	{
+		printf( "  the vehicle did not cover %.0fm\n", DRIFT_DISTANCE );
+		return false;
+	}
+
+	return numRebases > 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckFleetMatchesVehicle()
+// Desc: Drives a fleet of one vehicle, kept in the near tier, and a Vehicle
+//		 with the fleet's explicit Euler and no substeps side by side through
+//		 the script, from the same place, and checks that they stay together
+//------------------------------------------------------------------------------
+static bool CheckFleetMatchesVehicle()
+{
+	Terrain* pTerrain = NULL;
+	Vehicle* pVehicle = NULL;
+	VehicleFleet* pFleet = NULL;
+	try
+	{
+		pTerrain = new Terrain();
+		pVehicle = new Vehicle();
+		pFleet = new VehicleFleet( 1 );
+	}
+	catch( std::bad_alloc& )
+	{
+		printf( "  out of memory\n" );
+		delete pVehicle;
+		delete pTerrain;
+		return false;
+	}
+
+	const float timeInterval = 1.0f / float( APP_STEPS_PER_SECOND );
+	const float centre = pTerrain->GetTerrainSize() / 2.0f;
+	const Vector3 vStart( centre, pTerrain->GetHeightMapPoint( centre, centre ) + 3.0f, centre );
+	pVehicle->SetIntegrator( INTEGRATOR_EXPLICIT_EULER );
+	pVehicle->SetSubstepping( false );
+
+	//the centre is set first, or the vehicle would start in the far tier
+	pVehicle->SetPosition( vStart );
+	pFleet->SetLodCentre( vStart );
+	const int vehicle = pFleet->AddVehicle( vStart );
+
+	bool passed = true;
+	float worstDistance = 0.0f;
+	float worstRotation = 0.0f;
+	for( int step = 0; step < FLEET_SCRIPT_SEGMENTS * FLEET_SEGMENT_STEPS && passed; ++step )
+	{
+		const unsigned char controls = FLEET_SCRIPT[ step / FLEET_SEGMENT_STEPS ];
+		pVehicle->DoPhysics( timeInterval, pTerrain,
+							 ( controls & VehicleFleet::CONTROL_FORWARD ) != 0,
+							 ( controls & VehicleFleet::CONTROL_REVERSE ) != 0,
+							 ( controls & VehicleFleet::CONTROL_LEFT ) != 0,
+							 ( controls & VehicleFleet::CONTROL_RIGHT ) != 0 );
+
+		pFleet->SetControls( vehicle, controls );
+		pFleet->SetLodCentre( pFleet->GetPosition( vehicle ) );
+		pFleet->Step( timeInterval, pTerrain, NULL );
+
+		const float distance = Vec3Length( pFleet->GetPosition( vehicle ) -
+										   pVehicle->GetPosition() );
+		Matrix3 matFleetRotation;
+		pFleet->GetRotation( vehicle, matFleetRotation );
+		const Matrix3& matRotation = pVehicle->GetPhysicsState().matRotation;
+		float rotation = 0.0f;
+		for( int row = 0; row < 3; ++row )
+		{
+			for( int column = 0; column < 3; ++column )
+			{
+				rotation = max( rotation, fabsf( matFleetRotation( row, column ) -
+												 matRotation( row, column ) ) );
+			}
+		}
+		worstDistance = max( worstDistance, distance );
+		worstRotation = max( worstRotation, rotation );
+
+		if( distance > FLEET_POSITION_TOLERANCE || rotation > FLEET_ROTATION_TOLERANCE )
+		{
+			printf( "  step %d: the fleet's vehicle is %.4f away, its rotation out by %.4f\n",
+					step, distance, rotation );
+			passed = false;
+		}
+	}
+
+	if( passed )
+	{
+		printf( "  %d steps, at most %.4f apart and %.4f out in rotation, %.1f from the "
+				"start\n", FLEET_SCRIPT_SEGMENTS * FLEET_SEGMENT_STEPS, worstDistance,
+				worstRotation, Vec3Length( pVehicle->GetPosition() - vStart ) );
+	}
+
+	delete pFleet;
+	delete pVehicle;
+	delete pTerrain;
+	return passed;
+}
+
+//------------------------------------------------------------------------------
+// Name: StepSleepingFleet()
+// Desc: Steps the fleet and checks its slots, and that vehicles asleep before
+//		 the step have not moved, and ones that fell asleep in it were still
+//		 for long enough - on the ground, and moving no faster than a sleeping
+//		 vehicle may - counting the steps each has been still for
+//------------------------------------------------------------------------------
+static bool StepSleepingFleet( VehicleFleet* pFleet, const Terrain* pTerrain,
+							   const float timeInterval, std::vector<Vector3>& positions,
+							   std::vector<int>& stillSteps )
+{
+	std::vector<char> asleep( pFleet->GetNumVehicles() );
+	for( int vehicle = 0; vehicle < pFleet->GetNumVehicles(); ++vehicle )
+		asleep[ vehicle ] = pFleet->IsAsleep( vehicle ) ? 1 : 0;
+
+	pFleet->Step( timeInterval, pTerrain, NULL );
+
+	if( ! pFleet->CheckSlots() )
+	{
+		printf( "  the fleet's slots are out of order\n" );
+		return false;
+	}
+
+	//a little over, for rounding
+	const float maxMove = FLEET_SLEEP_SPEED * timeInterval * 1.001f;
+	int numAwake = 0;
+	for( int vehicle = 0; vehicle < pFleet->GetNumVehicles(); ++vehicle )
+	{
+		const Vector3 vPosition = pFleet->GetPosition( vehicle );
+		if( asleep[ vehicle ] == 0 )
+		{
+			const bool still = pFleet->IsOnGround( vehicle ) &&
+							   Vec3Length( vPosition - positions[ vehicle ] ) <= maxMove;
+			stillSteps[ vehicle ] = still ? ( stillSteps[ vehicle ] + 1 ) : 0;
+		}
+
+		if( ! pFleet->IsAsleep( vehicle ) )
+			++numAwake;
+		else if( asleep[ vehicle ] != 0 && ! ( vPosition == positions[ vehicle ] ) )
+		{
+			printf( "  vehicle %d moved in its sleep\n", vehicle );
+			return false;
+		}
+		else if( asleep[ vehicle ] == 0 && stillSteps[ vehicle ] < FLEET_SLEEP_STEPS )
+		{
+			printf( "  vehicle %d fell asleep after being still for %d steps\n", vehicle,
+					stillSteps[ vehicle ] );
+			return false;
+		}
+
+		positions[ vehicle ] = vPosition;
+	}
+
+	if( numAwake != pFleet->GetNumAwake() )
+	{
+		printf( "  %d vehicles are awake, but the fleet counts %d\n", numAwake,
+				pFleet->GetNumAwake() );
+		return false;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckFleetSleep()
+// Desc: Leaves a grid of idle vehicles to settle and sleep, while drivers go
+//		 round in circles across the tiers, then wakes one with its controls
+//		 and one with a box around it, and checks that no others wake and that
+//		 the one woken at rest sleeps again once it has been still for long
+//		 enough
+//------------------------------------------------------------------------------
+static bool CheckFleetSleep()
+{
+	const int numIdle = FLEET_IDLE_DIM * FLEET_IDLE_DIM;
+	const int numVehicles = numIdle + FLEET_DRIVERS;
+
+	Terrain* pTerrain = NULL;
+	VehicleFleet* pFleet = NULL;
+	try
+	{
+		pTerrain = new Terrain();
+		pFleet = new VehicleFleet( numVehicles );
+	}
+	catch( std::bad_alloc& )
+	{
+		printf( "  out of memory\n" );
+		delete pTerrain;
+		return false;
+	}
+
+	const float timeInterval = 1.0f / float( APP_STEPS_PER_SECOND );
+	const float middle = pTerrain->GetTerrainSize() / 2.0f;
+	const Vector3 vCentre( middle, pTerrain->GetHeightMapPoint( middle, middle ), middle );
+	pFleet->SetLodCentre( vCentre );
+
+	//the idle vehicles are the first ones added
+	const float gridStart = -0.5f * FLEET_IDLE_SPACING * float( FLEET_IDLE_DIM - 1 );
+	for( int vehicle = 0; vehicle < numIdle; ++vehicle )
+	{
+		const float x = middle + gridStart + ( FLEET_IDLE_SPACING * float( vehicle % FLEET_IDLE_DIM ) );
+		const float z = middle + gridStart + ( FLEET_IDLE_SPACING * float( vehicle / FLEET_IDLE_DIM ) );
+		pFleet->AddVehicle( Vector3( x, pTerrain->GetHeightMapPoint( x, z ) + 2.0f, z ) );
+	}
+
+	for( int driver = 0; driver < FLEET_DRIVERS; ++driver )
+	{
+		const float x = middle + FLEET_DRIVER_DISTANCES[ driver ];
+		const int vehicle = pFleet->AddVehicle(
+			Vector3( x, pTerrain->GetHeightMapPoint( x, middle ) + 2.0f, middle ) );
+		pFleet->SetControls( vehicle, VehicleFleet::CONTROL_FORWARD | VehicleFleet::CONTROL_LEFT );
+	}
+
+	std::vector<Vector3> positions( numVehicles );
+	std::vector<int> stillSteps( numVehicles, 0 );
+	for( int vehicle = 0; vehicle < numVehicles; ++vehicle )
+		positions[ vehicle ] = pFleet->GetPosition( vehicle );
+
+	//the idle vehicles settle, and the ones that come to rest sleep
+	bool passed = pFleet->CheckSlots();
+	int tierChanges = 0;
+	int lastNear = pFleet->GetNumInTier( VehicleFleet::TIER_NEAR );
+	for( int step = 0; step < FLEET_SETTLE_STEPS && passed; ++step )
+	{
+		passed = StepSleepingFleet( pFleet, pTerrain, timeInterval, positions, stillSteps );
+
+		const int numNear = pFleet->GetNumInTier( VehicleFleet::TIER_NEAR );
+		tierChanges += ( numNear != lastNear ) ? 1 : 0;
+		lastNear = numNear;
+	}
+
+	int numIdleAsleep = 0;
+	for( int vehicle = 0; vehicle < numIdle; ++vehicle )
+		numIdleAsleep += pFleet->IsAsleep( vehicle ) ? 1 : 0;
+
+	//one sleeping vehicle to wake with its controls, and one with a box
+	int inputVehicle = -1;
+	int boxVehicle = -1;
+	for( int vehicle = 0; vehicle < numIdle && boxVehicle < 0; ++vehicle )
+	{
+		if( ! pFleet->IsAsleep( vehicle ) )
+			continue;
+		if( inputVehicle < 0 )
+			inputVehicle = vehicle;
+		else
+			boxVehicle = vehicle;
+	}
+
+	if( passed && boxVehicle < 0 )
+	{
+		printf( "  only %d of %d idle vehicles went to sleep\n", numIdleAsleep, numIdle );
+		passed = false;
+	}
+
+	//controls wake a vehicle straight away, into the near tier, and it drives
+	//off
+	if( passed )
+	{
+		const unsigned int numWakes = pFleet->GetNumWakes();
+		const int numNear = pFleet->GetNumInTier( VehicleFleet::TIER_NEAR );
+		const Vector3 vStart = pFleet->GetPosition( inputVehicle );
+		pFleet->SetControls( inputVehicle, VehicleFleet::CONTROL_FORWARD );
+		stillSteps[ inputVehicle ] = 0;
+		if( pFleet->IsAsleep( inputVehicle ) || pFleet->GetNumWakes() != numWakes + 1 ||
+			pFleet->GetNumInTier( VehicleFleet::TIER_NEAR ) != numNear + 1 ||
+			! pFleet->CheckSlots() )
+		{
+			printf( "  the controls did not wake vehicle %d\n", inputVehicle );
+			passed = false;
+		}
+
+		for( int step = 0; step < FLEET_WAKE_DRIVE_STEPS && passed; ++step )
+			passed = StepSleepingFleet( pFleet, pTerrain, timeInterval, positions, stillSteps );
+		pFleet->SetControls( inputVehicle, 0 );
+
+		const float distance = Vec3Length( pFleet->GetPosition( inputVehicle ) - vStart );
+		if( passed && distance < FLEET_WAKE_DRIVE_DISTANCE )
+		{
+			printf( "  vehicle %d only drove %.2f once woken\n", inputVehicle, distance );
+			passed = false;
+		}
+	}
+
+	//a box wakes the sleeping vehicles over it and no others, and a box away
+	//from all of them wakes none
+	if( passed )
+	{
+		const unsigned int numWakes = pFleet->GetNumWakes();
+		const Vector3 vBox = pFleet->GetPosition( boxVehicle );
+		std::vector<char> asleep( numVehicles );
+		for( int vehicle = 0; vehicle < numVehicles; ++vehicle )
+			asleep[ vehicle ] = pFleet->IsAsleep( vehicle ) ? 1 : 0;
+
+		pFleet->WakeInBox( vBox.x - FLEET_WAKE_BOX_SIZE, vBox.z - FLEET_WAKE_BOX_SIZE,
+						   vBox.x + FLEET_WAKE_BOX_SIZE, vBox.z + FLEET_WAKE_BOX_SIZE );
+		pFleet->WakeInBox( middle - FLEET_WAKE_BOX_SIZE, -middle - FLEET_WAKE_BOX_SIZE,
+						   middle + FLEET_WAKE_BOX_SIZE, -middle + FLEET_WAKE_BOX_SIZE );
+
+		unsigned int numWoken = 0;
+		for( int vehicle = 0; vehicle < numVehicles && passed; ++vehicle )
+		{
+			if( asleep[ vehicle ] == 0 )
+				continue;
+
+			const Vector3 vPosition = pFleet->GetPosition( vehicle );
+			const float outside = max( fabsf( vPosition.x - vBox.x ),
+									   fabsf( vPosition.z - vBox.z ) ) - FLEET_WAKE_BOX_SIZE;
+			if( ! pFleet->IsAsleep( vehicle ) )
+			{
+				stillSteps[ vehicle ] = 0;
+				++numWoken;
+			}
+
+			if( outside <= 0.0f && pFleet->IsAsleep( vehicle ) )
+			{
+				printf( "  vehicle %d slept through the box over it\n", vehicle );
+				passed = false;
+			}
+			else if( outside > FLEET_WAKE_REACH && ! pFleet->IsAsleep( vehicle ) )
+			{
+				printf( "  vehicle %d woke for a box %.2f away\n", vehicle, outside );
+				passed = false;
+			}
+		}
+
+		if( passed && ( pFleet->GetNumWakes() != numWakes + numWoken || ! pFleet->CheckSlots() ) )
+		{
+			printf( "  %u vehicles woke, but the fleet counts %u\n", numWoken,
+					pFleet->GetNumWakes() - numWakes );
+			passed = false;
+		}
+	}
+
+	//the vehicle woken by the box settles and sleeps again
+	int resleepSteps = 0;
+	while( passed && ! pFleet->IsAsleep( boxVehicle ) && resleepSteps < FLEET_SETTLE_STEPS )
+	{
+		passed = StepSleepingFleet( pFleet, pTerrain, timeInterval, positions, stillSteps );
+		++resleepSteps;
+	}
+
+	if( passed && ! pFleet->IsAsleep( boxVehicle ) )
+	{
+		printf( "  vehicle %d did not sleep again once woken\n", boxVehicle );
+		passed = false;
+	}
+
+	if( passed )
+	{
+		printf( "  %d of %d idle vehicles asleep after %ds, with the near tier changing "
+				"%d times, and vehicle %d asleep again %d steps after the box\n",
+				numIdleAsleep, numIdle, FLEET_SETTLE_STEPS / APP_STEPS_PER_SECOND,
+				tierChanges, boxVehicle, resleepSteps );
+	}
+
+	delete pFleet;
+	delete pTerrain;
+	return passed;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckFleetTiers()
+// Desc: Drives the same vehicle in two fleets, one moving it through the tiers
+//		 by where it puts the centre and one keeping it near, and checks that
+//		 the reported position jumps no more across the tiers than it does
+//		 kept near
+//------------------------------------------------------------------------------
+static bool CheckFleetTiers()
+{
+	Terrain* pTerrain = NULL;
+	VehicleFleet* pFleets[ 2 ] = { NULL, NULL };
+	try
+	{
+		pTerrain = new Terrain();
+		pFleets[ 0 ] = new VehicleFleet( 1 );
+		pFleets[ 1 ] = new VehicleFleet( 1 );
+	}
+	catch( std::bad_alloc& )
+	{
+		printf( "  out of memory\n" );
+		delete pFleets[ 0 ];
+		delete pTerrain;
+		return false;
+	}
+
+	const float timeInterval = 1.0f / float( APP_STEPS_PER_SECOND );
+	const float middle = pTerrain->GetTerrainSize() / 2.0f;
+	const Vector3 vStart( middle, pTerrain->GetHeightMapPoint( middle, middle ) + 3.0f, middle );
+
+	//the first fleet is the one kept near
+	Vector3 vPositions[ 2 ][ 3 ];
+	for( int fleet = 0; fleet < 2; ++fleet )
+	{
+		pFleets[ fleet ]->SetLodCentre( vStart );
+		pFleets[ fleet ]->AddVehicle( vStart );
+		pFleets[ fleet ]->SetControls( 0, VehicleFleet::CONTROL_FORWARD | VehicleFleet::CONTROL_LEFT );
+	}
+
+	//the jumps kept near, and in each tier just after moving into it and after
+	float worstNear = 0.0f;
+	float worstChanges[ FLEET_TIER_SEGMENTS ];
+	float worstJumps[ FLEET_TIER_SEGMENTS ];
+	for( int segment = 0; segment < FLEET_TIER_SEGMENTS; ++segment )
+		worstChanges[ segment ] = worstJumps[ segment ] = 0.0f;
+
+	bool passed = true;
+	for( int step = 0; step < FLEET_TIER_SEGMENTS * FLEET_TIER_SEGMENT_STEPS; ++step )
+	{
+		const int segment = step / FLEET_TIER_SEGMENT_STEPS;
+		for( int fleet = 0; fleet < 2; ++fleet )
+		{
+			VehicleFleet* pFleet = pFleets[ fleet ];
+			const float height = ( fleet == 0 ) ? 0.0f : FLEET_TIER_HEIGHTS[ segment ];
+			pFleet->SetLodCentre( pFleet->GetPosition( 0 ) + Vector3( 0.0f, height, 0.0f ) );
+			pFleet->Step( timeInterval, pTerrain, NULL );
+
+			vPositions[ fleet ][ 0 ] = vPositions[ fleet ][ 1 ];
+			vPositions[ fleet ][ 1 ] = vPositions[ fleet ][ 2 ];
+			vPositions[ fleet ][ 2 ] = pFleet->GetPosition( 0 );
+			if( step < 2 )
+				continue;
+
+			const float jump = Vec3Length( vPositions[ fleet ][ 2 ] -
+										   ( vPositions[ fleet ][ 1 ] * 2.0f ) +
+										   vPositions[ fleet ][ 0 ] );
+			if( fleet == 0 )
+				worstNear = max( worstNear, jump );
+			else if( step % FLEET_TIER_SEGMENT_STEPS < FLEET_TIER_CHANGE_STEPS )
+				worstChanges[ segment ] = max( worstChanges[ segment ], jump );
+			else
+				worstJumps[ segment ] = max( worstJumps[ segment ], jump );
+		}
+
+		//it moves tier the next time it is stepped
+		if( ( step + 1 ) % FLEET_TIER_SEGMENT_STEPS == 0 &&
+			pFleets[ 1 ]->GetNumInTier( FLEET_TIER_TIERS[ segment ] ) != 1 )
+		{
+			printf( "  step %d: the vehicle is not in tier %d\n", step,
+					FLEET_TIER_TIERS[ segment ] );
+			passed = false;
+			break;
+		}
+	}
+
+	for( int segment = 0; segment < FLEET_TIER_SEGMENTS && passed; ++segment )
+	{
+		const float maxJump = FLEET_TIER_MAX_JUMPS[ FLEET_TIER_TIERS[ segment ] ];
+		const float maxChange = ( segment == 0 ) ? maxJump :
+			max( maxJump, FLEET_TIER_MAX_JUMPS[ FLEET_TIER_TIERS[ segment - 1 ] ] );
+
+		printf( "  tier %d: jumps of up to %.3f, and %.3f moving into it\n",
+				FLEET_TIER_TIERS[ segment ], worstJumps[ segment ], worstChanges[ segment ] );
+		if( worstJumps[ segment ] > maxJump || worstChanges[ segment ] > maxChange )
+			passed = false;
+	}
+
+	if( passed )
+		printf( "  kept near: jumps of up to %.3f\n", worstNear );
+
+	delete pFleets[ 1 ];
+	delete pFleets[ 0 ];
+	delete pTerrain;
+	return passed;
+}
+
+//------------------------------------------------------------------------------
+// Name: IsSameVehicle()
+// Desc: Tests whether a vehicle is in exactly the same state in two fleets
+//------------------------------------------------------------------------------
+static bool IsSameVehicle( const VehicleFleet* pFleetA, const VehicleFleet* pFleetB,
+						   const int vehicle )
+{
+	if( ! ( pFleetA->GetPosition( vehicle ) == pFleetB->GetPosition( vehicle ) ) ||
+		! ( pFleetA->GetVelocity( vehicle ) == pFleetB->GetVelocity( vehicle ) ) ||
+		pFleetA->IsOnGround( vehicle ) != pFleetB->IsOnGround( vehicle ) ||
+		pFleetA->IsAsleep( vehicle ) != pFleetB->IsAsleep( vehicle ) )
+		return false;
+
+	Matrix3 matRotationA, matRotationB;
+	pFleetA->GetRotation( vehicle, matRotationA );
+	pFleetB->GetRotation( vehicle, matRotationB );
+	for( int row = 0; row < 3; ++row )
+	{
+		for( int column = 0; column < 3; ++column )
+		{
+			if( matRotationA( row, column ) != matRotationB( row, column ) )
+				return false;
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckFleetPool()
+// Desc: Steps the same fleet on its own and on worker pools with one thread up
+//		 to several, while the centre moves across it, and checks that every
+//		 vehicle ends each step in exactly the same state on every pool
+//------------------------------------------------------------------------------
+static bool CheckFleetPool()
+{
+	const int maxThreads = min( max( PARALLEL_THREADS, WorkerPool::GetNumProcessors() ),
+								WorkerPool::MAX_THREADS + 1 );
+	const int numVehicles = FLEET_POOL_DIM * FLEET_POOL_DIM;
+
+	//the first fleet is stepped on the calling thread, and each other on the
+	//pool before it
+	Terrain* pTerrain = NULL;
+	std::vector<WorkerPool*> pools;
+	std::vector<VehicleFleet*> fleets;
+	try
+	{
+		pTerrain = new Terrain();
+		fleets.push_back( new VehicleFleet( numVehicles ) );
+		for( int numThreads = 1; numThreads <= maxThreads; ++numThreads )
+		{
+			pools.push_back( new WorkerPool( numThreads - 1 ) );
+			fleets.push_back( new VehicleFleet( numVehicles ) );
+		}
+	}
+	catch( std::bad_alloc& )
+	{
+		printf( "  out of memory\n" );
+		for( unsigned int fleet = 0; fleet < fleets.size(); ++fleet )
+			delete fleets[ fleet ];
+		for( unsigned int pool = 0; pool < pools.size(); ++pool )
+			delete pools[ pool ];
+		delete pTerrain;
+		return false;
+	}
+
+	const float timeInterval = 1.0f / float( APP_STEPS_PER_SECOND );
+	const float middle = pTerrain->GetTerrainSize() / 2.0f;
+	const float gridStart = middle - ( 0.5f * FLEET_POOL_SPACING * float( FLEET_POOL_DIM - 1 ) );
+	for( unsigned int fleet = 0; fleet < fleets.size(); ++fleet )
+	{
+		fleets[ fleet ]->SetLodCentre( Vector3( gridStart, 0.0f, gridStart ) );
+		for( int vehicle = 0; vehicle < numVehicles; ++vehicle )
+		{
+			const float x = gridStart + ( FLEET_POOL_SPACING * float( vehicle % FLEET_POOL_DIM ) );
+			const float z = gridStart + ( FLEET_POOL_SPACING * float( vehicle / FLEET_POOL_DIM ) );
+			fleets[ fleet ]->AddVehicle(
+				Vector3( x, pTerrain->GetHeightMapPoint( x, z ) + 2.0f, z ) );
+			fleets[ fleet ]->SetControls( vehicle,
+				FLEET_SCRIPT[ vehicle % FLEET_SCRIPT_SEGMENTS ] );
+		}
+	}
+
+	//the centre crosses the grid from corner to corner
+	bool passed = true;
+	int numStepped = 0;
+	for( int step = 0; step < FLEET_POOL_STEPS && passed; ++step )
+	{
+		const float along = float( step ) / float( FLEET_POOL_STEPS - 1 );
+		const float centre = gridStart + ( along * FLEET_POOL_SPACING * float( FLEET_POOL_DIM - 1 ) );
+		for( unsigned int fleet = 0; fleet < fleets.size(); ++fleet )
+		{
+			fleets[ fleet ]->SetLodCentre( Vector3( centre, 0.0f, centre ) );
+			fleets[ fleet ]->Step( timeInterval, pTerrain,
+								   ( fleet == 0 ) ? NULL : pools[ fleet - 1 ] );
+		}
+		numStepped += fleets[ 0 ]->GetNumStepped();
+
+		for( unsigned int fleet = 1; fleet < fleets.size() && passed; ++fleet )
+		{
+			for( int vehicle = 0; vehicle < numVehicles && passed; ++vehicle )
+			{
+				if( ! IsSameVehicle( fleets[ 0 ], fleets[ fleet ], vehicle ) )
+				{
+					printf( "  step %d: vehicle %d differs on a pool of %u threads\n", step,
+							vehicle, fleet );
+					passed = false;
+				}
+			}
+
+			for( int tier = 0; tier < VehicleFleet::NUM_TIERS && passed; ++tier )
+			{
+				if( fleets[ fleet ]->GetNumInTier( tier ) != fleets[ 0 ]->GetNumInTier( tier ) )
+				{
+					printf( "  step %d: tier %d differs on a pool of %u threads\n", step,
+							tier, fleet );
+					passed = false;
+				}
+			}
+		}
+	}
+
+	if( passed )
+	{
+		printf( "  %d vehicles on 1 to %d threads, %d steps, %d vehicle steps, %u sleeps\n",
+				numVehicles, maxThreads, FLEET_POOL_STEPS, numStepped,
+				fleets[ 0 ]->GetNumSleeps() );
+	}
+
+	for( unsigned int fleet = 0; fleet < fleets.size(); ++fleet )
+		delete fleets[ fleet ];
+	for( unsigned int pool = 0; pool < pools.size(); ++pool )
+		delete pools[ pool ];
+	delete pTerrain;
+	return passed;
+}
+
+//------------------------------------------------------------------------------
+// Name: GetScriptElapsedTime()
+// Desc: Finds the time a frame of the replay script takes
+//------------------------------------------------------------------------------
+static float GetScriptElapsedTime( const int frame )
+{
+	return 0.01f + ( 0.002f * float( frame % 7 ) );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetScriptControls()
+// Desc: Finds the controls the replay script gives a frame
+//------------------------------------------------------------------------------
+static unsigned char GetScriptControls( const int frame )
+{
+	return REPLAY_SCRIPT[ ( frame / REPLAY_CONTROL_FRAMES ) % REPLAY_SCRIPT_LENGTH ];
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckReplay()
+// Desc: Records a scripted run, plays the recording back headless and checks
+//		 that it ends with the checksum the run ended with, then changes the
+//		 controls of one frame in the file and checks that the playback no
+//		 longer matches
+//------------------------------------------------------------------------------
+static bool CheckReplay()
+{
+	DWORD recordedChecksum;
+	{
+		Simulation simulation;
+		ReplayRecorder recorder;
+		if( FAILED( simulation.Create( REPLAY_SEED, APP_STEPS_PER_SECOND ) ) ||
+			! recorder.Open( REPLAY_FILE, REPLAY_SEED, APP_STEPS_PER_SECOND ) )
+		{
+			printf( "  could not create the simulation or the recording\n" );
+			return false;
+		}
+
+		for( int frame = 0; frame < REPLAY_FRAMES; ++frame )
+		{
+			const float elapsedTime = GetScriptElapsedTime( frame );
+			const unsigned char controls = GetScriptControls( frame );
+			simulation.Advance( elapsedTime, controls );
+			recorder.RecordFrame( elapsedTime, controls );
+
+			Vector3 vShift;
+			simulation.RebaseOrigin( vShift );
+		}
+
+		recordedChecksum = simulation.GetChecksum();
+		if( ! recorder.Close( recordedChecksum ) )
+		{
+			printf( "  could not write the recording\n" );
+			remove( REPLAY_FILE );
+			return false;
+		}
+	}
+
+	ReplayResult result;
+	if( ! PlayReplay( REPLAY_FILE, result ) )
+	{
+		printf( "  could not play the recording back\n" );
+		remove( REPLAY_FILE );
+		return false;
+	}
+	printf( "  %u frames, %u steps at %.0f steps a second, checksum %08lx, recorded %08lx\n",
+			result.numFrames, result.numSteps,
+			( result.seconds > 0.0 ) ? double( result.numSteps ) / result.seconds : 0.0,
+			(unsigned long)( result.checksum ), (unsigned long)( recordedChecksum ) );
+	printf( "  %u of %u cells in the frustum behind the horizon, at most %u in a frame\n",
+			result.occludedCells, result.frustumCells, result.maxOccludedCells );
+
+	bool passed = true;
+	if( result.numFrames != (unsigned int)( REPLAY_FRAMES ) ||
+		result.expectedChecksum != recordedChecksum || result.checksum != recordedChecksum )
+	{
+		printf( "  the playback does not match the run\n" );
+		passed = false;
+	}
+
+	//a different control halfway through must show in the checksum
+	FILE* pFile = fopen( REPLAY_FILE, "r+b" );
+	const unsigned char changed = Simulation::CONTROL_LEFT;
+	if( pFile == NULL ||
+		fseek( pFile, REPLAY_FRAME_OFFSET + ( REPLAY_FRAME_SIZE * ( REPLAY_FRAMES / 2 ) ) +
+					  REPLAY_FRAME_SIZE - 1, SEEK_SET ) != 0 ||
+		fwrite( &changed, sizeof( changed ), 1, pFile ) != 1 )
+	{
+		printf( "  could not change the recording\n" );
+		passed = false;
+	}
+	if( pFile != NULL )
+		fclose( pFile );
+
+	if( passed && ( ! PlayReplay( REPLAY_FILE, result ) || result.checksum == recordedChecksum ) )
+	{
+		printf( "  changing the controls of frame %d did not change the checksum\n",
+				REPLAY_FRAMES / 2 );
+		passed = false;
+	}
+
+	remove( REPLAY_FILE );
+	return passed;
+}
+
+//------------------------------------------------------------------------------
+// Name: RunImpact()
+// Desc: Starts a vehicle at a position and velocity with no thrust, and returns
+//		 the deepest its collision grid goes into the terrain after any step,
+//		 or a negative value if it leaves the world
+//------------------------------------------------------------------------------
+static float RunImpact( const Terrain* pTerrain, const Vector3& vPosition,
+						const Vector3& vVelocity, const int stepsPerSecond )
+{
+	Vehicle* pVehicle = NULL;
+	try{ pVehicle = new Vehicle(); }
+	catch( std::bad_alloc& )
+	{
+		return -1.0f;
+	}
+
+	pVehicle->SetPosition( vPosition );
+	VehiclePhysicsState state = pVehicle->GetPhysicsState();
+	state.vLinearVelocity = vVelocity;
+	pVehicle->SetPhysicsState( state );
+
+	const float timeInterval = 1.0f / float( stepsPerSecond );
+	const int numSteps = int( IMPACT_SECONDS * float( stepsPerSecond ) );
+	float worstDepth = 0.0f;
+	for( int step = 0; step < numSteps; ++step )
+	{
+		pVehicle->DoPhysics( timeInterval, pTerrain, false, false, false, false );
+		if( ! ( fabsf( pVehicle->GetPosition().y ) < 1e5f ) )
+		{
+			worstDepth = -1.0f;
+			break;
+		}
+		worstDepth = max( worstDepth, pVehicle->GetTerrainDepth( pTerrain ) );
+	}
+
+	delete pVehicle;
+	return worstDepth;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckRollback()
+// Desc: Runs the replay script through two simulations side by side, and after
+//		 each frame rolls one of them back by 1 to SNAPSHOT_FRAMES frames in
+//		 turn, and checks that running those frames again brings it back to
+//		 the checksum the other reached without. Some of the rollbacks must go
+//		 back past a move of the floating origin.
+//------------------------------------------------------------------------------
+static bool CheckRollback()
+{
+	Simulation straight;
+	Simulation rolled;
+	if( FAILED( straight.Create( REPLAY_SEED, APP_STEPS_PER_SECOND ) ) ||
+		FAILED( rolled.Create( REPLAY_SEED, APP_STEPS_PER_SECOND ) ) )
+	{
+		printf( "  could not create the simulations\n" );
+		return false;
+	}
+
+	//the frame the origin last moved after
+	int lastShiftFrame = -1;
+	int numRollbacks = 0;
+	int numAcrossShifts = 0;
+	for( int frame = 0; frame < REPLAY_FRAMES; ++frame )
+	{
+		const float elapsedTime = GetScriptElapsedTime( frame );
+		const unsigned char controls = GetScriptControls( frame );
+		Vector3 vShift;
+		straight.Advance( elapsedTime, controls );
+		if( straight.RebaseOrigin( vShift ) )
+			lastShiftFrame = frame;
+		rolled.Advance( elapsedTime, controls );
+		rolled.RebaseOrigin( vShift );
+
+		const int frames = 1 + ( frame % Simulation::SNAPSHOT_FRAMES );
+		if( frames > frame + 1 )
+			continue;
+
+		if( ! rolled.Rollback( frames ) )
+		{
+			printf( "  frame %d: could not roll back %d frames\n", frame, frames );
+			return false;
+		}
+		if( rolled.GetChecksum() != straight.GetChecksum() )
+		{
+			printf( "  frame %d: rolled back %d frames%s to checksum %08lx, run straight "
+					"%08lx\n", frame, frames,
+					( lastShiftFrame > frame - frames ) ? " across a move of the origin" : "",
+					(unsigned long)( rolled.GetChecksum() ),
+					(unsigned long)( straight.GetChecksum() ) );
+			return false;
+		}
+		++numRollbacks;
+		if( lastShiftFrame > frame - frames )
+			++numAcrossShifts;
+	}
+
+	printf( "  %d rollbacks of 1 to %d frames, %d of them across a move of the origin\n",
+			numRollbacks, Simulation::SNAPSHOT_FRAMES, numAcrossShifts );
+	return numAcrossShifts > 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckTerrainImpacts()
+// Desc: Finds the steepest rise on the terrain, then fires the vehicle
+//		 straight at it and dives it onto the slope above, at a spread of
+//		 speeds and step lengths, and checks that the collision grid never
+//		 ends a step deep in the terrain
+//------------------------------------------------------------------------------
+static bool CheckTerrainImpacts()
+{
+	const int NUM_SPEEDS = sizeof( IMPACT_SPEEDS ) / sizeof( IMPACT_SPEEDS[ 0 ] );
+	const int NUM_STEP_RATES = sizeof( IMPACT_STEP_RATES ) / sizeof( IMPACT_STEP_RATES[ 0 ] );
+
+	Terrain* pTerrain = NULL;
+	try{ pTerrain = new Terrain(); }
+	catch( std::bad_alloc& )
+	{
+		printf( "  out of memory\n" );
+		return false;
+	}
+
+	//the steepest rise along x, away from the edges
+	const float size = pTerrain->GetTerrainSize();
+	float rise = 0.0f;
+	float riseX = 0.0f;
+	float riseZ = 0.0f;
+	for( float x = 100.0f; x < size - 200.0f; x += 8.0f )
+	{
+		for( float z = 100.0f; z < size - 100.0f; z += 8.0f )
+		{
+			const float r = pTerrain->GetHeightMapPoint( x + RISE_RUN, z ) -
+							pTerrain->GetHeightMapPoint( x, z );
+			if( r > rise )
+			{
+				rise = r;
+				riseX = x;
+				riseZ = z;
+			}
+		}
+	}
+	printf( "  steepest rise %.1f over %.0f at (%.0f, %.0f)\n", rise, RISE_RUN, riseX, riseZ );
+
+	bool passed = true;
+	for( int rate = 0; rate < NUM_STEP_RATES; ++rate )
+	{
+		for( int speed = 0; speed < NUM_SPEEDS; ++speed )
+		{
+			const float v = IMPACT_SPEEDS[ speed ];
+
+			const float cliffX = riseX - 6.0f;
+			const Vector3 vCliff( cliffX, pTerrain->GetHeightMapPoint( cliffX, riseZ ) + 1.2f,
+								  riseZ );
+			const float cliffDepth = RunImpact( pTerrain, vCliff, Vector3( v, 0.0f, 0.0f ),
+												IMPACT_STEP_RATES[ rate ] );
+
+			//air resistance soon slows a long fall, so the dive starts low enough
+			//to reach the slope in the first step
+			const float diveX = riseX + ( RISE_RUN / 2.0f );
+			const float diveHeight = 1.2f + ( 0.5f * v / float( IMPACT_STEP_RATES[ rate ] ) );
+			const Vector3 vDive( diveX, pTerrain->GetHeightMapPoint( diveX, riseZ ) + diveHeight,
+								 riseZ );
+			const float diveDepth = RunImpact( pTerrain, vDive, Vector3( v * 0.3f, -v, 0.0f ),
+											   IMPACT_STEP_RATES[ rate ] );
+
+			printf( "  1/%-3d %5.0f a second: cliff %5.2f deep, dive %5.2f deep\n",
+					IMPACT_STEP_RATES[ rate ], v, cliffDepth, diveDepth );
+			if( cliffDepth < 0.0f || cliffDepth > MAX_TERRAIN_DEPTH ||
+				diveDepth < 0.0f || diveDepth > MAX_TERRAIN_DEPTH )
+				passed = false;
+		}
+	}
+
+	delete pTerrain;
+	return passed;
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckIntegratorStability()
+// Desc: Finds how large a step each integrator stays stable at, prints them
+//		 side by side, and checks that all of them are stable at the app's step
+//------------------------------------------------------------------------------
+static bool CheckIntegratorStability()
+{
+	bool passed = true;
+	for( int integrator = 0; integrator < NUM_INTEGRATORS; ++integrator )
+	{
+		StabilityResult result;
+		if( ! FindStableStep( Integrator( integrator ), result ) )
+		{
+			printf( "  %s: the reference run failed\n",
+					Vehicle::GetIntegratorName( Integrator( integrator ) ) );
+			passed = false;
+			continue;
+		}
+
+		printf( "  %-18s stable down to %4d steps a second, %8.0fus per simulated second "
+				"(%.0fus at %d)\n", result.integrator, result.stepsPerSecond,
+				result.secondsPerSecond * 1000000.0,
+				result.secondsPerSecondAtReference * 1000000.0,
+				result.referenceStepsPerSecond );
+		if( result.stepsPerSecond > APP_STEPS_PER_SECOND )
+		{
+			printf( "  %s is not stable at %d steps a second\n", result.integrator,
+					APP_STEPS_PER_SECOND );
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+//------------------------------------------------------------------------------
+// Name: main()
+// Desc: Entry point. Runs every check, or only those with "-filter <text>" in
+//		 their name, and fails if any of them does.
+//------------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	const Check CHECKS[] =
+	{
+		{ "shadow volume inside its bounds",	CheckShadowBounds },
+		{ "frustum kernels match the reference",	CheckFrustumKernels },
+		{ "views culled together match alone",	CheckCullViews },
+		{ "coherent cull matches the plain cull",	CheckCoherentCull },
+		{ "parallel cull matches the serial cull",	CheckParallelCull },
+		{ "draws cover each visible cell once",		CheckCellDraws },
+		{ "loose quadtree ignores a second remove",	CheckLooseQuadtreeRemove },
+		{ "every integrator stable at the app's step",	CheckIntegratorStability },
+		{ "100km drive with the floating origin",	CheckFloatingOrigin },
+		{ "fleet keeps to the single vehicle",	CheckFleetMatchesVehicle },
+		{ "fleet vehicles sleep and wake",	CheckFleetSleep },
+		{ "fleet moves between tiers without popping",	CheckFleetTiers },
+		{ "fleet steps the same on a worker pool",	CheckFleetPool },
+		{ "replay plays back to the recorded checksum",	CheckReplay },
+		{ "rollback runs again to the same checksum",	CheckRollback },
+		{ "no deep impacts with the terrain",	CheckTerrainImpacts },
+	};
+	const int NUM_CHECKS = sizeof( CHECKS ) / sizeof( CHECKS[ 0 ] );
+
+	const char* filter = NULL;
+	for( int arg = 1; arg < argc; ++arg )
+	{
+		if( strcmp( argv[ arg ], "-filter" ) == 0 && arg + 1 < argc )
+			filter = argv[ ++arg ];
+		else
+		{
+			fprintf( stderr, "usage: %s [-filter <text>]\n", argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	int numFailed = 0;
+	for( int check = 0; check < NUM_CHECKS; ++check )
+	{
+		if( filter != NULL && strstr( CHECKS[ check ].name, filter ) == NULL )
+			continue;
+
+		printf( "%s\n", CHECKS[ check ].name );
+		fflush( stdout );
+		if( CHECKS[ check ].pFunction() )
+			printf( "  ok\n" );
+		else
+		{
+			printf( "  FAILED\n" );
+			++numFailed;
+		}
+	}
+
+	if( numFailed > 0 )
+	{
+		printf( "\n%d check%s failed\n", numFailed, ( numFailed > 1 ) ? "s" : "" );
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+//------------------------------------------------------------------------------
+// File: CullStats.h
+// Desc: Counters describing the work done by a terrain cull, for tuning
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_CULLSTATS_H
+#define INCLUSIONGUARD_CULLSTATS_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <string.h>
+
+//the counters are only collected if this is defined - otherwise the code that
+//fills them in is compiled out, and they stay at zero
+#if defined( HOVERCRAFT_CULL_STATS )
+	#define CULLSTATS_ENABLED
+#endif
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: struct CullStats
+// Desc: The quadtree fills in the traversal counters, and the terrain the rest
+//------------------------------------------------------------------------------
+struct CullStats
+{
+	//quadtree traversal
+	unsigned int nodesVisited;			//nodes whose four children were tested
+	unsigned int planeTests;			//box/plane tests done
+	unsigned int planeTestsSaved;		//tests a coherent cull found it could skip
+	unsigned int nodesAcceptedWhole;	//nodes added without testing anything below
+	unsigned int leavesAcceptedWhole;	//leaves below those nodes
+	unsigned int leavesRejected[ 6 ];	//leaves below the nodes rejected by each of
+										//the left, right, top, bottom, near and far
+										//planes
+
+	//terrain
+	unsigned int frustumCells;
+	unsigned int occludedCells;
+	unsigned int visibleCells;
+	unsigned int cellDraws;
+	float traversalTime;				//milliseconds in the quadtree
+	float cullTime;						//milliseconds for the whole cull
+};
+
+inline void ResetCullStats( CullStats& stats )
+{
+	memset( &stats, 0, sizeof( CullStats ) );
+}
+
+//adds the traversal counters of one cull to another, for culls split into parts
+inline void AddTraversalStats( CullStats& total, const CullStats& stats )
+{
+	total.nodesVisited			+= stats.nodesVisited;
+	total.planeTests			+= stats.planeTests;
+	total.planeTestsSaved		+= stats.planeTestsSaved;
+	total.nodesAcceptedWhole	+= stats.nodesAcceptedWhole;
+	total.leavesAcceptedWhole	+= stats.leavesAcceptedWhole;
+	for( int plane = 0; plane < 6; ++plane )
+		total.leavesRejected[ plane ] += stats.leavesRejected[ plane ];
+}
+
+
+#endif //INCLUSIONGUARD_CULLSTATS_H
@@ -0,0 +1,354 @@
+//------------------------------------------------------------------------------
+// File: Flythrough.cpp
+// Desc: Headless benchmark - drives the vehicle and the chasecam through a
+//		 scripted run over the terrain, doing each frame's simulation and
+//		 culling work as the app does, and reports how long each stage took
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "Benchmark.h"
+#include "Camera.h"
+#include "OcclusionBuffer.h"
+#include "ParticleSystem.h"
+#include "Simulation.h"
+#include "Terrain.h"
+#include "Vehicle.h"
+#include "WorkerPool.h"
+
+
+//------------------------------------------------------------------------------
+// Constants:
+//------------------------------------------------------------------------------
+
+//the app's frame and projection
+const float FRAME_TIME		= 1.0f / 60.0f;
+const float FAR_PLANE		= 350.0f;
+const float ASPECT_RATIO	= 4.0f / 3.0f;
+const unsigned int SEED		= 1;
+
+//terrain generation is timed over a few builds, as there is only one a run
+const int	TERRAIN_BUILDS	= 3;
+const int	DEFAULT_FRAMES	= 3600;
+
+//the scripted run, looped for as many frames as are asked for - settle,
+//straight ahead, turns either way with the camera near, a centred camera,
+//reverse, then coast
+struct ScriptSegment
+{
+	int				frames;
+	unsigned char	controls;
+};
+
+const ScriptSegment SCRIPT[] =
+{
+	{ 60,	0 },
+	{ 240,	Simulation::CONTROL_FORWARD },
+	{ 90,	Simulation::CONTROL_FORWARD | Simulation::CONTROL_LEFT },
+	{ 180,	Simulation::CONTROL_FORWARD | Simulation::CONTROL_CAMERA_NEAR },
+	{ 90,	Simulation::CONTROL_FORWARD | Simulation::CONTROL_RIGHT |
+			Simulation::CONTROL_CAMERA_NEAR },
+	{ 120,	Simulation::CONTROL_FORWARD | Simulation::CONTROL_CENTRE_CAMERA },
+	{ 60,	Simulation::CONTROL_REVERSE },
+	{ 60,	0 },
+};
+const int NUM_SCRIPT_SEGMENTS = sizeof( SCRIPT ) / sizeof( SCRIPT[ 0 ] );
+
+//the stages reported, in the order they run
+enum Stage
+{
+	STAGE_TERRAIN,
+	STAGE_PHYSICS,
+	STAGE_CHASECAM,
+	STAGE_PARTICLES,
+	STAGE_CULL,
+	STAGE_OCCLUSION,
+	STAGE_SHADOW,
+	STAGE_FRAME,
+	NUM_STAGES
+};
+
+const char* const STAGE_NAMES[ NUM_STAGES ] =
+{
+	"terrain generation",
+	"vehicle physics",
+	"chasecam",
+	"particles",
+	"quadtree cull",
+	"occlusion",
+	"shadow volume",
+	"frame",
+};
+
+const char* const STAGE_ITEMS[ NUM_STAGES ] =
+{
+	"cells",
+	"steps",
+	"steps",
+	"particles",
+	"visible cells",
+	"occluder tris",
+	"mesh faces",
+	"frames",
+};
+
+//the cells counted each frame, in the order the cull finds them
+enum Count
+{
+	COUNT_FRUSTUM,
+	COUNT_OCCLUDED,
+	COUNT_VISIBLE,
+	COUNT_DRAWS,
+	NUM_COUNTS
+};
+
+const char* const COUNT_NAMES[ NUM_COUNTS ] =
+{
+	"in the frustum",
+	"behind the horizon",
+	"visible",
+	"draw calls",
+};
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: GetScriptControls()
+// Desc: Finds the controls the script gives a frame
+//------------------------------------------------------------------------------
+static unsigned char GetScriptControls( const int frame )
+{
+	int scriptFrames = 0;
+	for( int segment = 0; segment < NUM_SCRIPT_SEGMENTS; ++segment )
+		scriptFrames += SCRIPT[ segment ].frames;
+
+	int frameInScript = frame % scriptFrames;
+	for( int segment = 0; segment < NUM_SCRIPT_SEGMENTS; ++segment )
+	{
+		if( frameInScript < SCRIPT[ segment ].frames )
+			return SCRIPT[ segment ].controls;
+		frameInScript -= SCRIPT[ segment ].frames;
+	}
+	return 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: RunFlythrough()
+// Desc: Runs the script through the simulation, timing the parts of each
+//		 frame it reports and counting the cells each cull finds, then culls
+//		 and builds the shadow volume the way App::FrameMove() does. Returns
+//		 false if it ran out of memory.
+//------------------------------------------------------------------------------
+static bool RunFlythrough( const int numFrames, const int stepsPerSecond, const int numThreads,
+						   const bool coherent, const bool merged, StageTimes* pTimes,
+						   FrameCounts* pCounts )
+{
+	//build the terrain a few times for its timing - the simulation builds the
+	//one it runs on
+	for( int build = 0; build < TERRAIN_BUILDS; ++build )
+	{
+		Terrain* pTerrain = NULL;
+		pTimes[ STAGE_TERRAIN ].Start();
+		try{ pTerrain = new Terrain(); }
+		catch( std::bad_alloc& )
+		{
+			return false;
+		}
+		pTimes[ STAGE_TERRAIN ].Stop( Terrain::CELLS_DIM * Terrain::CELLS_DIM );
+		delete pTerrain;
+	}
+
+	Simulation simulation;
+	OcclusionBuffer* pOcclusionBuffer = NULL;
+	WorkerPool* pPool = NULL;
+	try
+	{
+		pOcclusionBuffer = new OcclusionBuffer();
+		if( numThreads > 0 )
+			pPool = new WorkerPool( numThreads );
+	}
+	catch( std::bad_alloc& )
+	{
+		delete pOcclusionBuffer;
+		return false;
+	}
+	if( FAILED( simulation.Create( SEED, stepsPerSecond ) ) )
+	{
+		delete pPool;
+		delete pOcclusionBuffer;
+		return false;
+	}
+	simulation.SetFrameTiming( true );
+
+	Terrain* pTerrain = simulation.GetTerrain();
+	Vehicle* pVehicle = simulation.GetVehicle();
+	const unsigned int numParticles = simulation.GetParticles()->GetNumParticles();
+	pTerrain->SetWorkerPool( pPool );
+	pTerrain->SetCoherentCulling( coherent );
+	pTerrain->SetMergedDraws( merged );
+
+	std::vector<Vector3> hullVertices;
+	std::vector<WORD> hullIndices;
+	BuildStandInHull( hullVertices, hullIndices );
+	const int numHullFaces = int( hullIndices.size() / 3 );
+	pVehicle->SetMesh( &hullVertices[ 0 ], int( hullVertices.size() ), &hullIndices[ 0 ],
+					   numHullFaces );
+
+	Camera camera;
+	Matrix4 matProj;
+	Mat4PerspectiveFovLH( matProj, MATHS_PI/4, ASPECT_RATIO, 1.0f, FAR_PLANE );
+	camera.SetProjection( matProj );
+
+	const Vector3 vLight = Vec3Normalize( Vector3( 5.0f, -5.0f, 5.0f ) );
+
+	for( int frame = 0; frame < numFrames; ++frame )
+	{
+		const double frameStart = GetTimerSeconds();
+
+		const int steps = simulation.Advance( FRAME_TIME, GetScriptControls( frame ) );
+
+		const Simulation::FrameTimes& frameTimes = simulation.GetFrameTimes();
+		pTimes[ STAGE_PHYSICS ].Add( frameTimes.physicsSeconds, steps );
+		pTimes[ STAGE_CHASECAM ].Add( frameTimes.chaseCamSeconds, steps );
+		if( frameTimes.particlesMoved )
+			pTimes[ STAGE_PARTICLES ].Add( frameTimes.particlesSeconds, numParticles );
+
+		camera.SetCamera( simulation.GetCameraPosition(), simulation.GetCameraTarget(),
+						  Vector3( 0.0f, 1.0f, 0.0f ) );
+
+		pTimes[ STAGE_CULL ].Start();
+		pTerrain->CullQuadtree( camera );
+		pTimes[ STAGE_CULL ].Stop( pTerrain->GetVisibleCells() );
+		pCounts[ COUNT_FRUSTUM ].Add( static_cast<unsigned int>(
+			pTerrain->GetFrustumCellList().size() ) );
+		pCounts[ COUNT_OCCLUDED ].Add( pTerrain->GetOccludedCells() );
+		pCounts[ COUNT_VISIBLE ].Add( pTerrain->GetVisibleCells() );
+		pCounts[ COUNT_DRAWS ].Add( pTerrain->GetCellDraws() );
+
+		//as App::UpdateOcclusion()
+		pTimes[ STAGE_OCCLUSION ].Start();
+		pOcclusionBuffer->Begin( camera.GetViewProj(), camera.GetPosition() );
+		pTerrain->AddOccluders( *pOcclusionBuffer );
+		pOcclusionBuffer->Rasterise();
+		Vector3 vMin, vMax;
+		pVehicle->GetShadowBounds( vLight, vMin, vMax );
+		const bool shadowVisible = pOcclusionBuffer->IsVisible( vMin, vMax );
+		pTimes[ STAGE_OCCLUSION ].Stop( pOcclusionBuffer->GetOccluderTriangles() );
+
+		if( shadowVisible )
+		{
+			pTimes[ STAGE_SHADOW ].Start();
+			pVehicle->UpdateShadowVolume( vLight, false );
+			pTimes[ STAGE_SHADOW ].Stop( numHullFaces );
+		}
+
+		//keep near the origin, as the app does
+		Vector3 vShift;
+		simulation.RebaseOrigin( vShift );
+
+		pTimes[ STAGE_FRAME ].Add( GetTimerSeconds() - frameStart, 1.0 );
+	}
+
+	//the terrain does not own the pool
+	pTerrain->SetWorkerPool( NULL );
+	delete pPool;
+	delete pOcclusionBuffer;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: main()
+// Desc: Entry point. "-frames <n>" sets the length of the run, "-steps <n>"
+//		 the physics steps a second, "-threads <n>" culls on a worker pool of
+//		 that many threads, and "-coherent" reuses results from earlier culls
+//		 instead. "-unmerged" draws each visible cell on its own, rather than
+//		 merging them into blocks.
+//------------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	int numFrames = DEFAULT_FRAMES;
+	int stepsPerSecond = Simulation::DEFAULT_STEPS_PER_SECOND;
+	int numThreads = 0;
+	bool coherent = false;
+	bool merged = true;
+	for( int arg = 1; arg < argc; ++arg )
+	{
+		if( strcmp( argv[ arg ], "-frames" ) == 0 && arg + 1 < argc )
+			numFrames = atoi( argv[ ++arg ] );
+		else if( strcmp( argv[ arg ], "-steps" ) == 0 && arg + 1 < argc )
+			stepsPerSecond = atoi( argv[ ++arg ] );
+		else if( strcmp( argv[ arg ], "-threads" ) == 0 && arg + 1 < argc )
+			numThreads = atoi( argv[ ++arg ] );
+		else if( strcmp( argv[ arg ], "-coherent" ) == 0 )
+			coherent = true;
+		else if( strcmp( argv[ arg ], "-unmerged" ) == 0 )
+			merged = false;
+		else
+		{
+			fprintf( stderr, "usage: %s [-frames <n>] [-steps <n>] [-threads <n> | -coherent] "
+					 "[-unmerged]\n", argv[ 0 ] );
+			return 1;
+		}
+	}
+	if( numFrames < 1 )
+		numFrames = 1;
+	if( stepsPerSecond < 1 )
+		stepsPerSecond = 1;
+
+	StageTimes times[ NUM_STAGES ];
+	FrameCounts counts[ NUM_COUNTS ];
+	if( ! RunFlythrough( numFrames, stepsPerSecond, numThreads, coherent, merged, times,
+						 counts ) )
+	{
+		ShowError( "Out of memory" );
+		return 1;
+	}
+
+	printf( "flythrough: %d frames of %.1fms, %.1f physics steps of %.2fms each, ", numFrames,
+			FRAME_TIME * 1000.0f, times[ STAGE_PHYSICS ].GetNumItems() / double( numFrames ),
+			1000.0 / stepsPerSecond );
+	if( numThreads > 0 )
+		printf( "culled on %d threads", numThreads );
+	else if( coherent )
+		printf( "culled coherently" );
+	else
+		printf( "culled four boxes at a time" );
+	printf( merged ? ", merged into blocks to draw\n\n" : ", each cell drawn on its own\n\n" );
+
+	printf( "%-20s %8s %10s %10s %10s   %s\n", "stage", "runs", "p50 (us)", "p99 (us)",
+			"mean (us)", "throughput" );
+	for( int stage = 0; stage < NUM_STAGES; ++stage )
+	{
+		const StageTimes& stageTimes = times[ stage ];
+		printf( "%-20s %8d %10.2f %10.2f %10.2f   %.4g %s/s\n", STAGE_NAMES[ stage ],
+				stageTimes.GetNumSamples(), stageTimes.GetPercentile( 0.5 ) * 1e6,
+				stageTimes.GetPercentile( 0.99 ) * 1e6, stageTimes.GetMean() * 1e6,
+				stageTimes.GetThroughput(), STAGE_ITEMS[ stage ] );
+	}
+
+	printf( "\n%-20s %8s %8s %12s\n", "cells a frame", "p50", "p99", "total" );
+	for( int count = 0; count < NUM_COUNTS; ++count )
+	{
+		const FrameCounts& frameCounts = counts[ count ];
+		printf( "%-20s %8.0f %8.0f %12.0f\n", COUNT_NAMES[ count ],
+				frameCounts.GetPercentile( 0.5 ), frameCounts.GetPercentile( 0.99 ),
+				frameCounts.GetTotal() );
+	}
+
+	return 0;
+}
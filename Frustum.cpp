@@ -11,8 +11,15 @@
 //------------------------------------------------------------------------------
 // Included files:
 //------------------------------------------------------------------------------
+#include <algorithm>
+#include <float.h>
+
 #include "Frustum.h"
 
+#ifdef FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
 
 //------------------------------------------------------------------------------
 // Definitions:
@@ -22,56 +29,405 @@
 // Name: ExtractFrustum()
 // Desc: Generates a frustum from a view/projection transform matrix
 //------------------------------------------------------------------------------
-Frustum ExtractFrustum( const D3DMATRIX matrix, const bool normalise )
+Frustum ExtractFrustum( const Matrix4& matrix, const bool normalise )
 {
 	Frustum frustum;
 
 	//left clipping plane
-	frustum.planes[0].a = - ( matrix._14 + matrix._11 );
-	frustum.planes[0].b = - ( matrix._24 + matrix._21 );
-	frustum.planes[0].c = - ( matrix._34 + matrix._31 );
-	frustum.planes[0].d = - ( matrix._44 + matrix._41 );
+	frustum.planes[0].a = - ( matrix( 0, 3 ) + matrix( 0, 0 ) );
+	frustum.planes[0].b = - ( matrix( 1, 3 ) + matrix( 1, 0 ) );
+	frustum.planes[0].c = - ( matrix( 2, 3 ) + matrix( 2, 0 ) );
+	frustum.planes[0].d = - ( matrix( 3, 3 ) + matrix( 3, 0 ) );
 
 	//right clipping plane
-	frustum.planes[1].a = - ( matrix._14 - matrix._11 );
-	frustum.planes[1].b = - ( matrix._24 - matrix._21 );
-	frustum.planes[1].c = - ( matrix._34 - matrix._31 );
-	frustum.planes[1].d = - ( matrix._44 - matrix._41 );
+	frustum.planes[1].a = - ( matrix( 0, 3 ) - matrix( 0, 0 ) );
+	frustum.planes[1].b = - ( matrix( 1, 3 ) - matrix( 1, 0 ) );
+	frustum.planes[1].c = - ( matrix( 2, 3 ) - matrix( 2, 0 ) );
+	frustum.planes[1].d = - ( matrix( 3, 3 ) - matrix( 3, 0 ) );
 
 	//top clipping plane
-	frustum.planes[2].a = - ( matrix._14 - matrix._12 );
-	frustum.planes[2].b = - ( matrix._24 - matrix._22 );
-	frustum.planes[2].c = - ( matrix._34 - matrix._32 );
-	frustum.planes[2].d = - ( matrix._44 - matrix._42 );
+	frustum.planes[2].a = - ( matrix( 0, 3 ) - matrix( 0, 1 ) );
+	frustum.planes[2].b = - ( matrix( 1, 3 ) - matrix( 1, 1 ) );
+	frustum.planes[2].c = - ( matrix( 2, 3 ) - matrix( 2, 1 ) );
+	frustum.planes[2].d = - ( matrix( 3, 3 ) - matrix( 3, 1 ) );
 
 	//bottom clipping plane
-	frustum.planes[3].a = - ( matrix._14 + matrix._12 );
-	frustum.planes[3].b = - ( matrix._24 + matrix._22 );
-	frustum.planes[3].c = - ( matrix._34 + matrix._32 );
-	frustum.planes[3].d = - ( matrix._44 + matrix._42 );
+	frustum.planes[3].a = - ( matrix( 0, 3 ) + matrix( 0, 1 ) );
+	frustum.planes[3].b = - ( matrix( 1, 3 ) + matrix( 1, 1 ) );
+	frustum.planes[3].c = - ( matrix( 2, 3 ) + matrix( 2, 1 ) );
+	frustum.planes[3].d = - ( matrix( 3, 3 ) + matrix( 3, 1 ) );
 
 	//near clipping plane
-	frustum.planes[4].a = - matrix._13;
-	frustum.planes[4].b = - matrix._23;
-	frustum.planes[4].c = - matrix._33;
-	frustum.planes[4].d = - matrix._43;
+	frustum.planes[4].a = - matrix( 0, 2 );
+	frustum.planes[4].b = - matrix( 1, 2 );
+	frustum.planes[4].c = - matrix( 2, 2 );
+	frustum.planes[4].d = - matrix( 3, 2 );
 
 	//far clipping plane
-	frustum.planes[5].a = - ( matrix._14 - matrix._13 );
-	frustum.planes[5].b = - ( matrix._24 - matrix._23 );
-	frustum.planes[5].c = - ( matrix._34 - matrix._33 );
-	frustum.planes[5].d = - ( matrix._44 - matrix._43 );
+	frustum.planes[5].a = - ( matrix( 0, 3 ) - matrix( 0, 2 ) );
+	frustum.planes[5].b = - ( matrix( 1, 3 ) - matrix( 1, 2 ) );
+	frustum.planes[5].c = - ( matrix( 2, 3 ) - matrix( 2, 2 ) );
+	frustum.planes[5].d = - ( matrix( 3, 3 ) - matrix( 3, 2 ) );
 
 	//normalise
 	if( normalise )
 	{
-		D3DXPlaneNormalize( &frustum.planes[0], &frustum.planes[0] );
-		D3DXPlaneNormalize( &frustum.planes[1], &frustum.planes[1] );
-		D3DXPlaneNormalize( &frustum.planes[2], &frustum.planes[2] );
-		D3DXPlaneNormalize( &frustum.planes[3], &frustum.planes[3] );
-		D3DXPlaneNormalize( &frustum.planes[4], &frustum.planes[4] );
-		D3DXPlaneNormalize( &frustum.planes[5], &frustum.planes[5] );
+		frustum.planes[0] = PlaneNormalize( frustum.planes[0] );
+		frustum.planes[1] = PlaneNormalize( frustum.planes[1] );
+		frustum.planes[2] = PlaneNormalize( frustum.planes[2] );
+		frustum.planes[3] = PlaneNormalize( frustum.planes[3] );
+		frustum.planes[4] = PlaneNormalize( frustum.planes[4] );
+		frustum.planes[5] = PlaneNormalize( frustum.planes[5] );
+	}
+
+	UpdateNearMasks( frustum );
+
+	return frustum;
+}
+
+//------------------------------------------------------------------------------
+// Name: ExtractFrustum()
+// Desc: Generates a normalised frustum from separate view and projection
+//		 matrices. The far plane taken from a combined matrix loses most of its
+//		 precision, which matters when results are reused between frames, so the
+//		 planes are found in view space and then moved out by the view transform.
+//		 The view matrix must be a rigid transform.
+//------------------------------------------------------------------------------
+Frustum ExtractFrustum( const Affine& matView, const Matrix4& matProjection )
+{
+	Frustum viewFrustum = ExtractFrustum( matProjection, true );
+	Frustum frustum;
+
+	for( int planeNum = 0; planeNum < 6; ++planeNum )
+	{
+		const Plane& p = viewFrustum.planes[ planeNum ];
+		Plane& plane = frustum.planes[ planeNum ];
+
+		plane.a = matView( 0, 0 ) * p.a + matView( 0, 1 ) * p.b + matView( 0, 2 ) * p.c;
+		plane.b = matView( 1, 0 ) * p.a + matView( 1, 1 ) * p.b + matView( 1, 2 ) * p.c;
+		plane.c = matView( 2, 0 ) * p.a + matView( 2, 1 ) * p.b + matView( 2, 2 ) * p.c;
+		plane.d = matView( 3, 0 ) * p.a + matView( 3, 1 ) * p.b + matView( 3, 2 ) * p.c + p.d;
 	}
 
+	UpdateNearMasks( frustum );
+
 	return frustum;
 }
+
+//------------------------------------------------------------------------------
+// Name: UpdateNearMasks()
+// Desc: Works out which corner of a box is nearest to each plane, so the culling
+//		 kernels don't have to branch on the plane normals for every box
+//------------------------------------------------------------------------------
+void UpdateNearMasks( Frustum& frustum )
+{
+	for( int planeNum = 0; planeNum < 6; ++planeNum )
+	{
+		const Plane& plane = frustum.planes[ planeNum ];
+
+		frustum.nearMasks[ planeNum ] = ( ( plane.a < 0 ) ? 1 : 0 ) |
+										( ( plane.b < 0 ) ? 2 : 0 ) |
+										( ( plane.c < 0 ) ? 4 : 0 );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: IntersectFrustum4()
+// Desc: Tests four consecutive boxes, stored as separate arrays per component,
+//		 against a frustum in one pass
+//------------------------------------------------------------------------------
+CullMasks IntersectFrustum4( const Frustum& frustum,
+							 const float* minX, const float* minY, const float* minZ,
+							 const float* maxX, const float* maxY, const float* maxZ )
+{
+#ifdef FRUSTUM_USE_SSE
+	//the arrays are not guaranteed to be aligned
+	const __m128 boxMin[ 3 ] = { _mm_loadu_ps( minX ), _mm_loadu_ps( minY ),
+								 _mm_loadu_ps( minZ ) };
+	const __m128 boxMax[ 3 ] = { _mm_loadu_ps( maxX ), _mm_loadu_ps( maxY ),
+								 _mm_loadu_ps( maxZ ) };
+	const __m128 zero = _mm_setzero_ps();
+
+	__m128 outside = zero;
+	__m128 intersecting = zero;
+
+	//for each plane in the frustum
+	for( int planeNum = 0; planeNum < 6; ++planeNum )
+	{
+		const Plane& plane = frustum.planes[ planeNum ];
+		const unsigned int mask = frustum.nearMasks[ planeNum ];
+
+		//pick the nearest and furthest corners along the plane normal
+		const __m128 nearX = ( mask & 1 ) ? boxMax[ 0 ] : boxMin[ 0 ];
+		const __m128 nearY = ( mask & 2 ) ? boxMax[ 1 ] : boxMin[ 1 ];
+		const __m128 nearZ = ( mask & 4 ) ? boxMax[ 2 ] : boxMin[ 2 ];
+		const __m128 farX  = ( mask & 1 ) ? boxMin[ 0 ] : boxMax[ 0 ];
+		const __m128 farY  = ( mask & 2 ) ? boxMin[ 1 ] : boxMax[ 1 ];
+		const __m128 farZ  = ( mask & 4 ) ? boxMin[ 2 ] : boxMax[ 2 ];
+
+		const __m128 a = _mm_set1_ps( plane.a );
+		const __m128 b = _mm_set1_ps( plane.b );
+		const __m128 c = _mm_set1_ps( plane.c );
+		const __m128 d = _mm_set1_ps( plane.d );
+
+		//test which side of the plane each point is on
+		const __m128 nearDist = _mm_add_ps( _mm_add_ps( _mm_add_ps(
+									_mm_mul_ps( a, nearX ), _mm_mul_ps( b, nearY ) ),
+									_mm_mul_ps( c, nearZ ) ), d );
+		const __m128 farDist = _mm_add_ps( _mm_add_ps( _mm_add_ps(
+									_mm_mul_ps( a, farX ), _mm_mul_ps( b, farY ) ),
+									_mm_mul_ps( c, farZ ) ), d );
+
+		outside = _mm_or_ps( outside, _mm_cmpgt_ps( nearDist, zero ) );
+		intersecting = _mm_or_ps( intersecting, _mm_cmpge_ps( farDist, zero ) );
+
+		//stop early if every box has been rejected
+		if( _mm_movemask_ps( outside ) == 0xf )
+			break;
+	}
+
+	CullMasks masks;
+	masks.outside		= _mm_movemask_ps( outside );
+	masks.intersecting	= _mm_movemask_ps( intersecting ) & ~masks.outside;
+	masks.inside		= 0xf & ~( masks.outside | masks.intersecting );
+	return masks;
+#else
+	return IntersectFrustumReference( frustum, 4, minX, minY, minZ, maxX, maxY, maxZ );
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Name: IntersectFrustum4Coherent()
+// Desc: As IntersectFrustum4(), but starts with lastPlane - the plane that last
+//		 rejected one of the boxes, updated here - as it will usually reject
+//		 them again straight away. margin receives how far the planes could move
+//		 before any of the results could change, which needs normalised planes.
+//		 planeTests is incremented by the box/plane tests done.
+//------------------------------------------------------------------------------
+CullMasks IntersectFrustum4Coherent( const Frustum& frustum,
+									 const float* minX, const float* minY,
+									 const float* minZ, const float* maxX,
+									 const float* maxY, const float* maxZ,
+									 unsigned int& lastPlane, float& margin,
+									 unsigned int& planeTests )
+{
+	CullMasks masks;
+	masks.inside		= 0;
+	masks.outside		= 0;
+	masks.intersecting	= 0;
+
+	const unsigned int firstPlane = lastPlane;
+
+#ifdef FRUSTUM_USE_SSE
+	const __m128 boxMin[ 3 ] = { _mm_loadu_ps( minX ), _mm_loadu_ps( minY ),
+								 _mm_loadu_ps( minZ ) };
+	const __m128 boxMax[ 3 ] = { _mm_loadu_ps( maxX ), _mm_loadu_ps( maxY ),
+								 _mm_loadu_ps( maxZ ) };
+	const __m128 zero = _mm_setzero_ps();
+
+	//largest distances of the nearest and furthest corners, for the margin
+	__m128 nearMax = _mm_set1_ps( -FLT_MAX );
+	__m128 farMax = nearMax;
+	__m128 outside = zero;
+
+	//for each plane in the frustum, starting with the last to reject anything
+	for( unsigned int i = 0; i < 6; ++i )
+	{
+		const unsigned int planeNum = ( firstPlane + i ) % 6;
+		const Plane& plane = frustum.planes[ planeNum ];
+		const unsigned int mask = frustum.nearMasks[ planeNum ];
+
+		const __m128 nearX = ( mask & 1 ) ? boxMax[ 0 ] : boxMin[ 0 ];
+		const __m128 nearY = ( mask & 2 ) ? boxMax[ 1 ] : boxMin[ 1 ];
+		const __m128 nearZ = ( mask & 4 ) ? boxMax[ 2 ] : boxMin[ 2 ];
+		const __m128 farX  = ( mask & 1 ) ? boxMin[ 0 ] : boxMax[ 0 ];
+		const __m128 farY  = ( mask & 2 ) ? boxMin[ 1 ] : boxMax[ 1 ];
+		const __m128 farZ  = ( mask & 4 ) ? boxMin[ 2 ] : boxMax[ 2 ];
+
+		const __m128 a = _mm_set1_ps( plane.a );
+		const __m128 b = _mm_set1_ps( plane.b );
+		const __m128 c = _mm_set1_ps( plane.c );
+		const __m128 d = _mm_set1_ps( plane.d );
+
+		const __m128 nearDist = _mm_add_ps( _mm_add_ps( _mm_add_ps(
+									_mm_mul_ps( a, nearX ), _mm_mul_ps( b, nearY ) ),
+									_mm_mul_ps( c, nearZ ) ), d );
+		const __m128 farDist = _mm_add_ps( _mm_add_ps( _mm_add_ps(
+									_mm_mul_ps( a, farX ), _mm_mul_ps( b, farY ) ),
+									_mm_mul_ps( c, farZ ) ), d );
+
+		nearMax = _mm_max_ps( nearMax, nearDist );
+		farMax = _mm_max_ps( farMax, farDist );
+		planeTests += 4;
+
+		//remember the last plane to reject a new box
+		const __m128 rejected = _mm_cmpgt_ps( nearDist, zero );
+		if( _mm_movemask_ps( _mm_andnot_ps( outside, rejected ) ) )
+			lastPlane = planeNum;
+		outside = _mm_or_ps( outside, rejected );
+
+		if( _mm_movemask_ps( outside ) == 0xf )
+			break;
+	}
+
+	//outside boxes can survive until their nearest corner crosses the plane,
+	//inside boxes until their furthest corner does, and intersecting boxes until
+	//either happens
+	const __m128 intersectMargin = _mm_min_ps( _mm_sub_ps( zero, nearMax ), farMax );
+	const __m128 insideMargin = _mm_sub_ps( zero, farMax );
+	const __m128 boxMargin = _mm_or_ps( _mm_and_ps( outside, nearMax ),
+										_mm_andnot_ps( outside, _mm_max_ps( intersectMargin,
+																		   insideMargin ) ) );
+
+	__m128 minMargin = _mm_min_ps( boxMargin, _mm_movehl_ps( boxMargin, boxMargin ) );
+	minMargin = _mm_min_ss( minMargin, _mm_shuffle_ps( minMargin, minMargin, 1 ) );
+	_mm_store_ss( &margin, minMargin );
+
+	masks.outside		= _mm_movemask_ps( outside );
+	masks.inside		= _mm_movemask_ps( _mm_cmplt_ps( farMax, zero ) ) & ~masks.outside;
+	masks.intersecting	= 0xf & ~( masks.outside | masks.inside );
+#else
+	margin = FLT_MAX;
+
+	for( int box = 0; box < 4; ++box )
+	{
+		float nearMax = -FLT_MAX;
+		float farMax = -FLT_MAX;
+
+		for( unsigned int i = 0; i < 6 && nearMax <= 0; ++i )
+		{
+			const unsigned int planeNum = ( firstPlane + i ) % 6;
+			const Plane& plane = frustum.planes[ planeNum ];
+
+			const float nearX = ( plane.a >= 0 ) ? minX[ box ] : maxX[ box ];
+			const float nearY = ( plane.b >= 0 ) ? minY[ box ] : maxY[ box ];
+			const float nearZ = ( plane.c >= 0 ) ? minZ[ box ] : maxZ[ box ];
+			const float farX  = ( plane.a >= 0 ) ? maxX[ box ] : minX[ box ];
+			const float farY  = ( plane.b >= 0 ) ? maxY[ box ] : minY[ box ];
+			const float farZ  = ( plane.c >= 0 ) ? maxZ[ box ] : minZ[ box ];
+
+			const float nearDist = plane.a * nearX + plane.b * nearY + plane.c * nearZ + plane.d;
+			const float farDist = plane.a * farX + plane.b * farY + plane.c * farZ + plane.d;
+			nearMax = std::max( nearMax, nearDist );
+			farMax = std::max( farMax, farDist );
+			++planeTests;
+
+			if( nearDist > 0 )
+				lastPlane = planeNum;
+		}
+
+		if( nearMax > 0 )
+		{
+			masks.outside |= 1 << box;
+			margin = std::min( margin, nearMax );
+		}
+		else if( farMax >= 0 )
+		{
+			masks.intersecting |= 1 << box;
+			margin = std::min( margin, std::min( -nearMax, farMax ) );
+		}
+		else
+		{
+			masks.inside |= 1 << box;
+			margin = std::min( margin, -farMax );
+		}
+	}
+#endif
+
+	return masks;
+}
+
+//------------------------------------------------------------------------------
+// Name: IntersectFrustumBatch()
+// Desc: Tests a flat array of boxes against a frustum, four at a time. Writes
+//		 one set of masks per group of four boxes - bits past the end of the
+//		 array are left clear.
+//------------------------------------------------------------------------------
+void IntersectFrustumBatch( const Frustum& frustum, const int count,
+							const float* minX, const float* minY, const float* minZ,
+							const float* maxX, const float* maxY, const float* maxZ,
+							CullMasks* pResults )
+{
+	int box = 0;
+	for( ; box + 4 <= count; box += 4 )
+	{
+		*pResults++ = IntersectFrustum4( frustum, minX + box, minY + box, minZ + box,
+										 maxX + box, maxY + box, maxZ + box );
+	}
+
+	//pad the last group out to four boxes
+	const int remaining = count - box;
+	if( remaining > 0 )
+	{
+		float tail[ 6 ][ 4 ] = { { 0 } };
+		for( int i = 0; i < remaining; ++i )
+		{
+			tail[ 0 ][ i ] = minX[ box + i ];
+			tail[ 1 ][ i ] = minY[ box + i ];
+			tail[ 2 ][ i ] = minZ[ box + i ];
+			tail[ 3 ][ i ] = maxX[ box + i ];
+			tail[ 4 ][ i ] = maxY[ box + i ];
+			tail[ 5 ][ i ] = maxZ[ box + i ];
+		}
+
+		CullMasks masks = IntersectFrustum4( frustum, tail[ 0 ], tail[ 1 ], tail[ 2 ],
+											 tail[ 3 ], tail[ 4 ], tail[ 5 ] );
+		const unsigned int valid = ( 1 << remaining ) - 1;
+		masks.inside		&= valid;
+		masks.outside		&= valid;
+		masks.intersecting	&= valid;
+		*pResults = masks;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: IntersectFrustumReference()
+// Desc: Plain one-box-at-a-time version of IntersectFrustum4(), for up to four
+//		 boxes. Used to check the fast kernels, and where there is only a single
+//		 box to test.
+//------------------------------------------------------------------------------
+CullMasks IntersectFrustumReference( const Frustum& frustum, const int count,
+									 const float* minX, const float* minY,
+									 const float* minZ, const float* maxX,
+									 const float* maxY, const float* maxZ )
+{
+	CullMasks masks;
+	masks.inside		= 0;
+	masks.outside		= 0;
+	masks.intersecting	= 0;
+
+	for( int box = 0; box < count; ++box )
+	{
+		bool outside = false;
+		bool intersecting = false;
+
+		//for each plane in the frustum
+		for( int planeNum = 0; planeNum < 6 && !outside; ++planeNum )
+		{
+			const Plane& plane = frustum.planes[ planeNum ];
+
+			//calculate the two candidate points
+			const float nearX = ( plane.a >= 0 ) ? minX[ box ] : maxX[ box ];
+			const float nearY = ( plane.b >= 0 ) ? minY[ box ] : maxY[ box ];
+			const float nearZ = ( plane.c >= 0 ) ? minZ[ box ] : maxZ[ box ];
+			const float farX  = ( plane.a >= 0 ) ? maxX[ box ] : minX[ box ];
+			const float farY  = ( plane.b >= 0 ) ? maxY[ box ] : minY[ box ];
+			const float farZ  = ( plane.c >= 0 ) ? maxZ[ box ] : minZ[ box ];
+
+			//test which side of the plane each point is on
+			if( ( plane.a * nearX + plane.b * nearY + plane.c * nearZ + plane.d ) > 0 )
+				outside = true;
+			else if( ( plane.a * farX + plane.b * farY + plane.c * farZ + plane.d ) >= 0 )
+				intersecting = true;
+		}
+
+		if( outside )
+			masks.outside |= 1 << box;
+		else if( intersecting )
+			masks.intersecting |= 1 << box;
+		else
+			masks.inside |= 1 << box;
+	}
+
+	return masks;
+}
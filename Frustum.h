@@ -15,7 +15,13 @@
 //------------------------------------------------------------------------------
 // Included files:
 //------------------------------------------------------------------------------
-#include <d3dx9.h>
+#include "VectorMath.h"
+
+//the culling kernels use sse where the maths does - there is no neon version,
+//so on arm they are the plain float ones
+#if defined( MATHS_USE_SSE )
+	#define FRUSTUM_USE_SSE
+#endif
 
 
 //------------------------------------------------------------------------------
@@ -28,10 +34,46 @@
 //------------------------------------------------------------------------------
 struct Frustum
 {
-	D3DXPLANE planes[ 6 ];
+	Plane planes[ 6 ];
+
+	//for each plane, bits 0-2 are set where the nearest corner of a box uses the
+	//max x/y/z - filled in by ExtractFrustum()
+	unsigned int nearMasks[ 6 ];
+};
+
+//------------------------------------------------------------------------------
+// Name: struct CullMasks
+// Desc: The result of testing up to four boxes against a frustum - bit i of each
+//		 mask refers to box i
+//------------------------------------------------------------------------------
+struct CullMasks
+{
+	unsigned int inside;
+	unsigned int outside;
+	unsigned int intersecting;
 };
 
-Frustum ExtractFrustum( const D3DMATRIX matrix, const bool normalise );
+Frustum ExtractFrustum( const Matrix4& matrix, const bool normalise );
+Frustum ExtractFrustum( const Affine& matView, const Matrix4& matProjection );
+void UpdateNearMasks( Frustum& frustum );
+
+CullMasks IntersectFrustum4( const Frustum& frustum,
+							 const float* minX, const float* minY, const float* minZ,
+							 const float* maxX, const float* maxY, const float* maxZ );
+void IntersectFrustumBatch( const Frustum& frustum, const int count,
+							const float* minX, const float* minY, const float* minZ,
+							const float* maxX, const float* maxY, const float* maxZ,
+							CullMasks* pResults );
+CullMasks IntersectFrustum4Coherent( const Frustum& frustum,
+									 const float* minX, const float* minY,
+									 const float* minZ, const float* maxX,
+									 const float* maxY, const float* maxZ,
+									 unsigned int& lastPlane, float& margin,
+									 unsigned int& planeTests );
+CullMasks IntersectFrustumReference( const Frustum& frustum, const int count,
+									 const float* minX, const float* minY,
+									 const float* minZ, const float* maxX,
+									 const float* maxY, const float* maxZ );
 
 
 #endif //INCLUSIONGUARD_FRUSTUM_H
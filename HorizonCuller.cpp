@@ -0,0 +1,200 @@
+//------------------------------------------------------------------------------
+// File: HorizonCuller.cpp
+// Desc: Occlusion culling for heightfield terrain, using a horizon buffer that
+//		 holds the highest terrain seen so far in each direction
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <float.h>
+
+#include "HorizonCuller.h"
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: HorizonCuller()
+// Desc: Constructor for the horizon culler
+//------------------------------------------------------------------------------
+HorizonCuller::HorizonCuller()
+{
+	m_cellsOccluded = 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: Cull()
+// Desc: Adds the ids of the cells that are not hidden by the occluders to a
+//		 list, nearest first, and the horizontal distance to the nearest point
+//		 of each to another. An occluder only starts to hide cells once every
+//		 cell left to test is further away than all of it.
+//------------------------------------------------------------------------------
+void HorizonCuller::Cull( const Vector3& vEye, const std::vector<HorizonCell>& cells,
+						  const std::vector<HorizonCell>& occluders,
+						  std::vector<unsigned int>& visibleList,
+						  std::vector<float>& visibleDistances )
+{
+	m_cellsOccluded = 0;
+
+	for( int column = 0; column < NUM_COLUMNS; ++column )
+		m_horizon[ column ] = -FLT_MAX;
+
+	//find where everything is, and sort by distance
+	const int numCells = int( cells.size() );
+	m_cellSpans.resize( numCells );
+	m_nearOrder.resize( numCells );
+
+	for( int cell = 0; cell < numCells; ++cell )
+	{
+		GetSpan( vEye, cells[ cell ], m_cellSpans[ cell ] );
+		m_nearOrder[ cell ] = std::make_pair( m_cellSpans[ cell ].nearDistance, cell );
+	}
+
+	const int numOccluders = int( occluders.size() );
+	m_occluderSpans.resize( numOccluders );
+	m_farOrder.resize( numOccluders );
+
+	for( int occluder = 0; occluder < numOccluders; ++occluder )
+	{
+		GetSpan( vEye, occluders[ occluder ], m_occluderSpans[ occluder ] );
+		m_farOrder[ occluder ] = std::make_pair( m_occluderSpans[ occluder ].farDistance,
+												 occluder );
+	}
+
+	//the cells usually arrive front to back from the quadtree, which is close to
+	//this order but not the same - a nearer cell can have a further corner
+	std::sort( m_nearOrder.begin(), m_nearOrder.end() );
+	std::sort( m_farOrder.begin(), m_farOrder.end() );
+
+	//walk the cells front to back
+	int nextOccluder = 0;
+	for( int i = 0; i < numCells; ++i )
+	{
+		const int cell = m_nearOrder[ i ].second;
+		const CellSpan& span = m_cellSpans[ cell ];
+
+		//raise the horizon with everything that is entirely nearer than this cell
+		while( nextOccluder < numOccluders &&
+			   m_farOrder[ nextOccluder ].first <= span.nearDistance )
+		{
+			const int occluder = m_farOrder[ nextOccluder ].second;
+			AddOccluder( vEye, occluders[ occluder ], m_occluderSpans[ occluder ] );
+			++nextOccluder;
+		}
+
+		if( IsOccluded( vEye, cells[ cell ], span ) )
+			++m_cellsOccluded;
+		else
+		{
+			visibleList.push_back( cells[ cell ].id );
+			visibleDistances.push_back( span.nearDistance );
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: GetSpan()
+// Desc: Finds the horizontal distances to a cell, and the horizon columns it
+//		 covers - the columns are not wrapped, so may run past either end
+//------------------------------------------------------------------------------
+void HorizonCuller::GetSpan( const Vector3& vEye, const HorizonCell& cell,
+							 CellSpan& span ) const
+{
+	//nearest and furthest points of the footprint
+	const float nearX = std::max( std::max( cell.vMin.x - vEye.x, vEye.x - cell.vMax.x ), 0.0f );
+	const float nearZ = std::max( std::max( cell.vMin.z - vEye.z, vEye.z - cell.vMax.z ), 0.0f );
+	const float farX = std::max( fabs( cell.vMin.x - vEye.x ), fabs( cell.vMax.x - vEye.x ) );
+	const float farZ = std::max( fabs( cell.vMin.z - vEye.z ), fabs( cell.vMax.z - vEye.z ) );
+
+	span.nearDistance = float( sqrt( nearX * nearX + nearZ * nearZ ) );
+	span.farDistance = float( sqrt( farX * farX + farZ * farZ ) );
+
+	//the eye is over the cell, so it covers every direction
+	if( span.nearDistance == 0.0f )
+	{
+		span.firstColumn = 0;
+		span.lastColumn = NUM_COLUMNS - 1;
+		return;
+	}
+
+	//find the angles of the corners either side of the direction to the centre
+	const float centreAngle = float( atan2( ( cell.vMin.z + cell.vMax.z ) * 0.5f - vEye.z,
+											( cell.vMin.x + cell.vMax.x ) * 0.5f - vEye.x ) );
+	float minAngle = 0.0f;
+	float maxAngle = 0.0f;
+
+	for( int corner = 0; corner < 4; ++corner )
+	{
+		const float x = ( ( corner & 1 ) ? cell.vMax.x : cell.vMin.x ) - vEye.x;
+		const float z = ( ( corner & 2 ) ? cell.vMax.z : cell.vMin.z ) - vEye.z;
+
+		float angle = float( atan2( z, x ) ) - centreAngle;
+		if( angle > MATHS_PI ) angle -= 2.0f * MATHS_PI;
+		if( angle < -MATHS_PI ) angle += 2.0f * MATHS_PI;
+
+		minAngle = std::min( minAngle, angle );
+		maxAngle = std::max( maxAngle, angle );
+	}
+
+	const float columnsPerRadian = NUM_COLUMNS / ( 2.0f * MATHS_PI );
+	span.firstColumn = int( floor( ( centreAngle + minAngle + MATHS_PI ) * columnsPerRadian ) );
+	span.lastColumn = int( floor( ( centreAngle + maxAngle + MATHS_PI ) * columnsPerRadian ) );
+}
+
+//------------------------------------------------------------------------------
+// Name: IsOccluded()
+// Desc: Tests whether the top of a cell is below the horizon in every column
+//		 it touches
+//------------------------------------------------------------------------------
+bool HorizonCuller::IsOccluded( const Vector3& vEye, const HorizonCell& cell,
+								const CellSpan& span ) const
+{
+	if( span.nearDistance == 0.0f )
+		return false;
+
+	//steepest slope from the eye up to the top of the cell
+	const float top = cell.vMax.y - vEye.y;
+	const float slope = ( top >= 0 ) ? top / span.nearDistance : top / span.farDistance;
+
+	for( int column = span.firstColumn; column <= span.lastColumn; ++column )
+	{
+		const int wrapped = ( column + NUM_COLUMNS ) % NUM_COLUMNS;
+		if( m_horizon[ wrapped ] <= slope )
+			return false;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: AddOccluder()
+// Desc: Raises the horizon behind an occluder. The terrain is somewhere along
+//		 every line of sight that crosses the footprint, no lower than the bottom
+//		 of the box, so its slope is at least that of the bottom at the worst
+//		 distance. Only columns that are wholly covered are raised.
+//------------------------------------------------------------------------------
+void HorizonCuller::AddOccluder( const Vector3& vEye, const HorizonCell& occluder,
+								 const CellSpan& span )
+{
+	if( span.nearDistance == 0.0f )
+		return;
+
+	const float bottom = occluder.vMin.y - vEye.y;
+	const float slope = ( bottom >= 0 ) ? bottom / span.farDistance : bottom / span.nearDistance;
+
+	for( int column = span.firstColumn + 1; column < span.lastColumn; ++column )
+	{
+		const int wrapped = ( column + NUM_COLUMNS ) % NUM_COLUMNS;
+		if( m_horizon[ wrapped ] < slope )
+			m_horizon[ wrapped ] = slope;
+	}
+}
@@ -0,0 +1,92 @@
+//------------------------------------------------------------------------------
+// File: HorizonCuller.h
+// Desc: Occlusion culling for heightfield terrain, using a horizon buffer that
+//		 holds the highest terrain seen so far in each direction
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_HORIZONCULLER_H
+#define INCLUSIONGUARD_HORIZONCULLER_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <vector>
+
+#include "VectorMath.h"
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: struct HorizonCell
+// Desc: A box to be tested against the horizon, or one that raises it - the
+//		 terrain surface must cover an occluder's footprint, and be no lower
+//		 than its minimum
+//------------------------------------------------------------------------------
+struct HorizonCell
+{
+	Vector3 vMin;
+	Vector3 vMax;
+	unsigned int id;
+};
+
+//------------------------------------------------------------------------------
+// Name: class HorizonCuller
+// Desc: Finds which of a set of terrain cells are hidden behind nearer ones. The
+//		 horizon is stored as the steepest slope up from the eye seen so far in
+//		 each of a ring of directions around it, so it is independent of how the
+//		 camera is pitched or rolled. Needs no device.
+//------------------------------------------------------------------------------
+class HorizonCuller
+{
+public:
+	const static int NUM_COLUMNS = 1024;
+
+	HorizonCuller();
+
+	void Cull( const Vector3& vEye, const std::vector<HorizonCell>& cells,
+			   const std::vector<HorizonCell>& occluders,
+			   std::vector<unsigned int>& visibleList,
+			   std::vector<float>& visibleDistances );
+
+	inline unsigned int GetCellsOccluded() const { return m_cellsOccluded; }
+
+private:
+	//a box's extent as seen from the eye
+	struct CellSpan
+	{
+		int firstColumn;
+		int lastColumn;
+		float nearDistance;
+		float farDistance;
+	};
+
+	void GetSpan( const Vector3& vEye, const HorizonCell& cell, CellSpan& span ) const;
+	bool IsOccluded( const Vector3& vEye, const HorizonCell& cell,
+					 const CellSpan& span ) const;
+	void AddOccluder( const Vector3& vEye, const HorizonCell& occluder,
+					  const CellSpan& span );
+
+	float m_horizon[ NUM_COLUMNS ];
+
+	//cells sorted by nearest distance, and occluders by furthest distance -
+	//reused each frame
+	std::vector<CellSpan> m_cellSpans;
+	std::vector<CellSpan> m_occluderSpans;
+	std::vector< std::pair<float, int> > m_nearOrder;
+	std::vector< std::pair<float, int> > m_farOrder;
+
+	unsigned int m_cellsOccluded;
+
+};
+
+
+#endif //INCLUSIONGUARD_HORIZONCULLER_H
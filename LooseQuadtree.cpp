@@ -0,0 +1,538 @@
+//------------------------------------------------------------------------------
+// File: LooseQuadtree.cpp
+// Desc: A loose quadtree over the terrain, for finding moving objects near a
+//		 point or inside a view
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <float.h>
+#include <math.h>
+
+#include "LooseQuadtree.h"
+#include "Frustum.h"
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: LooseQuadtree()
+// Desc: Constructor for the loose quadtree class - the tree covers the same area
+//		 as a terrain of cellsDim by cellsDim cells, which must be a power of two
+//------------------------------------------------------------------------------
+LooseQuadtree::LooseQuadtree( const int cellsDim, const float cellSize )
+{
+	m_size = float( cellsDim ) * cellSize;
+
+	//count the levels, and where each one starts
+	m_numLevels = 0;
+	int numNodes = 0;
+	for( int dim = 1; dim <= cellsDim; dim *= 2 )
+	{
+		m_levelStart[ m_numLevels++ ] = numNodes;
+		numNodes += dim * dim;
+	}
+
+	//allocate the nodes - objects are allocated as they are added
+	Node emptyNode = { -1, 0, FLT_MAX, -FLT_MAX };
+	m_nodes.resize( numNodes, emptyNode );
+	m_firstFree = -1;
+}
+
+//------------------------------------------------------------------------------
+// Name: Insert()
+// Desc: Adds an object with the given bounding box, and returns a handle to it
+//------------------------------------------------------------------------------
+int LooseQuadtree::Insert( const Vector3& vMin, const Vector3& vMax,
+						   const unsigned int id )
+{
+	//reuse a free handle if there is one
+	int handle = m_firstFree;
+	if( handle >= 0 )
+	{
+		m_firstFree = m_objects[ handle ].next;
+	}
+	else
+	{
+		handle = int( m_objects.size() );
+		m_objects.resize( m_objects.size() + 1 );
+	}
+
+	Object& object = m_objects[ handle ];
+	object.vMin	= vMin;
+	object.vMax	= vMax;
+	object.id	= id;
+	object.inUse = true;
+	Link( handle );
+
+	return handle;
+}
+
+//------------------------------------------------------------------------------
+// Name: Update()
+// Desc: Moves an object to a new bounding box. It stays where it is as long as
+//		 it is still inside its node's loose bounds, which for small moves is
+//		 nearly always - this costs nothing more than the test. Handles that
+//		 have been removed are ignored.
+//------------------------------------------------------------------------------
+void LooseQuadtree::Update( const int handle, const Vector3& vMin,
+							const Vector3& vMax )
+{
+	if( !IsLive( handle ) )
+		return;
+
+	Object& object = m_objects[ handle ];
+
+	//objects at the root are there because they are too big for anything else or
+	//off the edge of the terrain, so are placed again in case that has changed
+	if( object.level > 0 && Fits( object.level, object.x, object.z, vMin, vMax ) )
+	{
+		object.vMin = vMin;
+		object.vMax = vMax;
+		GrowY( object.level, object.x, object.z, vMin.y, vMax.y );
+		return;
+	}
+
+	Unlink( handle );
+	object.vMin = vMin;
+	object.vMax = vMax;
+	Link( handle );
+}
+
+//------------------------------------------------------------------------------
+// Name: Remove()
+// Desc: Removes an object - its handle may be given out again by Insert().
+//		 Removing a handle that is already free does nothing, rather than
+//		 putting it on the free list twice.
+//------------------------------------------------------------------------------
+void LooseQuadtree::Remove( const int handle )
+{
+	if( !IsLive( handle ) )
+		return;
+
+	Unlink( handle );
+
+	Object& object = m_objects[ handle ];
+	object.inUse	= false;
+	object.next		= m_firstFree;
+	m_firstFree		= handle;
+}
+
+//------------------------------------------------------------------------------
+// Name: QueryBox()
+// Desc: Adds the ids of all objects whose boxes overlap the given box to a list
+//------------------------------------------------------------------------------
+void LooseQuadtree::QueryBox( const Vector3& vMin, const Vector3& vMax,
+							  std::vector<unsigned int>& idList ) const
+{
+	StackEntry stack[ MAX_STACK ];
+	int stackSize = 0;
+	const StackEntry root = { 0, 0, 0 };
+	stack[ stackSize++ ] = root;
+
+	while( stackSize > 0 )
+	{
+		const StackEntry entry = stack[ --stackSize ];
+		const Node& node = m_nodes[ GetNode( entry.level, entry.x, entry.z ) ];
+
+		if( node.numObjects == 0 || vMin.y > node.maxY || vMax.y < node.minY )
+			continue;
+
+		//the root also holds anything off the edge of the terrain, so has no
+		//bounds across it
+		if( entry.level > 0 )
+		{
+			Vector3 vNodeMin, vNodeMax;
+			GetLooseBounds( entry.level, entry.x, entry.z, vNodeMin, vNodeMax );
+			if( vMin.x > vNodeMax.x || vMax.x < vNodeMin.x ||
+				vMin.z > vNodeMax.z || vMax.z < vNodeMin.z )
+				continue;
+		}
+
+		for( int handle = node.firstObject; handle >= 0; handle = m_objects[ handle ].next )
+		{
+			const Object& object = m_objects[ handle ];
+			if( vMin.x <= object.vMax.x && vMax.x >= object.vMin.x &&
+				vMin.y <= object.vMax.y && vMax.y >= object.vMin.y &&
+				vMin.z <= object.vMax.z && vMax.z >= object.vMin.z )
+				idList.push_back( object.id );
+		}
+
+		if( entry.level + 1 < m_numLevels )
+		{
+			for( int child = 3; child >= 0; --child )
+			{
+				const StackEntry childEntry = { entry.level + 1,
+												( entry.x * 2 ) + ( child & 1 ),
+												( entry.z * 2 ) + ( child >> 1 ) };
+				stack[ stackSize++ ] = childEntry;
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: QueryRadius()
+// Desc: Adds the ids of all objects whose boxes come within radius of a point
+//		 to a list
+//------------------------------------------------------------------------------
+void LooseQuadtree::QueryRadius( const Vector3& vCentre, const float radius,
+								 std::vector<unsigned int>& idList ) const
+{
+	const float radiusSq = radius * radius;
+
+	StackEntry stack[ MAX_STACK ];
+	int stackSize = 0;
+	const StackEntry root = { 0, 0, 0 };
+	stack[ stackSize++ ] = root;
+
+	while( stackSize > 0 )
+	{
+		const StackEntry entry = stack[ --stackSize ];
+		const Node& node = m_nodes[ GetNode( entry.level, entry.x, entry.z ) ];
+
+		if( node.numObjects == 0 || vCentre.y - radius > node.maxY ||
+			vCentre.y + radius < node.minY )
+			continue;
+
+		//as QueryBox(), the root has no bounds across the terrain
+		if( entry.level > 0 )
+		{
+			Vector3 vNodeMin, vNodeMax;
+			GetLooseBounds( entry.level, entry.x, entry.z, vNodeMin, vNodeMax );
+
+			const float dx = max( max( vNodeMin.x - vCentre.x, vCentre.x - vNodeMax.x ), 0.0f );
+			const float dy = max( max( vNodeMin.y - vCentre.y, vCentre.y - vNodeMax.y ), 0.0f );
+			const float dz = max( max( vNodeMin.z - vCentre.z, vCentre.z - vNodeMax.z ), 0.0f );
+			if( dx * dx + dy * dy + dz * dz > radiusSq )
+				continue;
+		}
+
+		for( int handle = node.firstObject; handle >= 0; handle = m_objects[ handle ].next )
+		{
+			const Object& object = m_objects[ handle ];
+
+			const float dx = max( max( object.vMin.x - vCentre.x,
+									   vCentre.x - object.vMax.x ), 0.0f );
+			const float dy = max( max( object.vMin.y - vCentre.y,
+									   vCentre.y - object.vMax.y ), 0.0f );
+			const float dz = max( max( object.vMin.z - vCentre.z,
+									   vCentre.z - object.vMax.z ), 0.0f );
+			if( dx * dx + dy * dy + dz * dz <= radiusSq )
+				idList.push_back( object.id );
+		}
+
+		if( entry.level + 1 < m_numLevels )
+		{
+			for( int child = 3; child >= 0; --child )
+			{
+				const StackEntry childEntry = { entry.level + 1,
+												( entry.x * 2 ) + ( child & 1 ),
+												( entry.z * 2 ) + ( child >> 1 ) };
+				stack[ stackSize++ ] = childEntry;
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: QueryFrustum()
+// Desc: Adds the ids of all objects whose boxes are at least partly inside a
+//		 frustum, in terrain space, to a list. The four children of a node are
+//		 tested together, and everything below a child wholly inside is added
+//		 without further tests.
+//------------------------------------------------------------------------------
+void LooseQuadtree::QueryFrustum( const Frustum& frustum,
+								  std::vector<unsigned int>& idList ) const
+{
+	if( m_nodes[ 0 ].numObjects == 0 )
+		return;
+
+	//only nodes crossing the edge of the frustum go on the stack - as for
+	//QueryBox(), the root is never tested itself
+	StackEntry stack[ MAX_STACK ];
+	int stackSize = 0;
+	const StackEntry root = { 0, 0, 0 };
+	stack[ stackSize++ ] = root;
+
+	while( stackSize > 0 )
+	{
+		const StackEntry entry = stack[ --stackSize ];
+		TestObjects( frustum, GetNode( entry.level, entry.x, entry.z ), idList );
+
+		if( entry.level + 1 >= m_numLevels )
+			continue;
+
+		//test the children as a group
+		StackEntry childEntries[ 4 ];
+		float minX[ 4 ], minY[ 4 ], minZ[ 4 ];
+		float maxX[ 4 ], maxY[ 4 ], maxZ[ 4 ];
+		unsigned int nonEmpty = 0;
+
+		for( int child = 0; child < 4; ++child )
+		{
+			StackEntry& childEntry = childEntries[ child ];
+			childEntry.level	= entry.level + 1;
+			childEntry.x		= ( entry.x * 2 ) + ( child & 1 );
+			childEntry.z		= ( entry.z * 2 ) + ( child >> 1 );
+
+			Vector3 vNodeMin, vNodeMax;
+			GetLooseBounds( childEntry.level, childEntry.x, childEntry.z,
+							vNodeMin, vNodeMax );
+			minX[ child ] = vNodeMin.x;
+			minY[ child ] = vNodeMin.y;
+			minZ[ child ] = vNodeMin.z;
+			maxX[ child ] = vNodeMax.x;
+			maxY[ child ] = vNodeMax.y;
+			maxZ[ child ] = vNodeMax.z;
+
+			if( m_nodes[ GetNode( childEntry.level, childEntry.x, childEntry.z ) ].numObjects > 0 )
+				nonEmpty |= 1 << child;
+		}
+
+		if( nonEmpty == 0 )
+			continue;
+
+		const CullMasks masks = IntersectFrustum4( frustum, minX, minY, minZ,
+												   maxX, maxY, maxZ );
+
+		for( int child = 3; child >= 0; --child )
+		{
+			if( !( nonEmpty & ( 1 << child ) ) )
+				continue;
+
+			if( masks.inside & ( 1 << child ) )
+				AddAllObjects( childEntries[ child ], idList );
+			else if( masks.intersecting & ( 1 << child ) )
+				stack[ stackSize++ ] = childEntries[ child ];
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: TestObjects()
+// Desc: Tests the objects held by a single node against a frustum, four at a
+//		 time, and adds the ids of those not outside it to a list
+//------------------------------------------------------------------------------
+void LooseQuadtree::TestObjects( const Frustum& frustum, const int node,
+								 std::vector<unsigned int>& idList ) const
+{
+	float minX[ 4 ], minY[ 4 ], minZ[ 4 ];
+	float maxX[ 4 ], maxY[ 4 ], maxZ[ 4 ];
+	unsigned int ids[ 4 ];
+	int count = 0;
+
+	int handle = m_nodes[ node ].firstObject;
+	while( handle >= 0 || count > 0 )
+	{
+		if( handle >= 0 )
+		{
+			const Object& object = m_objects[ handle ];
+			minX[ count ] = object.vMin.x;
+			minY[ count ] = object.vMin.y;
+			minZ[ count ] = object.vMin.z;
+			maxX[ count ] = object.vMax.x;
+			maxY[ count ] = object.vMax.y;
+			maxZ[ count ] = object.vMax.z;
+			ids[ count ] = object.id;
+			++count;
+			handle = object.next;
+
+			if( count < 4 && handle >= 0 )
+				continue;
+		}
+
+		//a full group, or whatever is left at the end of the list
+		const CullMasks masks = ( count == 4 )
+			? IntersectFrustum4( frustum, minX, minY, minZ, maxX, maxY, maxZ )
+			: IntersectFrustumReference( frustum, count, minX, minY, minZ,
+										 maxX, maxY, maxZ );
+
+		for( int i = 0; i < count; ++i )
+		{
+			if( !( masks.outside & ( 1 << i ) ) )
+				idList.push_back( ids[ i ] );
+		}
+		count = 0;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: AddAllObjects()
+// Desc: Adds the ids of every object in a node and all of the nodes below it
+//		 to a list
+//------------------------------------------------------------------------------
+void LooseQuadtree::AddAllObjects( const StackEntry& start,
+								   std::vector<unsigned int>& idList ) const
+{
+	StackEntry stack[ MAX_STACK ];
+	int stackSize = 0;
+	stack[ stackSize++ ] = start;
+
+	while( stackSize > 0 )
+	{
+		const StackEntry entry = stack[ --stackSize ];
+		const Node& node = m_nodes[ GetNode( entry.level, entry.x, entry.z ) ];
+
+		if( node.numObjects == 0 )
+			continue;
+
+		for( int handle = node.firstObject; handle >= 0; handle = m_objects[ handle ].next )
+			idList.push_back( m_objects[ handle ].id );
+
+		if( entry.level + 1 < m_numLevels )
+		{
+			for( int child = 3; child >= 0; --child )
+			{
+				const StackEntry childEntry = { entry.level + 1,
+												( entry.x * 2 ) + ( child & 1 ),
+												( entry.z * 2 ) + ( child >> 1 ) };
+				stack[ stackSize++ ] = childEntry;
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: Fits()
+// Desc: Checks whether a box is inside a node's loose bounds across the terrain
+//------------------------------------------------------------------------------
+bool LooseQuadtree::Fits( const int level, const int x, const int z,
+						  const Vector3& vMin, const Vector3& vMax ) const
+{
+	const float width = GetCellWidth( level );
+	const float halfWidth = 0.5f * width;
+
+	return vMin.x >= ( float( x ) * width ) - halfWidth &&
+		   vMax.x <= ( float( x + 1 ) * width ) + halfWidth &&
+		   vMin.z >= ( float( z ) * width ) - halfWidth &&
+		   vMax.z <= ( float( z + 1 ) * width ) + halfWidth;
+}
+
+//------------------------------------------------------------------------------
+// Name: GetLooseBounds()
+// Desc: Retrieves the bounding box of a node - its cell grown by half its width
+//		 on each side, and the height range of the objects below it
+//------------------------------------------------------------------------------
+void LooseQuadtree::GetLooseBounds( const int level, const int x, const int z,
+									Vector3& vMin, Vector3& vMax ) const
+{
+	const float width = GetCellWidth( level );
+	const float halfWidth = 0.5f * width;
+	const Node& node = m_nodes[ GetNode( level, x, z ) ];
+
+	vMin = Vector3( ( float( x ) * width ) - halfWidth, node.minY,
+						( float( z ) * width ) - halfWidth );
+	vMax = Vector3( ( float( x + 1 ) * width ) + halfWidth, node.maxY,
+						( float( z + 1 ) * width ) + halfWidth );
+}
+
+//------------------------------------------------------------------------------
+// Name: Link()
+// Desc: Places an object in the deepest node whose cells are at least as wide as
+//		 it, by its centre - anything off the edge of the terrain moves up until
+//		 it fits, which may be as far as the root
+//------------------------------------------------------------------------------
+void LooseQuadtree::Link( const int handle )
+{
+	Object& object = m_objects[ handle ];
+
+	const float extent = max( object.vMax.x - object.vMin.x, object.vMax.z - object.vMin.z );
+	const float centreX = 0.5f * ( object.vMin.x + object.vMax.x );
+	const float centreZ = 0.5f * ( object.vMin.z + object.vMax.z );
+
+	int level = m_numLevels - 1;
+	while( level > 0 && extent > GetCellWidth( level ) )
+		--level;
+
+	int x = 0;
+	int z = 0;
+	for( ; level > 0; --level )
+	{
+		const int lastCell = ( 1 << level ) - 1;
+		const float width = GetCellWidth( level );
+		x = min( max( int( floor( centreX / width ) ), 0 ), lastCell );
+		z = min( max( int( floor( centreZ / width ) ), 0 ), lastCell );
+
+		if( Fits( level, x, z, object.vMin, object.vMax ) )
+			break;
+	}
+
+	if( level == 0 )
+	{
+		x = 0;
+		z = 0;
+	}
+
+	//add it to the front of the node's list
+	Node& node = m_nodes[ GetNode( level, x, z ) ];
+	object.level	= level;
+	object.x		= x;
+	object.z		= z;
+	object.prev		= -1;
+	object.next		= node.firstObject;
+	if( node.firstObject >= 0 )
+		m_objects[ node.firstObject ].prev = handle;
+	node.firstObject = handle;
+
+	//count it in every node up to the root
+	for( int up = 0; up <= level; ++up )
+		++m_nodes[ GetNode( level - up, x >> up, z >> up ) ].numObjects;
+
+	GrowY( level, x, z, object.vMin.y, object.vMax.y );
+}
+
+//------------------------------------------------------------------------------
+// Name: Unlink()
+// Desc: Takes an object out of its node's list. Nodes left with nothing below
+//		 them have their height range emptied.
+//------------------------------------------------------------------------------
+void LooseQuadtree::Unlink( const int handle )
+{
+	const Object& object = m_objects[ handle ];
+
+	if( object.prev >= 0 )
+		m_objects[ object.prev ].next = object.next;
+	else
+		m_nodes[ GetNode( object.level, object.x, object.z ) ].firstObject = object.next;
+
+	if( object.next >= 0 )
+		m_objects[ object.next ].prev = object.prev;
+
+	for( int up = 0; up <= object.level; ++up )
+	{
+		Node& node = m_nodes[ GetNode( object.level - up, object.x >> up, object.z >> up ) ];
+		if( --node.numObjects == 0 )
+		{
+			node.minY = FLT_MAX;
+			node.maxY = -FLT_MAX;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: GrowY()
+// Desc: Widens the height range of a node and those above it to cover a new
+//		 range. A parent's range always covers its children's, so this stops at
+//		 the first node that already covers it.
+//------------------------------------------------------------------------------
+void LooseQuadtree::GrowY( int level, int x, int z, const float minY, const float maxY )
+{
+	for( ; level >= 0; --level, x >>= 1, z >>= 1 )
+	{
+		Node& node = m_nodes[ GetNode( level, x, z ) ];
+		if( minY >= node.minY && maxY <= node.maxY )
+			break;
+
+		node.minY = min( node.minY, minY );
+		node.maxY = max( node.maxY, maxY );
+	}
+}
@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------
+// File: LooseQuadtree.h
+// Desc: A loose quadtree over the terrain, for finding moving objects near a
+//		 point or inside a view
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_LOOSEQUADTREE_H
+#define INCLUSIONGUARD_LOOSEQUADTREE_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <vector>
+
+#include "Platform.h"
+#include "VectorMath.h"
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+struct Frustum;
+
+//------------------------------------------------------------------------------
+// Name: class LooseQuadtree
+// Desc: Each node's bounds are its cell grown by half its width on every side,
+//		 so an object can be placed by its centre and size alone, and only has
+//		 to move when it leaves those bounds. Levels are stored as flat grids,
+//		 root first, and the leaves match the terrain's cells. Positions are in
+//		 terrain space, not relative to the floating origin. Objects are looked
+//		 up by the handle Insert() returns, and queries add the ids they were
+//		 given.
+//------------------------------------------------------------------------------
+class LooseQuadtree
+{
+public:
+	LooseQuadtree( const int cellsDim, const float cellSize );
+
+	int Insert( const Vector3& vMin, const Vector3& vMax, const unsigned int id );
+	void Update( const int handle, const Vector3& vMin, const Vector3& vMax );
+	void Remove( const int handle );
+
+	void QueryBox( const Vector3& vMin, const Vector3& vMax,
+				   std::vector<unsigned int>& idList ) const;
+	void QueryRadius( const Vector3& vCentre, const float radius,
+					  std::vector<unsigned int>& idList ) const;
+	void QueryFrustum( const Frustum& frustum, std::vector<unsigned int>& idList ) const;
+
+	inline unsigned int GetNumObjects() const { return m_nodes[ 0 ].numObjects; }
+
+private:
+	//deep enough for 2^15 cells per edge
+	const static int MAX_LEVELS = 16;
+	const static int MAX_STACK = 3 * MAX_LEVELS + 1;
+
+	struct Node
+	{
+		int firstObject;			//head of the list of objects in this node
+		unsigned int numObjects;	//objects in this node and all below it
+		float minY, maxY;			//covers every object below - only ever grows
+									//until the node is empty
+	};
+
+	struct Object
+	{
+		Vector3 vMin;
+		Vector3 vMax;
+		unsigned int id;
+		int level, x, z;			//node holding it
+		int prev, next;				//links in the node's list, or the free list
+		bool inUse;					//false once removed, until the handle is
+									//given out again
+	};
+
+	//a node waiting to be visited by a query
+	struct StackEntry
+	{
+		int level;
+		int x, z;
+	};
+
+	inline int GetNode( const int level, const int x, const int z ) const
+	{
+		return m_levelStart[ level ] + x + ( z << level );
+	}
+
+	inline float GetCellWidth( const int level ) const
+	{
+		return m_size / float( 1 << level );
+	}
+
+	inline bool IsLive( const int handle ) const
+	{
+		return handle >= 0 && handle < int( m_objects.size() ) && m_objects[ handle ].inUse;
+	}
+
+	bool Fits( const int level, const int x, const int z, const Vector3& vMin,
+			   const Vector3& vMax ) const;
+	void GetLooseBounds( const int level, const int x, const int z,
+						 Vector3& vMin, Vector3& vMax ) const;
+
+	void Link( const int handle );
+	void Unlink( const int handle );
+	void GrowY( int level, int x, int z, const float minY, const float maxY );
+
+	void TestObjects( const Frustum& frustum, const int node,
+					  std::vector<unsigned int>& idList ) const;
+	void AddAllObjects( const StackEntry& start, std::vector<unsigned int>& idList ) const;
+
+	float m_size;
+	int m_numLevels;
+	int m_levelStart[ MAX_LEVELS ];
+
+	std::vector<Node> m_nodes;
+	std::vector<Object> m_objects;
+	int m_firstFree;
+
+};
+
+
+#endif //INCLUSIONGUARD_LOOSEQUADTREE_H
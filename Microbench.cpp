@@ -0,0 +1,1253 @@
+//------------------------------------------------------------------------------
+// File: Microbench.cpp
+// Desc: Headless microbenchmarks - times each hot kernel on its own, on fixed
+//		 inputs, and can save the results as a baseline or compare them
+//		 against one to catch a kernel getting slower
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <string>
+
+#include "Benchmark.h"
+#include "Camera.h"
+#include "ChaseCam.h"
+#include "Frustum.h"
+#include "LooseQuadtree.h"
+#include "ParticleSystem.h"
+#include "Quadtree.h"
+#include "ShadowVolume.h"
+#include "Simulation.h"
+#include "Terrain.h"
+#include "Vehicle.h"
+#include "VehicleCollisions.h"
+#include "VehicleFleet.h"
+#include "WorkerPool.h"
+
+
+//------------------------------------------------------------------------------
+// Constants:
+//------------------------------------------------------------------------------
+
+//a kernel is run for at least this long each time it is timed, and timed this
+//many times - the median is reported, so a stray slow run does not count
+const double	MIN_RUN_SECONDS		= 0.02;
+const int		NUM_REPETITIONS		= 7;
+
+//a kernel is flagged if it is this much slower than its baseline, in percent
+const double	DEFAULT_TOLERANCE	= 15.0;
+
+//the inputs - fixed, so two runs do the same work
+const int		NUM_POINTS			= 4096;
+const int		NUM_VIEWS			= 8;
+const int		NUM_BOXES			= 256;
+const float		ASPECT_RATIO		= 4.0f / 3.0f;
+const float		FAR_PLANE			= 350.0f;
+const int		QUADTREE_CELLS_DIM	= 32;
+const float		QUADTREE_CELL_SIZE	= 160.0f;
+const int		LARGE_CELLS_DIM		= 256;
+const int		NUM_MOVING_OBJECTS	= 10000;
+const float		MOVING_OBJECT_SIZE	= 6.0f;
+const int		NUM_FLEET_EDGE		= 16;
+const float		FLEET_SPACING		= 8.0f;
+const float		FLEET_SPREAD_SPACING	= 48.0f;
+const int		FLEET_DRIVING_EVERY	= 16;
+const int		FLEET_SETTLE_STEPS	= 3600;
+const float		COLLISION_SPACING	= 7.0f;
+const float		COLLISION_ROW_SPACING	= 5.8f;
+const float		COLLISION_SLIDE		= 0.05f;
+const int		COLLISION_SWING		= 200;
+const int		ROLLBACK_FRAMES		= 8;
+const int		NUM_PARTICLES		= 10000;
+const float		PARTICLE_LIFETIME	= 2.0f;
+const unsigned int SEED				= 1;
+const float		FRAME_TIME			= 1.0f / 60.0f;
+const float		PHYSICS_STEP		= 1.0f / float( Simulation::DEFAULT_STEPS_PER_SECOND );
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: class Kernel
+// Desc: A kernel to be timed. Reset() puts back the state it starts from, and
+//		 Run() does the given number of operations on it.
+//------------------------------------------------------------------------------
+class Kernel
+{
+public:
+	Kernel( const std::string& name, const char* itemName, const double itemsPerOp )
+		: m_name( name ), m_itemName( itemName ), m_itemsPerOp( itemsPerOp ) {}
+	virtual ~Kernel() {}
+
+	virtual void Reset() {}
+	virtual void Run( const int numOps ) = 0;
+
+	inline const char* GetName() const { return m_name.c_str(); }
+	inline const char* GetItemName() const { return m_itemName; }
+	inline double GetItemsPerOp() const { return m_itemsPerOp; }
+
+protected:
+	std::string m_name;
+	const char* m_itemName;
+	double m_itemsPerOp;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: struct KernelResult
+// Desc: The time a kernel took, as it is saved in a baseline
+//------------------------------------------------------------------------------
+struct KernelResult
+{
+	std::string name;
+	double nsPerOp;
+	double itemsPerSecond;
+};
+
+//results are added into this so the kernels are not optimised away
+static volatile float g_sink = 0.0f;
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: GetViewFrustum()
+// Desc: Builds one of the fixed views - looking out from above the middle of
+//		 an area of the given size, tipped down a little, turned 360/NUM_VIEWS
+//		 degrees further round for each view
+//------------------------------------------------------------------------------
+static Frustum GetViewFrustum( const int view, const float areaSize, Vector3& vEye )
+{
+	const float angle = ( 2.0f * MATHS_PI * float( view ) ) / float( NUM_VIEWS );
+	vEye = Vector3( areaSize * 0.5f, 120.0f, areaSize * 0.5f );
+	const Vector3 vLookAt = vEye + Vector3( sinf( angle ) * 100.0f, -20.0f,
+											cosf( angle ) * 100.0f );
+
+	Camera camera;
+	Matrix4 matProj;
+	Mat4PerspectiveFovLH( matProj, MATHS_PI/4, ASPECT_RATIO, 1.0f, FAR_PLANE );
+	camera.SetProjection( matProj );
+	camera.SetCamera( vEye, vLookAt, Vector3( 0.0f, 1.0f, 0.0f ) );
+
+	return ExtractFrustum( camera.GetView(), matProj );
+}
+
+//------------------------------------------------------------------------------
+// Name: FindHollow()
+// Desc: Walks downhill from a point a metre at a time, to the bottom of the
+//		 hollow it is in
+//------------------------------------------------------------------------------
+static void FindHollow( const Terrain* pTerrain, float& x, float& z )
+{
+	float height = pTerrain->GetHeightMapPoint( x, z );
+	for( ;; )
+	{
+		float lowestX = x;
+		float lowestZ = z;
+		float lowest = height;
+		for( int stepZ = -1; stepZ <= 1; ++stepZ )
+		{
+			for( int stepX = -1; stepX <= 1; ++stepX )
+			{
+				const float sample = pTerrain->GetHeightMapPoint( x + float( stepX ),
+																  z + float( stepZ ) );
+				if( sample < lowest )
+				{
+					lowest = sample;
+					lowestX = x + float( stepX );
+					lowestZ = z + float( stepZ );
+				}
+			}
+		}
+
+		if( lowest >= height )
+			return;
+		x = lowestX;
+		z = lowestZ;
+		height = lowest;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: class HeightMapPointKernel
+// Desc: Looks up the height of the terrain at points spread over all of it
+//------------------------------------------------------------------------------
+class HeightMapPointKernel : public Kernel
+{
+public:
+	HeightMapPointKernel( const Terrain* pTerrain )
+		: Kernel( "Terrain::GetHeightMapPoint", "points", NUM_POINTS ), m_pTerrain( pTerrain )
+	{
+		//a fixed scatter, kept off the last row and column
+		const float size = pTerrain->GetTerrainSize() * 0.999f;
+		for( int point = 0; point < NUM_POINTS; ++point )
+		{
+			m_x[ point ] = fmodf( float( point ) * 97.31f, size );
+			m_z[ point ] = fmodf( float( point ) * 211.77f + 13.0f, size );
+		}
+	}
+
+	void Run( const int numOps )
+	{
+		float total = 0.0f;
+		for( int op = 0; op < numOps; ++op )
+		{
+			for( int point = 0; point < NUM_POINTS; ++point )
+				total += m_pTerrain->GetHeightMapPoint( m_x[ point ], m_z[ point ] );
+		}
+		g_sink = g_sink + total;
+	}
+
+private:
+	const Terrain* m_pTerrain;
+	float m_x[ NUM_POINTS ];
+	float m_z[ NUM_POINTS ];
+
+};
+
+//------------------------------------------------------------------------------
+// Name: class PerlinNoiseKernel
+// Desc: Generates heightmap points as Terrain's constructor does, along a
+//		 strip of rows
+//------------------------------------------------------------------------------
+class PerlinNoiseKernel : public Kernel
+{
+public:
+	PerlinNoiseKernel( const Terrain* pTerrain )
+		: Kernel( "Terrain::PerlinNoise2D", "points", NUM_POINTS ), m_pTerrain( pTerrain ) {}
+
+	void Run( const int numOps )
+	{
+		float total = 0.0f;
+		for( int op = 0; op < numOps; ++op )
+		{
+			for( int point = 0; point < NUM_POINTS; ++point )
+				total += m_pTerrain->PerlinNoise2D( float( point & 255 ), float( point >> 8 ) );
+		}
+		g_sink = g_sink + total;
+	}
+
+private:
+	const Terrain* m_pTerrain;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: class IntersectFrustumKernel
+// Desc: Tests a grid of boxes against one of the fixed views, four at a time
+//------------------------------------------------------------------------------
+class IntersectFrustumKernel : public Kernel
+{
+public:
+	IntersectFrustumKernel()
+		: Kernel( "IntersectFrustum4", "boxes", NUM_BOXES )
+	{
+		const int boxesDim = 16;
+		const float boxSize = QUADTREE_CELL_SIZE;
+		Vector3 vEye;
+		m_frustum = GetViewFrustum( 1, boxSize * boxesDim, vEye );
+
+		for( int box = 0; box < NUM_BOXES; ++box )
+		{
+			const float x = float( box % boxesDim ) * boxSize;
+			const float z = float( box / boxesDim ) * boxSize;
+			m_minX[ box ] = x;
+			m_minY[ box ] = 0.0f;
+			m_minZ[ box ] = z;
+			m_maxX[ box ] = x + boxSize;
+			m_maxY[ box ] = 40.0f + float( box % 7 ) * 10.0f;
+			m_maxZ[ box ] = z + boxSize;
+		}
+	}
+
+	void Run( const int numOps )
+	{
+		unsigned int masks = 0;
+		for( int op = 0; op < numOps; ++op )
+		{
+			for( int box = 0; box < NUM_BOXES; box += 4 )
+			{
+				const CullMasks result = IntersectFrustum4( m_frustum,
+					&m_minX[ box ], &m_minY[ box ], &m_minZ[ box ],
+					&m_maxX[ box ], &m_maxY[ box ], &m_maxZ[ box ] );
+				masks += result.inside + result.outside;
+			}
+		}
+		g_sink = g_sink + float( masks );
+	}
+
+private:
+	Frustum m_frustum;
+	float m_minX[ NUM_BOXES ];
+	float m_minY[ NUM_BOXES ];
+	float m_minZ[ NUM_BOXES ];
+	float m_maxX[ NUM_BOXES ];
+	float m_maxY[ NUM_BOXES ];
+	float m_maxZ[ NUM_BOXES ];
+
+};
+
+//------------------------------------------------------------------------------
+// Name: class AddVisibleNodesKernel
+// Desc: Culls a quadtree from each of the fixed views - on a pool of threads
+//		 as well as the calling one, if given one. The tree covers the same area
+//		 as the terrain, split into cellsDim cells along each edge, and its
+//		 heights are made up, so the terrain is not needed.
+//------------------------------------------------------------------------------
+class AddVisibleNodesKernel : public Kernel
+{
+public:
+	AddVisibleNodesKernel( const std::string& name, const int cellsDim, WorkerPool* pPool )
+		: Kernel( name, "visible cells", 0.0 ),
+		  m_quadtree( cellsDim, ( QUADTREE_CELLS_DIM * QUADTREE_CELL_SIZE ) / cellsDim ),
+		  m_pPool( pPool )
+	{
+		//the same hills whatever size the cells are
+		const float cellScale = float( QUADTREE_CELLS_DIM ) / float( cellsDim );
+		unsigned int baseVertex = 0;
+		for( int cellZ = 0; cellZ < cellsDim; ++cellZ )
+		{
+			for( int cellX = 0; cellX < cellsDim; ++cellX )
+			{
+				const float x = float( cellX ) * cellScale;
+				const float z = float( cellZ ) * cellScale;
+				const float minY = 20.0f * ( sinf( x * 0.7f ) + 1.0f );
+				const float maxY = minY + 30.0f + 20.0f * cosf( z * 0.4f );
+				m_quadtree.SetLeaf( cellX, cellZ, minY, maxY, baseVertex );
+				baseVertex += 1;
+			}
+		}
+		m_quadtree.FitBounds();
+
+		const float areaSize = QUADTREE_CELLS_DIM * QUADTREE_CELL_SIZE;
+		for( int view = 0; view < NUM_VIEWS; ++view )
+			m_frustums[ view ] = GetViewFrustum( view, areaSize, m_vEyes[ view ] );
+
+		//an op culls every view, and the cells found are the same each time
+		m_nodeList.reserve( cellsDim * cellsDim );
+		m_itemsPerOp = double( Cull() );
+	}
+	~AddVisibleNodesKernel() { delete m_pPool; }
+
+	void Run( const int numOps )
+	{
+		unsigned int numNodes = 0;
+		for( int op = 0; op < numOps; ++op )
+			numNodes += Cull();
+		g_sink = g_sink + float( numNodes );
+	}
+
+private:
+	unsigned int Cull()
+	{
+		unsigned int numNodes = 0;
+		for( int view = 0; view < NUM_VIEWS; ++view )
+		{
+			m_nodeList.clear();
+			if( m_pPool )
+			{
+				m_quadtree.AddVisibleNodesParallel( m_frustums[ view ], m_vEyes[ view ],
+													*m_pPool, m_nodeList );
+			}
+			else
+				m_quadtree.AddVisibleNodes( m_frustums[ view ], m_vEyes[ view ], m_nodeList );
+			numNodes += m_nodeList.size();
+		}
+		return numNodes;
+	}
+
+	Quadtree m_quadtree;
+	WorkerPool* m_pPool;
+	Frustum m_frustums[ NUM_VIEWS ];
+	Vector3 m_vEyes[ NUM_VIEWS ];
+	std::vector<unsigned int> m_nodeList;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: AddCullKernels()
+// Desc: Adds the serial quadtree cull at the terrain's size and a much finer
+//		 one, and the parallel cull of each on 1, 2, 4 and so on up to all the
+//		 processors - each kernel owns its pool
+//------------------------------------------------------------------------------
+static void AddCullKernels( std::vector<Kernel*>& kernels )
+{
+	const int SIZES[] = { QUADTREE_CELLS_DIM, LARGE_CELLS_DIM };
+	const int numProcessors = WorkerPool::GetNumProcessors();
+
+	for( int size = 0; size < 2; ++size )
+	{
+		const int cellsDim = SIZES[ size ];
+		char name[ 64 ];
+		if( cellsDim == QUADTREE_CELLS_DIM )
+			sprintf( name, "Quadtree::AddVisibleNodes" );
+		else
+			sprintf( name, "Quadtree::AddVisibleNodes/%dx%d", cellsDim, cellsDim );
+		kernels.push_back( new AddVisibleNodesKernel( name, cellsDim, NULL ) );
+
+		for( int cores = 1; ; cores *= 2 )
+		{
+			if( cores > numProcessors )
+				cores = numProcessors;
+
+			//the calling thread takes items too
+			const int numThreads = ( cores - 1 < WorkerPool::MAX_THREADS ) ?
+								   cores - 1 : WorkerPool::MAX_THREADS;
+			sprintf( name, "Quadtree::AddVisibleNodesParallel/%dx%d/%d", cellsDim, cellsDim,
+					 numThreads + 1 );
+			WorkerPool* pPool = new WorkerPool( numThreads );
+			try{ kernels.push_back( new AddVisibleNodesKernel( name, cellsDim, pPool ) ); }
+			catch( std::bad_alloc& )
+			{
+				delete pPool;
+				throw;
+			}
+
+			if( cores >= numProcessors || numThreads == WorkerPool::MAX_THREADS )
+				break;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: class LooseQuadtreeKernel
+// Desc: Moves vehicle sized boxes across a loose quadtree the size of the
+//		 terrain, a frame at a time, and finds those inside one of the fixed
+//		 views after each frame. Boxes leaving the terrain come back on the far
+//		 side.
+//------------------------------------------------------------------------------
+class LooseQuadtreeKernel : public Kernel
+{
+public:
+	LooseQuadtreeKernel()
+		: Kernel( "LooseQuadtree::Update", "objects", NUM_MOVING_OBJECTS ),
+		  m_size( QUADTREE_CELLS_DIM * QUADTREE_CELL_SIZE ), m_pTree( NULL )
+	{
+		Vector3 vEye;
+		m_frustum = GetViewFrustum( 2, m_size, vEye );
+		m_idList.reserve( NUM_MOVING_OBJECTS );
+	}
+	~LooseQuadtreeKernel() { delete m_pTree; }
+
+	void Reset()
+	{
+		delete m_pTree;
+		m_pTree = NULL;
+		m_pTree = new LooseQuadtree( QUADTREE_CELLS_DIM, QUADTREE_CELL_SIZE );
+
+		//a fixed scatter, each heading its own way at up to 40 units a second
+		for( int object = 0; object < NUM_MOVING_OBJECTS; ++object )
+		{
+			const float angle = float( object ) * 2.39996f;
+			const float speed = 5.0f + float( object % 8 ) * 5.0f;
+			m_positions[ object ] = Vector3( fmodf( float( object ) * 97.31f, m_size ),
+											 20.0f + float( object % 13 ) * 3.0f,
+											 fmodf( float( object ) * 211.77f + 13.0f, m_size ) );
+			m_velocities[ object ] = Vector3( sinf( angle ) * speed, 0.0f,
+											  cosf( angle ) * speed );
+
+			Vector3 vMin, vMax;
+			GetBounds( object, vMin, vMax );
+			m_handles[ object ] = m_pTree->Insert( vMin, vMax, object );
+		}
+	}
+
+	void Run( const int numOps )
+	{
+		unsigned int numFound = 0;
+		for( int op = 0; op < numOps; ++op )
+		{
+			for( int object = 0; object < NUM_MOVING_OBJECTS; ++object )
+			{
+				Vector3& vPosition = m_positions[ object ];
+				vPosition += m_velocities[ object ] * FRAME_TIME;
+				if( vPosition.x < 0.0f )
+					vPosition.x += m_size;
+				else if( vPosition.x >= m_size )
+					vPosition.x -= m_size;
+				if( vPosition.z < 0.0f )
+					vPosition.z += m_size;
+				else if( vPosition.z >= m_size )
+					vPosition.z -= m_size;
+
+				Vector3 vMin, vMax;
+				GetBounds( object, vMin, vMax );
+				m_pTree->Update( m_handles[ object ], vMin, vMax );
+			}
+
+			m_idList.clear();
+			m_pTree->QueryFrustum( m_frustum, m_idList );
+			numFound += m_idList.size();
+		}
+		g_sink = g_sink + float( numFound );
+	}
+
+private:
+	inline void GetBounds( const int object, Vector3& vMin, Vector3& vMax ) const
+	{
+		const Vector3 vHalfSize( MOVING_OBJECT_SIZE * 0.5f, MOVING_OBJECT_SIZE * 0.25f,
+								 MOVING_OBJECT_SIZE * 0.5f );
+		vMin = m_positions[ object ] - vHalfSize;
+		vMax = m_positions[ object ] + vHalfSize;
+	}
+
+	float m_size;
+	LooseQuadtree* m_pTree;
+	Frustum m_frustum;
+	Vector3 m_positions[ NUM_MOVING_OBJECTS ];
+	Vector3 m_velocities[ NUM_MOVING_OBJECTS ];
+	int m_handles[ NUM_MOVING_OBJECTS ];
+	std::vector<unsigned int> m_idList;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: class ExtractFrustumKernel
+// Desc: Extracts the world space frustum of each of the fixed views
+//------------------------------------------------------------------------------
+class ExtractFrustumKernel : public Kernel
+{
+public:
+	ExtractFrustumKernel()
+		: Kernel( "ExtractFrustum", "frustums", NUM_VIEWS )
+	{
+		Mat4PerspectiveFovLH( m_matProj, MATHS_PI/4, ASPECT_RATIO, 1.0f, FAR_PLANE );
+		for( int view = 0; view < NUM_VIEWS; ++view )
+		{
+			const float angle = ( 2.0f * MATHS_PI * float( view ) ) / float( NUM_VIEWS );
+			const Vector3 vEye( 2560.0f, 120.0f, 2560.0f );
+			const Vector3 vLookAt = vEye + Vector3( sinf( angle ), -0.2f, cosf( angle ) );
+
+			Camera camera;
+			camera.SetProjection( m_matProj );
+			camera.SetCamera( vEye, vLookAt, Vector3( 0.0f, 1.0f, 0.0f ) );
+			m_matViews[ view ] = camera.GetView();
+		}
+	}
+
+	void Run( const int numOps )
+	{
+		float total = 0.0f;
+		for( int op = 0; op < numOps; ++op )
+		{
+			for( int view = 0; view < NUM_VIEWS; ++view )
+			{
+				const Frustum frustum = ExtractFrustum( m_matViews[ view ], m_matProj );
+				total += frustum.planes[ 0 ].d;
+			}
+		}
+		g_sink = g_sink + total;
+	}
+
+private:
+	Matrix4 m_matProj;
+	Affine m_matViews[ NUM_VIEWS ];
+
+};
+
+//------------------------------------------------------------------------------
+// Name: class ShadowVolumeKernel
+// Desc: Builds the shadow volume of the stand-in hull from a fixed light
+//------------------------------------------------------------------------------
+class ShadowVolumeKernel : public Kernel
+{
+public:
+	ShadowVolumeKernel( ShadowVolume* pShadowVolume )
+		: Kernel( "ShadowVolume::BuildFromMesh", "mesh faces", 0.0 ),
+		  m_pShadowVolume( pShadowVolume )
+	{
+		BuildStandInHull( m_vertices, m_indices );
+		m_numFaces = DWORD( m_indices.size() / 3 );
+		m_itemsPerOp = double( m_numFaces );
+		m_vLight = Vec3Normalize( Vector3( 5.0f, -5.0f, 5.0f ) );
+	}
+
+	void Run( const int numOps )
+	{
+		int numVertices = 0;
+		for( int op = 0; op < numOps; ++op )
+		{
+			m_pShadowVolume->Reset();
+			m_pShadowVolume->BuildFromMesh( &m_vertices[ 0 ], &m_indices[ 0 ], m_numFaces,
+											m_vLight );
+			numVertices += m_pShadowVolume->GetNumVertices();
+		}
+		g_sink = g_sink + float( numVertices );
+	}
+
+private:
+	ShadowVolume* m_pShadowVolume;
+	std::vector<Vector3> m_vertices;
+	std::vector<WORD> m_indices;
+	DWORD m_numFaces;
+	Vector3 m_vLight;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: class ParticlesKernel
+// Desc: Steps the dust trail a frame at a time, from a freshly seeded system
+//------------------------------------------------------------------------------
+class ParticlesKernel : public Kernel
+{
+public:
+	ParticlesKernel()
+		: Kernel( "ParticleSystem::UpdateParticles", "particles", NUM_PARTICLES ),
+		  m_pParticles( NULL ) {}
+	~ParticlesKernel() { delete m_pParticles; }
+
+	void Reset()
+	{
+		delete m_pParticles;
+		m_pParticles = NULL;
+		m_pParticles = new ParticleSystem( NUM_PARTICLES, PARTICLE_LIFETIME, SEED );
+		m_pParticles->SetPosition( Vector3( 100.0f, 20.0f, 100.0f ) );
+		m_pParticles->SetVelocity( Vector3( -10.0f, 0.0f, -20.0f ) );
+	}
+
+	void Run( const int numOps )
+	{
+		for( int op = 0; op < numOps; ++op )
+			m_pParticles->UpdateParticles( FRAME_TIME );
+	}
+
+private:
+	ParticleSystem* m_pParticles;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: class VehiclePhysicsKernel
+// Desc: Steps the vehicle over the terrain, turning left under full thrust,
+//		 from its start in the middle of the terrain
+//------------------------------------------------------------------------------
+class VehiclePhysicsKernel : public Kernel
+{
+public:
+	VehiclePhysicsKernel( const Terrain* pTerrain )
+		: Kernel( "Vehicle::DoPhysics", "steps", 1.0 ),
+		  m_pTerrain( pTerrain ), m_pVehicle( NULL )
+	{
+		BuildStandInHull( m_vertices, m_indices );
+	}
+	~VehiclePhysicsKernel() { delete m_pVehicle; }
+
+	void Reset()
+	{
+		delete m_pVehicle;
+		m_pVehicle = NULL;
+		m_pVehicle = new Vehicle();
+		m_pVehicle->SetMesh( &m_vertices[ 0 ], int( m_vertices.size() ), &m_indices[ 0 ],
+							 int( m_indices.size() / 3 ) );
+
+		//as Simulation::Create()
+		const float centerPoint = m_pTerrain->GetTerrainSize() / 2.0f;
+		const float centerHeight = m_pTerrain->GetHeightMapPoint( centerPoint, centerPoint );
+		m_pVehicle->SetPosition( Vector3( centerPoint, centerHeight + 2.0f, centerPoint ) );
+	}
+
+	void Run( const int numOps )
+	{
+		for( int op = 0; op < numOps; ++op )
+			m_pVehicle->DoPhysics( PHYSICS_STEP, m_pTerrain, true, false, true, false );
+		g_sink = g_sink + m_pVehicle->GetPosition().y;
+	}
+
+private:
+	const Terrain* m_pTerrain;
+	Vehicle* m_pVehicle;
+	std::vector<Vector3> m_vertices;
+	std::vector<WORD> m_indices;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: class FleetStepKernel
+// Desc: Steps a square of NUM_FLEET_EDGE x NUM_FLEET_EDGE vehicles, spacing
+//		 apart, around the LOD centre in the middle of the terrain - at
+//		 FLEET_SPACING all of them are near it, and at FLEET_SPREAD_SPACING
+//		 most are in the tiers stepped less often. One in drivingEvery
+//		 of them drives - with more than one, the rest are parked in the
+//		 hollows below their places, there being no flat ground for them to
+//		 rest on, and left to settle and go to sleep before the timing starts.
+//		 pPool may be NULL, or the kernel owns it.
+//------------------------------------------------------------------------------
+class FleetStepKernel : public Kernel
+{
+public:
+	FleetStepKernel( const std::string& name, const Terrain* pTerrain, WorkerPool* pPool,
+					 const float spacing, const int drivingEvery )
+		: Kernel( name, "vehicles", NUM_FLEET_EDGE * NUM_FLEET_EDGE ),
+		  m_pTerrain( pTerrain ), m_pPool( pPool ), m_pFleet( NULL ), m_spacing( spacing ),
+		  m_drivingEvery( drivingEvery ) {}
+	~FleetStepKernel()
+	{
+		delete m_pFleet;
+		delete m_pPool;
+	}
+
+	void Reset()
+	{
+		delete m_pFleet;
+		m_pFleet = NULL;
+		m_pFleet = new VehicleFleet( NUM_FLEET_EDGE * NUM_FLEET_EDGE );
+
+		const float centre = m_pTerrain->GetTerrainSize() / 2.0f;
+		const float corner = centre - ( m_spacing * float( NUM_FLEET_EDGE - 1 ) * 0.5f );
+		for( int z = 0; z < NUM_FLEET_EDGE; ++z )
+		{
+			for( int x = 0; x < NUM_FLEET_EDGE; ++x )
+			{
+				const bool driving = ( ( ( z * NUM_FLEET_EDGE ) + x ) % m_drivingEvery ) == 0;
+				float posX = corner + ( m_spacing * float( x ) );
+				float posZ = corner + ( m_spacing * float( z ) );
+				if( ! driving )
+					FindHollow( m_pTerrain, posX, posZ );
+				const int vehicle = m_pFleet->AddVehicle(
+					Vector3( posX, m_pTerrain->GetHeightMapPoint( posX, posZ ) + 2.0f, posZ ) );
+
+				//forwards, half of them turning each way
+				if( ! driving )
+					continue;
+				m_pFleet->SetControls( vehicle, VehicleFleet::CONTROL_FORWARD |
+									   ( ( ( vehicle / m_drivingEvery ) & 1 ) ?
+										 VehicleFleet::CONTROL_LEFT :
+										 VehicleFleet::CONTROL_RIGHT ) );
+			}
+		}
+		m_pFleet->SetLodCentre( Vector3( centre, 0.0f, centre ) );
+
+		if( m_drivingEvery > 1 )
+		{
+			for( int step = 0; step < FLEET_SETTLE_STEPS; ++step )
+				m_pFleet->Step( PHYSICS_STEP, m_pTerrain, m_pPool );
+		}
+	}
+
+	void Run( const int numOps )
+	{
+		for( int op = 0; op < numOps; ++op )
+			m_pFleet->Step( PHYSICS_STEP, m_pTerrain, m_pPool );
+		g_sink = g_sink + m_pFleet->GetPosition( 0 ).y;
+	}
+
+private:
+	const Terrain* m_pTerrain;
+	WorkerPool* m_pPool;
+	VehicleFleet* m_pFleet;
+	float m_spacing;
+	int m_drivingEvery;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: AddFleetKernels()
+// Desc: Adds the fleet stepped on the calling thread, with every vehicle
+//		 driving, with most of them asleep and with most of them far from the
+//		 LOD centre, and across a pool of 1, 2, 4 and so on up to all the
+//		 processors
+//------------------------------------------------------------------------------
+static void AddFleetKernels( std::vector<Kernel*>& kernels, const Terrain* pTerrain )
+{
+	const int numProcessors = WorkerPool::GetNumProcessors();
+	kernels.push_back( new FleetStepKernel( "VehicleFleet::Step", pTerrain, NULL,
+											FLEET_SPACING, 1 ) );
+
+	char name[ 64 ];
+	sprintf( name, "VehicleFleet::Step/1in%d", FLEET_DRIVING_EVERY );
+	kernels.push_back( new FleetStepKernel( name, pTerrain, NULL, FLEET_SPACING,
+											FLEET_DRIVING_EVERY ) );
+	kernels.push_back( new FleetStepKernel( "VehicleFleet::Step/tiers", pTerrain, NULL,
+											FLEET_SPREAD_SPACING, 1 ) );
+
+	for( int cores = 1; ; cores *= 2 )
+	{
+		if( cores > numProcessors )
+			cores = numProcessors;
+
+		//the calling thread takes items too
+		const int numThreads = ( cores - 1 < WorkerPool::MAX_THREADS ) ?
+							   cores - 1 : WorkerPool::MAX_THREADS;
+		sprintf( name, "VehicleFleet::StepParallel/%d", numThreads + 1 );
+		WorkerPool* pPool = new WorkerPool( numThreads );
+		try{ kernels.push_back( new FleetStepKernel( name, pTerrain, pPool, FLEET_SPACING, 1 ) ); }
+		catch( std::bad_alloc& )
+		{
+			delete pPool;
+			throw;
+		}
+
+		if( cores >= numProcessors || numThreads == WorkerPool::MAX_THREADS )
+			break;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: class CollisionsKernel
+// Desc: Slides alternate rows of a square of vehicles past each other along
+//		 the sort axis, a little each time, and back again every COLLISION_SWING
+//		 times, and updates the collisions - the broadphase has swaps to make,
+//		 and the rows are close enough that the boxes in neighbouring rows keep
+//		 touching as they pass
+//------------------------------------------------------------------------------
+class CollisionsKernel : public Kernel
+{
+public:
+	CollisionsKernel( const std::string& name, const int numVehicles )
+		: Kernel( name, "vehicles", numVehicles ), m_numVehicles( numVehicles ),
+		  m_edge( 1 ), m_op( 0 ), m_pVehicles( NULL ), m_pCollisions( NULL ) {}
+	~CollisionsKernel()
+	{
+		delete m_pCollisions;
+		delete [] m_pVehicles;
+	}
+
+	void Reset()
+	{
+		delete m_pCollisions;
+		m_pCollisions = NULL;
+		delete [] m_pVehicles;
+		m_pVehicles = NULL;
+
+		m_pVehicles = new Vehicle[ m_numVehicles ];
+		m_pCollisions = new VehicleCollisions();
+
+		int edge = 1;
+		while( edge * edge < m_numVehicles )
+			++edge;
+		for( int vehicle = 0; vehicle < m_numVehicles; ++vehicle )
+		{
+			m_pVehicles[ vehicle ].SetPosition( Vector3( COLLISION_SPACING * float( vehicle % edge ),
+														 10.0f,
+														 COLLISION_ROW_SPACING * float( vehicle / edge ) ) );
+			m_pCollisions->Insert( &m_pVehicles[ vehicle ] );
+		}
+		m_edge = edge;
+		m_op = 0;
+	}
+
+	void Run( const int numOps )
+	{
+		unsigned int numContacts = 0;
+		for( int op = 0; op < numOps; ++op, ++m_op )
+		{
+			const bool back = ( ( m_op / COLLISION_SWING ) & 1 ) != 0;
+			for( int vehicle = 0; vehicle < m_numVehicles; ++vehicle )
+			{
+				const bool right = ( ( ( vehicle / m_edge ) & 1 ) != 0 ) != back;
+				m_pVehicles[ vehicle ].Move( Vector3( right ? COLLISION_SLIDE : -COLLISION_SLIDE,
+													  0.0f, 0.0f ) );
+			}
+			m_pCollisions->Update();
+			numContacts += m_pCollisions->GetNumContacts();
+		}
+		g_sink = g_sink + float( numContacts );
+	}
+
+private:
+	int m_numVehicles;
+	int m_edge;
+	int m_op;
+	Vehicle* m_pVehicles;
+	VehicleCollisions* m_pCollisions;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: AddCollisionsKernels()
+// Desc: Adds the collisions for 64 vehicles and each four times as many up to
+//		 4096, to show how the broadphase scales
+//------------------------------------------------------------------------------
+static void AddCollisionsKernels( std::vector<Kernel*>& kernels )
+{
+	for( int numVehicles = 64; numVehicles <= 4096; numVehicles *= 4 )
+	{
+		char name[ 64 ];
+		sprintf( name, "VehicleCollisions::Update/%d", numVehicles );
+		kernels.push_back( new CollisionsKernel( name, numVehicles ) );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: class SimulationKernel
+// Desc: Advances the simulation a frame at a time, driving forwards and
+//		 turning left, or rolls back the given number of frames and runs them
+//		 again. Every frame saves a snapshot, so the two show what restoring
+//		 one adds. The simulation is shared with the other simulation kernels.
+//------------------------------------------------------------------------------
+class SimulationKernel : public Kernel
+{
+public:
+	SimulationKernel( const std::string& name, Simulation* pSimulation, const int rollbackFrames )
+		: Kernel( name, "frames", ( rollbackFrames > 0 ) ? rollbackFrames : 1 ),
+		  m_pSimulation( pSimulation ), m_rollbackFrames( rollbackFrames ) {}
+
+	void Reset()
+	{
+		while( m_pSimulation->GetNumSnapshots() < m_rollbackFrames )
+			Advance();
+	}
+
+	void Run( const int numOps )
+	{
+		for( int op = 0; op < numOps; ++op )
+		{
+			if( m_rollbackFrames > 0 )
+				m_pSimulation->Rollback( m_rollbackFrames );
+			else
+				Advance();
+		}
+		g_sink = g_sink + m_pSimulation->GetCameraPosition().y;
+	}
+
+private:
+	//one frame as the app runs it
+	inline void Advance()
+	{
+		m_pSimulation->Advance( FRAME_TIME, Simulation::CONTROL_FORWARD | Simulation::CONTROL_LEFT );
+		Vector3 vShift;
+		m_pSimulation->RebaseOrigin( vShift );
+	}
+
+	Simulation* m_pSimulation;
+	int m_rollbackFrames;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: class VehicleSnapshotKernel
+// Desc: Saves the vehicle's physics state into a ring of snapshots, and
+//		 restores the one saved longest ago, as a rollback would
+//------------------------------------------------------------------------------
+class VehicleSnapshotKernel : public Kernel
+{
+public:
+	VehicleSnapshotKernel()
+		: Kernel( "Vehicle::SetPhysicsState", "snapshots", 1.0 )
+	{
+		m_vehicle.SetPosition( Vector3( 100.0f, 20.0f, 100.0f ) );
+	}
+
+	void Run( const int numOps )
+	{
+		for( int op = 0; op < numOps; ++op )
+		{
+			const int slot = op % Simulation::SNAPSHOT_FRAMES;
+			memcpy( &m_snapshots[ slot ], &m_vehicle.GetPhysicsState(),
+					sizeof( VehiclePhysicsState ) );
+			m_vehicle.SetPhysicsState( m_snapshots[ ( slot + 1 ) % Simulation::SNAPSHOT_FRAMES ] );
+		}
+		g_sink = g_sink + m_vehicle.GetPosition().y;
+	}
+
+private:
+	Vehicle m_vehicle;
+	VehiclePhysicsState m_snapshots[ Simulation::SNAPSHOT_FRAMES ];
+
+};
+
+//------------------------------------------------------------------------------
+// Name: class ChaseCamKernel
+// Desc: Steps the chasecam after a target moving in a circle, starting from
+//		 behind and above it as in Simulation::Create()
+//------------------------------------------------------------------------------
+class ChaseCamKernel : public Kernel
+{
+public:
+	ChaseCamKernel()
+		: Kernel( "ChaseCam::UpdatePosition", "steps", 1.0 ),
+		  m_chaseCam( 30.0f, 8.0f, 100.0f ), m_angle( 0.0f ) {}
+
+	void Reset()
+	{
+		m_angle = 0.0f;
+		m_chaseCam.SetChasePosition( Vector3( 0.0f, 0.0f, 0.0f ) );
+		m_chaseCam.SetCameraPosition( Vector3( -30.0f, 10.0f, -30.0f ) );
+		m_chaseCam.SetParameters( 30.0f, 8.0f );
+	}
+
+	void Run( const int numOps )
+	{
+		const float radius = 200.0f;
+		const float turnRate = 0.5f;
+		for( int op = 0; op < numOps; ++op )
+		{
+			m_angle += turnRate * PHYSICS_STEP;
+			const Vector3 vDirection( cosf( m_angle ), 0.0f, -sinf( m_angle ) );
+			const Vector3 vVelocity = vDirection * ( radius * turnRate );
+			m_chaseCam.SetChasePosition( Vector3( sinf( m_angle ) * radius, 0.0f,
+												  cosf( m_angle ) * radius ) );
+			m_chaseCam.SetChaseDirection( vDirection );
+			m_chaseCam.SetChaseVelocity( vVelocity );
+			m_chaseCam.SetCameraVelocity( vVelocity );
+			m_chaseCam.UpdatePosition( PHYSICS_STEP, ( op & 1 ) != 0 );
+		}
+		g_sink = g_sink + m_chaseCam.GetCameraPosition().y;
+	}
+
+private:
+	ChaseCam m_chaseCam;
+	float m_angle;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: TimeKernel()
+// Desc: Doubles the number of operations until a run takes long enough to
+//		 time, then times that many NUM_REPETITIONS times, from a reset each
+//		 time, and keeps the median
+//------------------------------------------------------------------------------
+static KernelResult TimeKernel( Kernel& kernel )
+{
+	int numOps = 1;
+	for( ;; )
+	{
+		kernel.Reset();
+		const double start = GetTimerSeconds();
+		kernel.Run( numOps );
+		if( GetTimerSeconds() - start >= MIN_RUN_SECONDS || numOps >= ( 1 << 28 ) )
+			break;
+		numOps *= 2;
+	}
+
+	StageTimes times;
+	for( int repetition = 0; repetition < NUM_REPETITIONS; ++repetition )
+	{
+		kernel.Reset();
+		times.Start();
+		kernel.Run( numOps );
+		times.Stop( kernel.GetItemsPerOp() * numOps );
+	}
+
+	const double seconds = times.GetPercentile( 0.5 );
+	KernelResult result;
+	result.name				= kernel.GetName();
+	result.nsPerOp			= ( seconds * 1e9 ) / double( numOps );
+	result.itemsPerSecond	= ( seconds > 0.0 ) ?
+							  ( kernel.GetItemsPerOp() * numOps ) / seconds : 0.0;
+	return result;
+}
+
+//------------------------------------------------------------------------------
+// Name: SaveBaseline()
+// Desc: Writes the results out as JSON. Returns false if the file could not be
+//		 written.
+//------------------------------------------------------------------------------
+static bool SaveBaseline( const char* fileName, const std::vector<KernelResult>& results )
+{
+	FILE* pFile = fopen( fileName, "w" );
+	if( pFile == NULL )
+		return false;
+
+	fprintf( pFile, "{\n\t\"kernels\": [\n" );
+	for( unsigned int i = 0; i < results.size(); ++i )
+	{
+		fprintf( pFile, "\t\t{ \"name\": \"%s\", \"ns_per_op\": %.2f, \"items_per_s\": %.6g }%s\n",
+				 results[ i ].name.c_str(), results[ i ].nsPerOp, results[ i ].itemsPerSecond,
+				 ( i + 1 < results.size() ) ? "," : "" );
+	}
+	fprintf( pFile, "\t]\n}\n" );
+
+	return fclose( pFile ) == 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: LoadBaseline()
+// Desc: Reads a file written by SaveBaseline() into a string. Returns false if
+//		 the file could not be read.
+//------------------------------------------------------------------------------
+static bool LoadBaseline( const char* fileName, std::string& baseline )
+{
+	FILE* pFile = fopen( fileName, "r" );
+	if( pFile == NULL )
+		return false;
+
+	char buffer[ 4096 ];
+	size_t numRead;
+	baseline.clear();
+	while( ( numRead = fread( buffer, 1, sizeof( buffer ), pFile ) ) > 0 )
+		baseline.append( buffer, numRead );
+
+	fclose( pFile );
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: FindBaseline()
+// Desc: Finds a kernel's ns/op in a baseline. Only has to read what
+//		 SaveBaseline() writes - each kernel's name comes before its ns/op.
+//		 Returns false if the kernel is not in it.
+//------------------------------------------------------------------------------
+static bool FindBaseline( const std::string& baseline, const std::string& name,
+						  double& nsPerOp )
+{
+	const std::string key = "\"name\": \"" + name + "\"";
+	const size_t namePos = baseline.find( key );
+	if( namePos == std::string::npos )
+		return false;
+
+	const char* const NS_PER_OP_KEY = "\"ns_per_op\":";
+	const size_t valuePos = baseline.find( NS_PER_OP_KEY, namePos + key.size() );
+	if( valuePos == std::string::npos )
+		return false;
+
+	nsPerOp = strtod( baseline.c_str() + valuePos + strlen( NS_PER_OP_KEY ), NULL );
+	return nsPerOp > 0.0;
+}
+
+//------------------------------------------------------------------------------
+// Name: main()
+// Desc: Entry point. "-filter <text>" only runs the kernels with that in their
+//		 name, "-save <file>" writes the results as a baseline, and
+//		 "-compare <file>" flags every kernel more than "-tolerance <percent>"
+//		 slower than in a baseline, and fails if there are any.
+//------------------------------------------------------------------------------
+int main( int argc, char* argv[] )
+{
+	const char* filter = NULL;
+	const char* saveFile = NULL;
+	const char* compareFile = NULL;
+	double tolerance = DEFAULT_TOLERANCE;
+	for( int arg = 1; arg < argc; ++arg )
+	{
+		if( strcmp( argv[ arg ], "-filter" ) == 0 && arg + 1 < argc )
+			filter = argv[ ++arg ];
+		else if( strcmp( argv[ arg ], "-save" ) == 0 && arg + 1 < argc )
+			saveFile = argv[ ++arg ];
+		else if( strcmp( argv[ arg ], "-compare" ) == 0 && arg + 1 < argc )
+			compareFile = argv[ ++arg ];
+		else if( strcmp( argv[ arg ], "-tolerance" ) == 0 && arg + 1 < argc )
+			tolerance = atof( argv[ ++arg ] );
+		else
+		{
+			fprintf( stderr, "usage: %s [-filter <text>] [-save <file>] "
+					 "[-compare <file> [-tolerance <percent>]]\n", argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	std::string baseline;
+	if( compareFile != NULL && ! LoadBaseline( compareFile, baseline ) )
+	{
+		ShowError( "Could not read the baseline" );
+		return 1;
+	}
+
+	//the terrain and shadow volume are too big for the stack
+	Terrain* pTerrain = NULL;
+	ShadowVolume* pShadowVolume = NULL;
+	Simulation* pSimulation = NULL;
+	std::vector<Kernel*> kernels;
+	try
+	{
+		pTerrain		= new Terrain();
+		pShadowVolume	= new ShadowVolume();
+		pSimulation		= new Simulation();
+
+		//Create() only fails for want of memory
+		if( FAILED( pSimulation->Create( SEED, Simulation::DEFAULT_STEPS_PER_SECOND ) ) )
+			throw std::bad_alloc();
+
+		kernels.push_back( new HeightMapPointKernel( pTerrain ) );
+		kernels.push_back( new PerlinNoiseKernel( pTerrain ) );
+		kernels.push_back( new IntersectFrustumKernel() );
+		AddCullKernels( kernels );
+		kernels.push_back( new LooseQuadtreeKernel() );
+		kernels.push_back( new ExtractFrustumKernel() );
+		kernels.push_back( new ShadowVolumeKernel( pShadowVolume ) );
+		kernels.push_back( new ParticlesKernel() );
+		kernels.push_back( new VehiclePhysicsKernel( pTerrain ) );
+		AddFleetKernels( kernels, pTerrain );
+		AddCollisionsKernels( kernels );
+		kernels.push_back( new ChaseCamKernel() );
+		kernels.push_back( new SimulationKernel( "Simulation::Advance", pSimulation, 0 ) );
+		char rollbackName[ 64 ];
+		sprintf( rollbackName, "Simulation::Rollback/%d", ROLLBACK_FRAMES );
+		kernels.push_back( new SimulationKernel( rollbackName, pSimulation, ROLLBACK_FRAMES ) );
+		kernels.push_back( new VehicleSnapshotKernel() );
+	}
+	catch( std::bad_alloc& )
+	{
+		for( unsigned int i = 0; i < kernels.size(); ++i )
+			delete kernels[ i ];
+		delete pSimulation;
+		delete pShadowVolume;
+		delete pTerrain;
+		ShowError( "Out of memory" );
+		return 1;
+	}
+
+	if( compareFile != NULL )
+	{
+		printf( "%-44s %12s %14s   %-13s %12s %9s\n", "kernel", "ns/op", "items/s", "",
+				"baseline", "change" );
+	}
+	else
+		printf( "%-44s %12s %14s\n", "kernel", "ns/op", "items/s" );
+
+	std::vector<KernelResult> results;
+	int numSlower = 0;
+	for( unsigned int i = 0; i < kernels.size(); ++i )
+	{
+		Kernel& kernel = *kernels[ i ];
+		if( filter != NULL && strstr( kernel.GetName(), filter ) == NULL )
+			continue;
+
+		const KernelResult result = TimeKernel( kernel );
+		results.push_back( result );
+		printf( "%-44s %12.2f %14.4g   ", result.name.c_str(), result.nsPerOp,
+				result.itemsPerSecond );
+
+		double baselineNsPerOp;
+		if( compareFile == NULL )
+			printf( "%s\n", kernel.GetItemName() );
+		else if( ! FindBaseline( baseline, result.name, baselineNsPerOp ) )
+			printf( "%-13s %12s\n", kernel.GetItemName(), "none" );
+		else
+		{
+			const double change = ( ( result.nsPerOp / baselineNsPerOp ) - 1.0 ) * 100.0;
+			const bool slower = change > tolerance;
+			printf( "%-13s %12.2f %+8.1f%%%s\n", kernel.GetItemName(), baselineNsPerOp, change,
+					slower ? "  SLOWER" : "" );
+			if( slower )
+				++numSlower;
+		}
+		fflush( stdout );
+	}
+
+	for( unsigned int i = 0; i < kernels.size(); ++i )
+		delete kernels[ i ];
+	delete pSimulation;
+	delete pShadowVolume;
+	delete pTerrain;
+
+	if( saveFile != NULL && ! SaveBaseline( saveFile, results ) )
+	{
+		ShowError( "Could not write the baseline" );
+		return 1;
+	}
+
+	if( numSlower > 0 )
+	{
+		printf( "\n%d kernel%s more than %.0f%% slower than the baseline\n", numSlower,
+				( numSlower > 1 ) ? "s" : "", tolerance );
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,418 @@
+//------------------------------------------------------------------------------
+// File: OcclusionBuffer.cpp
+// Desc: A small software depth buffer, used to find dynamic objects that are
+//		 hidden behind the terrain before they are drawn
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <float.h>
+
+#include "OcclusionBuffer.h"
+
+#ifdef OCCLUSION_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+
+//a projected triangle has 3 vertices, and gains at most one from each plane
+const static int MAX_CLIP_VERTICES = 8;
+
+//triangles are clipped to a band around the screen, so pixel positions stay
+//small enough for the edge functions to be accurate
+const static float GUARD_BAND = 2.0f;
+
+int ClipPolygon( const Vector4* pIn, const int numIn, const Vector4& plane,
+				 Vector4* pOut );
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: OcclusionBuffer()
+// Desc: Constructor for the occlusion buffer
+//------------------------------------------------------------------------------
+OcclusionBuffer::OcclusionBuffer()
+{
+	Mat4Identity( m_matViewProj );
+	m_vEye = Vector3( 0.0f, 0.0f, 0.0f );
+
+	for( int pixel = 0; pixel < WIDTH * HEIGHT; ++pixel )
+		m_depth[ pixel ] = FLT_MAX;
+
+	for( int tile = 0; tile < TILES_X * TILES_Y; ++tile )
+		m_tileMaxDepth[ tile ] = FLT_MAX;
+}
+
+//------------------------------------------------------------------------------
+// Name: Begin()
+// Desc: Empties the buffer, ready for a new set of occluders seen from the
+//		 given camera
+//------------------------------------------------------------------------------
+void OcclusionBuffer::Begin( const Matrix4& matViewProj, const Vector3& vEye )
+{
+	m_matViewProj	= matViewProj;
+	m_vEye			= vEye;
+
+	m_triangles.clear();
+	for( int tile = 0; tile < TILES_X * TILES_Y; ++tile )
+		m_bins[ tile ].clear();
+}
+
+//------------------------------------------------------------------------------
+// Name: AddOccluder()
+// Desc: Projects an occluder triangle and sorts it into the tiles it covers.
+//		 The triangle faces the side that (v1-v0)x(v2-v0) points to, and is
+//		 dropped if that faces away from the eye.
+//------------------------------------------------------------------------------
+void OcclusionBuffer::AddOccluder( const Vector3& v0, const Vector3& v1,
+								   const Vector3& v2 )
+{
+	//the occluders are closed surfaces, so a back face is always behind a front one
+	const Vector3 vEdge1 = v1 - v0;
+	const Vector3 vEdge2 = v2 - v0;
+	const Vector3 vToEye = m_vEye - v0;
+	const Vector3 vNormal = Vec3Cross( vEdge1, vEdge2 );
+	if( Vec3Dot( vNormal, vToEye ) <= 0.0f )
+		return;
+
+	Vector4 vClip[ 2 ][ MAX_CLIP_VERTICES ];
+	vClip[ 0 ][ 0 ] = Vec4Transform( Vector4( v0, 1.0f ), m_matViewProj );
+	vClip[ 0 ][ 1 ] = Vec4Transform( Vector4( v1, 1.0f ), m_matViewProj );
+	vClip[ 0 ][ 2 ] = Vec4Transform( Vector4( v2, 1.0f ), m_matViewProj );
+
+	//clip to the near plane and the guard band - the far plane is left, as
+	//anything beyond it is never drawn anyway
+	const Vector4 planes[ 5 ] =
+	{
+		Vector4( 0.0f, 0.0f, 1.0f, 0.0f ),			//z >= 0
+		Vector4( -1.0f, 0.0f, 0.0f, GUARD_BAND ),	//x <= band * w
+		Vector4( 1.0f, 0.0f, 0.0f, GUARD_BAND ),	//x >= -band * w
+		Vector4( 0.0f, -1.0f, 0.0f, GUARD_BAND ),	//y <= band * w
+		Vector4( 0.0f, 1.0f, 0.0f, GUARD_BAND ),	//y >= -band * w
+	};
+
+	int numVertices = 3;
+	int current = 0;
+	for( int plane = 0; plane < 5 && numVertices >= 3; ++plane )
+	{
+		numVertices = ClipPolygon( vClip[ current ], numVertices, planes[ plane ],
+								   vClip[ 1 - current ] );
+		current = 1 - current;
+	}
+
+	//split what is left into a fan
+	for( int vertex = 2; vertex < numVertices; ++vertex )
+	{
+		AddScreenTriangle( vClip[ current ][ 0 ], vClip[ current ][ vertex - 1 ],
+						   vClip[ current ][ vertex ] );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: ClipPolygon()
+// Desc: Clips a convex polygon in clip space to the side of a plane where
+//		 plane.v >= 0, returning the number of vertices left
+//------------------------------------------------------------------------------
+int ClipPolygon( const Vector4* pIn, const int numIn, const Vector4& plane,
+				 Vector4* pOut )
+{
+	int numOut = 0;
+
+	for( int vertex = 0; vertex < numIn; ++vertex )
+	{
+		const Vector4& vA = pIn[ vertex ];
+		const Vector4& vB = pIn[ ( vertex + 1 ) % numIn ];
+		const float distA = Vec4Dot( vA, plane );
+		const float distB = Vec4Dot( vB, plane );
+
+		if( distA >= 0.0f )
+			pOut[ numOut++ ] = vA;
+
+		if( ( distA >= 0.0f ) != ( distB >= 0.0f ) )
+			pOut[ numOut++ ] = vA + ( vB - vA ) * ( distA / ( distA - distB ) );
+	}
+
+	return numOut;
+}
+
+//------------------------------------------------------------------------------
+// Name: AddScreenTriangle()
+// Desc: Sets up a clipped triangle for rasterisation, and adds it to the bin of
+//		 each tile its bounding rectangle touches
+//------------------------------------------------------------------------------
+void OcclusionBuffer::AddScreenTriangle( const Vector4& v0, const Vector4& v1,
+										 const Vector4& v2 )
+{
+	//move to pixels, with y down the screen
+	const Vector4* pVertices[ 3 ] = { &v0, &v1, &v2 };
+	float x[ 3 ], y[ 3 ], z[ 3 ];
+	for( int vertex = 0; vertex < 3; ++vertex )
+	{
+		const Vector4& v = *pVertices[ vertex ];
+		const float invW = 1.0f / v.w;
+		x[ vertex ] = ( ( v.x * invW * 0.5f ) + 0.5f ) * WIDTH;
+		y[ vertex ] = ( 0.5f - ( v.y * invW * 0.5f ) ) * HEIGHT;
+		z[ vertex ] = v.z * invW;
+	}
+
+	//wind the triangle so the inside of each edge is positive
+	float area = ( ( x[ 1 ] - x[ 0 ] ) * ( y[ 2 ] - y[ 0 ] ) ) -
+				 ( ( x[ 2 ] - x[ 0 ] ) * ( y[ 1 ] - y[ 0 ] ) );
+	if( area == 0.0f )
+		return;
+
+	if( area < 0.0f )
+	{
+		std::swap( x[ 1 ], x[ 2 ] );
+		std::swap( y[ 1 ], y[ 2 ] );
+		std::swap( z[ 1 ], z[ 2 ] );
+		area = -area;
+	}
+
+	ScreenTriangle triangle;
+
+	for( int edge = 0; edge < 3; ++edge )
+	{
+		const int a = edge;
+		const int b = ( edge + 1 ) % 3;
+		triangle.edgeA[ edge ] = y[ a ] - y[ b ];
+		triangle.edgeB[ edge ] = x[ b ] - x[ a ];
+		triangle.edgeC[ edge ] = ( x[ a ] * y[ b ] ) - ( x[ b ] * y[ a ] );
+	}
+
+	triangle.depthDX = ( ( ( z[ 1 ] - z[ 0 ] ) * ( y[ 2 ] - y[ 0 ] ) ) -
+						 ( ( z[ 2 ] - z[ 0 ] ) * ( y[ 1 ] - y[ 0 ] ) ) ) / area;
+	triangle.depthDY = ( ( ( z[ 2 ] - z[ 0 ] ) * ( x[ 1 ] - x[ 0 ] ) ) -
+						 ( ( z[ 1 ] - z[ 0 ] ) * ( x[ 2 ] - x[ 0 ] ) ) ) / area;
+	triangle.depthC	 = z[ 0 ] - ( triangle.depthDX * x[ 0 ] ) - ( triangle.depthDY * y[ 0 ] );
+
+	//pixels are sampled at their centres
+	const float minX = std::min( std::min( x[ 0 ], x[ 1 ] ), x[ 2 ] );
+	const float maxX = std::max( std::max( x[ 0 ], x[ 1 ] ), x[ 2 ] );
+	const float minY = std::min( std::min( y[ 0 ], y[ 1 ] ), y[ 2 ] );
+	const float maxY = std::max( std::max( y[ 0 ], y[ 1 ] ), y[ 2 ] );
+
+	triangle.minX = std::max( int( ceil( minX - 0.5f ) ), 0 );
+	triangle.maxX = std::min( int( floor( maxX - 0.5f ) ), WIDTH - 1 );
+	triangle.minY = std::max( int( ceil( minY - 0.5f ) ), 0 );
+	triangle.maxY = std::min( int( floor( maxY - 0.5f ) ), HEIGHT - 1 );
+
+	if( triangle.minX > triangle.maxX || triangle.minY > triangle.maxY )
+		return;
+
+	const unsigned int index = static_cast<unsigned int>( m_triangles.size() );
+	m_triangles.push_back( triangle );
+
+	for( int tileY = triangle.minY / TILE_HEIGHT; tileY <= triangle.maxY / TILE_HEIGHT; ++tileY )
+	{
+		for( int tileX = triangle.minX / TILE_WIDTH; tileX <= triangle.maxX / TILE_WIDTH; ++tileX )
+			m_bins[ tileX + ( tileY * TILES_X ) ].push_back( index );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: Rasterise()
+// Desc: Fills the depth buffer from the occluders added since Begin()
+//------------------------------------------------------------------------------
+void OcclusionBuffer::Rasterise()
+{
+	for( int tile = 0; tile < TILES_X * TILES_Y; ++tile )
+		RasteriseTile( tile );
+}
+
+//------------------------------------------------------------------------------
+// Name: RasteriseTile()
+// Desc: Clears one tile and draws the triangles in its bin, then finds the
+//		 furthest depth left in it. Tiles share nothing, so may be drawn in any
+//		 order.
+//------------------------------------------------------------------------------
+void OcclusionBuffer::RasteriseTile( const int tile )
+{
+	const int tileX = ( tile % TILES_X ) * TILE_WIDTH;
+	const int tileY = ( tile / TILES_X ) * TILE_HEIGHT;
+
+	for( int y = tileY; y < tileY + TILE_HEIGHT; ++y )
+	{
+		for( int x = tileX; x < tileX + TILE_WIDTH; ++x )
+			m_depth[ x + ( y * WIDTH ) ] = FLT_MAX;
+	}
+
+	const std::vector<unsigned int>& bin = m_bins[ tile ];
+
+	for( unsigned int i = 0; i < bin.size(); ++i )
+	{
+		const ScreenTriangle& triangle = m_triangles[ bin[ i ] ];
+
+		//start on a multiple of four, so each group of pixels stays in the tile
+		const int x0 = std::max( triangle.minX, tileX ) & ~3;
+		const int x1 = std::min( triangle.maxX, tileX + TILE_WIDTH - 1 );
+		const int y0 = std::max( triangle.minY, tileY );
+		const int y1 = std::min( triangle.maxY, tileY + TILE_HEIGHT - 1 );
+
+		#ifdef OCCLUSION_USE_SSE
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 offsets = _mm_set_ps( 3.5f, 2.5f, 1.5f, 0.5f );
+		const __m128 edgeA[ 3 ] = { _mm_set1_ps( triangle.edgeA[ 0 ] ),
+									_mm_set1_ps( triangle.edgeA[ 1 ] ),
+									_mm_set1_ps( triangle.edgeA[ 2 ] ) };
+		const __m128 depthDX = _mm_set1_ps( triangle.depthDX );
+
+		for( int y = y0; y <= y1; ++y )
+		{
+			const float centreY = float( y ) + 0.5f;
+			const __m128 rowEdge[ 3 ] =
+			{
+				_mm_set1_ps( ( triangle.edgeB[ 0 ] * centreY ) + triangle.edgeC[ 0 ] ),
+				_mm_set1_ps( ( triangle.edgeB[ 1 ] * centreY ) + triangle.edgeC[ 1 ] ),
+				_mm_set1_ps( ( triangle.edgeB[ 2 ] * centreY ) + triangle.edgeC[ 2 ] ),
+			};
+			const __m128 rowDepth = _mm_set1_ps( ( triangle.depthDY * centreY ) +
+												 triangle.depthC );
+
+			for( int x = x0; x <= x1; x += 4 )
+			{
+				const __m128 centreX = _mm_add_ps( _mm_set1_ps( float( x ) ), offsets );
+
+				__m128 inside = _mm_cmpge_ps( _mm_add_ps( _mm_mul_ps( edgeA[ 0 ], centreX ),
+														  rowEdge[ 0 ] ), zero );
+				inside = _mm_and_ps( inside, _mm_cmpge_ps( _mm_add_ps(
+								_mm_mul_ps( edgeA[ 1 ], centreX ), rowEdge[ 1 ] ), zero ) );
+				inside = _mm_and_ps( inside, _mm_cmpge_ps( _mm_add_ps(
+								_mm_mul_ps( edgeA[ 2 ], centreX ), rowEdge[ 2 ] ), zero ) );
+				if( _mm_movemask_ps( inside ) == 0 )
+					continue;
+
+				float* pDepth = &m_depth[ x + ( y * WIDTH ) ];
+				const __m128 oldDepth = _mm_loadu_ps( pDepth );
+				const __m128 newDepth = _mm_min_ps( oldDepth, _mm_add_ps(
+											_mm_mul_ps( depthDX, centreX ), rowDepth ) );
+
+				_mm_storeu_ps( pDepth, _mm_or_ps( _mm_and_ps( inside, newDepth ),
+												  _mm_andnot_ps( inside, oldDepth ) ) );
+			}
+		}
+		#else
+		for( int y = y0; y <= y1; ++y )
+		{
+			const float centreY = float( y ) + 0.5f;
+
+			for( int x = x0; x <= x1; ++x )
+			{
+				const float centreX = float( x ) + 0.5f;
+
+				bool inside = true;
+				for( int edge = 0; edge < 3; ++edge )
+				{
+					if( ( triangle.edgeA[ edge ] * centreX ) + ( triangle.edgeB[ edge ] * centreY ) +
+						triangle.edgeC[ edge ] < 0.0f )
+						inside = false;
+				}
+
+				if( !inside )
+					continue;
+
+				const float depth = ( triangle.depthDX * centreX ) +
+									( triangle.depthDY * centreY ) + triangle.depthC;
+				float& pixel = m_depth[ x + ( y * WIDTH ) ];
+				pixel = std::min( pixel, depth );
+			}
+		}
+		#endif
+	}
+
+	//the furthest depth lets whole tiles be passed over when testing
+	float maxDepth = 0.0f;
+	for( int y = tileY; y < tileY + TILE_HEIGHT; ++y )
+	{
+		for( int x = tileX; x < tileX + TILE_WIDTH; ++x )
+			maxDepth = std::max( maxDepth, m_depth[ x + ( y * WIDTH ) ] );
+	}
+
+	m_tileMaxDepth[ tile ] = maxDepth;
+}
+
+//------------------------------------------------------------------------------
+// Name: IsVisible()
+// Desc: Tests whether any part of a box could be in front of the occluders.
+//		 The box's screen rectangle is grown by a pixel either way, as the
+//		 occluders are only sampled at pixel centres.
+//------------------------------------------------------------------------------
+bool OcclusionBuffer::IsVisible( const Vector3& vMin, const Vector3& vMax ) const
+{
+	float minX = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float minY = FLT_MAX;
+	float maxY = -FLT_MAX;
+	float nearestDepth = FLT_MAX;
+
+	for( int corner = 0; corner < 8; ++corner )
+	{
+		const Vector3 vCorner( ( corner & 1 ) ? vMax.x : vMin.x,
+								   ( corner & 2 ) ? vMax.y : vMin.y,
+								   ( corner & 4 ) ? vMax.z : vMin.z );
+		const Vector4 vClip = Vec4Transform( Vector4( vCorner, 1.0f ), m_matViewProj );
+
+		//a box that crosses the near plane could cover anything
+		if( vClip.z < 0.0f )
+			return true;
+
+		const float invW = 1.0f / vClip.w;
+		const float x = ( ( vClip.x * invW * 0.5f ) + 0.5f ) * WIDTH;
+		const float y = ( 0.5f - ( vClip.y * invW * 0.5f ) ) * HEIGHT;
+
+		minX = std::min( minX, x );
+		maxX = std::max( maxX, x );
+		minY = std::min( minY, y );
+		maxY = std::max( maxY, y );
+		nearestDepth = std::min( nearestDepth, vClip.z * invW );
+	}
+
+	//a box off the edge of the screen cannot be seen either
+	if( maxX < -1.0f || minX > WIDTH + 1.0f || maxY < -1.0f || minY > HEIGHT + 1.0f )
+		return false;
+
+	const int pixelMinX = std::max( int( floor( minX ) ) - 1, 0 );
+	const int pixelMaxX = std::min( int( floor( maxX ) ) + 1, WIDTH - 1 );
+	const int pixelMinY = std::max( int( floor( minY ) ) - 1, 0 );
+	const int pixelMaxY = std::min( int( floor( maxY ) ) + 1, HEIGHT - 1 );
+
+	for( int tileY = pixelMinY / TILE_HEIGHT; tileY <= pixelMaxY / TILE_HEIGHT; ++tileY )
+	{
+		for( int tileX = pixelMinX / TILE_WIDTH; tileX <= pixelMaxX / TILE_WIDTH; ++tileX )
+		{
+			//everything in this tile is nearer than the box
+			if( m_tileMaxDepth[ tileX + ( tileY * TILES_X ) ] < nearestDepth )
+				continue;
+
+			const int x0 = std::max( pixelMinX, tileX * TILE_WIDTH );
+			const int x1 = std::min( pixelMaxX, ( tileX + 1 ) * TILE_WIDTH - 1 );
+			const int y0 = std::max( pixelMinY, tileY * TILE_HEIGHT );
+			const int y1 = std::min( pixelMaxY, ( tileY + 1 ) * TILE_HEIGHT - 1 );
+
+			for( int y = y0; y <= y1; ++y )
+			{
+				for( int x = x0; x <= x1; ++x )
+				{
+					if( m_depth[ x + ( y * WIDTH ) ] >= nearestDepth )
+						return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
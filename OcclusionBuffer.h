@@ -0,0 +1,94 @@
+//------------------------------------------------------------------------------
+// File: OcclusionBuffer.h
+// Desc: A small software depth buffer, used to find dynamic objects that are
+//		 hidden behind the terrain before they are drawn
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_OCCLUSIONBUFFER_H
+#define INCLUSIONGUARD_OCCLUSIONBUFFER_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <vector>
+
+#include "VectorMath.h"
+
+//the rasteriser uses sse where the maths does - there is no neon version, so
+//on arm it rasterises with plain floats
+#if defined( MATHS_USE_SSE )
+	#define OCCLUSION_USE_SSE
+#endif
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: class OcclusionBuffer
+// Desc: Occluder triangles are projected and sorted into screen tiles, then each
+//		 tile is rasterised into the nearest depth seen at each pixel. Boxes are
+//		 tested against the result by their nearest depth and screen rectangle.
+//		 Depths are post-projection z, so are linear in screen space. Needs no
+//		 device.
+//------------------------------------------------------------------------------
+class OcclusionBuffer
+{
+public:
+	const static int WIDTH = 256;
+	const static int HEIGHT = 128;
+	const static int TILE_WIDTH = 32;	//must be a multiple of 4
+	const static int TILE_HEIGHT = 32;
+	const static int TILES_X = WIDTH / TILE_WIDTH;
+	const static int TILES_Y = HEIGHT / TILE_HEIGHT;
+
+	OcclusionBuffer();
+
+	void Begin( const Matrix4& matViewProj, const Vector3& vEye );
+	void AddOccluder( const Vector3& v0, const Vector3& v1, const Vector3& v2 );
+	void Rasterise();
+
+	bool IsVisible( const Vector3& vMin, const Vector3& vMax ) const;
+
+	inline unsigned int GetOccluderTriangles() const
+	{
+		return static_cast<unsigned int>( m_triangles.size() );
+	}
+
+private:
+	//a projected triangle, as edge functions and a depth plane in pixels
+	struct ScreenTriangle
+	{
+		float edgeA[ 3 ];
+		float edgeB[ 3 ];
+		float edgeC[ 3 ];
+		float depthC;
+		float depthDX;
+		float depthDY;
+		int minX, minY, maxX, maxY;	//pixels whose centres may be covered
+	};
+
+	void AddScreenTriangle( const Vector4& v0, const Vector4& v1,
+							const Vector4& v2 );
+	void RasteriseTile( const int tile );
+
+	Matrix4	m_matViewProj;
+	Vector3	m_vEye;
+
+	std::vector<ScreenTriangle> m_triangles;
+	std::vector<unsigned int> m_bins[ TILES_X * TILES_Y ];
+
+	float m_depth[ WIDTH * HEIGHT ];
+	float m_tileMaxDepth[ TILES_X * TILES_Y ];
+
+};
+
+
+#endif //INCLUSIONGUARD_OCCLUSIONBUFFER_H
@@ -13,37 +13,53 @@
 // Included files:
 //------------------------------------------------------------------------------
 #include <new>
+#include <stdlib.h>
+#include <string.h>
 
 #include "ParticleSystem.h"
-#include "Resource.h"
-#include "Scene.h"
-#include "DXUtil.h"
+
+#if !defined( HOVERCRAFT_HEADLESS )
+	#include "Resource.h"
+	#include "Scene.h"
+#endif
 
 
 //------------------------------------------------------------------------------
 // Definitions:
 //------------------------------------------------------------------------------
+const float ParticleSystem::HIDDEN_HEIGHT = -1000.0f;
 
 //------------------------------------------------------------------------------
 // Name: ParticleSystem()
 // Desc: Constructor for the particle system class
 //------------------------------------------------------------------------------
-ParticleSystem::ParticleSystem( const int numParticles, const float particleLifetime )
+ParticleSystem::ParticleSystem( const int numParticles, const float particleLifetime,
+								const unsigned int seed )
 {
 	//initialise member variables
 	m_numParticles		= numParticles;
 	m_particleLifetime	= particleLifetime;
-	m_initialPosition	= D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
-	m_initialVelocity	= D3DXVECTOR3( 0.0f, 0.0f, 0.0f );
-	m_gravity			= D3DXVECTOR3( 0.0f, -1.0f, 0.0f );
+	m_gravity			= Vector3( 0.0f, -1.0f, 0.0f );
+
+	m_emitter.initialPosition	= Vector3( 0.0f, 0.0f, 0.0f );
+	m_emitter.initialVelocity	= Vector3( 0.0f, 0.0f, 0.0f );
+	m_emitter.initialSpeed		= 0.0f;
+	m_emitter.randomState		= seed;
 
+	m_pParticleData			= NULL;
 	m_particlePositions		= NULL;
 	m_particleVelocities	= NULL;
 	m_particleAges			= NULL;
 
+	m_emitter.hasBounds		= false;
+	m_emitter.vBoundsMin	= Vector3( 0.0f, 0.0f, 0.0f );
+	m_emitter.vBoundsMax	= Vector3( 0.0f, 0.0f, 0.0f );
+
+	#if !defined( HOVERCRAFT_HEADLESS )
 	m_pd3dDevice	= NULL;
 	m_pVSDecl		= NULL;
 	m_pVS			= NULL;
+	#endif
 
 	//initialise the particles
 	InitParticles();
@@ -56,39 +72,28 @@ ParticleSystem::ParticleSystem( const int numParticles, const float particleLife
 void ParticleSystem::InitParticles()
 {
 	//if storage has already been allocated, destroy it
-	SAFE_DELETE_ARRAY( m_particlePositions );
-	SAFE_DELETE_ARRAY( m_particleVelocities );
-	SAFE_DELETE_ARRAY( m_particleAges );
-
-	//allocate storage for the particles
-	try{ m_particlePositions = new D3DXVECTOR3[ m_numParticles ]; }
-	catch( std::bad_alloc& error )
-	{
-		MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
-		exit( 1 );
-	}
-
-	try{ m_particleVelocities = new D3DXVECTOR3[ m_numParticles ]; }
-	catch( std::bad_alloc& error )
-	{
-		MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
-		exit( 1 );
-	}
+	SAFE_DELETE_ARRAY( m_pParticleData );
 
-	try{ m_particleAges = new float[ m_numParticles ]; }
+	//allocate storage for the particles - positions, then velocities, then ages
+	try{ m_pParticleData = new unsigned char[ GetStateSize() - sizeof( EmitterState ) ]; }
 	catch( std::bad_alloc& error )
 	{
-		MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
+		ShowError( error.what() );
 		exit( 1 );
 	}
+	m_particlePositions		= reinterpret_cast<Vector3*>( m_pParticleData );
+	m_particleVelocities	= m_particlePositions + m_numParticles;
+	m_particleAges			= reinterpret_cast<float*>( m_particleVelocities + m_numParticles );
 
 	//set initial particle parameters
 	for( unsigned int particle = 0; particle < m_numParticles; ++particle )
 	{
-		m_particlePositions[ particle ]	 = m_initialPosition;
-		m_particleVelocities[ particle ] = m_initialVelocity;
-		m_particleAges[ particle ]		 = frand( rand() ) * m_particleLifetime;
+		m_particlePositions[ particle ]	 = m_emitter.initialPosition;
+		m_particleVelocities[ particle ] = m_emitter.initialVelocity;
+		m_particleAges[ particle ]		 = frand( Random() ) * m_particleLifetime;
 	}
+
+	UpdateBounds();
 }
 
 //------------------------------------------------------------------------------
@@ -97,11 +102,11 @@ void ParticleSystem::InitParticles()
 //------------------------------------------------------------------------------
 ParticleSystem::~ParticleSystem()
 {
-	SAFE_DELETE_ARRAY( m_particlePositions );
-	SAFE_DELETE_ARRAY( m_particleVelocities );
-	SAFE_DELETE_ARRAY( m_particleAges );
+	SAFE_DELETE_ARRAY( m_pParticleData );
 }
 
+#if !defined( HOVERCRAFT_HEADLESS )
+
 //------------------------------------------------------------------------------
 // Name: InitDeviceObjects()
 // Desc: Sets up device-specific data on startup and device change
@@ -204,13 +209,12 @@ HRESULT ParticleSystem::Render( const Scene& scene ) const
 
 	//set vertex shader constants...
 	//transform matrix
-	D3DXMATRIX matViewProj = scene.GetCamera().GetViewProj();
-	D3DXMATRIX matResult;
-	D3DXMatrixTranspose( &matResult, &matViewProj );
+	Matrix4 matResult;
+	Mat4Transpose( matResult, scene.GetCamera().GetViewProj() );
 	m_pd3dDevice->SetVertexShaderConstantF( 0, (float*)&matResult, 4 );
 
 	m_pd3dDevice->DrawPrimitiveUP( D3DPT_POINTLIST, m_numParticles,
-								   m_particlePositions, sizeof(D3DXVECTOR3) );
+								   m_particlePositions, sizeof(Vector3) );
 
 	m_pd3dDevice->SetRenderState( D3DRS_ALPHABLENDENABLE, FALSE );
 	m_pd3dDevice->SetRenderState( D3DRS_SRCBLEND, D3DBLEND_ONE );
@@ -219,6 +223,8 @@ HRESULT ParticleSystem::Render( const Scene& scene ) const
 	return S_OK;
 }
 
+#endif
+
 //------------------------------------------------------------------------------
 // Name: UpdateParticles()
 // Desc: Updates the particle positions and lifetimes
@@ -226,12 +232,12 @@ HRESULT ParticleSystem::Render( const Scene& scene ) const
 HRESULT ParticleSystem::UpdateParticles( const float timeStep )
 {
 	//calculate change in velocity
-	const D3DXVECTOR3 velocityDelta = m_gravity * timeStep;
+	const Vector3 velocityDelta = m_gravity * timeStep;
 
 	//track particles created this frame
 	unsigned int particlesCreated = 0;
 
-	unsigned int maxCreation = unsigned int( timeStep / 
+	unsigned int maxCreation = static_cast<unsigned int>( timeStep / 
 								( m_particleLifetime / m_numParticles ) );
 
 	//for each particle
@@ -249,14 +255,14 @@ HRESULT ParticleSystem::UpdateParticles( const float timeStep )
 
 			//particle is dead, kill it and create a new one
 			m_particleAges[ particle ]			= 0.0f;
-			m_particlePositions[ particle ]		= m_initialPosition;
-			m_particleVelocities[ particle ]	= m_initialVelocity;
+			m_particlePositions[ particle ]		= m_emitter.initialPosition;
+			m_particleVelocities[ particle ]	= m_emitter.initialVelocity;
 
 			//if we are moving slowly, do not produce particles
-			if( m_initialSpeed < 17.0f )
+			if( m_emitter.initialSpeed < 17.0f )
 			{
 				//simply hide the particles
-				m_particlePositions[ particle ].y = -1000.0f;
+				m_particlePositions[ particle ].y = HIDDEN_HEIGHT;
 			}
 
 			//jitter the particle position and velocity to create a particle
@@ -265,15 +271,14 @@ HRESULT ParticleSystem::UpdateParticles( const float timeStep )
 
 			//jitter velocity
 			const float jitterAngle = float( gaussianRand( 0.0f, maxJitterAngle ) );
-			D3DXMATRIX matJitter;
-			D3DXMatrixRotationY( &matJitter, jitterAngle );
-			D3DXVECTOR4 temp;
-			D3DXVec3Transform( &temp, &m_particleVelocities[ particle ], &matJitter );
-			m_particleVelocities[ particle ] = D3DXVECTOR3( temp.x, temp.y, temp.z );
-			m_particleVelocities[ particle ].y += frand( rand() );
+			Matrix3 matJitter;
+			Mat3RotationY( matJitter, jitterAngle );
+			m_particleVelocities[ particle ] = Vec3Transform( m_particleVelocities[ particle ],
+															  matJitter );
+			m_particleVelocities[ particle ].y += frand( Random() );
 
 			//jitter position
-			m_particlePositions[ particle ] -= m_initialVelocity;
+			m_particlePositions[ particle ] -= m_emitter.initialVelocity;
 			m_particlePositions[ particle ] += m_particleVelocities[ particle ];
 		}
 		else
@@ -286,5 +291,95 @@ HRESULT ParticleSystem::UpdateParticles( const float timeStep )
 		}
 	}
 
+	UpdateBounds();
+
 	return S_OK;
 }
+
+//------------------------------------------------------------------------------
+// Name: UpdateBounds()
+// Desc: Finds a box around the particles, leaving out those that are parked
+//------------------------------------------------------------------------------
+void ParticleSystem::UpdateBounds()
+{
+	m_emitter.hasBounds = false;
+
+	for( unsigned int particle = 0; particle < m_numParticles; ++particle )
+	{
+		//parked particles have been jittered and fallen a little since
+		const Vector3& vPosition = m_particlePositions[ particle ];
+		if( vPosition.y < HIDDEN_HEIGHT * 0.5f )
+			continue;
+
+		if( m_emitter.hasBounds )
+		{
+			m_emitter.vBoundsMin = Vec3Minimize( m_emitter.vBoundsMin, vPosition );
+			m_emitter.vBoundsMax = Vec3Maximize( m_emitter.vBoundsMax, vPosition );
+		}
+		else
+		{
+			m_emitter.vBoundsMin	= vPosition;
+			m_emitter.vBoundsMax	= vPosition;
+			m_emitter.hasBounds		= true;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: GetBounds()
+// Desc: Retrieves the box around the particles in sight, if there are any
+//------------------------------------------------------------------------------
+bool ParticleSystem::GetBounds( Vector3& vMin, Vector3& vMax ) const
+{
+	vMin = m_emitter.vBoundsMin;
+	vMax = m_emitter.vBoundsMax;
+
+	return m_emitter.hasBounds;
+}
+
+//------------------------------------------------------------------------------
+// Name: Rebase()
+// Desc: Moves all particles when the floating origin moves by vShift
+//------------------------------------------------------------------------------
+void ParticleSystem::Rebase( const Vector3& vShift )
+{
+	m_emitter.initialPosition -= vShift;
+
+	for( unsigned int particle = 0; particle < m_numParticles; ++particle )
+		m_particlePositions[ particle ] -= vShift;
+
+	m_emitter.vBoundsMin -= vShift;
+	m_emitter.vBoundsMax -= vShift;
+}
+
+//------------------------------------------------------------------------------
+// Name: GetStateSize()
+// Desc: Retrieves the size of a snapshot of the particle system
+//------------------------------------------------------------------------------
+unsigned int ParticleSystem::GetStateSize() const
+{
+	return sizeof( EmitterState ) +
+		   m_numParticles * ( 2 * sizeof( Vector3 ) + sizeof( float ) );
+}
+
+//------------------------------------------------------------------------------
+// Name: SaveState()
+// Desc: Copies the emitter and the particles to a snapshot
+//------------------------------------------------------------------------------
+void ParticleSystem::SaveState( unsigned char* pState ) const
+{
+	memcpy( pState, &m_emitter, sizeof( EmitterState ) );
+	memcpy( pState + sizeof( EmitterState ), m_pParticleData,
+			GetStateSize() - sizeof( EmitterState ) );
+}
+
+//------------------------------------------------------------------------------
+// Name: RestoreState()
+// Desc: Copies the emitter and the particles back from a snapshot
+//------------------------------------------------------------------------------
+void ParticleSystem::RestoreState( const unsigned char* pState )
+{
+	memcpy( &m_emitter, pState, sizeof( EmitterState ) );
+	memcpy( m_pParticleData, pState + sizeof( EmitterState ),
+			GetStateSize() - sizeof( EmitterState ) );
+}
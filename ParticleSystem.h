@@ -16,7 +16,8 @@
 //------------------------------------------------------------------------------
 // Included files:
 //------------------------------------------------------------------------------
-#include <d3dx9.h>
+#include "Platform.h"
+#include "VectorMath.h"
 
 
 //------------------------------------------------------------------------------
@@ -31,9 +32,11 @@ class Scene;
 class ParticleSystem
 {
 public:
-	ParticleSystem( const int numParticles, const float particleLifetime );
+	ParticleSystem( const int numParticles, const float particleLifetime,
+					const unsigned int seed );
 	~ParticleSystem();
 
+	#if !defined( HOVERCRAFT_HEADLESS )
 	HRESULT InitDeviceObjects( const LPDIRECT3DDEVICE9 pd3dDevice, const bool dx9Shaders,
 							   const bool twoSidedStencil );
 	HRESULT RestoreDeviceObjects();
@@ -41,55 +44,96 @@ public:
 	HRESULT DeleteDeviceObjects();
 
 	HRESULT Render( const Scene& scene ) const;
+	#endif
 
 	HRESULT UpdateParticles( const float timeStep );
+	void Rebase( const Vector3& vShift );
 
-	inline void SetPosition( const D3DXVECTOR3 position ) { m_initialPosition = position; }
-	inline void SetVelocity( const D3DXVECTOR3 velocity )
+	inline unsigned int GetNumParticles() const { return m_numParticles; }
+
+	//box around the particles in sight - false if there are none
+	bool GetBounds( Vector3& vMin, Vector3& vMax ) const;
+
+	//snapshots - a buffer of GetStateSize() bytes holds everything that
+	//UpdateParticles() changes
+	unsigned int GetStateSize() const;
+	void SaveState( unsigned char* pState ) const;
+	void RestoreState( const unsigned char* pState );
+
+	inline void SetPosition( const Vector3 position )
 	{
-		D3DXVECTOR3 particleVelocity = velocity;
-		D3DXVec3Normalize( &particleVelocity, &particleVelocity );
-		m_initialVelocity = particleVelocity;
-		m_initialSpeed = ( velocity.x * velocity.x ) +
-						 ( velocity.y * velocity.y ) +
-						 ( velocity.z * velocity.z );
-		m_initialSpeed = float( sqrt( m_initialSpeed ) );
+		m_emitter.initialPosition = position;
+	}
+	inline void SetVelocity( const Vector3 velocity )
+	{
+		m_emitter.initialVelocity = Vec3Normalize( velocity );
+		m_emitter.initialSpeed = ( velocity.x * velocity.x ) +
+								 ( velocity.y * velocity.y ) +
+								 ( velocity.z * velocity.z );
+		m_emitter.initialSpeed = float( sqrt( m_emitter.initialSpeed ) );
 	}
 
 private:
+	//particles are parked below the terrain when none are being made
+	const static float HIDDEN_HEIGHT;
+
 	void InitParticles();
+	void UpdateBounds();
 
-	inline float ParticleSystem::frand( const int seed )
-	{
-		const int x = ( seed << 13 ) ^ seed;
-		return ( 2.0f - ( ( x * ( x * x * 15731 + 789221 ) + 1376312589 ) & 0x7fffffff )
-				/ 1073741824.0f ) * 0.5f;
+	inline float frand( const int seed )
+	{
+		const int x = ( seed << 13 ) ^ seed;
+		return ( 2.0f - ( ( x * ( x * x * 15731 + 789221 ) + 1376312589 ) & 0x7fffffff )
+				/ 1073741824.0f ) * 0.5f;
+	}
+
+	//the same generator as the C runtime's rand(), but with its own seed, so
+	//that a snapshot can save it with the particles
+	inline int Random()
+	{
+		m_emitter.randomState = m_emitter.randomState * 214013 + 2531011;
+		return int( ( m_emitter.randomState >> 16 ) & 0x7fff );
 	}
 
-	inline double gaussianRand( const float mean, const float sd )
-	{
-		double x2pi = frand( rand() ) * 2.0f * D3DX_PI;
-		double g2rad = sqrt( -2.0f * log( 1.0f - frand( rand() ) ) );
-		return mean + cos( x2pi ) * g2rad * sd;
+	inline double gaussianRand( const float mean, const float sd )
+	{
+		double x2pi = frand( Random() ) * 2.0f * MATHS_PI;
+		double g2rad = sqrt( -2.0f * log( 1.0f - frand( Random() ) ) );
+		return mean + cos( x2pi ) * g2rad * sd;
 	}
 
 	//initial particle parameters
 	unsigned int	m_numParticles;
-	D3DXVECTOR3		m_initialPosition;
-	D3DXVECTOR3		m_initialVelocity;
-	float			m_initialSpeed;
-	D3DXVECTOR3		m_gravity;
+	Vector3		m_gravity;
 	float			m_particleLifetime;
 
-	//per-particle parameters
-    D3DXVECTOR3*	m_particlePositions;
-	D3DXVECTOR3*	m_particleVelocities;
+	//everything about the emitter that changes as it runs
+	struct EmitterState
+	{
+		Vector3		initialPosition;
+		Vector3		initialVelocity;
+		float			initialSpeed;
+		unsigned int	randomState;
+
+		//bounds of the particles that are not parked
+		bool			hasBounds;
+		Vector3		vBoundsMin;
+		Vector3		vBoundsMax;
+	};
+	EmitterState m_emitter;
+
+	//per-particle parameters, in one block so a snapshot is a single copy
+	unsigned char*	m_pParticleData;
+	Vector3*	m_particlePositions;
+	Vector3*	m_particleVelocities;
 	float*			m_particleAges;
 
 	//direct3d objects
+	#if !defined( HOVERCRAFT_HEADLESS )
 	LPDIRECT3DDEVICE9				m_pd3dDevice;
 	LPDIRECT3DVERTEXDECLARATION9	m_pVSDecl;
 	LPDIRECT3DVERTEXSHADER9			m_pVS;
+	#endif
 
 };
 
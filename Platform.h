@@ -0,0 +1,111 @@
+//------------------------------------------------------------------------------
+// File: Platform.h
+// Desc: What the core simulation and culling code takes from the platform -
+//		 Win32 and Direct3D in the app, and stand-ins for the few types and
+//		 helpers it uses in a headless build
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_PLATFORM_H
+#define INCLUSIONGUARD_PLATFORM_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+
+//a headless build leaves out everything that needs a device, so the terrain,
+//vehicle, particles and shadow volumes can be built and timed without one -
+//always the case away from windows
+#if !defined( _WIN32 ) && !defined( HOVERCRAFT_HEADLESS )
+	#define HOVERCRAFT_HEADLESS
+#endif
+
+#if defined( _WIN32 )
+	#include <windows.h>
+#else
+	#include <algorithm>
+	#include <stdio.h>
+	#include <time.h>
+#endif
+
+#if !defined( HOVERCRAFT_HEADLESS )
+	#include <d3dx9.h>
+	#include "DXUtil.h"
+#endif
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+#if !defined( _WIN32 )
+
+typedef unsigned char	BYTE;
+typedef unsigned short	WORD;
+typedef unsigned int	DWORD;
+typedef int				HRESULT;
+
+const HRESULT S_OK			= 0;
+const HRESULT E_FAIL		= HRESULT( 0x80004005 );
+const HRESULT E_OUTOFMEMORY	= HRESULT( 0x8007000e );
+
+#define SUCCEEDED( hr )	( HRESULT( hr ) >= 0 )
+#define FAILED( hr )	( HRESULT( hr ) < 0 )
+
+//there is no debugger to send this to
+inline void OutputDebugString( const char* ) {}
+
+#define UNREFERENCED_PARAMETER( p )	( (void)( p ) )
+
+//windows.h has these as macros
+using std::min;
+using std::max;
+
+#endif
+
+#if defined( HOVERCRAFT_HEADLESS )
+
+#define SAFE_DELETE( p )		{ if( p ) { delete ( p ); ( p ) = NULL; } }
+#define SAFE_DELETE_ARRAY( p )	{ if( p ) { delete[] ( p ); ( p ) = NULL; } }
+
+#endif
+
+//------------------------------------------------------------------------------
+// Name: ShowError()
+// Desc: Tells the user something has gone wrong - in a message box on
+//		 windows, and on stderr elsewhere
+//------------------------------------------------------------------------------
+inline void ShowError( const char* message )
+{
+	#if defined( _WIN32 )
+	MessageBox( NULL, message, "Error", MB_ICONEXCLAMATION | MB_OK );
+	#else
+	fprintf( stderr, "Error: %s\n", message );
+	#endif
+}
+
+//------------------------------------------------------------------------------
+// Name: GetTimerSeconds()
+// Desc: Reads a high resolution clock that only ever goes forward. Only the
+//		 difference between two readings means anything.
+//------------------------------------------------------------------------------
+inline double GetTimerSeconds()
+{
+	#if defined( _WIN32 )
+	LARGE_INTEGER count, frequency;
+	QueryPerformanceCounter( &count );
+	QueryPerformanceFrequency( &frequency );
+	return double( count.QuadPart ) / double( frequency.QuadPart );
+	#else
+	timespec time;
+	clock_gettime( CLOCK_MONOTONIC, &time );
+	return double( time.tv_sec ) + double( time.tv_nsec ) * 1e-9;
+	#endif
+}
+
+
+#endif //INCLUSIONGUARD_PLATFORM_H
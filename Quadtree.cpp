@@ -0,0 +1,777 @@
+//------------------------------------------------------------------------------
+// File: Quadtree.cpp
+// Desc: A linearised terrain quadtree that can be tested against the view
+//		 frustum to find the visible cells
+//
+// Created: 03 January 2003 10:27:37
+//
+// (c)2003 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include "Quadtree.h"
+#include "Frustum.h"
+#include "WorkerPool.h"
+
+
+//------------------------------------------------------------------------------
+// Constants:
+//------------------------------------------------------------------------------
+
+//box/plane tests in testing a group of four children against every plane
+const unsigned int TESTS_PER_GROUP = 4 * 6;
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+const float Quadtree::COHERENCE_EPSILON = 0.05f;
+
+//------------------------------------------------------------------------------
+// Name: class Quadtree::CullJob
+// Desc: Culls the subtrees found by AddVisibleNodesParallel(), one per item
+//------------------------------------------------------------------------------
+class Quadtree::CullJob : public WorkerJob
+{
+public:
+	CullJob( Quadtree& tree, const Frustum& frustum, const Vector3& vEye )
+		: m_tree( tree ), m_frustum( frustum ), m_vEye( vEye ) {}
+
+	virtual void Execute( const int item )
+	{
+		CullTask& task = m_tree.m_cullTasks.tasks[ item ];
+		task.nodeList.clear();
+		ResetCullStats( task.stats );
+		m_tree.CullSubtree( m_frustum, m_vEye, task.entry, task.nodeList, NULL, task.stats );
+	}
+
+private:
+	Quadtree& m_tree;
+	const Frustum& m_frustum;
+	const Vector3 m_vEye;
+};
+
+//------------------------------------------------------------------------------
+// Name: Quadtree()
+// Desc: Constructor for the quadtree class - cellsDim must be a power of two
+//------------------------------------------------------------------------------
+Quadtree::Quadtree( const int cellsDim, const float cellSize )
+{
+	m_cellsDim	= cellsDim;
+	m_cellSize	= cellSize;
+
+	//count the levels, and the nodes above the leaves
+	m_numLevels = 1;
+	m_firstLeaf = 0;
+	int levelNodes = 1;
+	for( int dim = 1; dim < cellsDim; dim *= 2 )
+	{
+		m_firstLeaf += levelNodes;
+		levelNodes *= 4;
+		++m_numLevels;
+	}
+	m_numNodes = m_firstLeaf + levelNodes;
+
+	//the first node at TASK_LEVEL, or the first leaf if the tree is shallower
+	m_firstTaskNode = 0;
+	int taskLevelNodes = 1;
+	for( int level = 0; level < TASK_LEVEL; ++level )
+	{
+		m_firstTaskNode += taskLevelNodes;
+		taskLevelNodes *= 4;
+	}
+	m_firstTaskNode = min( m_firstTaskNode, m_firstLeaf );
+
+	//allocate the node arrays - this is the only allocation the tree makes
+	m_minX.resize( m_numNodes, 0.0f );
+	m_minY.resize( m_numNodes, 0.0f );
+	m_minZ.resize( m_numNodes, 0.0f );
+	m_maxX.resize( m_numNodes, 0.0f );
+	m_maxY.resize( m_numNodes, 0.0f );
+	m_maxZ.resize( m_numNodes, 0.0f );
+	m_baseVertex.resize( levelNodes, 0 );
+
+	//no cached results until the first reset
+	m_vReferenceEye		= Vector3( 0.0f, 0.0f, 0.0f );
+	m_coherenceStamp	= 1;
+	CachedGroup emptyGroup = { 0, 0, 0, 0.0f, 0.0f };
+	m_cachedGroups.resize( m_firstLeaf, emptyGroup );
+
+	m_cullTasks.numTasks = 0;
+
+	ResetCullStats( m_cullStats );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetLeafNode()
+// Desc: Finds the node index of the leaf covering a given cell - child k of a
+//		 node covers (x + (k & 1), z + (k >> 1)) of its four quarters
+//------------------------------------------------------------------------------
+int Quadtree::GetLeafNode( const int cellX, const int cellZ ) const
+{
+	int node = 0;
+	for( int bit = m_numLevels - 2; bit >= 0; --bit )
+	{
+		const int child = ( ( cellX >> bit ) & 1 ) + ( ( ( cellZ >> bit ) & 1 ) << 1 );
+		node = GetFirstChild( node ) + child;
+	}
+
+	return node;
+}
+
+//------------------------------------------------------------------------------
+// Name: SetLeaf()
+// Desc: Sets the height range and start vertex of a single cell
+//------------------------------------------------------------------------------
+void Quadtree::SetLeaf( const int cellX, const int cellZ, const float minY, const float maxY,
+						const unsigned int baseVertex )
+{
+	const int node = GetLeafNode( cellX, cellZ );
+
+	m_minX[ node ] = float( cellX ) * m_cellSize;
+	m_maxX[ node ] = m_minX[ node ] + m_cellSize;
+	m_minY[ node ] = minY;
+	m_maxY[ node ] = maxY;
+	m_minZ[ node ] = float( cellZ ) * m_cellSize;
+	m_maxZ[ node ] = m_minZ[ node ] + m_cellSize;
+
+	m_baseVertex[ node - m_firstLeaf ] = baseVertex;
+}
+
+//------------------------------------------------------------------------------
+// Name: GetCellBounds()
+// Desc: Retrieves the bounding box of a single cell
+//------------------------------------------------------------------------------
+void Quadtree::GetCellBounds( const int cellX, const int cellZ, Vector3& vMin,
+							  Vector3& vMax ) const
+{
+	const int node = GetLeafNode( cellX, cellZ );
+
+	vMin = Vector3( m_minX[ node ], m_minY[ node ], m_minZ[ node ] );
+	vMax = Vector3( m_maxX[ node ], m_maxY[ node ], m_maxZ[ node ] );
+}
+
+//------------------------------------------------------------------------------
+// Name: FitBounds()
+// Desc: Fits the bounding box of every parent node around its children - must
+//		 be called once all leaves have been set
+//------------------------------------------------------------------------------
+void Quadtree::FitBounds()
+{
+	//parents always come before their children, so walk backwards
+	for( int node = m_firstLeaf - 1; node >= 0; --node )
+	{
+		const int c = GetFirstChild( node );
+
+		m_minX[ node ] = min( min( m_minX[ c ], m_minX[ c + 1 ] ),
+							  min( m_minX[ c + 2 ], m_minX[ c + 3 ] ) );
+		m_minY[ node ] = min( min( m_minY[ c ], m_minY[ c + 1 ] ),
+							  min( m_minY[ c + 2 ], m_minY[ c + 3 ] ) );
+		m_minZ[ node ] = min( min( m_minZ[ c ], m_minZ[ c + 1 ] ),
+							  min( m_minZ[ c + 2 ], m_minZ[ c + 3 ] ) );
+		m_maxX[ node ] = max( max( m_maxX[ c ], m_maxX[ c + 1 ] ),
+							  max( m_maxX[ c + 2 ], m_maxX[ c + 3 ] ) );
+		m_maxY[ node ] = max( max( m_maxY[ c ], m_maxY[ c + 1 ] ),
+							  max( m_maxY[ c + 2 ], m_maxY[ c + 3 ] ) );
+		m_maxZ[ node ] = max( max( m_maxZ[ c ], m_maxZ[ c + 1 ] ),
+							  max( m_maxZ[ c + 2 ], m_maxZ[ c + 3 ] ) );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: AddVisibleNodes()
+// Desc: Finds all visible leaves and adds their start vertex numbers to a list.
+//		 The four children of a node are tested against the frustum together,
+//		 and visited nearest the eye first, so the leaves come out front to back
+//		 without sorting. Uses an explicit stack, so nothing is allocated as
+//		 long as the list has enough capacity.
+//------------------------------------------------------------------------------
+void Quadtree::AddVisibleNodes( const Frustum& frustum, const Vector3& vEye,
+								std::vector<unsigned int>& nodeList )
+{
+	#if defined(_DEBUG) || defined(DEBUG)
+	const unsigned int firstEntry = nodeList.size();
+	#endif
+
+	#ifdef CULLSTATS_ENABLED
+	ResetCullStats( m_cullStats );
+	#endif
+
+	const int rootEntry = GetRootEntry( frustum, m_cullStats );
+	if( rootEntry >= 0 )
+		CullSubtree( frustum, vEye, rootEntry, nodeList, NULL, m_cullStats );
+
+	#if defined(_DEBUG) || defined(DEBUG)
+	CheckVisibleNodes( frustum, nodeList, firstEntry );
+	#endif
+}
+
+//------------------------------------------------------------------------------
+// Name: AddVisibleNodesParallel()
+// Desc: As AddVisibleNodes(), but the top of the tree is walked first to find
+//		 subtrees that can be culled separately. These are culled on the pool's
+//		 threads into lists of their own, which are then joined in the order
+//		 the subtrees were found in - the order a single walk would visit them.
+//------------------------------------------------------------------------------
+void Quadtree::AddVisibleNodesParallel( const Frustum& frustum, const Vector3& vEye,
+										WorkerPool& pool,
+										std::vector<unsigned int>& nodeList )
+{
+	#if defined(_DEBUG) || defined(DEBUG)
+	const unsigned int firstEntry = nodeList.size();
+	#endif
+
+	m_cullTasks.numTasks = 0;
+
+	#ifdef CULLSTATS_ENABLED
+	ResetCullStats( m_cullStats );
+	#endif
+
+	const int rootEntry = GetRootEntry( frustum, m_cullStats );
+	if( rootEntry >= 0 )
+		CullSubtree( frustum, vEye, rootEntry, nodeList, &m_cullTasks, m_cullStats );
+
+	CullJob job( *this, frustum, vEye );
+	pool.Run( job, int( m_cullTasks.numTasks ) );
+
+	for( unsigned int task = 0; task < m_cullTasks.numTasks; ++task )
+	{
+		const std::vector<unsigned int>& taskList = m_cullTasks.tasks[ task ].nodeList;
+		nodeList.insert( nodeList.end(), taskList.begin(), taskList.end() );
+
+		#ifdef CULLSTATS_ENABLED
+		AddTraversalStats( m_cullStats, m_cullTasks.tasks[ task ].stats );
+		#endif
+	}
+
+	#if defined(_DEBUG) || defined(DEBUG)
+	CheckVisibleNodes( frustum, nodeList, firstEntry );
+	#endif
+}
+
+//------------------------------------------------------------------------------
+// Name: GetRootEntry()
+// Desc: Tests the root, which has no siblings, on its own - returns the stack
+//		 entry to start a cull from, or -1 if the whole tree is outside
+//------------------------------------------------------------------------------
+int Quadtree::GetRootEntry( const Frustum& frustum, CullStats& stats ) const
+{
+	CullMasks rootMasks = IntersectFrustumReference( frustum, 1,
+													 &m_minX[ 0 ], &m_minY[ 0 ], &m_minZ[ 0 ],
+													 &m_maxX[ 0 ], &m_maxY[ 0 ], &m_maxZ[ 0 ] );
+
+	#ifdef CULLSTATS_ENABLED
+	GatherCullStats( frustum, 0, 1, rootMasks.outside, true, stats );
+	#else
+	UNREFERENCED_PARAMETER( stats );
+	#endif
+	if( rootMasks.inside || ( rootMasks.intersecting && IsLeaf( 0 ) ) )
+		return 1;
+	if( rootMasks.intersecting )
+		return 0;
+	return -1;
+}
+
+//------------------------------------------------------------------------------
+// Name: CullSubtree()
+// Desc: Adds the visible leaves below a stack entry to a list, front to back.
+//		 If pTasks is given, entries for nodes at TASK_LEVEL, and for subtrees
+//		 wholly inside, are added to it in visiting order instead of being
+//		 followed. Work done is added to stats.
+//------------------------------------------------------------------------------
+void Quadtree::CullSubtree( const Frustum& frustum, const Vector3& vEye,
+							const int startEntry, std::vector<unsigned int>& nodeList,
+							CullTaskList* pTasks, CullStats& stats ) const
+{
+	#ifndef CULLSTATS_ENABLED
+	UNREFERENCED_PARAMETER( stats );
+	#endif
+
+	//stack entries are node * 2, plus one if every leaf below the node is to be
+	//added without further testing
+	int stack[ MAX_STACK ];
+	int stackSize = 0;
+	stack[ stackSize++ ] = startEntry;
+
+	while( stackSize > 0 )
+	{
+		const int entry = stack[ --stackSize ];
+		const int node = entry >> 1;
+
+		if( pTasks && ( ( entry & 1 ) || node >= m_firstTaskNode ) )
+		{
+			//tasks are kept from one cull to the next, so their lists are not
+			//allocated again
+			if( pTasks->numTasks == pTasks->tasks.size() )
+				pTasks->tasks.resize( pTasks->numTasks + 1 );
+			pTasks->tasks[ pTasks->numTasks++ ].entry = entry;
+			continue;
+		}
+
+		if( entry & 1 )
+		{
+			//all child nodes are inside
+			AddAllNodes( node, vEye, nodeList );
+
+			#ifdef CULLSTATS_ENABLED
+			++stats.nodesAcceptedWhole;
+			stats.leavesAcceptedWhole += GetLeafCount( node );
+			#endif
+			continue;
+		}
+
+		//node is intersecting the frustum boundary - test all four children
+		const int c = GetFirstChild( node );
+		const CullMasks masks = IntersectFrustum4( frustum,
+												   &m_minX[ c ], &m_minY[ c ], &m_minZ[ c ],
+												   &m_maxX[ c ], &m_maxY[ c ], &m_maxZ[ c ] );
+
+		#ifdef CULLSTATS_ENABLED
+		++stats.nodesVisited;
+		GatherCullStats( frustum, c, 4, masks.outside, true, stats );
+		#endif
+
+		//children of a node are either all leaves or all parents
+		const unsigned int addMask = IsLeaf( c ) ? ( masks.inside | masks.intersecting )
+												 : masks.inside;
+
+		//pushed in reverse so the child nearest the eye is visited first
+		const int nearest = GetNearestChild( node, vEye );
+		for( int order = 3; order >= 0; --order )
+		{
+			const int child = nearest ^ order;
+			if( addMask & ( 1 << child ) )
+				stack[ stackSize++ ] = ( ( c + child ) << 1 ) | 1;
+			else if( masks.intersecting & ( 1 << child ) )
+				stack[ stackSize++ ] = ( c + child ) << 1;
+		}
+		//anything left must be outside
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: AddVisibleNodesMulti()
+// Desc: As AddVisibleNodes(), for several frusta at once. Each node carries the
+//		 views it is still to be tested against and the views it is wholly
+//		 inside, so the tree is walked once however many views there are, and a
+//		 node is only tested against the views whose edges it might cross. The
+//		 leaves for view i are added to pNodeLists[ i ], in the same order that
+//		 AddVisibleNodes() would give - front to back from vEye, which need not
+//		 be where any of the views are from.
+//------------------------------------------------------------------------------
+void Quadtree::AddVisibleNodesMulti( const Frustum* pFrusta, const int numFrusta,
+									 const Vector3& vEye,
+									 std::vector<unsigned int>* pNodeLists ) const
+{
+	//each view is a bit of the masks carried down the tree
+	const int numViews = ( numFrusta < MAX_VIEWS ) ? numFrusta : MAX_VIEWS;
+
+	#if defined(_DEBUG) || defined(DEBUG)
+	unsigned int firstEntries[ MAX_VIEWS ];
+	for( int view = 0; view < numViews; ++view )
+		firstEntries[ view ] = pNodeLists[ view ].size();
+	#endif
+
+	MultiViewEntry stack[ MAX_MULTI_STACK ];
+	int stackSize = 0;
+
+	//the root has no siblings, so test it on its own
+	MultiViewEntry rootTest = { 0, 0, 0 };
+	MultiViewEntry rootInside = { 0, 0, 0 };
+	for( int view = 0; view < numViews; ++view )
+	{
+		CullMasks rootMasks = IntersectFrustumReference( pFrusta[ view ], 1,
+														 &m_minX[ 0 ], &m_minY[ 0 ],
+														 &m_minZ[ 0 ], &m_maxX[ 0 ],
+														 &m_maxY[ 0 ], &m_maxZ[ 0 ] );
+		if( rootMasks.inside || ( rootMasks.intersecting && IsLeaf( 0 ) ) )
+			rootInside.insideViews |= 1u << view;
+		else if( rootMasks.intersecting )
+			rootTest.testViews |= 1u << view;
+	}
+
+	if( rootTest.testViews )
+		stack[ stackSize++ ] = rootTest;
+	if( rootInside.insideViews )
+		stack[ stackSize++ ] = rootInside;
+
+	while( stackSize > 0 )
+	{
+		const MultiViewEntry entry = stack[ --stackSize ];
+
+		if( entry.insideViews )
+		{
+			//all child nodes are inside these views
+			AddAllNodesMulti( entry.node, entry.insideViews, vEye, pNodeLists );
+			continue;
+		}
+
+		//node is intersecting the edges of some views - test all four children
+		//against each of them
+		const int c = GetFirstChild( entry.node );
+		unsigned int childTest[ 4 ] = { 0, 0, 0, 0 };
+		unsigned int childInside[ 4 ] = { 0, 0, 0, 0 };
+
+		for( int view = 0; view < numViews; ++view )
+		{
+			if( !( entry.testViews & ( 1u << view ) ) )
+				continue;
+
+			const CullMasks masks = IntersectFrustum4( pFrusta[ view ],
+													   &m_minX[ c ], &m_minY[ c ], &m_minZ[ c ],
+													   &m_maxX[ c ], &m_maxY[ c ], &m_maxZ[ c ] );
+			const unsigned int addMask = IsLeaf( c ) ? ( masks.inside | masks.intersecting )
+													 : masks.inside;
+
+			const unsigned int testMask = masks.intersecting & ~addMask;
+			for( int child = 0; child < 4; ++child )
+			{
+				childInside[ child ] |= ( ( addMask >> child ) & 1 ) << view;
+				childTest[ child ] |= ( ( testMask >> child ) & 1 ) << view;
+			}
+		}
+
+		//pushed in reverse so the child nearest the eye is visited first. A child
+		//that is inside some views and crosses others gets an entry for each, so
+		//the views it is inside have its leaves added in one go rather than leaf
+		//by leaf.
+		const int nearest = GetNearestChild( entry.node, vEye );
+		for( int order = 3; order >= 0; --order )
+		{
+			const int child = nearest ^ order;
+			if( childTest[ child ] )
+			{
+				MultiViewEntry& childEntry = stack[ stackSize++ ];
+				childEntry.node			= c + child;
+				childEntry.testViews	= childTest[ child ];
+				childEntry.insideViews	= 0;
+			}
+
+			if( childInside[ child ] )
+			{
+				MultiViewEntry& childEntry = stack[ stackSize++ ];
+				childEntry.node			= c + child;
+				childEntry.testViews	= 0;
+				childEntry.insideViews	= childInside[ child ];
+			}
+		}
+	}
+
+	#if defined(_DEBUG) || defined(DEBUG)
+	for( int view = 0; view < numViews; ++view )
+		CheckVisibleNodes( pFrusta[ view ], pNodeLists[ view ], firstEntries[ view ] );
+	#endif
+}
+
+//------------------------------------------------------------------------------
+// Name: ResetCoherence()
+// Desc: Throws away all cached results, and sets the eye position that new
+//		 results will be cached against
+//------------------------------------------------------------------------------
+void Quadtree::ResetCoherence( const Vector3& vReferenceEye )
+{
+	m_vReferenceEye = vReferenceEye;
+	++m_coherenceStamp;
+}
+
+//------------------------------------------------------------------------------
+// Name: AddVisibleNodesCoherent()
+// Desc: As AddVisibleNodes(), but reuses results from earlier frames where the
+//		 camera cannot have moved enough to change them. translation is how far
+//		 the eye has moved since the reference position, and rotation is the
+//		 largest distance any unit vector can have been turned through by the
+//		 camera since then. The frustum planes must be normalised.
+//------------------------------------------------------------------------------
+void Quadtree::AddVisibleNodesCoherent( const Frustum& frustum, const Vector3& vEye,
+										const float translation, const float rotation,
+										std::vector<unsigned int>& nodeList )
+{
+	#if defined(_DEBUG) || defined(DEBUG)
+	const unsigned int firstEntry = nodeList.size();
+	#endif
+
+	#ifdef CULLSTATS_ENABLED
+	ResetCullStats( m_cullStats );
+	#endif
+
+	//stack entries are as for AddVisibleNodes()
+	int stack[ MAX_STACK ];
+	int stackSize = 0;
+
+	const int rootEntry = GetRootEntry( frustum, m_cullStats );
+	if( rootEntry >= 0 )
+		stack[ stackSize++ ] = rootEntry;
+
+	while( stackSize > 0 )
+	{
+		const int entry = stack[ --stackSize ];
+		const int node = entry >> 1;
+
+		if( entry & 1 )
+		{
+			AddAllNodes( node, vEye, nodeList );
+
+			#ifdef CULLSTATS_ENABLED
+			++m_cullStats.nodesAcceptedWhole;
+			m_cullStats.leavesAcceptedWhole += GetLeafCount( node );
+			#endif
+			continue;
+		}
+
+		//use the cached results for the children if they are still good, otherwise
+		//test them again
+		const int c = GetFirstChild( node );
+		CullMasks masks;
+		if( GetCachedMasks( node, translation, rotation, masks ) )
+		{
+			#ifdef CULLSTATS_ENABLED
+			m_cullStats.planeTestsSaved += TESTS_PER_GROUP;
+			#endif
+		}
+		else
+		{
+			unsigned int plane = m_cachedGroups[ node ].plane;
+			float margin;
+			unsigned int tests = 0;
+			masks = IntersectFrustum4Coherent( frustum,
+											   &m_minX[ c ], &m_minY[ c ], &m_minZ[ c ],
+											   &m_maxX[ c ], &m_maxY[ c ], &m_maxZ[ c ],
+											   plane, margin, tests );
+			m_cachedGroups[ node ].plane = (unsigned short)plane;
+			SetCachedMasks( node, translation, rotation, masks, margin );
+
+			#ifdef CULLSTATS_ENABLED
+			m_cullStats.planeTests += tests;
+			m_cullStats.planeTestsSaved += TESTS_PER_GROUP - tests;
+			#endif
+		}
+
+		//rejections found in the cache are put down to the plane that would have
+		//rejected them first
+		#ifdef CULLSTATS_ENABLED
+		++m_cullStats.nodesVisited;
+		GatherCullStats( frustum, c, 4, masks.outside, false, m_cullStats );
+		#endif
+
+		const unsigned int addMask = IsLeaf( c ) ? ( masks.inside | masks.intersecting )
+												 : masks.inside;
+
+		const int nearest = GetNearestChild( node, vEye );
+		for( int order = 3; order >= 0; --order )
+		{
+			const int child = nearest ^ order;
+			if( addMask & ( 1 << child ) )
+				stack[ stackSize++ ] = ( ( c + child ) << 1 ) | 1;
+			else if( masks.intersecting & ( 1 << child ) )
+				stack[ stackSize++ ] = ( c + child ) << 1;
+		}
+	}
+
+	#if defined(_DEBUG) || defined(DEBUG)
+	CheckVisibleNodes( frustum, nodeList, firstEntry );
+	#endif
+}
+
+//------------------------------------------------------------------------------
+// Name: GetCachedMasks()
+// Desc: Gets the cached results for the four children of a node - fails if
+//		 any of them might have changed. A plane point at distance r from the
+//		 reference eye can have moved by at most rotation * r + translation.
+//------------------------------------------------------------------------------
+bool Quadtree::GetCachedMasks( const int node, const float translation,
+							   const float rotation, CullMasks& masks ) const
+{
+	const CachedGroup& group = m_cachedGroups[ node ];
+
+	if( group.stamp != m_coherenceStamp ||
+		rotation * group.range + translation >= group.margin )
+		return false;
+
+	masks.inside		= group.masks & 0xf;
+	masks.outside		= ( group.masks >> 4 ) & 0xf;
+	masks.intersecting	= ( group.masks >> 8 ) & 0xf;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: SetCachedMasks()
+// Desc: Caches the results for the four children of a node. Results found away
+//		 from the reference eye have their margin reduced by the distance the
+//		 planes may already have moved, so it stays relative to the reference.
+//------------------------------------------------------------------------------
+void Quadtree::SetCachedMasks( const int node, const float translation,
+							   const float rotation, const CullMasks& masks,
+							   const float margin )
+{
+	//distance from the reference eye to the furthest corner of the parent, which
+	//encloses all of the children
+	const float dx = max( fabs( m_minX[ node ] - m_vReferenceEye.x ),
+						  fabs( m_maxX[ node ] - m_vReferenceEye.x ) );
+	const float dy = max( fabs( m_minY[ node ] - m_vReferenceEye.y ),
+						  fabs( m_maxY[ node ] - m_vReferenceEye.y ) );
+	const float dz = max( fabs( m_minZ[ node ] - m_vReferenceEye.z ),
+						  fabs( m_maxZ[ node ] - m_vReferenceEye.z ) );
+	const float range = float( sqrt( dx * dx + dy * dy + dz * dz ) );
+
+	CachedGroup& group = m_cachedGroups[ node ];
+	group.stamp		= m_coherenceStamp;
+	group.masks		= (unsigned short)( masks.inside | ( masks.outside << 4 ) |
+									( masks.intersecting << 8 ) );
+	group.margin	= margin - ( rotation * range + translation ) - COHERENCE_EPSILON;
+	group.range		= range;
+}
+
+#ifdef CULLSTATS_ENABLED
+//------------------------------------------------------------------------------
+// Name: GatherCullStats()
+// Desc: Counts the tests a group of boxes took and the leaves each plane
+//		 rejected. The kernels test every box in a group against each plane in
+//		 turn, stopping only when all of them are outside, so each rejection is
+//		 put down to the first plane the box is outside.
+//------------------------------------------------------------------------------
+void Quadtree::GatherCullStats( const Frustum& frustum, const int firstNode,
+								const int numNodes, const unsigned int outsideMask,
+								const bool countTests, CullStats& stats ) const
+{
+	unsigned int rejected = 0;
+	int planesTested = 0;
+
+	for( int planeNum = 0; planeNum < 6 && rejected != outsideMask; ++planeNum )
+	{
+		const Plane& plane = frustum.planes[ planeNum ];
+		++planesTested;
+
+		for( int box = 0; box < numNodes; ++box )
+		{
+			if( !( outsideMask & ( 1 << box ) ) || ( rejected & ( 1 << box ) ) )
+				continue;
+
+			const int node = firstNode + box;
+			const float nearX = ( plane.a >= 0 ) ? m_minX[ node ] : m_maxX[ node ];
+			const float nearY = ( plane.b >= 0 ) ? m_minY[ node ] : m_maxY[ node ];
+			const float nearZ = ( plane.c >= 0 ) ? m_minZ[ node ] : m_maxZ[ node ];
+
+			if( ( plane.a * nearX + plane.b * nearY + plane.c * nearZ + plane.d ) > 0 )
+			{
+				rejected |= 1 << box;
+				stats.leavesRejected[ planeNum ] += GetLeafCount( node );
+			}
+		}
+	}
+
+	if( countTests )
+	{
+		const unsigned int allBoxes = ( 1 << numNodes ) - 1;
+		stats.planeTests += numNodes * ( ( outsideMask == allBoxes ) ? planesTested : 6 );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: GetLeafCount()
+// Desc: Counts the leaves below a node
+//------------------------------------------------------------------------------
+int Quadtree::GetLeafCount( int node ) const
+{
+	int count = 1;
+	while( node < m_firstLeaf )
+	{
+		node = GetFirstChild( node );
+		count *= 4;
+	}
+
+	return count;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Name: AddAllNodes()
+// Desc: Adds start vertex numbers for all leaves below a node to a list, front
+//		 to back from the eye
+//------------------------------------------------------------------------------
+void Quadtree::AddAllNodes( const int node, const Vector3& vEye,
+							std::vector<unsigned int>& nodeList ) const
+{
+	int stack[ MAX_STACK ];
+	int stackSize = 0;
+	stack[ stackSize++ ] = node;
+
+	while( stackSize > 0 )
+	{
+		const int parent = stack[ --stackSize ];
+		const int c = GetFirstChild( parent );
+		const int nearest = GetNearestChild( parent, vEye );
+
+		if( IsLeaf( parent ) )
+		{
+			nodeList.push_back( m_baseVertex[ parent - m_firstLeaf ] );
+		}
+		else if( IsLeaf( c ) )
+		{
+			for( int order = 0; order < 4; ++order )
+				nodeList.push_back( m_baseVertex[ c + ( nearest ^ order ) - m_firstLeaf ] );
+		}
+		else
+		{
+			for( int order = 3; order >= 0; --order )
+				stack[ stackSize++ ] = c + ( nearest ^ order );
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: AddAllNodesMulti()
+// Desc: Adds all leaves below a node to the list of each of a set of views
+//------------------------------------------------------------------------------
+void Quadtree::AddAllNodesMulti( const int node, const unsigned int views,
+								 const Vector3& vEye,
+								 std::vector<unsigned int>* pNodeLists ) const
+{
+	for( int view = 0; view < MAX_VIEWS && ( views >> view ) != 0; ++view )
+	{
+		if( views & ( 1u << view ) )
+			AddAllNodes( node, vEye, pNodeLists[ view ] );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckVisibleNodes()
+// Desc: Debug check - compares the leaves found by AddVisibleNodes() with a brute
+//		 force test of every leaf, using both the batch and reference kernels
+//------------------------------------------------------------------------------
+void Quadtree::CheckVisibleNodes( const Frustum& frustum,
+								  const std::vector<unsigned int>& nodeList,
+								  const unsigned int firstEntry ) const
+{
+	const int numLeaves = m_numNodes - m_firstLeaf;
+	const int f = m_firstLeaf;
+
+	std::vector<CullMasks> batch( ( numLeaves + 3 ) / 4 );
+	IntersectFrustumBatch( frustum, numLeaves, &m_minX[ f ], &m_minY[ f ], &m_minZ[ f ],
+						   &m_maxX[ f ], &m_maxY[ f ], &m_maxZ[ f ], &batch[ 0 ] );
+
+	unsigned int numVisible = 0;
+	for( int leaf = 0; leaf < numLeaves; leaf += 4 )
+	{
+		const int count = min( 4, numLeaves - leaf );
+		const CullMasks reference = IntersectFrustumReference( frustum, count,
+			&m_minX[ f + leaf ], &m_minY[ f + leaf ], &m_minZ[ f + leaf ],
+			&m_maxX[ f + leaf ], &m_maxY[ f + leaf ], &m_maxZ[ f + leaf ] );
+		const CullMasks& fast = batch[ leaf / 4 ];
+
+		if( reference.inside != fast.inside || reference.outside != fast.outside ||
+			reference.intersecting != fast.intersecting )
+			OutputDebugString( "Quadtree: batch frustum test disagrees with reference\n" );
+
+		for( int i = 0; i < count; ++i )
+		{
+			if( ( reference.outside & ( 1 << i ) ) == 0 )
+				++numVisible;
+		}
+	}
+
+	if( numVisible != nodeList.size() - firstEntry )
+		OutputDebugString( "Quadtree: visible leaves differ from brute force test\n" );
+}
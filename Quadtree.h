@@ -0,0 +1,218 @@
+//------------------------------------------------------------------------------
+// File: Quadtree.h
+// Desc: A linearised terrain quadtree that can be tested against the view
+//		 frustum to find the visible cells
+//
+// Created: 03 January 2003 08:27:35
+//
+// (c)2003 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_QUADTREE_H
+#define INCLUSIONGUARD_QUADTREE_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <vector>
+
+#include "CullStats.h"
+#include "VectorMath.h"
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+struct Frustum;
+struct CullMasks;
+class WorkerPool;
+
+//------------------------------------------------------------------------------
+// Name: class Quadtree
+// Desc: The terrain quadtree. Nodes are stored breadth-first in flat arrays, so
+//		 the children of node n are always nodes 4n+1 to 4n+4 and no pointers
+//		 are needed. Bounding boxes are stored as separate arrays per component.
+//------------------------------------------------------------------------------
+class Quadtree
+{
+public:
+	const static int LEAFNODE_WIDTH = 40;	//width in quads
+
+	Quadtree( const int cellsDim, const float cellSize );
+
+	void SetLeaf( const int cellX, const int cellZ, const float minY, const float maxY,
+				  const unsigned int baseVertex );
+	void FitBounds();
+
+	inline int GetNumNodes() const { return m_numNodes; }
+	void GetCellBounds( const int cellX, const int cellZ, Vector3& vMin,
+						Vector3& vMax ) const;
+	inline float GetAABBMin( const int node, const int dim ) const;
+	inline float GetAABBMax( const int node, const int dim ) const;
+
+	//leaves are added front to back from vEye
+	void AddVisibleNodes( const Frustum& frustum, const Vector3& vEye,
+						  std::vector<unsigned int>& nodeList );
+	void AddAllNodes( const int node, const Vector3& vEye,
+					  std::vector<unsigned int>& nodeList ) const;
+
+	//the same leaves in the same order as AddVisibleNodes(), with the subtrees
+	//below TASK_LEVEL culled on the pool's threads
+	void AddVisibleNodesParallel( const Frustum& frustum, const Vector3& vEye,
+								  WorkerPool& pool, std::vector<unsigned int>& nodeList );
+
+	//several views culled in one walk of the tree, with a list for each - no
+	//more than MAX_VIEWS, and any past that are left alone
+	const static int MAX_VIEWS = 32;
+	void AddVisibleNodesMulti( const Frustum* pFrusta, const int numViews,
+							   const Vector3& vEye,
+							   std::vector<unsigned int>* pNodeLists ) const;
+
+	//temporal coherence - results are cached against a reference eye position, and
+	//reused while the camera stays close to it
+	void ResetCoherence( const Vector3& vReferenceEye );
+	void AddVisibleNodesCoherent( const Frustum& frustum, const Vector3& vEye,
+								  const float translation, const float rotation,
+								  std::vector<unsigned int>& nodeList );
+
+	//traversal counters for the last single view cull - all zero unless
+	//CULLSTATS_ENABLED is defined
+	inline const CullStats& GetCullStats() const { return m_cullStats; }
+
+private:
+	//deep enough for 2^20 cells per edge
+	const static int MAX_STACK = 64;
+
+	//the parallel cull gives each node this far down, and each subtree found to
+	//be wholly inside above it, a task of its own
+	const static int TASK_LEVEL = 3;
+
+	//a subtree culled by the parallel cull, and the leaves found in it - padded
+	//so that tasks run on different threads don't share cache lines
+	struct CullTask
+	{
+		int entry;
+		std::vector<unsigned int> nodeList;
+		CullStats stats;
+		char padding[ 64 ];
+	};
+
+	//the tasks of the last parallel cull are the first numTasks
+	struct CullTaskList
+	{
+		std::vector<CullTask> tasks;
+		unsigned int numTasks;
+	};
+
+	class CullJob;
+	friend class CullJob;
+
+	//results of testing the four children of a node, cached by the parent
+	struct CachedGroup
+	{
+		unsigned int stamp;		//valid if this matches m_coherenceStamp
+		unsigned short masks;	//inside, outside and intersecting, four bits each
+		unsigned short plane;	//plane that last rejected a child - kept over resets
+		float margin;			//plane movement the results can survive
+		float range;			//distance from eye to furthest corner of any child
+	};
+
+	//allowance for rounding errors in the plane distances
+	const static float COHERENCE_EPSILON;
+
+	//a node waiting to be visited by the multi-view cull, with a bit for each
+	//view - only one of the masks is used by any entry
+	struct MultiViewEntry
+	{
+		int node;
+		unsigned int testViews;		//views the node crosses the edge of
+		unsigned int insideViews;	//views the node is wholly inside
+	};
+
+	//up to seven entries are left on the stack for each level
+	const static int MAX_MULTI_STACK = 7 * MAX_STACK / 3 + 2;
+
+	int GetRootEntry( const Frustum& frustum, CullStats& stats ) const;
+	void CullSubtree( const Frustum& frustum, const Vector3& vEye, const int startEntry,
+					  std::vector<unsigned int>& nodeList, CullTaskList* pTasks,
+					  CullStats& stats ) const;
+
+	#ifdef CULLSTATS_ENABLED
+	void GatherCullStats( const Frustum& frustum, const int firstNode, const int numNodes,
+						  const unsigned int outsideMask, const bool countTests,
+						  CullStats& stats ) const;
+	int GetLeafCount( int node ) const;
+	#endif
+
+	void AddAllNodesMulti( const int node, const unsigned int views,
+						   const Vector3& vEye,
+						   std::vector<unsigned int>* pNodeLists ) const;
+
+	bool GetCachedMasks( const int node, const float translation, const float rotation,
+						 CullMasks& masks ) const;
+	void SetCachedMasks( const int node, const float translation, const float rotation,
+						 const CullMasks& masks, const float margin );
+
+	void CheckVisibleNodes( const Frustum& frustum, const std::vector<unsigned int>& nodeList,
+							const unsigned int firstEntry ) const;
+	int GetLeafNode( const int cellX, const int cellZ ) const;
+
+	inline static int GetFirstChild( const int node ) { return ( node * 4 ) + 1; }
+	inline bool IsLeaf( const int node ) const { return node >= m_firstLeaf; }
+
+	//the child in the same quarter of a node as the eye - the one opposite it
+	//is nearest ^ 3, and the other two are in between
+	inline int GetNearestChild( const int node, const Vector3& vEye ) const
+	{
+		const int xHalf = ( vEye.x * 2.0f >= m_minX[ node ] + m_maxX[ node ] ) ? 1 : 0;
+		const int zHalf = ( vEye.z * 2.0f >= m_minZ[ node ] + m_maxZ[ node ] ) ? 2 : 0;
+		return xHalf | zHalf;
+	}
+
+	int m_cellsDim;
+	float m_cellSize;
+	int m_numLevels;
+	int m_numNodes;
+	int m_firstLeaf;
+	int m_firstTaskNode;
+
+	//AABB
+	std::vector<float> m_minX, m_minY, m_minZ;
+	std::vector<float> m_maxX, m_maxY, m_maxZ;
+
+	//start vertex of each leaf, indexed from m_firstLeaf
+	std::vector<unsigned int> m_baseVertex;
+
+	//temporal coherence
+	Vector3 m_vReferenceEye;
+	unsigned int m_coherenceStamp;
+	std::vector<CachedGroup> m_cachedGroups;	//indexed by parent node
+
+	//parallel culling, reused each frame
+	CullTaskList m_cullTasks;
+
+	CullStats m_cullStats;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: GetAABBMin() / GetAABBMax()
+// Desc: Retrieves a component of a node's bounding box
+//------------------------------------------------------------------------------
+float Quadtree::GetAABBMin( const int node, const int dim ) const
+{
+	if( dim == 0 ) return m_minX[ node ];
+	if( dim == 1 ) return m_minY[ node ];
+	return m_minZ[ node ];
+}
+
+float Quadtree::GetAABBMax( const int node, const int dim ) const
+{
+	if( dim == 0 ) return m_maxX[ node ];
+	if( dim == 1 ) return m_maxY[ node ];
+	return m_maxZ[ node ];
+}
+
+#endif //INCLUSIONGUARD_QUADTREE_H
@@ -0,0 +1,214 @@
+//------------------------------------------------------------------------------
+// File: Replay.cpp
+// Desc: Recording of the input and frame times that drive the simulation, and
+//		 headless playback of a recording
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <string.h>
+#include <vector>
+
+#include "Camera.h"
+#include "Replay.h"
+#include "Simulation.h"
+#include "Terrain.h"
+
+
+//------------------------------------------------------------------------------
+// Constants:
+//------------------------------------------------------------------------------
+
+//the header is the tag, the version, the seed, the step rate, the frame count
+//and the final checksum, each four bytes
+const char			REPLAY_TAG[ 4 ]	= { 'H', 'V', 'R', 'P' };
+const unsigned int	REPLAY_VERSION	= 4;
+const long			HEADER_SIZE		= 24;
+
+//the app's projection, for the culling a playback counts
+const float			FAR_PLANE		= 350.0f;
+const float			ASPECT_RATIO	= 4.0f / 3.0f;
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: ReplayRecorder()
+// Desc: Constructor
+//------------------------------------------------------------------------------
+ReplayRecorder::ReplayRecorder()
+{
+	m_pFile		= NULL;
+	m_seed				= 0;
+	m_stepsPerSecond	= 0;
+	m_numFrames			= 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: ~ReplayRecorder()
+// Desc: Destructor - a recording that was never closed keeps a zero checksum
+//------------------------------------------------------------------------------
+ReplayRecorder::~ReplayRecorder()
+{
+	if( m_pFile != NULL )
+		fclose( m_pFile );
+}
+
+//------------------------------------------------------------------------------
+// Name: Open()
+// Desc: Starts a recording, with a header to be filled in by Close()
+//------------------------------------------------------------------------------
+bool ReplayRecorder::Open( const char* fileName, const unsigned int seed,
+						   const int stepsPerSecond )
+{
+	m_pFile = fopen( fileName, "wb" );
+	if( m_pFile == NULL )
+		return false;
+
+	m_seed = seed;
+	m_stepsPerSecond = stepsPerSecond;
+	m_numFrames = 0;
+	WriteHeader( 0 );
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: RecordFrame()
+// Desc: Adds a frame to the recording
+//------------------------------------------------------------------------------
+void ReplayRecorder::RecordFrame( const float elapsedTime, const unsigned char controls )
+{
+	fwrite( &elapsedTime, sizeof( elapsedTime ), 1, m_pFile );
+	fwrite( &controls, sizeof( controls ), 1, m_pFile );
+	++m_numFrames;
+}
+
+//------------------------------------------------------------------------------
+// Name: Close()
+// Desc: Finishes a recording with the checksum of the state it ended in
+//------------------------------------------------------------------------------
+bool ReplayRecorder::Close( const DWORD checksum )
+{
+	if( m_pFile == NULL )
+		return false;
+
+	fseek( m_pFile, 0, SEEK_SET );
+	WriteHeader( checksum );
+
+	const bool written = ferror( m_pFile ) == 0;
+	fclose( m_pFile );
+	m_pFile = NULL;
+
+	return written;
+}
+
+//------------------------------------------------------------------------------
+// Name: WriteHeader()
+// Desc: Writes the header at the current file position
+//------------------------------------------------------------------------------
+void ReplayRecorder::WriteHeader( const DWORD checksum )
+{
+	fwrite( REPLAY_TAG, sizeof( REPLAY_TAG ), 1, m_pFile );
+	fwrite( &REPLAY_VERSION, sizeof( REPLAY_VERSION ), 1, m_pFile );
+	fwrite( &m_seed, sizeof( m_seed ), 1, m_pFile );
+	fwrite( &m_stepsPerSecond, sizeof( m_stepsPerSecond ), 1, m_pFile );
+	fwrite( &m_numFrames, sizeof( m_numFrames ), 1, m_pFile );
+	fwrite( &checksum, sizeof( checksum ), 1, m_pFile );
+}
+
+//------------------------------------------------------------------------------
+// Name: PlayReplay()
+// Desc: Loads the whole recording first, and times only the stepping, not
+//		 the culling. The terrain is culled and the origin rebased after each
+//		 frame, as the app does.
+//------------------------------------------------------------------------------
+bool PlayReplay( const char* fileName, ReplayResult& result )
+{
+	FILE* pFile = fopen( fileName, "rb" );
+	if( pFile == NULL )
+		return false;
+
+	char tag[ 4 ];
+	unsigned int version = 0;
+	unsigned int seed = 0;
+	int stepsPerSecond = 0;
+	unsigned int numFrames = 0;
+	DWORD expectedChecksum = 0;
+	if( fread( tag, sizeof( tag ), 1, pFile ) != 1 ||
+		memcmp( tag, REPLAY_TAG, sizeof( tag ) ) != 0 ||
+		fread( &version, sizeof( version ), 1, pFile ) != 1 || version != REPLAY_VERSION ||
+		fread( &seed, sizeof( seed ), 1, pFile ) != 1 ||
+		fread( &stepsPerSecond, sizeof( stepsPerSecond ), 1, pFile ) != 1 ||
+		fread( &numFrames, sizeof( numFrames ), 1, pFile ) != 1 ||
+		fread( &expectedChecksum, sizeof( expectedChecksum ), 1, pFile ) != 1 )
+	{
+		fclose( pFile );
+		return false;
+	}
+
+	std::vector<float> elapsedTimes( numFrames );
+	std::vector<unsigned char> controls( numFrames );
+	for( unsigned int frame = 0; frame < numFrames; ++frame )
+	{
+		if( fread( &elapsedTimes[ frame ], sizeof( float ), 1, pFile ) != 1 ||
+			fread( &controls[ frame ], sizeof( unsigned char ), 1, pFile ) != 1 )
+		{
+			fclose( pFile );
+			return false;
+		}
+	}
+	fclose( pFile );
+
+	Simulation simulation;
+	if( FAILED( simulation.Create( seed, stepsPerSecond ) ) )
+		return false;
+
+	Camera camera;
+	Matrix4 matProj;
+	Mat4PerspectiveFovLH( matProj, MATHS_PI/4, ASPECT_RATIO, 1.0f, FAR_PLANE );
+	camera.SetProjection( matProj );
+	Terrain* pTerrain = simulation.GetTerrain();
+
+	double seconds = 0.0;
+	unsigned int numSteps = 0;
+	unsigned int frustumCells = 0;
+	unsigned int occludedCells = 0;
+	unsigned int maxOccludedCells = 0;
+	for( unsigned int frame = 0; frame < numFrames; ++frame )
+	{
+		const double start = GetTimerSeconds();
+		numSteps += simulation.Advance( elapsedTimes[ frame ], controls[ frame ] );
+		seconds += GetTimerSeconds() - start;
+
+		camera.SetCamera( simulation.GetCameraPosition(), simulation.GetCameraTarget(),
+						  Vector3( 0.0f, 1.0f, 0.0f ) );
+		pTerrain->CullQuadtree( camera );
+		frustumCells += static_cast<unsigned int>( pTerrain->GetFrustumCellList().size() );
+		occludedCells += pTerrain->GetOccludedCells();
+		if( pTerrain->GetOccludedCells() > maxOccludedCells )
+			maxOccludedCells = pTerrain->GetOccludedCells();
+
+		Vector3 vShift;
+		simulation.RebaseOrigin( vShift );
+	}
+
+	result.numFrames		= numFrames;
+	result.numSteps			= numSteps;
+	result.seconds			= seconds;
+	result.checksum			= simulation.GetChecksum();
+	result.expectedChecksum	= expectedChecksum;
+	result.frustumCells		= frustumCells;
+	result.occludedCells	= occludedCells;
+	result.maxOccludedCells	= maxOccludedCells;
+
+	return true;
+}
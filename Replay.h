@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+// File: Replay.h
+// Desc: Recording of the input and frame times that drive the simulation, and
+//		 headless playback of a recording
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_REPLAY_H
+#define INCLUSIONGUARD_REPLAY_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <stdio.h>
+
+#include "Platform.h"
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: class ReplayRecorder
+// Desc: Writes the seed and step rate the simulation was created with, then
+//		 the elapsed time and controls of each frame it was advanced by, five
+//		 bytes a frame. Close() fills in the frame count and the checksum of the final
+//		 state in the header.
+//------------------------------------------------------------------------------
+class ReplayRecorder
+{
+public:
+	ReplayRecorder();
+	~ReplayRecorder();
+
+	bool Open( const char* fileName, const unsigned int seed, const int stepsPerSecond );
+	void RecordFrame( const float elapsedTime, const unsigned char controls );
+	bool Close( const DWORD checksum );
+
+	inline bool IsOpen() const { return m_pFile != NULL; }
+
+private:
+	void WriteHeader( const DWORD checksum );
+
+	FILE*			m_pFile;
+	unsigned int	m_seed;
+	int				m_stepsPerSecond;
+	unsigned int	m_numFrames;
+
+};
+
+//------------------------------------------------------------------------------
+// Name: struct ReplayResult
+// Desc: What a headless playback found. The cell counts are over every
+//		 frame's cull, from the simulation's camera with the app's projection.
+//------------------------------------------------------------------------------
+struct ReplayResult
+{
+	unsigned int	numFrames;
+	unsigned int	numSteps;
+	double			seconds;			//time spent stepping, not loading or culling
+	DWORD			checksum;
+	DWORD			expectedChecksum;	//from the recording
+	unsigned int	frustumCells;
+	unsigned int	occludedCells;		//inside the frustum, behind the horizon
+	unsigned int	maxOccludedCells;	//in any one frame
+};
+
+//------------------------------------------------------------------------------
+// Name: PlayReplay()
+// Desc: Runs a recording through a new simulation as fast as it will go,
+//		 culling the terrain each frame but drawing nothing. Returns false if the file could not be read; the
+//		 checksums say whether the run matched the recording.
+//------------------------------------------------------------------------------
+bool PlayReplay( const char* fileName, ReplayResult& result );
+
+
+#endif //INCLUSIONGUARD_REPLAY_H
@@ -15,14 +15,16 @@
 #include <new>
 
 #include "ShadowVolume.h"
-#include "Resource.h"
 
-#include "DXUtil.h"
+#if !defined( HOVERCRAFT_HEADLESS )
+	#include "Resource.h"
+#endif
 
 
 //------------------------------------------------------------------------------
 // Definitions:
 //------------------------------------------------------------------------------
+const float ShadowVolume::EXTRUSION_LENGTH = 100.0f;
 
 //------------------------------------------------------------------------------
 // Name: ShadowVolume()
@@ -31,14 +33,19 @@
 ShadowVolume::ShadowVolume()
 {
 	//initialise member pointers
+	#if !defined( HOVERCRAFT_HEADLESS )
 	m_pd3dDevice	= NULL;
 	m_pVS			= NULL;
 	m_pVSDecl		= NULL;
+	#endif
 	m_numVertices	= 0;
 
 	m_showVolumes = false;
+	m_twoSidedStencil = false;
 }
 
+#if !defined( HOVERCRAFT_HEADLESS )
+
 //------------------------------------------------------------------------------
 // Name: InitDeviceObjects()
 // Desc: Sets up device-specific data on startup and device change
@@ -130,7 +137,7 @@ HRESULT ShadowVolume::Render() const
 		m_pd3dDevice->SetRenderState( D3DRS_STENCILENABLE, FALSE );
 		m_pd3dDevice->SetRenderState( D3DRS_ZWRITEENABLE, FALSE );
 		m_pd3dDevice->DrawPrimitiveUP( D3DPT_TRIANGLELIST, m_numVertices/3,
-									m_pVertices, sizeof(D3DXVECTOR3) );
+									m_pVertices, sizeof(Vector3) );
 	}
 
 	//disable z-buffer writes (note: z-testing still occurs), and enable the stencil-buffer
@@ -171,7 +178,7 @@ HRESULT ShadowVolume::Render() const
 
 		//draw both sides of shadow volume in stencil/z only
 		m_pd3dDevice->DrawPrimitiveUP( D3DPT_TRIANGLELIST, m_numVertices/3,
-									m_pVertices, sizeof(D3DXVECTOR3) );
+									m_pVertices, sizeof(Vector3) );
 
 		m_pd3dDevice->SetRenderState( D3DRS_TWOSIDEDSTENCILMODE, FALSE );
 	}
@@ -180,7 +187,7 @@ HRESULT ShadowVolume::Render() const
 		//draw front-side of shadow volume in stencil/z only
 		m_pd3dDevice->SetRenderState( D3DRS_CULLMODE, D3DCULL_CW );
 		m_pd3dDevice->DrawPrimitiveUP( D3DPT_TRIANGLELIST, m_numVertices/3,
-									m_pVertices, sizeof(D3DXVECTOR3) );
+									m_pVertices, sizeof(Vector3) );
 
 		//decrement stencil buffer value
 		m_pd3dDevice->SetRenderState( D3DRS_STENCILPASS, D3DSTENCILOP_DECR );
@@ -188,7 +195,7 @@ HRESULT ShadowVolume::Render() const
 		//draw back-side of shadow volume in stencil/z only
 		m_pd3dDevice->SetRenderState( D3DRS_CULLMODE, D3DCULL_CCW );
 		m_pd3dDevice->DrawPrimitiveUP( D3DPT_TRIANGLELIST, m_numVertices/3,
-									m_pVertices, sizeof(D3DXVECTOR3) );
+									m_pVertices, sizeof(Vector3) );
 	}
 
 	//restore render states
@@ -202,6 +209,8 @@ HRESULT ShadowVolume::Render() const
 	return S_OK;
 }
 
+#endif
+
 //-----------------------------------------------------------------------------
 // Name: BuildFromMesh()
 // Desc: Takes a mesh as input, and uses it to build a shadowvolume. The
@@ -210,32 +219,18 @@ HRESULT ShadowVolume::Render() const
 //       only silohuette edges are kept. Finally, the silohuette edges are
 //       extruded to make the shadow volume vertex list.
 //-----------------------------------------------------------------------------
-HRESULT ShadowVolume::BuildFromMesh( LPD3DXMESH pMesh, D3DXVECTOR3 vLight )
+HRESULT ShadowVolume::BuildFromMesh( const Vector3* pVertices, const WORD* pIndices,
+									 const DWORD numFaces, const Vector3& vLightDirection )
 {
-	//note: the MESHVERTEX format depends on the FVF of the mesh
-	struct MESHVERTEX
-	{
-		D3DXVECTOR3 p, n;
-	};
-
-	vLight = -vLight;
-
-	MESHVERTEX* pVertices;
-	WORD*       pIndices;
-
-	//lock the geometry buffers
-	pMesh->LockVertexBuffer( 0, (LPVOID*)&pVertices );
-	pMesh->LockIndexBuffer( 0, (LPVOID*)&pIndices );
-	DWORD numFaces = pMesh->GetNumFaces();
+	const Vector3 vLight = -vLightDirection;
+	const Vector3 vExtrusion = GetExtrusion( vLightDirection );
 
 	//allocate a temporary edge list
 	WORD* pEdges = NULL;
 	try{ pEdges = new WORD[ numFaces * 6 ]; }
 	catch( std::bad_alloc& error )
 	{
-		pMesh->UnlockVertexBuffer();
-		pMesh->UnlockIndexBuffer();
-		MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
+		ShowError( error.what() );
 		return E_OUTOFMEMORY;
 	}
 	DWORD numEdges = 0;
@@ -247,17 +242,14 @@ HRESULT ShadowVolume::BuildFromMesh( LPD3DXMESH pMesh, D3DXVECTOR3 vLight )
 		WORD wFace1 = pIndices[ 3*i + 1 ];
 		WORD wFace2 = pIndices[ 3*i + 2 ];
 
-		D3DXVECTOR3 v0 = pVertices[ wFace0 ].p;
-		D3DXVECTOR3 v1 = pVertices[ wFace1 ].p;
-		D3DXVECTOR3 v2 = pVertices[ wFace2 ].p;
+		const Vector3& v0 = pVertices[ wFace0 ];
+		const Vector3& v1 = pVertices[ wFace1 ];
+		const Vector3& v2 = pVertices[ wFace2 ];
 
 		//transform vertices or transform light?
-		D3DXVECTOR3 vCross1(v2-v1);
-		D3DXVECTOR3 vCross2(v1-v0);
-		D3DXVECTOR3 vNormal;
-		D3DXVec3Cross( &vNormal, &vCross1, &vCross2 );
+		const Vector3 vNormal = Vec3Cross( v2 - v1, v1 - v0 );
 
-		if( D3DXVec3Dot( &vNormal, &vLight ) >= 0.0f )
+		if( Vec3Dot( vNormal, vLight ) >= 0.0f )
 		{
 			//add edges to the list
 			pEdges[ 2*numEdges ] = wFace0;
@@ -274,10 +266,10 @@ HRESULT ShadowVolume::BuildFromMesh( LPD3DXMESH pMesh, D3DXVECTOR3 vLight )
 
 	for( DWORD i = 0;  i < numEdges; ++i )
 	{
-		D3DXVECTOR3 v1 = pVertices[ pEdges[ 2*i + 0 ] ].p;
-		D3DXVECTOR3 v2 = pVertices[ pEdges[ 2*i + 1 ] ].p;
-		D3DXVECTOR3 v3 = v1 - vLight * 100;
-		D3DXVECTOR3 v4 = v2 - vLight * 100;
+		const Vector3& v1 = pVertices[ pEdges[ 2*i + 0 ] ];
+		const Vector3& v2 = pVertices[ pEdges[ 2*i + 1 ] ];
+		const Vector3 v3 = v1 + vExtrusion;
+		const Vector3 v4 = v2 + vExtrusion;
 
 		//add a quad (two triangles) to the vertex list
 		m_pVertices[ m_numVertices++ ] = v1;
@@ -291,9 +283,5 @@ HRESULT ShadowVolume::BuildFromMesh( LPD3DXMESH pMesh, D3DXVECTOR3 vLight )
 	//delete the temporary edge list
 	delete[] pEdges;
 
-	//unlock the geometry buffers
-	pMesh->UnlockVertexBuffer();
-	pMesh->UnlockIndexBuffer();
-
     return S_OK;
 }
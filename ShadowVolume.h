@@ -16,7 +16,8 @@
 //------------------------------------------------------------------------------
 // Included files:
 //------------------------------------------------------------------------------
-#include <d3dx9.h>
+#include "Platform.h"
+#include "VectorMath.h"
 
 
 //------------------------------------------------------------------------------
@@ -30,15 +31,32 @@
 class ShadowVolume
 {
 public:
+	//distance the silhouette is pushed away from the light, in object space
+	const static float EXTRUSION_LENGTH;
+
+	//what a vertex is moved by to extrude it, away from a light shining along
+	//vLight - anything that bounds the volume has to push the same way
+	static inline Vector3 GetExtrusion( const Vector3& vLight )
+	{
+		return vLight * EXTRUSION_LENGTH;
+	}
+
 	ShadowVolume();
 
+	#if !defined( HOVERCRAFT_HEADLESS )
 	HRESULT InitDeviceObjects( const LPDIRECT3DDEVICE9 pd3dDevice, const bool dx9Shaders,
 							   const bool twoSidedStencil );
 	HRESULT DeleteDeviceObjects();
 	HRESULT Render() const;
+	#endif
 
+	//adds the volume cast by a triangle list - the positions of its vertices,
+	//and three indices for each face - to the one built since the last reset
 	void Reset() { m_numVertices = 0; }
-	HRESULT BuildFromMesh( const LPD3DXMESH pMesh, const D3DXVECTOR3 vLight );
+	HRESULT BuildFromMesh( const Vector3* pVertices, const WORD* pIndices,
+						   const DWORD numFaces, const Vector3& vLight );
+	inline DWORD GetNumVertices() const { return m_numVertices; }
+	inline const Vector3& GetVertex( const DWORD vertex ) const { return m_pVertices[ vertex ]; }
 
 	void ShowVolumes( const bool showVolumes ) { m_showVolumes = showVolumes; }
 
@@ -46,14 +64,16 @@ private:
 	bool m_showVolumes;
 	bool m_twoSidedStencil;
 
-	D3DXVECTOR3 m_pVertices[ 32000 ];
+	Vector3 m_pVertices[ 32000 ];
 	DWORD m_numVertices;
 
 	//direct3d objects
+	#if !defined( HOVERCRAFT_HEADLESS )
 	struct TerrainVertex;
 	LPDIRECT3DDEVICE9		m_pd3dDevice;
 	LPDIRECT3DVERTEXSHADER9 m_pVS;
 	LPDIRECT3DVERTEXDECLARATION9 m_pVSDecl;
+	#endif
 
 };
 
@@ -0,0 +1,437 @@
+//------------------------------------------------------------------------------
+// File: Simulation.cpp
+// Desc: The simulated part of the scene - the vehicle, its dust trail and the
+//		 chasecam - stepped the same way by the app and by the replay player
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+#include "ChaseCam.h"
+#include "ParticleSystem.h"
+#include "Simulation.h"
+#include "Terrain.h"
+#include "Vehicle.h"
+
+
+//------------------------------------------------------------------------------
+// Constants:
+//------------------------------------------------------------------------------
+const float CAMERA_NEAR			= 10.0f;
+const float CAMERA_FAR			= 30.0f;
+const float CAMERA_HEIGHT		= 8.0f;
+const int	REBASE_CELLS		= 2;	//camera distance (cells) before the origin moves
+const float MAX_FRAME_STEP_TIME	= 0.1f;	//time a frame may step through before the simulation slows
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: HashBytes()
+// Desc: Adds some bytes to a 32-bit FNV-1a hash
+//------------------------------------------------------------------------------
+static DWORD HashBytes( DWORD hash, const void* pData, const unsigned int size )
+{
+	const unsigned char* pBytes = static_cast<const unsigned char*>( pData );
+	for( unsigned int i = 0; i < size; ++i )
+	{
+		hash ^= pBytes[ i ];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+//------------------------------------------------------------------------------
+// Name: Simulation()
+// Desc: Constructor
+//------------------------------------------------------------------------------
+Simulation::Simulation()
+{
+	m_pTerrain		= NULL;
+	m_pVehicle		= NULL;
+	m_pParticles	= NULL;
+	m_pChaseCam		= NULL;
+
+	m_state.cameraNear	= false;
+	m_state.physicsTime	= 0.0f;
+
+	m_state.vPreviousCameraPosition	= Vector3( 0.0f, 0.0f, 0.0f );
+	m_state.vPreviousChasePosition	= Vector3( 0.0f, 0.0f, 0.0f );
+	m_state.vCameraPosition			= Vector3( 0.0f, 0.0f, 0.0f );
+	m_state.vCameraTarget			= Vector3( 0.0f, 0.0f, 0.0f );
+
+	m_stepsPerSecond	= DEFAULT_STEPS_PER_SECOND;
+	m_physicsStep		= 1.0f / float( DEFAULT_STEPS_PER_SECOND );
+	m_maxPhysicsSteps	= 1;
+
+	m_snapshotSize	= 0;
+	m_frame			= 0;
+	m_numSnapshots	= 0;
+
+	m_frameTiming	= false;
+	memset( &m_frameTimes, 0, sizeof( m_frameTimes ) );
+}
+
+//------------------------------------------------------------------------------
+// Name: ~Simulation()
+// Desc: Destructor
+//------------------------------------------------------------------------------
+Simulation::~Simulation()
+{
+	SAFE_DELETE( m_pChaseCam );
+	SAFE_DELETE( m_pParticles );
+	SAFE_DELETE( m_pVehicle );
+	SAFE_DELETE( m_pTerrain );
+}
+
+//------------------------------------------------------------------------------
+// Name: Create()
+// Desc: Creates the simulated objects, stepped that many times a second, and
+//		 puts the vehicle at the centre of the terrain with the camera behind
+//		 it. Fails if the step rate is not positive.
+//------------------------------------------------------------------------------
+HRESULT Simulation::Create( const unsigned int seed, const int stepsPerSecond )
+{
+	if( stepsPerSecond < 1 )
+		return E_FAIL;
+
+	m_stepsPerSecond = stepsPerSecond;
+	m_physicsStep = 1.0f / float( stepsPerSecond );
+	m_maxPhysicsSteps = int( ( MAX_FRAME_STEP_TIME * float( stepsPerSecond ) ) + 0.5f );
+	if( m_maxPhysicsSteps < 1 )
+		m_maxPhysicsSteps = 1;
+
+	try
+	{
+		m_pParticles	= new ParticleSystem( 10000, 2.0f, seed );
+		m_pTerrain		= new Terrain();
+		m_pVehicle		= new Vehicle();
+		m_pChaseCam		= new ChaseCam( CAMERA_FAR, CAMERA_HEIGHT, 100.0f );
+	}
+	catch( std::bad_alloc& )
+	{
+		return E_OUTOFMEMORY;
+	}
+
+	//set the initial vehicle parameters
+	const float centerPoint = m_pTerrain->GetTerrainSize() / 2.0f;
+	const float centerHeight = m_pTerrain->GetHeightMapPoint( centerPoint, centerPoint );
+	m_pVehicle->SetPosition( Vector3( centerPoint, centerHeight + 2.0f, centerPoint ) );
+
+	//set up the camera
+	Vector3 vPosition = m_pVehicle->GetPosition();
+	m_pChaseCam->SetChasePosition( vPosition );
+	vPosition[ 0 ] -= 30.0f;
+	vPosition[ 1 ] += 10.0f;
+	vPosition[ 2 ] -= 30.0f;
+	m_pChaseCam->SetCameraPosition( vPosition );
+	m_state.vPreviousCameraPosition	= m_pChaseCam->GetCameraPosition();
+	m_state.vPreviousChasePosition	= m_pChaseCam->GetChasePosition();
+	m_state.vCameraPosition			= m_state.vPreviousCameraPosition;
+	m_state.vCameraTarget			= m_state.vPreviousChasePosition;
+
+	//each snapshot is rounded up to keep the next one aligned
+	m_snapshotSize = sizeof( SnapshotHeader ) + sizeof( VehiclePhysicsState ) +
+					 sizeof( ChaseCam ) + m_pParticles->GetStateSize();
+	m_snapshotSize = ( m_snapshotSize + 15 ) & ~15;
+	try{ m_snapshots.resize( SNAPSHOT_FRAMES * m_snapshotSize ); }
+	catch( std::bad_alloc& )
+	{
+		return E_OUTOFMEMORY;
+	}
+
+	return S_OK;
+}
+
+//------------------------------------------------------------------------------
+// Name: Advance()
+// Desc: Runs the simulation for a frame
+//------------------------------------------------------------------------------
+int Simulation::Advance( const float elapsedTime, const unsigned char controls )
+{
+	const bool forwardThrust	= ( controls & CONTROL_FORWARD ) != 0;
+	const bool reverseThrust	= ( controls & CONTROL_REVERSE ) != 0;
+	const bool leftThrust		= ( controls & CONTROL_LEFT ) != 0;
+	const bool rightThrust		= ( controls & CONTROL_RIGHT ) != 0;
+	const bool centerCam		= ( controls & CONTROL_CENTRE_CAMERA ) != 0;
+	const bool cameraNear		= ( controls & CONTROL_CAMERA_NEAR ) != 0;
+
+	SaveSnapshot( elapsedTime, controls );
+	++m_frame;
+	if( m_numSnapshots < SNAPSHOT_FRAMES )
+		++m_numSnapshots;
+
+	//camera distance
+	if( cameraNear != m_state.cameraNear )
+	{
+		m_state.cameraNear = cameraNear;
+		if( m_state.cameraNear )
+			m_pChaseCam->SetParameters( CAMERA_NEAR, CAMERA_HEIGHT );
+		else
+			m_pChaseCam->SetParameters( CAMERA_FAR, CAMERA_HEIGHT );
+	}
+
+	//run the physics simulation on the vehicle and the chasecam in fixed steps,
+	//so that they behave the same at any framerate - time that doesn't make a
+	//whole step is carried over to the next frame
+	memset( &m_frameTimes, 0, sizeof( m_frameTimes ) );
+	m_state.physicsTime += elapsedTime;
+	int steps = 0;
+	while( m_state.physicsTime >= m_physicsStep && steps < m_maxPhysicsSteps )
+	{
+		m_state.vPreviousCameraPosition	= m_pChaseCam->GetCameraPosition();
+		m_state.vPreviousChasePosition	= m_pChaseCam->GetChasePosition();
+
+		const double physicsStart = m_frameTiming ? GetTimerSeconds() : 0.0;
+		m_pVehicle->DoPhysics( m_physicsStep, m_pTerrain, forwardThrust, reverseThrust,
+							   leftThrust, rightThrust );
+		const double chaseStart = m_frameTiming ? GetTimerSeconds() : 0.0;
+
+		const Vector3 vVehicleVelocity = m_pVehicle->GetVelocity();
+		m_pChaseCam->SetChasePosition( m_pVehicle->GetPosition() );
+		m_pChaseCam->SetChaseDirection( m_pVehicle->GetDirection() );
+		m_pChaseCam->SetChaseVelocity( vVehicleVelocity );
+		m_pChaseCam->SetCameraVelocity( vVehicleVelocity );
+		m_pChaseCam->UpdatePosition( m_physicsStep, centerCam );
+
+		if( m_frameTiming )
+		{
+			const double chaseEnd = GetTimerSeconds();
+			m_frameTimes.physicsSeconds += chaseStart - physicsStart;
+			m_frameTimes.chaseCamSeconds += chaseEnd - chaseStart;
+		}
+
+		m_state.physicsTime -= m_physicsStep;
+		++steps;
+	}
+
+	//if a frame needs more steps than that, drop the rest of its time and let
+	//the simulation fall behind rather than spending ever longer catching up
+	if( m_state.physicsTime >= m_physicsStep )
+		m_state.physicsTime = fmodf( m_state.physicsTime, m_physicsStep );
+
+	//draw everything between the states before and after the last step
+	const float interpolation = m_state.physicsTime / m_physicsStep;
+	m_pVehicle->SetInterpolation( interpolation );
+
+	const Vector3 vVehiclePosition	= m_pVehicle->GetRenderPosition();
+	const Vector3 vVehicleVelocity	= m_pVehicle->GetVelocity();
+
+	//update the vehicle's dust trail...
+	//particle generation position
+	Vector3 particlePosition = vVehiclePosition;
+	particlePosition.y -= 1.8f;
+	m_pParticles->SetPosition( particlePosition );
+
+	//particle velocity
+	if( m_pVehicle->IsOnGround() )
+	{
+		m_pParticles->SetVelocity( - vVehicleVelocity );
+
+		const double particlesStart = m_frameTiming ? GetTimerSeconds() : 0.0;
+		m_pParticles->UpdateParticles( steps * m_physicsStep );
+		if( m_frameTiming )
+			m_frameTimes.particlesSeconds = GetTimerSeconds() - particlesStart;
+		m_frameTimes.particlesMoved = true;
+	}
+	else
+	{
+		m_pParticles->SetVelocity( Vector3( 0.0f, 0.0f, 0.0f ) );
+	}
+
+	//the chasecam too
+	const Vector3 vCameraPosition	= m_pChaseCam->GetCameraPosition();
+	const Vector3 vChaseTarget		= m_pChaseCam->GetChasePosition();
+	m_state.vCameraPosition = Vec3Lerp( m_state.vPreviousCameraPosition, vCameraPosition,
+										interpolation );
+	m_state.vCameraTarget = Vec3Lerp( m_state.vPreviousChasePosition, vChaseTarget,
+									  interpolation );
+
+	//adjust height to make sure the camera follows the terrain
+	float height = m_pTerrain->GetHeightMapPoint( m_state.vCameraPosition[ 0 ],
+												  m_state.vCameraPosition[ 2 ] );
+	height = m_state.vCameraPosition[ 1 ] - ( height + 3.0f );
+	if( height < 0.0f )
+		m_state.vCameraPosition[ 1 ] -= height;
+
+	return steps;
+}
+
+//------------------------------------------------------------------------------
+// Name: RebaseOrigin()
+// Desc: Moves the floating origin by whole cells once the camera strays too far
+//		 from it, shifting everything simulated in origin-relative coordinates
+//------------------------------------------------------------------------------
+bool Simulation::RebaseOrigin( Vector3& vShift )
+{
+	const float cellSize = m_pTerrain->GetCellSize();
+	const int shiftX = int( floor( m_state.vCameraPosition[ 0 ] / cellSize ) );
+	const int shiftZ = int( floor( m_state.vCameraPosition[ 2 ] / cellSize ) );
+
+	if( abs( shiftX ) < REBASE_CELLS && abs( shiftZ ) < REBASE_CELLS )
+		return false;
+
+	//whole cells only, so the shift is exact and terrain cells stay aligned
+	vShift = Vector3( float( shiftX ) * cellSize, 0.0f, float( shiftZ ) * cellSize );
+	m_pTerrain->SetOrigin( m_pTerrain->GetOriginX() + shiftX,
+						   m_pTerrain->GetOriginZ() + shiftZ );
+
+	m_pVehicle->Rebase( vShift );
+	m_pParticles->Rebase( vShift );
+	m_pChaseCam->Rebase( vShift );
+	m_state.vPreviousCameraPosition	-= vShift;
+	m_state.vPreviousChasePosition	-= vShift;
+	m_state.vCameraPosition			-= vShift;
+	m_state.vCameraTarget			-= vShift;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: Rollback()
+// Desc: Restores the snapshot from the start of a past frame, and runs forward
+//		 from it to the present again
+//------------------------------------------------------------------------------
+bool Simulation::Rollback( const int frames )
+{
+	if( frames < 1 || frames > m_numSnapshots )
+		return false;
+
+	m_frame -= frames;
+	m_numSnapshots -= frames;
+	RestoreSnapshot( m_frame );
+
+	//Advance() saves each frame's snapshot again before running it
+	for( int frame = 0; frame < frames; ++frame )
+	{
+		const SnapshotHeader* pHeader = reinterpret_cast<const SnapshotHeader*>(
+			&m_snapshots[ ( m_frame % SNAPSHOT_FRAMES ) * m_snapshotSize ] );
+		const float elapsedTime = pHeader->elapsedTime;
+		const unsigned char controls = pHeader->controls;
+
+		Advance( elapsedTime, controls );
+
+		Vector3 vShift;
+		RebaseOrigin( vShift );
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: SetPastControls()
+// Desc: Changes the controls recorded for a past frame
+//------------------------------------------------------------------------------
+bool Simulation::SetPastControls( const int frames, const unsigned char controls )
+{
+	if( frames < 1 || frames > m_numSnapshots )
+		return false;
+
+	const unsigned int frame = m_frame - frames;
+	SnapshotHeader* pHeader = reinterpret_cast<SnapshotHeader*>(
+		&m_snapshots[ ( frame % SNAPSHOT_FRAMES ) * m_snapshotSize ] );
+	pHeader->controls = controls;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: SaveSnapshot()
+// Desc: Copies the state into the ring at the current frame, along with what
+//		 the frame is about to be run with
+//------------------------------------------------------------------------------
+void Simulation::SaveSnapshot( const float elapsedTime, const unsigned char controls )
+{
+	unsigned char* pSnapshot =
+		&m_snapshots[ ( m_frame % SNAPSHOT_FRAMES ) * m_snapshotSize ];
+
+	SnapshotHeader header;
+	header.elapsedTime	= elapsedTime;
+	header.controls		= controls;
+	header.originX		= m_pTerrain->GetOriginX();
+	header.originZ		= m_pTerrain->GetOriginZ();
+	header.state		= m_state;
+	memcpy( pSnapshot, &header, sizeof( header ) );
+	pSnapshot += sizeof( header );
+
+	memcpy( pSnapshot, &m_pVehicle->GetPhysicsState(), sizeof( VehiclePhysicsState ) );
+	pSnapshot += sizeof( VehiclePhysicsState );
+
+	memcpy( pSnapshot, m_pChaseCam, sizeof( ChaseCam ) );
+	pSnapshot += sizeof( ChaseCam );
+
+	m_pParticles->SaveState( pSnapshot );
+}
+
+//------------------------------------------------------------------------------
+// Name: RestoreSnapshot()
+// Desc: Copies the state back from the ring at a given frame
+//------------------------------------------------------------------------------
+void Simulation::RestoreSnapshot( const unsigned int frame )
+{
+	const unsigned char* pSnapshot =
+		&m_snapshots[ ( frame % SNAPSHOT_FRAMES ) * m_snapshotSize ];
+
+	const SnapshotHeader* pHeader = reinterpret_cast<const SnapshotHeader*>( pSnapshot );
+	m_state = pHeader->state;
+	if( pHeader->originX != m_pTerrain->GetOriginX() ||
+		pHeader->originZ != m_pTerrain->GetOriginZ() )
+	{
+		m_pTerrain->SetOrigin( pHeader->originX, pHeader->originZ );
+	}
+	pSnapshot += sizeof( SnapshotHeader );
+
+	m_pVehicle->SetPhysicsState( *reinterpret_cast<const VehiclePhysicsState*>( pSnapshot ) );
+	pSnapshot += sizeof( VehiclePhysicsState );
+
+	memcpy( m_pChaseCam, pSnapshot, sizeof( ChaseCam ) );
+	pSnapshot += sizeof( ChaseCam );
+
+	m_pParticles->RestoreState( pSnapshot );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetChecksum()
+// Desc: Hashes the bits of the simulated state - any difference at all in how
+//		 a replay ran shows up in the result
+//------------------------------------------------------------------------------
+DWORD Simulation::GetChecksum() const
+{
+	DWORD hash = 2166136261;
+
+	const int origin[ 2 ] = { m_pTerrain->GetOriginX(), m_pTerrain->GetOriginZ() };
+	hash = HashBytes( hash, origin, sizeof( origin ) );
+
+	const Vector3 vPosition = m_pVehicle->GetPosition();
+	const Vector3 vVelocity = m_pVehicle->GetVelocity();
+	const Quaternion& qOrientation = m_pVehicle->GetOrientation();
+	hash = HashBytes( hash, &vPosition, sizeof( vPosition ) );
+	hash = HashBytes( hash, &vVelocity, sizeof( vVelocity ) );
+	hash = HashBytes( hash, &qOrientation, sizeof( qOrientation ) );
+
+	const Vector3 vCameraPosition = m_pChaseCam->GetCameraPosition();
+	hash = HashBytes( hash, &vCameraPosition, sizeof( vCameraPosition ) );
+	hash = HashBytes( hash, &m_state.physicsTime, sizeof( m_state.physicsTime ) );
+
+	//the dust trail's bounds depend on every particle in sight
+	Vector3 vMin, vMax;
+	if( m_pParticles->GetBounds( vMin, vMax ) )
+	{
+		hash = HashBytes( hash, &vMin, sizeof( vMin ) );
+		hash = HashBytes( hash, &vMax, sizeof( vMax ) );
+	}
+
+	return hash;
+}
@@ -0,0 +1,170 @@
+//------------------------------------------------------------------------------
+// File: Simulation.h
+// Desc: The simulated part of the scene - the vehicle, its dust trail and the
+//		 chasecam - stepped the same way by the app and by the replay player
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_SIMULATION_H
+#define INCLUSIONGUARD_SIMULATION_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <vector>
+
+#include "Platform.h"
+#include "VectorMath.h"
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+class ChaseCam;
+class ParticleSystem;
+class Terrain;
+class Vehicle;
+
+//------------------------------------------------------------------------------
+// Name: class Simulation
+// Desc: Owns the objects the simulation changes, and runs them in fixed steps.
+//		 Everything that happens to them comes from the seed and step rate
+//		 given to Create() and the elapsed time and controls given to
+//		 Advance(), so a recording of those plays back to the same state. A
+//		 snapshot of the state is taken at the start of each frame, each part
+//		 of it a plain copy, so the last few frames can be rolled back and run
+//		 again.
+//------------------------------------------------------------------------------
+class Simulation
+{
+public:
+	//bits of the controls for one frame
+	const static unsigned char CONTROL_FORWARD			= 1;
+	const static unsigned char CONTROL_REVERSE			= 2;
+	const static unsigned char CONTROL_LEFT				= 4;
+	const static unsigned char CONTROL_RIGHT			= 8;
+	const static unsigned char CONTROL_CENTRE_CAMERA	= 16;
+	const static unsigned char CONTROL_CAMERA_NEAR		= 32;
+
+	//frames that can be rolled back
+	const static int SNAPSHOT_FRAMES = 32;
+
+	//the app's physics steps a second, unless it is told otherwise
+	const static int DEFAULT_STEPS_PER_SECOND = 240;
+
+	//how long the last Advance() spent on each part of the frame
+	struct FrameTimes
+	{
+		double	physicsSeconds;
+		double	chaseCamSeconds;
+		double	particlesSeconds;
+		bool	particlesMoved;		//the dust trail only moves on the ground
+	};
+
+	Simulation();
+	~Simulation();
+
+	//the seed is for the random numbers the dust trail uses, and the physics
+	//is run in stepsPerSecond fixed steps a second
+	HRESULT Create( const unsigned int seed, const int stepsPerSecond );
+
+	//runs the fixed steps that fit in the time since the last frame, then
+	//moves the dust trail and finds the camera for drawing - returns the number
+	//of steps taken
+	int Advance( const float elapsedTime, const unsigned char controls );
+
+	//moves the floating origin by whole cells once the camera strays too far
+	//from it, returning true and the shift if it moved
+	bool RebaseOrigin( Vector3& vShift );
+
+	//puts everything back as it was the given number of frames ago, then runs
+	//those frames again with the elapsed times and controls they were run
+	//with, rebasing the origin after each as the app does - returns false if
+	//the snapshots do not go back that far
+	bool Rollback( const int frames );
+
+	//changes the controls a frame that has been run is run with by the next
+	//Rollback(), for input that arrives late - 1 is the latest frame
+	bool SetPastControls( const int frames, const unsigned char controls );
+
+	inline int GetNumSnapshots() const { return m_numSnapshots; }
+
+	inline int GetStepsPerSecond() const { return m_stepsPerSecond; }
+	inline float GetPhysicsStep() const { return m_physicsStep; }
+
+	//a hash of the simulated state, for checking that a replay matches
+	DWORD GetChecksum() const;
+
+	//the frame times are only measured once this turns them on, to keep the
+	//timer out of the steps otherwise
+	inline void SetFrameTiming( const bool timed ) { m_frameTiming = timed; }
+	inline const FrameTimes& GetFrameTimes() const { return m_frameTimes; }
+
+	//the camera, between the states before and after the last step
+	inline const Vector3& GetCameraPosition() const { return m_state.vCameraPosition; }
+	inline const Vector3& GetCameraTarget() const { return m_state.vCameraTarget; }
+
+	inline Terrain* GetTerrain() const { return m_pTerrain; }
+	inline Vehicle* GetVehicle() const { return m_pVehicle; }
+	inline ParticleSystem* GetParticles() const { return m_pParticles; }
+
+private:
+	//everything the simulation changes apart from the objects it owns
+	struct State
+	{
+		bool cameraNear;
+
+		//time left over from the last frame, and the chasecam before the last step
+		float		physicsTime;
+		Vector3	vPreviousCameraPosition;
+		Vector3	vPreviousChasePosition;
+
+		Vector3 vCameraPosition;
+		Vector3 vCameraTarget;
+	};
+
+	//the start of each snapshot - the vehicle, the chasecam and the dust trail
+	//follow it, in that order
+	struct SnapshotHeader
+	{
+		float			elapsedTime;	//what the frame after the snapshot was run with
+		unsigned char	controls;
+		int				originX;
+		int				originZ;
+		State			state;
+	};
+
+	void SaveSnapshot( const float elapsedTime, const unsigned char controls );
+	void RestoreSnapshot( const unsigned int frame );
+
+	Terrain*		m_pTerrain;
+	Vehicle*		m_pVehicle;
+	ParticleSystem*	m_pParticles;
+	ChaseCam*		m_pChaseCam;
+
+	State m_state;
+
+	//time simulated by each physics step, and the steps a frame may take
+	//before the simulation slows
+	int		m_stepsPerSecond;
+	float	m_physicsStep;
+	int		m_maxPhysicsSteps;
+
+	bool		m_frameTiming;
+	FrameTimes	m_frameTimes;
+
+	//a ring of snapshots, one taken at the start of each frame
+	std::vector<unsigned char>	m_snapshots;
+	unsigned int				m_snapshotSize;
+	unsigned int				m_frame;			//frames advanced so far
+	int							m_numSnapshots;		//snapshots that can be rolled back to
+
+};
+
+
+#endif //INCLUSIONGUARD_SIMULATION_H
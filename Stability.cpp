@@ -0,0 +1,212 @@
+//------------------------------------------------------------------------------
+// File: Stability.cpp
+// Desc: Finds the largest physics step each vehicle integrator stays stable at
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <math.h>
+#include <time.h>
+#include <new>
+
+#include "Stability.h"
+#include "Terrain.h"
+#include "Vehicle.h"
+
+
+//------------------------------------------------------------------------------
+// Constants:
+//------------------------------------------------------------------------------
+
+//the run every step size is judged by, and the steps a second it is judged
+//against - four times the rate the app runs at
+const float	SCRIPT_SECONDS		= 20.0f;
+const int	REFERENCE_RATE		= 960;
+const int	LOWEST_RATE			= 2;
+
+//how far a run may stray from the reference before it counts as unstable
+const float	SPEED_MARGIN			= 1.5f;
+const float	ANGULAR_SPEED_MARGIN	= 2.0f;
+const float	ANGULAR_SPEED_SLACK		= 1.0f;		//radians a second
+
+//a simulated second is timed for at least this long
+const double MIN_TIMING_SECONDS	= 0.25;
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: struct RunStats
+// Desc: The extremes of a scripted run
+//------------------------------------------------------------------------------
+struct RunStats
+{
+	bool	isFinite;
+	float	maxSpeed;
+	float	maxAngularSpeed;
+	bool	isUpright;		//at the end
+};
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: RunScript()
+// Desc: Drops a vehicle onto the middle of the terrain and drives it through
+//		 the script - settle, straight ahead, turns either way, reverse, then
+//		 coast to a stop
+//------------------------------------------------------------------------------
+static void RunScript( const Terrain& terrain, const Integrator integrator,
+					   const int stepsPerSecond, RunStats& stats )
+{
+	Vehicle vehicle;
+	vehicle.SetSubstepping( false );
+	vehicle.SetIntegrator( integrator );
+	const float centerPoint = terrain.GetTerrainSize() / 2.0f;
+	const float centerHeight = terrain.GetHeightMapPoint( centerPoint, centerPoint );
+	vehicle.SetPosition( Vector3( centerPoint, centerHeight + 2.0f, centerPoint ) );
+
+	stats.isFinite = true;
+	stats.maxSpeed = 0.0f;
+	stats.maxAngularSpeed = 0.0f;
+
+	const float timeInterval = 1.0f / float( stepsPerSecond );
+	const int numSteps = int( SCRIPT_SECONDS * stepsPerSecond );
+	for( int step = 0; step < numSteps; ++step )
+	{
+		const float time = step * timeInterval;
+		const bool forward = time >= 2.0f && time < 12.0f;
+		const bool reverse = time >= 12.0f && time < 14.0f;
+		const bool left = time >= 8.0f && time < 10.0f;
+		const bool right = time >= 10.0f && time < 12.0f;
+		vehicle.DoPhysics( timeInterval, &terrain, forward, reverse, left, right );
+
+		//the hover force turns the vehicle without going through its angular
+		//velocity, so the angular speed is found from how far it turned
+		const Vector3 vVelocity = vehicle.GetVelocity();
+		const float speed = Vec3Length( vVelocity );
+		const Quaternion& q = vehicle.GetOrientation();
+		const Quaternion& qPrevious = vehicle.GetPhysicsState().qPreviousOrientation;
+		const float cosHalf = fabsf( QuaternionDot( q, qPrevious ) );
+		const float angularSpeed = 2.0f * acosf( min( cosHalf, 1.0f ) ) / timeInterval;
+
+		if( ! ( speed < 1e6f ) || ! ( angularSpeed < 1e6f ) )
+		{
+			stats.isFinite = false;
+			return;
+		}
+		stats.maxSpeed = max( stats.maxSpeed, speed );
+		stats.maxAngularSpeed = max( stats.maxAngularSpeed, angularSpeed );
+	}
+
+	Matrix3 matRotation;
+	Mat3RotationQuaternion( matRotation, vehicle.GetOrientation() );
+	stats.isUpright = matRotation( 1, 1 ) > 0.0f;
+}
+
+//------------------------------------------------------------------------------
+// Name: IsStable()
+// Desc: A run is stable if it stays finite, ends the right way up if the
+//		 reference did, and never moves or turns much faster than the
+//		 reference did
+//------------------------------------------------------------------------------
+static bool IsStable( const RunStats& stats, const RunStats& reference )
+{
+	return stats.isFinite &&
+		   ( stats.isUpright || ! reference.isUpright ) &&
+		   stats.maxSpeed <= reference.maxSpeed * SPEED_MARGIN &&
+		   stats.maxAngularSpeed <= ( reference.maxAngularSpeed * ANGULAR_SPEED_MARGIN ) +
+									ANGULAR_SPEED_SLACK;
+}
+
+//------------------------------------------------------------------------------
+// Name: TimeScript()
+// Desc: Times the script at a step size, repeating it until the clock has run
+//		 long enough to trust, and returns the time per simulated second
+//------------------------------------------------------------------------------
+static double TimeScript( const Terrain& terrain, const Integrator integrator,
+						  const int stepsPerSecond )
+{
+	RunStats stats;
+	int runs = 0;
+	const clock_t start = clock();
+	double seconds = 0.0;
+	do
+	{
+		RunScript( terrain, integrator, stepsPerSecond, stats );
+		++runs;
+		seconds = double( clock() - start ) / CLOCKS_PER_SEC;
+	}
+	while( seconds < MIN_TIMING_SECONDS );
+
+	return seconds / ( runs * SCRIPT_SECONDS );
+}
+
+//------------------------------------------------------------------------------
+// Name: FindStableStep()
+// Desc: Halves the rate until a run goes unstable, then searches between the
+//		 last two rates for the lowest that stays stable
+//------------------------------------------------------------------------------
+bool FindStableStep( const Integrator integrator, StabilityResult& result )
+{
+	Terrain* pTerrain = NULL;
+	try
+	{
+		pTerrain = new Terrain();
+	}
+	catch( std::bad_alloc& )
+	{
+		return false;
+	}
+	const Terrain& terrain = *pTerrain;
+
+	RunStats reference;
+	RunScript( terrain, integrator, REFERENCE_RATE, reference );
+	if( ! reference.isFinite )
+	{
+		delete pTerrain;
+		return false;
+	}
+
+	RunStats stats;
+	int stableRate = REFERENCE_RATE;
+	int unstableRate = 0;
+	while( unstableRate == 0 && stableRate > LOWEST_RATE )
+	{
+		const int rate = max( stableRate / 2, LOWEST_RATE );
+		RunScript( terrain, integrator, rate, stats );
+		if( IsStable( stats, reference ) )
+			stableRate = rate;
+		else
+			unstableRate = rate;
+	}
+
+	while( unstableRate != 0 && stableRate - unstableRate > 1 )
+	{
+		const int rate = ( stableRate + unstableRate ) / 2;
+		RunScript( terrain, integrator, rate, stats );
+		if( IsStable( stats, reference ) )
+			stableRate = rate;
+		else
+			unstableRate = rate;
+	}
+
+	result.integrator = Vehicle::GetIntegratorName( integrator );
+	result.stepsPerSecond = stableRate;
+	result.secondsPerSecond = TimeScript( terrain, integrator, stableRate );
+	result.referenceStepsPerSecond = REFERENCE_RATE;
+	result.secondsPerSecondAtReference = TimeScript( terrain, integrator, REFERENCE_RATE );
+
+	delete pTerrain;
+	return true;
+}
@@ -0,0 +1,48 @@
+//------------------------------------------------------------------------------
+// File: Stability.h
+// Desc: Finds the largest physics step each vehicle integrator stays stable at
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_STABILITY_H
+#define INCLUSIONGUARD_STABILITY_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include "Vehicle.h"
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: struct StabilityResult
+// Desc: What a stability search found for one integrator
+//------------------------------------------------------------------------------
+struct StabilityResult
+{
+	const char*	integrator;			//as Vehicle::GetIntegratorName() gives it
+	int			stepsPerSecond;		//fewest steps a second that stayed stable
+	double		secondsPerSecond;	//time to simulate a second at that rate
+	double		secondsPerSecondAtReference;	//and at the reference rate
+	int			referenceStepsPerSecond;
+};
+
+//------------------------------------------------------------------------------
+// Name: FindStableStep()
+// Desc: Drives a vehicle over the terrain through the same scripted run at
+//		 ever larger steps, until the run stops behaving like the one at the
+//		 reference step, and times a simulated second at the largest step that
+//		 still did. Returns false if the reference run itself failed.
+//------------------------------------------------------------------------------
+bool FindStableStep( const Integrator integrator, StabilityResult& result );
+
+
+#endif //INCLUSIONGUARD_STABILITY_H
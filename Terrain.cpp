@@ -11,25 +11,46 @@
 //------------------------------------------------------------------------------
 // Included files:
 //------------------------------------------------------------------------------
+#include <float.h>
 #include <new>
+#include <stdlib.h>
+#include <string.h>
 
 #include "Terrain.h"
+#include "Camera.h"
 #include "Frustum.h"
-#include "Resource.h"
-#include "Scene.h"
+#include "OcclusionBuffer.h"
 
-#include "DXUtil.h"
+#if !defined( HOVERCRAFT_HEADLESS )
+	#include "Resource.h"
+	#include "Scene.h"
+#endif
 
 
 //------------------------------------------------------------------------------
 // Constants:
 //------------------------------------------------------------------------------
 const float Terrain::TERRAIN_SCALE = 4.0f;
+const float Terrain::RECULL_DISTANCE = 20.0f;
+const float Terrain::RECULL_ROTATION = 0.05f;	//about 3 degrees
+const float Terrain::DISTANCE_BUCKET_WIDTH = 80.0f;	//half a cell
 
 
 //------------------------------------------------------------------------------
 // Definitions:
 //------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: FloorDivide()
+// Desc: Divides, rounding towards minus infinity rather than zero
+//------------------------------------------------------------------------------
+static inline int FloorDivide( const int value, const int divisor )
+{
+	const int quotient = value / divisor;
+	return ( ( value % divisor ) < 0 ) ? quotient - 1 : quotient;
+}
+
+#if !defined( HOVERCRAFT_HEADLESS )
 
 //------------------------------------------------------------------------------
 // Name: struct TerrainVertex
@@ -44,6 +65,8 @@ struct Terrain::TerrainVertex
 	float tu2, tv2;
 };
 
+#endif
+
 //------------------------------------------------------------------------------
 // Name: Terrain()
 // Desc: Constructor for the terrain object
@@ -51,6 +74,7 @@ struct Terrain::TerrainVertex
 Terrain::Terrain()
 {
 	//initialise member vars
+	#if !defined( HOVERCRAFT_HEADLESS )
 	m_pVSAmbient = NULL;
 	m_pVSDiffuse = NULL;
 	m_pVSDecl	 = NULL;
@@ -63,13 +87,32 @@ Terrain::Terrain()
 
 	m_pTextureFlat	= NULL;
 	m_pTextureSlope	= NULL;
+	#endif
 
 	//create the terrain heightmap
 	GenerateHeightmap();
 
 	//create the terrain quadtree
 	m_pQuadtree = NULL;
+	m_pWorkerPool = NULL;
 	BuildQuadtree();
+	m_visibleCells.reserve( CELLS_DIM * CELLS_DIM );
+	m_visibleDistances.reserve( CELLS_DIM * CELLS_DIM );
+	m_cellDraws.reserve( CELLS_DIM * CELLS_DIM );
+	for( int bucket = 0; bucket <= NUM_DISTANCE_BUCKETS; ++bucket )
+		m_distanceBucketStart[ bucket ] = 0;
+	m_frustumCells.reserve( CELLS_DIM * CELLS_DIM );
+	m_horizonCells.reserve( CELLS_DIM * CELLS_DIM );
+	m_horizonOccluders.reserve( CELLS_DIM * CELLS_DIM * OCCLUDERS_PER_CELL );
+	m_coherentCulling = false;
+	m_mergedDraws = true;
+	m_cullReferenceValid = false;
+	ResetCullStats( m_cullStats );
+
+	//start with the origin at the corner of the terrain
+	m_originX = 0;
+	m_originZ = 0;
+	m_tiled = false;
 }
 
 //------------------------------------------------------------------------------
@@ -83,6 +126,8 @@ Terrain::~Terrain()
 	m_pQuadtree = NULL;
 }
 
+#if !defined( HOVERCRAFT_HEADLESS )
+
 //------------------------------------------------------------------------------
 // Name: InitDeviceObjects()
 // Desc: Sets up device-specific data on startup and device change
@@ -104,7 +149,7 @@ HRESULT Terrain::InitDeviceObjects( const LPDIRECT3DDEVICE9 pd3dDevice,
 												  D3DPOOL_MANAGED, &m_pVB, NULL ) ) )
 		return E_FAIL;
 	
-	const int IB_SIZE = FACES_PER_CELL * 3 * sizeof( WORD );
+	const int IB_SIZE = NUM_INDICES * sizeof( WORD );
 	if( FAILED( m_pd3dDevice->CreateIndexBuffer( IB_SIZE, D3DUSAGE_WRITEONLY, D3DFMT_INDEX16,
 												 D3DPOOL_MANAGED, &m_pIB, NULL ) ) )
 		return E_FAIL;
@@ -260,11 +305,8 @@ HRESULT Terrain::DeleteDeviceObjects()
 HRESULT Terrain::Render( const Scene& scene, const bool useLight ) const
 {
 	//set vertex shader constants...
-	//transform matrix
-	D3DXMATRIX matViewProj = scene.GetCamera().GetViewProj();
-	D3DXMATRIX matViewProjTranspose;
-	D3DXMatrixTranspose( &matViewProjTranspose, &matViewProj );
-	m_pd3dDevice->SetVertexShaderConstantF( 0, (float*)&matViewProjTranspose, 4 );
+	//transform matrix - cells are stored cell-local, so this is set per cell below
+	const Matrix4& matViewProj = scene.GetCamera().GetViewProj();
 
 	//which lighting mode are we using?
 	if( useLight )
@@ -294,34 +336,378 @@ HRESULT Terrain::Render( const Scene& scene, const bool useLight ) const
 	m_pd3dDevice->SetTexture( 0, m_pTextureFlat );
 	m_pd3dDevice->SetTexture( 1, m_pTextureSlope );
 
-	//render all visible nodes
-	std::vector< unsigned int >::const_iterator iter = m_visibleCells.begin();
-	while( iter != m_visibleCells.end() )
+	//render all visible nodes, merged into blocks where possible
+	const float cellSize = GetCellSize();
+	std::vector< CellDraw >::const_iterator iter = m_cellDraws.begin();
+	while( iter != m_cellDraws.end() )
 	{
-		m_pd3dDevice->DrawIndexedPrimitive( D3DPT_TRIANGLELIST, *iter, 0, VERTS_PER_CELL,
-											0, FACES_PER_CELL );
+		//place the draw block relative to the origin - integer maths keeps this
+		//exact
+		int cellX, cellZ;
+		GetCellFromBaseVertex( iter->baseVertex, cellX, cellZ );
+		const int blockX = cellX - ( cellX % DRAW_BLOCK_DIM );
+		const int blockZ = cellZ - ( cellZ % DRAW_BLOCK_DIM );
+
+		Affine matCell;
+		Matrix4 matResult;
+		AffineTranslation( matCell, float( blockX - m_originX ) * cellSize, 0.0f,
+						   float( blockZ - m_originZ ) * cellSize );
+		Mat4MultiplyAffine( matResult, matCell, matViewProj );
+		Mat4Transpose( matResult, matResult );
+		m_pd3dDevice->SetVertexShaderConstantF( 0, (float*)&matResult, 4 );
+
+		//the cells before this size in the index buffer - 0, 1 or 1 + 4
+		const int numCells = iter->blockDim * iter->blockDim;
+		const int startIndex = FACES_PER_CELL * 3 * ( ( numCells - 1 ) / 3 );
+
+		m_pd3dDevice->DrawIndexedPrimitive( D3DPT_TRIANGLELIST, iter->baseVertex, 0,
+											VERTS_PER_CELL * numCells, startIndex,
+											FACES_PER_CELL * numCells );
 		iter++;
 	}
 
 	return S_OK;
 }
 
+#endif
+
 //------------------------------------------------------------------------------
 // Name: CullQuadtree()
-// Desc: Finds visible nodes in the quadtree
+// Desc: Finds visible nodes in the quadtree - across the threads of the
+//		 worker pool if one has been set, otherwise reusing results from
+//		 earlier frames if coherent culling is on, and with the plain four at a
+//		 time cull if not. Cells hidden behind nearer terrain are then
+//		 removed, and the rest are left in front to back order, grouped by
+//		 distance.
 //------------------------------------------------------------------------------
-HRESULT Terrain::CullQuadtree( const Scene& scene )
+HRESULT Terrain::CullQuadtree( const Camera& camera )
 {
-	D3DXMATRIX matViewProj = scene.GetCamera().GetViewProj();
-	Frustum frustum = ExtractFrustum( matViewProj, false );
+	#ifdef CULLSTATS_ENABLED
+	const double startTime = GetTimerSeconds();
+	#endif
+
+	//the quadtree is built in terrain space, so move the frustum out to it
+	const Vector3 vOrigin( float( m_originX ) * GetCellSize(), 0.0f,
+						   float( m_originZ ) * GetCellSize() );
+	Affine matOrigin, matTerrainView;
+	AffineTranslation( matOrigin, -vOrigin[ 0 ], 0.0f, -vOrigin[ 2 ] );
+	AffineMultiply( matTerrainView, matOrigin, camera.GetView() );
+	Frustum frustum = ExtractFrustum( matTerrainView, camera.GetProjection() );
+
+	const Vector3 vEye = camera.GetPosition() + vOrigin;
+
+	m_frustumCells.clear();
+
+	#ifdef CULLSTATS_ENABLED
+	const double traversalStartTime = GetTimerSeconds();
+	#endif
+
+	if( m_pWorkerPool )
+		m_pQuadtree->AddVisibleNodesParallel( frustum, vEye, *m_pWorkerPool, m_frustumCells );
+	else if( m_coherentCulling )
+		CullCoherent( camera, frustum, vEye );
+	else
+		m_pQuadtree->AddVisibleNodes( frustum, vEye, m_frustumCells );
+
+	#ifdef CULLSTATS_ENABLED
+	const double traversalEndTime = GetTimerSeconds();
+	#endif
+
+	//look up the bounds of each cell in the frustum, and its occluder blocks -
+	//terrain outside the frustum cannot hide anything inside it
+	const float blockSize = GetCellSize() / OCCLUDERS_PER_EDGE;
+	m_horizonCells.resize( m_frustumCells.size() );
+	m_horizonOccluders.resize( m_frustumCells.size() * OCCLUDERS_PER_CELL );
+
+	for( unsigned int i = 0; i < m_frustumCells.size(); ++i )
+	{
+		int cellX, cellZ;
+		GetCellFromBaseVertex( m_frustumCells[ i ], cellX, cellZ );
+		const int cellNumber = cellX + ( cellZ * CELLS_DIM );
+		HorizonCell& cell = m_horizonCells[ i ];
+
+		m_pQuadtree->GetCellBounds( cellX, cellZ, cell.vMin, cell.vMax );
+		cell.id = m_frustumCells[ i ];
+
+		for( int block = 0; block < OCCLUDERS_PER_CELL; ++block )
+		{
+			HorizonCell& occluder = m_horizonOccluders[ i * OCCLUDERS_PER_CELL + block ];
+			const float height = m_occluderHeights[ cellNumber * OCCLUDERS_PER_CELL + block ];
+
+			occluder.vMin.x = cell.vMin.x + float( block % OCCLUDERS_PER_EDGE ) * blockSize;
+			occluder.vMin.y = height;
+			occluder.vMin.z = cell.vMin.z + float( block / OCCLUDERS_PER_EDGE ) * blockSize;
+			occluder.vMax.x = occluder.vMin.x + blockSize;
+			occluder.vMax.y = height;
+			occluder.vMax.z = occluder.vMin.z + blockSize;
+			occluder.id = cell.id;
+		}
+	}
 
 	m_visibleCells.clear();
+	m_visibleDistances.clear();
+
+	m_horizonCuller.Cull( vEye, m_horizonCells, m_horizonOccluders, m_visibleCells,
+						  m_visibleDistances );
+
+	//the distances are in order, so each bucket starts where the last one ends
+	const unsigned int numVisible = static_cast<unsigned int>( m_visibleCells.size() );
+	unsigned int cell = 0;
+	m_distanceBucketStart[ 0 ] = 0;
+	for( int bucket = 1; bucket < NUM_DISTANCE_BUCKETS; ++bucket )
+	{
+		const float limit = float( bucket ) * DISTANCE_BUCKET_WIDTH;
+		while( cell < numVisible && m_visibleDistances[ cell ] < limit )
+			++cell;
+		m_distanceBucketStart[ bucket ] = cell;
+	}
+	m_distanceBucketStart[ NUM_DISTANCE_BUCKETS ] = numVisible;
+
+	MergeVisibleCells();
+
+	#ifdef CULLSTATS_ENABLED
+	const double endTime = GetTimerSeconds();
 
-	m_pQuadtree->AddVisibleNodes( frustum, m_visibleCells );
+	m_cullStats = m_pQuadtree->GetCullStats();
+	m_cullStats.frustumCells	= static_cast<unsigned int>( m_frustumCells.size() );
+	m_cullStats.occludedCells	= m_horizonCuller.GetCellsOccluded();
+	m_cullStats.visibleCells	= numVisible;
+	m_cullStats.cellDraws		= static_cast<unsigned int>( m_cellDraws.size() );
+	m_cullStats.traversalTime	= float( ( traversalEndTime - traversalStartTime ) * 1000.0 );
+	m_cullStats.cullTime		= float( ( endTime - startTime ) * 1000.0 );
+	#endif
 
 	return S_OK;
 }
 
+//------------------------------------------------------------------------------
+// Name: MergeVisibleCells()
+// Desc: Builds the draw list from the visible cells. Each aligned 4x4 block or
+//		 2x2 quarter that is entirely visible is drawn in one call, in the place
+//		 its first cell had in the list, so the list stays roughly front to
+//		 back. Single cells are left only where a block is cut by the edge of
+//		 the view or by occlusion - or everywhere, if merging is off.
+//------------------------------------------------------------------------------
+void Terrain::MergeVisibleCells()
+{
+	m_cellDraws.clear();
+	if( ! m_mergedDraws )
+	{
+		CellDraw draw;
+		draw.blockDim = 1;
+		for( unsigned int i = 0; i < m_visibleCells.size(); ++i )
+		{
+			draw.baseVertex = m_visibleCells[ i ];
+			m_cellDraws.push_back( draw );
+		}
+		return;
+	}
+
+	memset( m_quarterCounts, 0, sizeof( m_quarterCounts ) );
+	memset( m_blockCounts, 0, sizeof( m_blockCounts ) );
+
+	for( unsigned int i = 0; i < m_visibleCells.size(); ++i )
+	{
+		int cellX, cellZ;
+		GetCellFromBaseVertex( m_visibleCells[ i ], cellX, cellZ );
+		++m_quarterCounts[ ( cellX / 2 ) + ( ( cellZ / 2 ) * DRAW_QUARTERS_DIM ) ];
+		++m_blockCounts[ ( cellX / DRAW_BLOCK_DIM ) + ( ( cellZ / DRAW_BLOCK_DIM ) * DRAW_BLOCKS_DIM ) ];
+	}
+
+	//counts are cleared once their cells have been drawn, and a visible cell
+	//never has a count of zero otherwise
+	for( unsigned int i = 0; i < m_visibleCells.size(); ++i )
+	{
+		int cellX, cellZ;
+		GetCellFromBaseVertex( m_visibleCells[ i ], cellX, cellZ );
+		const int quarterX = cellX / 2;
+		const int quarterZ = cellZ / 2;
+		unsigned char& quarterCount = m_quarterCounts[ quarterX + ( quarterZ * DRAW_QUARTERS_DIM ) ];
+		unsigned char& blockCount = m_blockCounts[ ( cellX / DRAW_BLOCK_DIM ) +
+												   ( ( cellZ / DRAW_BLOCK_DIM ) * DRAW_BLOCKS_DIM ) ];
+
+		CellDraw draw;
+		if( blockCount == CELLS_PER_DRAW_BLOCK )
+		{
+			const int blockX = cellX - ( cellX % DRAW_BLOCK_DIM );
+			const int blockZ = cellZ - ( cellZ % DRAW_BLOCK_DIM );
+			draw.baseVertex = GetCellBaseVertex( blockX, blockZ );
+			draw.blockDim = DRAW_BLOCK_DIM;
+
+			blockCount = 0;
+			for( int z = blockZ / 2; z < ( blockZ + DRAW_BLOCK_DIM ) / 2; ++z )
+			{
+				for( int x = blockX / 2; x < ( blockX + DRAW_BLOCK_DIM ) / 2; ++x )
+					m_quarterCounts[ x + ( z * DRAW_QUARTERS_DIM ) ] = 0;
+			}
+		}
+		else if( quarterCount == 4 )
+		{
+			draw.baseVertex = GetCellBaseVertex( quarterX * 2, quarterZ * 2 );
+			draw.blockDim = 2;
+			quarterCount = 0;
+		}
+		else if( quarterCount == 0 )
+		{
+			continue;
+		}
+		else
+		{
+			draw.baseVertex = m_visibleCells[ i ];
+			draw.blockDim = 1;
+		}
+
+		m_cellDraws.push_back( draw );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: GetDrawnCells()
+// Desc: Lists the cells each draw covers - the vertices of a block or quarter
+//		 are a run of whole cells from its base vertex, as Render() draws them
+//------------------------------------------------------------------------------
+void Terrain::GetDrawnCells( std::vector<unsigned int>& cells ) const
+{
+	cells.clear();
+	for( unsigned int i = 0; i < m_cellDraws.size(); ++i )
+	{
+		const int numCells = m_cellDraws[ i ].blockDim * m_cellDraws[ i ].blockDim;
+		for( int cell = 0; cell < numCells; ++cell )
+			cells.push_back( m_cellDraws[ i ].baseVertex + ( cell * VERTS_PER_CELL ) );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: CullCoherent()
+// Desc: Culls the quadtree reusing results from earlier frames, until the
+//		 camera has moved or turned too far from where it was at the last full
+//		 cull. vEye is in terrain space.
+//------------------------------------------------------------------------------
+void Terrain::CullCoherent( const Camera& camera, const Frustum& frustum, const Vector3& vEye )
+{
+	const Affine& matView = camera.GetView();
+
+	//work out how far the camera has moved since the last full cull - the
+	//rotation is the chord length 2sin(angle/2), which bounds how far any plane
+	//normal can have turned. It is found from the difference between the two
+	//rotation matrices, as 3 - trace would lose small angles to rounding.
+	float translation = 0.0f;
+	float rotation = 0.0f;
+	if( m_cullReferenceValid )
+	{
+		translation = Vec3Length( vEye - m_vCullReferenceEye );
+
+		float sumSq = 0.0f;
+		for( int row = 0; row < 3; ++row )
+		{
+			for( int column = 0; column < 3; ++column )
+			{
+				const float diff = matView.m[ row ][ column ] -
+								   m_matCullReferenceView.m[ row ][ column ];
+				sumSq += diff * diff;
+			}
+		}
+		rotation = float( sqrt( 0.5f * sumSq ) );
+	}
+
+	//start again if the camera has gone too far, or the projection has changed
+	if( !m_cullReferenceValid || translation > RECULL_DISTANCE ||
+		rotation > RECULL_ROTATION ||
+		memcmp( &camera.GetProjection(), &m_matCullReferenceProj, sizeof( Matrix4 ) ) != 0 )
+	{
+		m_cullReferenceValid	= true;
+		m_vCullReferenceEye		= vEye;
+		m_matCullReferenceView	= matView;
+		m_matCullReferenceProj	= camera.GetProjection();
+		m_pQuadtree->ResetCoherence( vEye );
+
+		translation = 0.0f;
+		rotation = 0.0f;
+	}
+
+	m_pQuadtree->AddVisibleNodesCoherent( frustum, vEye, translation, rotation,
+										  m_frustumCells );
+}
+
+//------------------------------------------------------------------------------
+// Name: CullViews()
+// Desc: Finds the cells seen by each of a set of views - such as a light's view
+//		 for shadows, or a map - in one walk of the quadtree for each
+//		 Quadtree::MAX_VIEWS of them. The matrices and vEye are relative to the
+//		 current origin, and the cells seen by view i replace the contents of
+//		 pCellLists[ i ], front to back from vEye.
+//------------------------------------------------------------------------------
+void Terrain::CullViews( const Matrix4* pViewProjections, const int numViews,
+						 const Vector3& vEye,
+						 std::vector<unsigned int>* pCellLists ) const
+{
+	//the quadtree is built in terrain space, so move the frusta out to it
+	const Vector3 vOrigin( float( m_originX ) * GetCellSize(), 0.0f,
+						   float( m_originZ ) * GetCellSize() );
+	Affine matOrigin;
+	AffineTranslation( matOrigin, -vOrigin[ 0 ], 0.0f, -vOrigin[ 2 ] );
+
+	//the quadtree keeps a view's results in a bit of a mask, so takes no more
+	//than MAX_VIEWS at once
+	Frustum frusta[ Quadtree::MAX_VIEWS ];
+	for( int firstView = 0; firstView < numViews; firstView += Quadtree::MAX_VIEWS )
+	{
+		const int batchViews = ( numViews - firstView < Quadtree::MAX_VIEWS ) ?
+							   numViews - firstView : Quadtree::MAX_VIEWS;
+		for( int view = 0; view < batchViews; ++view )
+		{
+			Matrix4 matTerrainViewProj;
+			Mat4MultiplyAffine( matTerrainViewProj, matOrigin,
+								pViewProjections[ firstView + view ] );
+			frusta[ view ] = ExtractFrustum( matTerrainViewProj, false );
+
+			pCellLists[ firstView + view ].clear();
+		}
+
+		m_pQuadtree->AddVisibleNodesMulti( frusta, batchViews, vEye + vOrigin,
+										   &pCellLists[ firstView ] );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: AddOccluders()
+// Desc: Adds the occluder mesh under each visible cell to an occlusion buffer,
+//		 relative to the current origin. The mesh is below the terrain
+//		 everywhere, so anything it hides the terrain hides too.
+//------------------------------------------------------------------------------
+void Terrain::AddOccluders( OcclusionBuffer& buffer ) const
+{
+	const float blockSize = GetCellSize() / OCCLUDERS_PER_EDGE;
+
+	for( unsigned int i = 0; i < m_visibleCells.size(); ++i )
+	{
+		int cellX, cellZ;
+		GetCellFromBaseVertex( m_visibleCells[ i ], cellX, cellZ );
+		const int firstX = cellX * OCCLUDERS_PER_EDGE;
+		const int firstZ = cellZ * OCCLUDERS_PER_EDGE;
+
+		for( int x = firstX; x < firstX + OCCLUDERS_PER_EDGE; ++x )
+		{
+			for( int z = firstZ; z < firstZ + OCCLUDERS_PER_EDGE; ++z )
+			{
+				const float x0 = float( x - ( m_originX * OCCLUDERS_PER_EDGE ) ) * blockSize;
+				const float z0 = float( z - ( m_originZ * OCCLUDERS_PER_EDGE ) ) * blockSize;
+				const float* pHeights = &m_occluderMeshHeights[ z + ( x * OCCLUDER_MESH_DIM ) ];
+
+				const Vector3 v00( x0, pHeights[ 0 ], z0 );
+				const Vector3 v01( x0, pHeights[ 1 ], z0 + blockSize );
+				const Vector3 v10( x0 + blockSize, pHeights[ OCCLUDER_MESH_DIM ], z0 );
+				const Vector3 v11( x0 + blockSize, pHeights[ OCCLUDER_MESH_DIM + 1 ],
+								   z0 + blockSize );
+
+				//wound to face up
+				buffer.AddOccluder( v00, v01, v10 );
+				buffer.AddOccluder( v10, v01, v11 );
+			}
+		}
+	}
+}
+
 //------------------------------------------------------------------------------
 // Name: GetHeightMapPoint()
 // Desc: Retrieves an interpolated value for the height at a given point
@@ -331,27 +717,43 @@ float Terrain::GetHeightMapPoint( const float xPos, const float zPos ) const
 	const float x = xPos / TERRAIN_SCALE;
 	const float z = zPos / TERRAIN_SCALE;
 
-	//find current square
+	//find current square - the origin is added as an integer, so the result is
+	//as accurate far from the world origin as it is near it
 	const float minX = float( floor( x ) );
 	const float minZ = float( floor( z ) );
-	int intX = int( minX );
-	int intZ = int( minZ );
+	int intX = int( minX ) + m_originX * Quadtree::LEAFNODE_WIDTH;
+	int intZ = int( minZ ) + m_originZ * Quadtree::LEAFNODE_WIDTH;
 
-	//make sure values are within range of the heightmap
-	if( intX < 0 ) intX = 0;
-	if( intX >= ( HEIGHTMAP_DIM - 1 ) ) intX = ( HEIGHTMAP_DIM - 2 );
-	if( intZ < 0 ) intZ = 0;
-	if( intZ >= ( HEIGHTMAP_DIM - 1 ) ) intZ = ( HEIGHTMAP_DIM - 2 );
-
 	//find weights
 	const float wx = x - minX;
 	const float wz = z - minZ;
 
 	//get surrounding points
-	const float p11 = GetHeightMapPoint( intX, intZ );
-	const float p12 = GetHeightMapPoint( intX, intZ + 1 );
-	const float p21 = GetHeightMapPoint( intX + 1, intZ );
-	const float p22 = GetHeightMapPoint( intX + 1, intZ + 1 );
+	float p11, p12, p21, p22;
+	if( m_tiled )
+	{
+		const int x0 = GetTiledPoint( intX );
+		const int x1 = GetTiledPoint( intX + 1 );
+		const int z0 = GetTiledPoint( intZ );
+		const int z1 = GetTiledPoint( intZ + 1 );
+		p11 = GetHeightMapPoint( x0, z0 );
+		p12 = GetHeightMapPoint( x0, z1 );
+		p21 = GetHeightMapPoint( x1, z0 );
+		p22 = GetHeightMapPoint( x1, z1 );
+	}
+	else
+	{
+		//make sure values are within range of the heightmap
+		if( intX < 0 ) intX = 0;
+		if( intX >= ( HEIGHTMAP_DIM - 1 ) ) intX = ( HEIGHTMAP_DIM - 2 );
+		if( intZ < 0 ) intZ = 0;
+		if( intZ >= ( HEIGHTMAP_DIM - 1 ) ) intZ = ( HEIGHTMAP_DIM - 2 );
+
+		p11 = GetHeightMapPoint( intX, intZ );
+		p12 = GetHeightMapPoint( intX, intZ + 1 );
+		p21 = GetHeightMapPoint( intX + 1, intZ );
+		p22 = GetHeightMapPoint( intX + 1, intZ + 1 );
+	}
 
 	//lerp in x direction
 	const float px1 = p11 + wx * ( p21 - p11 );
@@ -363,6 +765,146 @@ float Terrain::GetHeightMapPoint( const float xPos, const float zPos ) const
 	return p;
 }
 
+//------------------------------------------------------------------------------
+// Name: GetHeightMapPoints()
+// Desc: GetHeightMapPoint() for a batch of points, giving the same results
+//------------------------------------------------------------------------------
+void Terrain::GetHeightMapPoints( const float* pXPos, const float* pZPos, float* pHeights,
+								  const int numPoints ) const
+{
+	const int originX = m_originX * Quadtree::LEAFNODE_WIDTH;
+	const int originZ = m_originZ * Quadtree::LEAFNODE_WIDTH;
+
+	//the tiled world is rare enough to leave to the single point lookup
+	if( m_tiled )
+	{
+		for( int point = 0; point < numPoints; ++point )
+			pHeights[ point ] = GetHeightMapPoint( pXPos[ point ], pZPos[ point ] );
+		return;
+	}
+
+	for( int point = 0; point < numPoints; ++point )
+	{
+		const float x = pXPos[ point ] / TERRAIN_SCALE;
+		const float z = pZPos[ point ] / TERRAIN_SCALE;
+
+		const float minX = float( floor( x ) );
+		const float minZ = float( floor( z ) );
+		int intX = int( minX ) + originX;
+		int intZ = int( minZ ) + originZ;
+
+		if( intX < 0 ) intX = 0;
+		if( intX >= ( HEIGHTMAP_DIM - 1 ) ) intX = ( HEIGHTMAP_DIM - 2 );
+		if( intZ < 0 ) intZ = 0;
+		if( intZ >= ( HEIGHTMAP_DIM - 1 ) ) intZ = ( HEIGHTMAP_DIM - 2 );
+
+		const float wx = x - minX;
+		const float wz = z - minZ;
+
+		const float* pRow = &m_heights[ intZ + ( intX * HEIGHTMAP_DIM ) ];
+		const float p11 = pRow[ 0 ];
+		const float p12 = pRow[ 1 ];
+		const float p21 = pRow[ HEIGHTMAP_DIM ];
+		const float p22 = pRow[ HEIGHTMAP_DIM + 1 ];
+
+		const float px1 = p11 + wx * ( p21 - p11 );
+		const float px2 = p12 + wx * ( p22 - p12 );
+		pHeights[ point ] = px1 + wz * ( px2 - px1 );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: GetMaxHeight()
+// Desc: Finds the highest of the blocks under a box. The box is clamped to
+//		 the heightmap, as GetHeightMapPoint() clamps its points, or its
+//		 blocks mirrored into it if the terrain is tiled.
+//------------------------------------------------------------------------------
+float Terrain::GetMaxHeight( const float minX, const float minZ, const float maxX,
+							 const float maxZ ) const
+{
+	const int blockWidth = Quadtree::LEAFNODE_WIDTH / OCCLUDERS_PER_EDGE;
+	const int blocksDim = OCCLUDER_MESH_DIM - 1;
+	const int originX = m_originX * Quadtree::LEAFNODE_WIDTH;
+	const int originZ = m_originZ * Quadtree::LEAFNODE_WIDTH;
+
+	if( m_tiled )
+	{
+		//blocks repeat with the points, every two tiles, so no box needs more
+		//than that many
+		const int period = 2 * blocksDim;
+		const int firstX = FloorDivide( int( floor( minX / TERRAIN_SCALE ) ) + originX, blockWidth );
+		const int firstZ = FloorDivide( int( floor( minZ / TERRAIN_SCALE ) ) + originZ, blockWidth );
+		const int lastX = min( FloorDivide( int( floor( maxX / TERRAIN_SCALE ) ) + originX,
+											blockWidth ), firstX + period - 1 );
+		const int lastZ = min( FloorDivide( int( floor( maxZ / TERRAIN_SCALE ) ) + originZ,
+											blockWidth ), firstZ + period - 1 );
+
+		float height = -FLT_MAX;
+		for( int blockX = firstX; blockX <= lastX; ++blockX )
+		{
+			int tiledX = ( ( blockX % period ) + period ) % period;
+			if( tiledX >= blocksDim )
+				tiledX = period - 1 - tiledX;
+			const float* pRow = &m_blockMaxHeights[ tiledX * blocksDim ];
+			for( int blockZ = firstZ; blockZ <= lastZ; ++blockZ )
+			{
+				int tiledZ = ( ( blockZ % period ) + period ) % period;
+				if( tiledZ >= blocksDim )
+					tiledZ = period - 1 - tiledZ;
+				height = max( height, pRow[ tiledZ ] );
+			}
+		}
+		return height;
+	}
+
+	const int firstX = max( ( int( floor( minX / TERRAIN_SCALE ) ) + originX ) / blockWidth, 0 );
+	const int firstZ = max( ( int( floor( minZ / TERRAIN_SCALE ) ) + originZ ) / blockWidth, 0 );
+	const int lastX = min( ( int( floor( maxX / TERRAIN_SCALE ) ) + originX ) / blockWidth,
+						   blocksDim - 1 );
+	const int lastZ = min( ( int( floor( maxZ / TERRAIN_SCALE ) ) + originZ ) / blockWidth,
+						   blocksDim - 1 );
+
+	float height = -FLT_MAX;
+	for( int blockX = firstX; blockX <= lastX; ++blockX )
+	{
+		const float* pRow = &m_blockMaxHeights[ blockX * blocksDim ];
+		for( int blockZ = firstZ; blockZ <= lastZ; ++blockZ )
+			height = max( height, pRow[ blockZ ] );
+	}
+
+	return height;
+}
+
+//------------------------------------------------------------------------------
+// Name: SetOrigin()
+// Desc: Moves the floating origin to the corner of a given cell
+//------------------------------------------------------------------------------
+void Terrain::SetOrigin( const int cellX, const int cellZ )
+{
+	m_originX = cellX;
+	m_originZ = cellZ;
+}
+
+//------------------------------------------------------------------------------
+// Name: GetLocalBounds()
+// Desc: Finds the area objects are kept in, relative to the current origin
+//------------------------------------------------------------------------------
+void Terrain::GetLocalBounds( const float margin, float& minX, float& minZ, float& maxX,
+							  float& maxZ ) const
+{
+	if( m_tiled )
+	{
+		minX = minZ = -FLT_MAX;
+		maxX = maxZ = FLT_MAX;
+		return;
+	}
+
+	minX = GetLocalMinX() + margin;
+	minZ = GetLocalMinZ() + margin;
+	maxX = GetLocalMinX() + GetTerrainSize() - margin;
+	maxZ = GetLocalMinZ() + GetTerrainSize() - margin;
+}
+
 //------------------------------------------------------------------------------
 // Name: GenerateHeightmap()
 // Desc: Fills the heightmap with height values based on a given method
@@ -384,6 +926,8 @@ void Terrain::GenerateHeightmap()
 	OutputDebugString( "done\n" );
 }
 
+#if !defined( HOVERCRAFT_HEADLESS )
+
 //------------------------------------------------------------------------------
 // Name: FillVertexBuffer()
 // Desc: Fills a vertex buffer with the terrain vertices
@@ -398,25 +942,31 @@ HRESULT Terrain::FillVertexBuffer()
 							 (void**)&pBuffer, 0 ) ) )
 		return E_FAIL;
 
-	int bufferIndex = 0;
-
 	//create the vertices...
 	//for each cell
 	for( int cellColumn = 0; cellColumn < CELLS_DIM; ++cellColumn )
 	{
 		for( int cellRow = 0; cellRow < CELLS_DIM; ++cellRow )				
 		{
-			for( int subRow = 0; subRow <= QuadtreeNode::LEAFNODE_WIDTH; ++subRow )
+			int bufferIndex = GetCellBaseVertex( cellRow, cellColumn );
+
+			//offset of the cell within its draw block
+			const int blockRow = ( cellRow % DRAW_BLOCK_DIM ) * Quadtree::LEAFNODE_WIDTH;
+			const int blockColumn = ( cellColumn % DRAW_BLOCK_DIM ) * Quadtree::LEAFNODE_WIDTH;
+
+			for( int subRow = 0; subRow <= Quadtree::LEAFNODE_WIDTH; ++subRow )
 			{
-				for( int subColumn = 0; subColumn <= QuadtreeNode::LEAFNODE_WIDTH; ++subColumn )
+				for( int subColumn = 0; subColumn <= Quadtree::LEAFNODE_WIDTH; ++subColumn )
 				{
-					int row = subRow + ( cellRow * QuadtreeNode::LEAFNODE_WIDTH );
-					int column = subColumn + ( cellColumn * QuadtreeNode::LEAFNODE_WIDTH );
+					int row = subRow + ( cellRow * Quadtree::LEAFNODE_WIDTH );
+					int column = subColumn + ( cellColumn * Quadtree::LEAFNODE_WIDTH );
 					int index = column + ( row * HEIGHTMAP_DIM );
 
-					//convert to floating point once, as we will need this many times
-					float fRow		= float( row ) * TERRAIN_SCALE;
-					float fColumn	= float( column ) * TERRAIN_SCALE;
+					//convert to floating point once, as we will need this many times -
+					//positions are relative to the draw block's corner, Render() places
+					//the block
+					float fRow		= float( subRow + blockRow ) * TERRAIN_SCALE;
+					float fColumn	= float( subColumn + blockColumn ) * TERRAIN_SCALE;
 
 					//calculate the position of this vertex
 					D3DXVECTOR3 vPosition = D3DXVECTOR3( fRow,
@@ -538,29 +1088,40 @@ HRESULT Terrain::FillIndexBuffer()
 	//lock the index buffer
 	WORD* pBuffer = NULL;
 	int bufferIndex = 0;
-	if( FAILED( m_pIB->Lock( 0, FACES_PER_CELL * 3 * sizeof( WORD ),
+	if( FAILED( m_pIB->Lock( 0, NUM_INDICES * sizeof( WORD ),
 							 (void**)&pBuffer, 0 ) ) )
 		return E_FAIL;
 
-	const int realWidth = QuadtreeNode::LEAFNODE_WIDTH + 1;
+	const int realWidth = Quadtree::LEAFNODE_WIDTH + 1;
 
-	//for each quad in the cell
-	for( int row = 0; row < QuadtreeNode::LEAFNODE_WIDTH; ++row )
+	//a single cell, a 2x2 quarter and a 4x4 block - the cells of a block follow
+	//each other in the vertex buffer, so each is the first cell's indices again
+	//with the vertices moved on
+	for( int blockDim = 1; blockDim <= DRAW_BLOCK_DIM; blockDim *= 2 )
 	{
-		for( int column = 0; column < QuadtreeNode::LEAFNODE_WIDTH; ++column )
+		for( int cell = 0; cell < blockDim * blockDim; ++cell )
 		{
-			//create triangles for this quad
-			WORD firstIndex = WORD( column + ( row * realWidth ) );
-
-			//triangle 1
-			pBuffer[ bufferIndex++ ] = firstIndex;
-			pBuffer[ bufferIndex++ ] = firstIndex + 1;
-			pBuffer[ bufferIndex++ ] = firstIndex + realWidth;
-
-			//triangle 2
-			pBuffer[ bufferIndex++ ] = firstIndex + realWidth;
-			pBuffer[ bufferIndex++ ] = firstIndex + 1;
-			pBuffer[ bufferIndex++ ] = firstIndex + realWidth + 1;
+			const int cellVertex = cell * VERTS_PER_CELL;
+
+			//for each quad in the cell
+			for( int row = 0; row < Quadtree::LEAFNODE_WIDTH; ++row )
+			{
+				for( int column = 0; column < Quadtree::LEAFNODE_WIDTH; ++column )
+				{
+					//create triangles for this quad
+					WORD firstIndex = WORD( cellVertex + column + ( row * realWidth ) );
+
+					//triangle 1
+					pBuffer[ bufferIndex++ ] = firstIndex;
+					pBuffer[ bufferIndex++ ] = firstIndex + 1;
+					pBuffer[ bufferIndex++ ] = firstIndex + realWidth;
+
+					//triangle 2
+					pBuffer[ bufferIndex++ ] = firstIndex + realWidth;
+					pBuffer[ bufferIndex++ ] = firstIndex + 1;
+					pBuffer[ bufferIndex++ ] = firstIndex + realWidth + 1;
+				}
+			}
 		}
 	}
 
@@ -572,6 +1133,8 @@ HRESULT Terrain::FillIndexBuffer()
 	return S_OK;
 }
 
+#endif
+
 //------------------------------------------------------------------------------
 // Name: BuildQuadtree()
 // Desc: Creates a quadtree for the terrain
@@ -580,123 +1143,95 @@ HRESULT Terrain::BuildQuadtree()
 {
 	OutputDebugString( "Creating terrain quadtree..." );
 
-	const float minY = -100.0f;
-	const float maxY = 100.0f;
-	const float cellWidth = float( QuadtreeNode::LEAFNODE_WIDTH );
-	const int verticesPerCell = ( QuadtreeNode::LEAFNODE_WIDTH + 1 ) *
-								( QuadtreeNode::LEAFNODE_WIDTH + 1 );
-
-	//create leaf nodes...
-	QuadtreeNode** pNodes = NULL;
-	try{ pNodes = new QuadtreeNode*[ CELLS_DIM * CELLS_DIM ]; }
+	try{ m_pQuadtree = new Quadtree( CELLS_DIM, GetCellSize() ); }
 	catch( std::bad_alloc& error )
 	{
-		MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
+		ShowError( error.what() );
 		exit( 1 );
 	}
 
-	//for each cell - note, loop ordering is important here as aabb must match with vertices
+	//for each cell - note, base vertex must match the vertex buffer layout
 	for( int cellColumn = 0; cellColumn < CELLS_DIM; ++cellColumn )
 	{
-		for( int cellRow = 0; cellRow < CELLS_DIM; ++cellRow )			
+		for( int cellRow = 0; cellRow < CELLS_DIM; ++cellRow )
 		{
-			const float fCellRow = float( cellRow );
-			const float fCellColumn = float( cellColumn );
+			//fit the height bounds to the heightmap points under this cell
+			const int firstX = cellColumn * Quadtree::LEAFNODE_WIDTH;
+			const int firstZ = cellRow * Quadtree::LEAFNODE_WIDTH;
+			float minY = GetHeightMapPoint( firstX, firstZ );
+			float maxY = minY;
 
-			//calculate x and z bounding values
-			const float minX = fCellColumn * cellWidth * TERRAIN_SCALE;
-			const float maxX = minX + cellWidth * TERRAIN_SCALE;
-			const float minZ = fCellRow * cellWidth * TERRAIN_SCALE;
-			const float maxZ = minZ + cellWidth * TERRAIN_SCALE;
+			for( int x = firstX; x <= firstX + Quadtree::LEAFNODE_WIDTH; ++x )
+			{
+				for( int z = firstZ; z <= firstZ + Quadtree::LEAFNODE_WIDTH; ++z )
+				{
+					const float height = GetHeightMapPoint( x, z );
+					if( height < minY ) minY = height;
+					if( height > maxY ) maxY = height;
+				}
+			}
 
 			//calculate base vertex for this cell
 			const int cellNumber = cellColumn + ( cellRow * CELLS_DIM );
-			const int baseVertex = verticesPerCell * cellNumber;
+			const unsigned int baseVertex = GetCellBaseVertex( cellColumn, cellRow );
+
+			//find the lowest point in each occluder block
+			const int blockWidth = Quadtree::LEAFNODE_WIDTH / OCCLUDERS_PER_EDGE;
+			for( int block = 0; block < OCCLUDERS_PER_CELL; ++block )
+			{
+				const int blockX = firstX + ( block % OCCLUDERS_PER_EDGE ) * blockWidth;
+				const int blockZ = firstZ + ( block / OCCLUDERS_PER_EDGE ) * blockWidth;
+				float blockMinY = GetHeightMapPoint( blockX, blockZ );
+				float blockMaxY = blockMinY;
+
+				for( int x = blockX; x <= blockX + blockWidth; ++x )
+				{
+					for( int z = blockZ; z <= blockZ + blockWidth; ++z )
+					{
+						blockMinY = min( blockMinY, GetHeightMapPoint( x, z ) );
+						blockMaxY = max( blockMaxY, GetHeightMapPoint( x, z ) );
+					}
+				}
+
+				m_occluderHeights[ cellNumber * OCCLUDERS_PER_CELL + block ] = blockMinY;
+				const int maxIndex = ( blockX / blockWidth ) * ( OCCLUDER_MESH_DIM - 1 ) +
+									 ( blockZ / blockWidth );
+				m_blockMaxHeights[ maxIndex ] = blockMaxY;
+			}
 
-			//create the quadtree leaf node for this cell
-			QuadtreeNode* pNode = new QuadtreeNode( minX, maxX, minY, maxY, minZ, maxZ,
-													baseVertex );
-			pNodes[ ( cellRow * CELLS_DIM ) + cellColumn ] = pNode;
+			m_pQuadtree->SetLeaf( cellColumn, cellRow, minY, maxY, baseVertex );
 		}
 	}
 
-    //build quadtree from leaf nodes...
-	int level = CELLS_DIM / 2;
-	QuadtreeNode** pNewNodes = NULL;
+	//build the rest of the tree from the leaf nodes
+	m_pQuadtree->FitBounds();
 
-	for(;;)	//forever
+	//each corner of the occluder mesh takes the lowest of the blocks around it,
+	//so no part of the mesh is higher than the block it lies over
+	const int blocksDim = OCCLUDER_MESH_DIM - 1;
+	for( int vertexX = 0; vertexX < OCCLUDER_MESH_DIM; ++vertexX )
 	{
-		try{ pNewNodes = new QuadtreeNode*[ level * level ]; }
-		catch( std::bad_alloc& error )
+		for( int vertexZ = 0; vertexZ < OCCLUDER_MESH_DIM; ++vertexZ )
 		{
-			MessageBox( NULL, error.what(), "Error", MB_ICONEXCLAMATION | MB_OK );
-			exit( 1 );
-		}		
+			float height = FLT_MAX;
 
-		//for each node at this level
-		for( int row = 0; row < level; ++row )
-		{
-			for( int column = 0; column < level; ++column )
+			for( int blockX = max( vertexX - 1, 0 ); blockX <= min( vertexX, blocksDim - 1 ); ++blockX )
 			{
-                //find child nodes
-				const int lastLevel = level * 2;
-				const int rowIndex = row * 2;
-				const int columnIndex = column * 2;
-
-				QuadtreeNode* child1 = pNodes[ ( rowIndex * lastLevel ) + columnIndex ];
-				QuadtreeNode* child2 = pNodes[ ( rowIndex * lastLevel ) + columnIndex + 1 ];				
-				QuadtreeNode* child3 = pNodes[ ( (rowIndex + 1)* lastLevel ) + columnIndex ];
-				QuadtreeNode* child4 = pNodes[ ( (rowIndex + 1)* lastLevel ) + columnIndex + 1 ];
-
-				//calculate bounding values
-				float minX = min( child1->GetAABBMin( 0 ),
-							  min( child2->GetAABBMin( 0 ),
-							   min( child3->GetAABBMin( 0 ),
-									child4->GetAABBMin( 0 ) ) ) );
-				float maxX = max( child1->GetAABBMax( 0 ),
-							  max( child2->GetAABBMax( 0 ),
-							   max( child3->GetAABBMax( 0 ),
-									child4->GetAABBMax( 0 ) ) ) );
-				
-				float minY = child1->GetAABBMin( 1 );
-				float maxY = child1->GetAABBMax( 1 );
-
-				float minZ = min( child1->GetAABBMin( 2 ),
-							  min( child2->GetAABBMin( 2 ),
-							   min( child3->GetAABBMin( 2 ),
-									child4->GetAABBMin( 2 ) ) ) );
-				float maxZ = max( child1->GetAABBMax( 2 ),
-							  max( child2->GetAABBMax( 2 ),
-							   max( child3->GetAABBMax( 2 ),
-									child4->GetAABBMax( 2 ) ) ) );
-
-				//create parent node and store
-				QuadtreeNode* pNode = new QuadtreeNode( child1, child2, child3, child4,
-														minX, maxX, minY, maxY, minZ, maxZ );
-				pNewNodes[ ( row * level ) + column ] = pNode;
+				for( int blockZ = max( vertexZ - 1, 0 ); blockZ <= min( vertexZ, blocksDim - 1 ); ++blockZ )
+					height = min( height, GetOccluderHeight( blockX, blockZ ) );
 			}
-		}
-		
-		//update the node store
-		delete[] pNodes;
-		pNodes = pNewNodes;
 
-		//are we at the root level?
-		if( level == 1 )
-			break;
-
-		level /= 2;
+			m_occluderMeshHeights[ vertexZ + ( vertexX * OCCLUDER_MESH_DIM ) ] = height;
+		}
 	}
 
-	//store the parent node
-	m_pQuadtree = pNodes[ 0 ];
-	delete[] pNodes;
-
 	OutputDebugString( "done\n" );
 
 	return S_OK;
 }
 
+#if !defined( HOVERCRAFT_HEADLESS )
+
 //------------------------------------------------------------------------------
 // Name: GetFaceNormal()
 // Desc: Returns the face normal of a given triangle
@@ -714,13 +1249,15 @@ D3DXVECTOR3 Terrain::GetFaceNormal( const D3DXVECTOR3& v1, const D3DXVECTOR3& v2
 	return vNormal;
 }
 
+#endif
+
 //------------------------------------------------------------------------------
 // Name: Interpolate()
 // Desc: Interpolates between two values using a cosine interpolation scheme
 //------------------------------------------------------------------------------
 float Terrain::Interpolate( const float a, const float b, const float x ) const
 {
-	float ft = x * D3DX_PI;
+	float ft = x * MATHS_PI;
 	ft = ( 1.0f - float( cos(ft) ) ) * 0.5f;
 
 	return a * ( 1.0f - ft ) + b * ft;
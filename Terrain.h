@@ -16,15 +16,20 @@
 // Included files:
 //------------------------------------------------------------------------------
 #include <vector>
-#include <d3dx9.h>
 
-#include "QuadtreeNode.h"
+#include "HorizonCuller.h"
+#include "Platform.h"
+#include "Quadtree.h"
+#include "VectorMath.h"
 
 
 //------------------------------------------------------------------------------
 // Prototypes and declarations:
 //------------------------------------------------------------------------------
+class Camera;
+class OcclusionBuffer;
 class Scene;
+class WorkerPool;
 
 //------------------------------------------------------------------------------
 // Name: class Terrain
@@ -43,6 +48,7 @@ public:
 	Terrain();
 	~Terrain();
 
+	#if !defined( HOVERCRAFT_HEADLESS )
 	HRESULT InitDeviceObjects( const LPDIRECT3DDEVICE9 pd3dDevice, const bool dx9Shaders,
 							   const bool twoSidedStencil );
 	HRESULT RestoreDeviceObjects();
@@ -50,54 +56,259 @@ public:
 	HRESULT DeleteDeviceObjects();
 
 	HRESULT Render( const Scene& scene, const bool useLight ) const;
-	HRESULT CullQuadtree( const Scene& scene );
+	#endif
+
+	HRESULT CullQuadtree( const Camera& camera );
+	void CullViews( const Matrix4* pViewProjections, const int numViews,
+					const Vector3& vEye, std::vector<unsigned int>* pCellLists ) const;
+	void AddOccluders( OcclusionBuffer& buffer ) const;
+
+	//cull on the pool's threads - NULL goes back to the single threaded cull
+	void SetWorkerPool( WorkerPool* pPool ) { m_pWorkerPool = pPool; }
+
+	//reuse results from earlier frames in the single threaded cull. Off by
+	//default, as it only saves time when the camera moves slowly.
+	void SetCoherentCulling( const bool coherent ) { m_coherentCulling = coherent; }
+
+	//merge the visible cells into blocks and quarters where they are all
+	//visible, drawing each in one call. On by default - off draws each cell on
+	//its own, to compare against.
+	void SetMergedDraws( const bool merged ) { m_mergedDraws = merged; }
 
 	float GetHeightMapPoint( const float xPos, const float zPos ) const;
+	void GetHeightMapPoints( const float* pXPos, const float* pZPos, float* pHeights,
+							 const int numPoints ) const;
 	float GetTerrainSize() const { return (HEIGHTMAP_DIM - 1) * TERRAIN_SCALE; }
 
+	//the height the generator gives the heightmap point in a column and row
+	float PerlinNoise2D( const float x, const float y ) const;
+
+	//a height the terrain does not rise above anywhere in a box, from the
+	//highest points of the occluder blocks it touches
+	float GetMaxHeight( const float minX, const float minZ, const float maxX,
+						const float maxZ ) const;
+	float GetCellSize() const { return Quadtree::LEAFNODE_WIDTH * TERRAIN_SCALE; }
+
+	//floating origin - positions passed to and from the terrain are relative to
+	//the corner of the origin cell, which is moved to stay near the camera
+	void SetOrigin( const int cellX, const int cellZ );
+	inline int GetOriginX() const { return m_originX; }
+	inline int GetOriginZ() const { return m_originZ; }
+
+	//terrain extents relative to the current origin
+	float GetLocalMinX() const { return - float( m_originX ) * GetCellSize(); }
+	float GetLocalMinZ() const { return - float( m_originZ ) * GetCellSize(); }
+
+	//repeat the heightmap across the whole world for height queries, mirrored
+	//in alternate tiles so they meet without a step, instead of holding it at
+	//its edges. For checking the floating origin far from the world origin -
+	//the terrain is still drawn and culled once, where it is.
+	void SetTiled( const bool tiled ) { m_tiled = tiled; }
+	inline bool IsTiled() const { return m_tiled; }
+
+	//the area objects are kept in, relative to the current origin - the terrain
+	//less a margin, or everywhere if it is tiled
+	void GetLocalBounds( const float margin, float& minX, float& minZ, float& maxX,
+						 float& maxZ ) const;
+
 	unsigned int GetVisibleCells() const
 	{
 		return static_cast<unsigned int>( m_visibleCells.size() );
 	}
 
+	//base vertices of the cells inside the frustum in the last cull, front to
+	//back, before the horizon culling
+	const std::vector<unsigned int>& GetFrustumCellList() const { return m_frustumCells; }
+
+	//base vertices of the visible cells from the last cull, front to back
+	const std::vector<unsigned int>& GetVisibleCellList() const { return m_visibleCells; }
+
+	//draw calls the visible cells were merged into
+	unsigned int GetCellDraws() const
+	{
+		return static_cast<unsigned int>( m_cellDraws.size() );
+	}
+
+	//the base vertex of each cell the draw calls cover, in draw order - a cell
+	//covered by two draws is listed twice
+	void GetDrawnCells( std::vector<unsigned int>& cells ) const;
+
+	//cells inside the frustum but hidden behind nearer terrain in the last cull
+	unsigned int GetOccludedCells() const { return m_horizonCuller.GetCellsOccluded(); }
+
+	//everything counted during the last CullQuadtree() - all zero unless
+	//CULLSTATS_ENABLED is defined
+	const CullStats& GetCullStats() const { return m_cullStats; }
+
+	//the visible cells are in order of horizontal distance from the eye to their
+	//nearest point, and grouped into bands DISTANCE_BUCKET_WIDTH wide - bucket i
+	//is the cells from GetDistanceBucketStart( i ) up to but not including
+	//GetDistanceBucketStart( i + 1 ), and the last bucket has no far limit
+	const static int NUM_DISTANCE_BUCKETS = 8;
+	const static float DISTANCE_BUCKET_WIDTH;
+
+	inline unsigned int GetDistanceBucketStart( const int bucket ) const
+	{
+		return m_distanceBucketStart[ bucket ];
+	}
+
+	inline float GetVisibleCellDistance( const unsigned int cell ) const
+	{
+		return m_visibleDistances[ cell ];
+	}
+
 private:
-	const static int HEIGHTMAP_DIM = ( CELLS_DIM * QuadtreeNode::LEAFNODE_WIDTH ) + 1;
-	const static int FACES_PER_CELL = QuadtreeNode::LEAFNODE_WIDTH *
-									  QuadtreeNode::LEAFNODE_WIDTH * 2;
-	const static int VERTS_PER_CELL = ( QuadtreeNode::LEAFNODE_WIDTH + 1 ) *
-									  ( QuadtreeNode::LEAFNODE_WIDTH + 1 );
+	const static int HEIGHTMAP_DIM = ( CELLS_DIM * Quadtree::LEAFNODE_WIDTH ) + 1;
+	const static int FACES_PER_CELL = Quadtree::LEAFNODE_WIDTH *
+									  Quadtree::LEAFNODE_WIDTH * 2;
+	const static int VERTS_PER_CELL = ( Quadtree::LEAFNODE_WIDTH + 1 ) *
+									  ( Quadtree::LEAFNODE_WIDTH + 1 );
 	const static int NUM_VERTS = VERTS_PER_CELL * CELLS_DIM * CELLS_DIM;
 	const static float TERRAIN_SCALE;
 
+	//cells are stored in the vertex buffer in aligned blocks of 4x4, so whole
+	//blocks, or 2x2 quarters of them, can be drawn in one call where they are
+	//all visible - CELLS_DIM must be a multiple of DRAW_BLOCK_DIM
+	const static int DRAW_BLOCK_DIM = 4;
+	const static int CELLS_PER_DRAW_BLOCK = DRAW_BLOCK_DIM * DRAW_BLOCK_DIM;
+	const static int DRAW_BLOCKS_DIM = CELLS_DIM / DRAW_BLOCK_DIM;
+	const static int DRAW_QUARTERS_DIM = CELLS_DIM / 2;
+
+	//the index buffer holds a single cell, then a 2x2 quarter, then a 4x4 block
+	const static int NUM_INDICES = FACES_PER_CELL * 3 * ( 1 + 4 + CELLS_PER_DRAW_BLOCK );
+
+	//a single cell, or a 2x2 or 4x4 block of them, to be drawn in one call
+	struct CellDraw
+	{
+		unsigned int baseVertex;	//of the first cell
+		int blockDim;				//cells per edge
+	};
+
+	//occluder blocks per cell edge for horizon culling
+	const static int OCCLUDERS_PER_EDGE = 8;
+	const static int OCCLUDERS_PER_CELL = OCCLUDERS_PER_EDGE * OCCLUDERS_PER_EDGE;
+	const static int OCCLUDER_MESH_DIM = ( CELLS_DIM * OCCLUDERS_PER_EDGE ) + 1;
+
+	//camera movement allowed before the quadtree is fully culled again
+	const static float RECULL_DISTANCE;
+	const static float RECULL_ROTATION;
+
 	inline float GetHeightMapPoint( const int x, const int z ) const
 	{
 		return m_heights[ z + ( x * HEIGHTMAP_DIM ) ];
 	}
 
+	//the heightmap point a point of the tiled world takes its height from
+	inline int GetTiledPoint( const int point ) const
+	{
+		const int period = 2 * ( HEIGHTMAP_DIM - 1 );
+		int wrapped = point % period;
+		if( wrapped < 0 )
+			wrapped += period;
+		return ( wrapped < HEIGHTMAP_DIM ) ? wrapped : period - wrapped;
+	}
+
+	//the first vertex of a cell - within each block cells are in the same order
+	//as the quadtree's children, so each 2x2 quarter is a run of four
+	inline unsigned int GetCellBaseVertex( const int cellX, const int cellZ ) const
+	{
+		const int block = ( cellX / DRAW_BLOCK_DIM ) + ( ( cellZ / DRAW_BLOCK_DIM ) * DRAW_BLOCKS_DIM );
+		const int cell = ( cellX & 1 ) | ( ( cellZ & 1 ) << 1 ) |
+						 ( ( cellX & 2 ) << 1 ) | ( ( cellZ & 2 ) << 2 );
+		return ( ( block * CELLS_PER_DRAW_BLOCK ) + cell ) * VERTS_PER_CELL;
+	}
+
+	inline void GetCellFromBaseVertex( const unsigned int baseVertex, int& cellX,
+									   int& cellZ ) const
+	{
+		const int block = int( baseVertex ) / ( VERTS_PER_CELL * CELLS_PER_DRAW_BLOCK );
+		const int cell = ( int( baseVertex ) / VERTS_PER_CELL ) % CELLS_PER_DRAW_BLOCK;
+		cellX = ( ( block % DRAW_BLOCKS_DIM ) * DRAW_BLOCK_DIM ) +
+				( cell & 1 ) + ( ( cell >> 1 ) & 2 );
+		cellZ = ( ( block / DRAW_BLOCKS_DIM ) * DRAW_BLOCK_DIM ) +
+				( ( cell >> 1 ) & 1 ) + ( ( cell >> 2 ) & 2 );
+	}
+
+	inline float GetOccluderHeight( const int blockX, const int blockZ ) const
+	{
+		const int cellNumber = ( blockX / OCCLUDERS_PER_EDGE ) +
+							   ( ( blockZ / OCCLUDERS_PER_EDGE ) * CELLS_DIM );
+		const int block = ( blockX % OCCLUDERS_PER_EDGE ) +
+						  ( ( blockZ % OCCLUDERS_PER_EDGE ) * OCCLUDERS_PER_EDGE );
+		return m_occluderHeights[ ( cellNumber * OCCLUDERS_PER_CELL ) + block ];
+	}
+
 	void GenerateHeightmap();
 
+	#if !defined( HOVERCRAFT_HEADLESS )
 	HRESULT FillVertexBuffer();
 	HRESULT FillIndexBuffer();
+	#endif
 	HRESULT BuildQuadtree();
+	void CullCoherent( const Camera& camera, const Frustum& frustum, const Vector3& vEye );
+	void MergeVisibleCells();
 
+	#if !defined( HOVERCRAFT_HEADLESS )
     D3DXVECTOR3 GetFaceNormal( const D3DXVECTOR3& v1, const D3DXVECTOR3& v2,
 							   const D3DXVECTOR3& v3 ) const;
+	#endif
 
 	//perlin noise generator functions
 	inline float Interpolate( const float a, const float b, const float x ) const;
 	inline float Noise1( const int x, const int y ) const;
 	inline float SmoothedNoise1( const int x, const int y ) const;
 	inline float InterpolatedNoise1( const float x, const float y ) const;
-	float PerlinNoise2D( const float x, const float y ) const;
 
 	//heightmap
 	float m_heights[ HEIGHTMAP_DIM * HEIGHTMAP_DIM ];
 
 	//terrain quadtree
-	QuadtreeNode* m_pQuadtree;
+	Quadtree* m_pQuadtree;
+	WorkerPool* m_pWorkerPool;
 	std::vector<unsigned int> m_visibleCells;
 
+	CullStats m_cullStats;
+
+	//visible cells merged into as few draw calls as possible, using the number
+	//visible in each 2x2 quarter and 4x4 block
+	std::vector<CellDraw> m_cellDraws;
+	unsigned char m_quarterCounts[ DRAW_QUARTERS_DIM * DRAW_QUARTERS_DIM ];
+	unsigned char m_blockCounts[ DRAW_BLOCKS_DIM * DRAW_BLOCKS_DIM ];
+
+	//horizon occlusion, applied to the cells inside the frustum
+	HorizonCuller m_horizonCuller;
+	std::vector<float> m_visibleDistances;
+	unsigned int m_distanceBucketStart[ NUM_DISTANCE_BUCKETS + 1 ];
+	std::vector<unsigned int> m_frustumCells;
+	std::vector<HorizonCell> m_horizonCells;
+	std::vector<HorizonCell> m_horizonOccluders;
+
+	//lowest height in each block of each cell - cells are much wider than the
+	//hills, so a whole cell hides very little
+	float m_occluderHeights[ CELLS_DIM * CELLS_DIM * OCCLUDERS_PER_CELL ];
+
+	//highest height in the same blocks, in heightmap order, for physics queries
+	float m_blockMaxHeights[ CELLS_DIM * CELLS_DIM * OCCLUDERS_PER_CELL ];
+
+	//corners of the occluder blocks, as a low detail mesh that is never above the
+	//terrain - used for occlusion tests on the objects drawn over it
+	float m_occluderMeshHeights[ OCCLUDER_MESH_DIM * OCCLUDER_MESH_DIM ];
+
+	//coherent culling, and the camera at its last full cull, in terrain space
+	bool		m_coherentCulling;
+	bool		m_mergedDraws;
+	bool		m_cullReferenceValid;
+	Vector3		m_vCullReferenceEye;
+	Affine		m_matCullReferenceView;
+	Matrix4		m_matCullReferenceProj;
+
+	//floating origin, in cells
+	int m_originX;
+	int m_originZ;
+	bool m_tiled;
+
 	//direct3d objects
+	#if !defined( HOVERCRAFT_HEADLESS )
 	struct TerrainVertex;
 	LPDIRECT3DDEVICE9		m_pd3dDevice;
 	LPD3DXMESH				m_pMesh;
@@ -112,6 +323,7 @@ private:
 	LPDIRECT3DVERTEXSHADER9 m_pVSDiffuse;
 	LPDIRECT3DVERTEXDECLARATION9 m_pVSDecl;
 	LPDIRECT3DPIXELSHADER9	m_pPS;
+	#endif
 
 };
 
@@ -0,0 +1,721 @@
+//------------------------------------------------------------------------------
+// File: VectorMath.h
+// Desc: Vectors, quaternions, matrices and planes for the simulation and
+//		 culling code, with no dependence on D3DX
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_VECTORMATH_H
+#define INCLUSIONGUARD_VECTORMATH_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <math.h>
+
+//the four-wide operations use sse on x86 and neon on arm unless this is
+//defined, and plain floats otherwise. Neon only reaches the Simd4 operations
+//below - the frustum kernels, the occlusion rasteriser and the fleet's kernel
+//are written in sse, and on arm run their plain float code.
+#if !defined( HOVERCRAFT_NO_SSE )
+	#if defined( __ARM_NEON ) || defined( __ARM_NEON__ )
+		#define MATHS_USE_NEON
+	#elif defined( _M_IX86 ) || defined( _M_X64 ) || defined( __i386__ ) || defined( __x86_64__ )
+		#define MATHS_USE_SSE
+	#endif
+#endif
+
+#if defined( MATHS_USE_SSE )
+	#include <xmmintrin.h>
+#elif defined( MATHS_USE_NEON )
+	#include <arm_neon.h>
+#endif
+
+
+//------------------------------------------------------------------------------
+// Constants:
+//------------------------------------------------------------------------------
+const float MATHS_PI = 3.14159265f;
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: Simd4
+// Desc: Four floats in a register. Loads and stores need no alignment, so a row
+//		 of any of the types below can be read in place. SimdMulAdd() is a
+//		 multiply then an add, never fused, so the results match the scalar
+//		 code's rounding.
+//------------------------------------------------------------------------------
+#if defined( MATHS_USE_SSE )
+
+typedef __m128 Simd4;
+
+inline Simd4 SimdLoad( const float* p ) { return _mm_loadu_ps( p ); }
+inline void SimdStore( float* p, const Simd4 v ) { _mm_storeu_ps( p, v ); }
+inline Simd4 SimdSplat( const float f ) { return _mm_set1_ps( f ); }
+inline Simd4 SimdSet( const float x, const float y, const float z, const float w )
+{
+	return _mm_setr_ps( x, y, z, w );
+}
+inline Simd4 SimdAdd( const Simd4 a, const Simd4 b ) { return _mm_add_ps( a, b ); }
+inline Simd4 SimdSub( const Simd4 a, const Simd4 b ) { return _mm_sub_ps( a, b ); }
+inline Simd4 SimdMul( const Simd4 a, const Simd4 b ) { return _mm_mul_ps( a, b ); }
+inline Simd4 SimdMulAdd( const Simd4 a, const Simd4 b, const Simd4 c )
+{
+	return _mm_add_ps( _mm_mul_ps( a, b ), c );
+}
+
+#elif defined( MATHS_USE_NEON )
+
+typedef float32x4_t Simd4;
+
+inline Simd4 SimdLoad( const float* p ) { return vld1q_f32( p ); }
+inline void SimdStore( float* p, const Simd4 v ) { vst1q_f32( p, v ); }
+inline Simd4 SimdSplat( const float f ) { return vdupq_n_f32( f ); }
+inline Simd4 SimdSet( const float x, const float y, const float z, const float w )
+{
+	const float f[ 4 ] = { x, y, z, w };
+	return vld1q_f32( f );
+}
+inline Simd4 SimdAdd( const Simd4 a, const Simd4 b ) { return vaddq_f32( a, b ); }
+inline Simd4 SimdSub( const Simd4 a, const Simd4 b ) { return vsubq_f32( a, b ); }
+inline Simd4 SimdMul( const Simd4 a, const Simd4 b ) { return vmulq_f32( a, b ); }
+inline Simd4 SimdMulAdd( const Simd4 a, const Simd4 b, const Simd4 c )
+{
+	return vaddq_f32( vmulq_f32( a, b ), c );
+}
+
+#else
+
+struct Simd4
+{
+	float f[ 4 ];
+};
+
+inline Simd4 SimdSet( const float x, const float y, const float z, const float w )
+{
+	Simd4 v;
+	v.f[ 0 ] = x;
+	v.f[ 1 ] = y;
+	v.f[ 2 ] = z;
+	v.f[ 3 ] = w;
+	return v;
+}
+inline Simd4 SimdLoad( const float* p ) { return SimdSet( p[ 0 ], p[ 1 ], p[ 2 ], p[ 3 ] ); }
+inline void SimdStore( float* p, const Simd4& v )
+{
+	p[ 0 ] = v.f[ 0 ];
+	p[ 1 ] = v.f[ 1 ];
+	p[ 2 ] = v.f[ 2 ];
+	p[ 3 ] = v.f[ 3 ];
+}
+inline Simd4 SimdSplat( const float f ) { return SimdSet( f, f, f, f ); }
+inline Simd4 SimdAdd( const Simd4& a, const Simd4& b )
+{
+	return SimdSet( a.f[ 0 ] + b.f[ 0 ], a.f[ 1 ] + b.f[ 1 ], a.f[ 2 ] + b.f[ 2 ],
+					a.f[ 3 ] + b.f[ 3 ] );
+}
+inline Simd4 SimdSub( const Simd4& a, const Simd4& b )
+{
+	return SimdSet( a.f[ 0 ] - b.f[ 0 ], a.f[ 1 ] - b.f[ 1 ], a.f[ 2 ] - b.f[ 2 ],
+					a.f[ 3 ] - b.f[ 3 ] );
+}
+inline Simd4 SimdMul( const Simd4& a, const Simd4& b )
+{
+	return SimdSet( a.f[ 0 ] * b.f[ 0 ], a.f[ 1 ] * b.f[ 1 ], a.f[ 2 ] * b.f[ 2 ],
+					a.f[ 3 ] * b.f[ 3 ] );
+}
+inline Simd4 SimdMulAdd( const Simd4& a, const Simd4& b, const Simd4& c )
+{
+	return SimdAdd( SimdMul( a, b ), c );
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+// Name: struct Vector3
+// Desc: A 3d vector. Like D3DXVECTOR3 it converts to a float pointer, so it can
+//		 be indexed, and handed to D3DX as D3DXVECTOR3( v ).
+//------------------------------------------------------------------------------
+struct Vector3
+{
+	float x, y, z;
+
+	Vector3() {}
+	Vector3( const float fx, const float fy, const float fz ) : x( fx ), y( fy ), z( fz ) {}
+	explicit Vector3( const float* pf ) : x( pf[ 0 ] ), y( pf[ 1 ] ), z( pf[ 2 ] ) {}
+
+	operator float*() { return &x; }
+	operator const float*() const { return &x; }
+
+	Vector3& operator+=( const Vector3& v ) { x += v.x; y += v.y; z += v.z; return *this; }
+	Vector3& operator-=( const Vector3& v ) { x -= v.x; y -= v.y; z -= v.z; return *this; }
+	Vector3& operator*=( const float f ) { x *= f; y *= f; z *= f; return *this; }
+	Vector3& operator/=( const float f ) { x /= f; y /= f; z /= f; return *this; }
+
+	Vector3 operator+( const Vector3& v ) const { return Vector3( x + v.x, y + v.y, z + v.z ); }
+	Vector3 operator-( const Vector3& v ) const { return Vector3( x - v.x, y - v.y, z - v.z ); }
+	Vector3 operator*( const float f ) const { return Vector3( x * f, y * f, z * f ); }
+	Vector3 operator/( const float f ) const { return Vector3( x / f, y / f, z / f ); }
+	Vector3 operator-() const { return Vector3( -x, -y, -z ); }
+
+	bool operator==( const Vector3& v ) const { return x == v.x && y == v.y && z == v.z; }
+	bool operator!=( const Vector3& v ) const { return !( *this == v ); }
+};
+
+inline Vector3 operator*( const float f, const Vector3& v ) { return v * f; }
+
+//------------------------------------------------------------------------------
+// Name: struct Vector4
+// Desc: A 4d vector
+//------------------------------------------------------------------------------
+struct Vector4
+{
+	float x, y, z, w;
+
+	Vector4() {}
+	Vector4( const float fx, const float fy, const float fz, const float fw )
+		: x( fx ), y( fy ), z( fz ), w( fw ) {}
+	Vector4( const Vector3& v, const float fw ) : x( v.x ), y( v.y ), z( v.z ), w( fw ) {}
+	explicit Vector4( const float* pf ) : x( pf[ 0 ] ), y( pf[ 1 ] ), z( pf[ 2 ] ), w( pf[ 3 ] ) {}
+
+	operator float*() { return &x; }
+	operator const float*() const { return &x; }
+
+	Vector4& operator+=( const Vector4& v ) { x += v.x; y += v.y; z += v.z; w += v.w; return *this; }
+	Vector4& operator-=( const Vector4& v ) { x -= v.x; y -= v.y; z -= v.z; w -= v.w; return *this; }
+	Vector4& operator*=( const float f ) { x *= f; y *= f; z *= f; w *= f; return *this; }
+	Vector4& operator/=( const float f ) { x /= f; y /= f; z /= f; w /= f; return *this; }
+
+	Vector4 operator+( const Vector4& v ) const
+	{
+		return Vector4( x + v.x, y + v.y, z + v.z, w + v.w );
+	}
+	Vector4 operator-( const Vector4& v ) const
+	{
+		return Vector4( x - v.x, y - v.y, z - v.z, w - v.w );
+	}
+	Vector4 operator*( const float f ) const { return Vector4( x * f, y * f, z * f, w * f ); }
+	Vector4 operator/( const float f ) const { return Vector4( x / f, y / f, z / f, w / f ); }
+	Vector4 operator-() const { return Vector4( -x, -y, -z, -w ); }
+};
+
+//------------------------------------------------------------------------------
+// Name: struct Quaternion
+// Desc: A rotation, kept in D3DX's convention - QuaternionMultiply( a, b ) is
+//		 the turn a followed by the turn b
+//------------------------------------------------------------------------------
+struct Quaternion
+{
+	float x, y, z, w;
+
+	Quaternion() {}
+	Quaternion( const float fx, const float fy, const float fz, const float fw )
+		: x( fx ), y( fy ), z( fz ), w( fw ) {}
+
+	operator float*() { return &x; }
+	operator const float*() const { return &x; }
+};
+
+//------------------------------------------------------------------------------
+// Name: struct Plane
+// Desc: The plane ax + by + cz + d = 0
+//------------------------------------------------------------------------------
+struct Plane
+{
+	float a, b, c, d;
+
+	Plane() {}
+	Plane( const float fa, const float fb, const float fc, const float fd )
+		: a( fa ), b( fb ), c( fc ), d( fd ) {}
+};
+
+//------------------------------------------------------------------------------
+// Name: struct Matrix3
+// Desc: A 3x3 matrix, for rotations. Vectors are rows, and are multiplied on
+//		 the left, as in D3DX.
+//------------------------------------------------------------------------------
+struct Matrix3
+{
+	float m[ 3 ][ 3 ];
+
+	float& operator()( const int row, const int column ) { return m[ row ][ column ]; }
+	float operator()( const int row, const int column ) const { return m[ row ][ column ]; }
+};
+
+//------------------------------------------------------------------------------
+// Name: struct Affine
+// Desc: A transform with no projection - a 3x3 part in the first three rows and
+//		 a translation in the last. It is laid out as a whole 4x4 matrix, with
+//		 the last column always 0, 0, 0, 1, so it can be handed to Direct3D as
+//		 D3DXMATRIX( m ), but the functions that take one leave that column out.
+//------------------------------------------------------------------------------
+struct Affine
+{
+	float m[ 4 ][ 4 ];
+
+	float& operator()( const int row, const int column ) { return m[ row ][ column ]; }
+	float operator()( const int row, const int column ) const { return m[ row ][ column ]; }
+
+	operator float*() { return &m[ 0 ][ 0 ]; }
+	operator const float*() const { return &m[ 0 ][ 0 ]; }
+};
+
+//------------------------------------------------------------------------------
+// Name: struct Matrix4
+// Desc: A general 4x4 matrix, for projections
+//------------------------------------------------------------------------------
+struct Matrix4
+{
+	float m[ 4 ][ 4 ];
+
+	Matrix4() {}
+	explicit Matrix4( const float* pf )
+	{
+		for( int i = 0; i < 16; ++i )
+			m[ i / 4 ][ i % 4 ] = pf[ i ];
+	}
+
+	float& operator()( const int row, const int column ) { return m[ row ][ column ]; }
+	float operator()( const int row, const int column ) const { return m[ row ][ column ]; }
+
+	operator float*() { return &m[ 0 ][ 0 ]; }
+	operator const float*() const { return &m[ 0 ][ 0 ]; }
+};
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: Vec3 functions
+// Desc: Sums are taken in x, y, z order, as D3DX does
+//------------------------------------------------------------------------------
+inline float Vec3Dot( const Vector3& a, const Vector3& b )
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vector3 Vec3Cross( const Vector3& a, const Vector3& b )
+{
+	return Vector3( a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x );
+}
+
+inline float Vec3LengthSq( const Vector3& v ) { return Vec3Dot( v, v ); }
+inline float Vec3Length( const Vector3& v ) { return sqrtf( Vec3Dot( v, v ) ); }
+
+//a zero vector stays zero
+inline Vector3 Vec3Normalize( const Vector3& v )
+{
+	const float length = Vec3Length( v );
+	return ( length > 0.0f ) ? v / length : Vector3( 0.0f, 0.0f, 0.0f );
+}
+
+inline Vector3 Vec3Minimize( const Vector3& a, const Vector3& b )
+{
+	return Vector3( ( a.x < b.x ) ? a.x : b.x, ( a.y < b.y ) ? a.y : b.y,
+					( a.z < b.z ) ? a.z : b.z );
+}
+
+inline Vector3 Vec3Maximize( const Vector3& a, const Vector3& b )
+{
+	return Vector3( ( a.x > b.x ) ? a.x : b.x, ( a.y > b.y ) ? a.y : b.y,
+					( a.z > b.z ) ? a.z : b.z );
+}
+
+inline Vector3 Vec3Lerp( const Vector3& a, const Vector3& b, const float s )
+{
+	return a + ( b - a ) * s;
+}
+
+//v * m, and v * the transpose of m - for a rotation, the turn and its inverse
+inline Vector3 Vec3Transform( const Vector3& v, const Matrix3& m )
+{
+	return Vector3( ( v.x * m.m[ 0 ][ 0 ] + v.y * m.m[ 1 ][ 0 ] ) + v.z * m.m[ 2 ][ 0 ],
+					( v.x * m.m[ 0 ][ 1 ] + v.y * m.m[ 1 ][ 1 ] ) + v.z * m.m[ 2 ][ 1 ],
+					( v.x * m.m[ 0 ][ 2 ] + v.y * m.m[ 1 ][ 2 ] ) + v.z * m.m[ 2 ][ 2 ] );
+}
+
+inline Vector3 Vec3TransformTranspose( const Vector3& v, const Matrix3& m )
+{
+	return Vector3( ( v.x * m.m[ 0 ][ 0 ] + v.y * m.m[ 0 ][ 1 ] ) + v.z * m.m[ 0 ][ 2 ],
+					( v.x * m.m[ 1 ][ 0 ] + v.y * m.m[ 1 ][ 1 ] ) + v.z * m.m[ 1 ][ 2 ],
+					( v.x * m.m[ 2 ][ 0 ] + v.y * m.m[ 2 ][ 1 ] ) + v.z * m.m[ 2 ][ 2 ] );
+}
+
+//a point, moved by the translation, and a direction, which is not
+inline Vector3 Vec3TransformCoord( const Vector3& v, const Affine& m )
+{
+	float result[ 4 ];
+	const Simd4 rotated = SimdMulAdd( SimdSplat( v.z ), SimdLoad( m.m[ 2 ] ),
+									  SimdMulAdd( SimdSplat( v.y ), SimdLoad( m.m[ 1 ] ),
+												  SimdMul( SimdSplat( v.x ), SimdLoad( m.m[ 0 ] ) ) ) );
+	SimdStore( result, SimdAdd( rotated, SimdLoad( m.m[ 3 ] ) ) );
+	return Vector3( result );
+}
+
+inline Vector3 Vec3TransformNormal( const Vector3& v, const Affine& m )
+{
+	float result[ 4 ];
+	SimdStore( result, SimdMulAdd( SimdSplat( v.z ), SimdLoad( m.m[ 2 ] ),
+								   SimdMulAdd( SimdSplat( v.y ), SimdLoad( m.m[ 1 ] ),
+											   SimdMul( SimdSplat( v.x ), SimdLoad( m.m[ 0 ] ) ) ) ) );
+	return Vector3( result );
+}
+
+//------------------------------------------------------------------------------
+// Name: Vec4 functions
+//------------------------------------------------------------------------------
+inline float Vec4Dot( const Vector4& a, const Vector4& b )
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+inline Vector4 Vec4Lerp( const Vector4& a, const Vector4& b, const float s )
+{
+	return a + ( b - a ) * s;
+}
+
+inline Vector4 Vec4Transform( const Vector4& v, const Matrix4& m )
+{
+	Vector4 result;
+	SimdStore( result, SimdMulAdd( SimdSplat( v.w ), SimdLoad( m.m[ 3 ] ),
+								   SimdMulAdd( SimdSplat( v.z ), SimdLoad( m.m[ 2 ] ),
+											   SimdMulAdd( SimdSplat( v.y ), SimdLoad( m.m[ 1 ] ),
+														   SimdMul( SimdSplat( v.x ),
+																	SimdLoad( m.m[ 0 ] ) ) ) ) ) );
+	return result;
+}
+
+//------------------------------------------------------------------------------
+// Name: Quaternion functions
+//------------------------------------------------------------------------------
+inline Quaternion QuaternionIdentity() { return Quaternion( 0.0f, 0.0f, 0.0f, 1.0f ); }
+
+inline float QuaternionDot( const Quaternion& a, const Quaternion& b )
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+inline Quaternion QuaternionNormalize( const Quaternion& q )
+{
+	const float length = sqrtf( QuaternionDot( q, q ) );
+	return Quaternion( q.x / length, q.y / length, q.z / length, q.w / length );
+}
+
+//each of b's components scales a shuffled copy of a, and the four are summed
+//in the order D3DX sums them
+inline Quaternion QuaternionMultiply( const Quaternion& a, const Quaternion& b )
+{
+	const Simd4 t0 = SimdMul( SimdSplat( b.w ), SimdSet( a.x, a.y, a.z, a.w ) );
+	const Simd4 t1 = SimdMul( SimdSplat( b.x ), SimdSet( a.w, -a.z, a.y, -a.x ) );
+	const Simd4 t2 = SimdMul( SimdSplat( b.y ), SimdSet( a.z, a.w, -a.x, -a.y ) );
+	const Simd4 t3 = SimdMul( SimdSplat( b.z ), SimdSet( -a.y, a.x, a.w, -a.z ) );
+
+	Quaternion result;
+	SimdStore( result, SimdAdd( SimdAdd( SimdAdd( t0, t1 ), t2 ), t3 ) );
+	return result;
+}
+
+//takes the short way round, and blends linearly when the two are too close
+//for the angle between them to be found accurately
+inline Quaternion QuaternionSlerp( const Quaternion& a, const Quaternion& b, const float t )
+{
+	float cosAngle = QuaternionDot( a, b );
+	float sign = 1.0f;
+	if( cosAngle < 0.0f )
+	{
+		cosAngle = -cosAngle;
+		sign = -1.0f;
+	}
+
+	float k0, k1;
+	if( cosAngle > 0.9999f )
+	{
+		k0 = 1.0f - t;
+		k1 = t;
+	}
+	else
+	{
+		const float angle = acosf( cosAngle );
+		const float sinAngle = sinf( angle );
+		k0 = sinf( ( 1.0f - t ) * angle ) / sinAngle;
+		k1 = sinf( t * angle ) / sinAngle;
+	}
+	k1 *= sign;
+
+	return Quaternion( k0 * a.x + k1 * b.x, k0 * a.y + k1 * b.y, k0 * a.z + k1 * b.z,
+					   k0 * a.w + k1 * b.w );
+}
+
+//------------------------------------------------------------------------------
+// Name: Mat3 functions
+//------------------------------------------------------------------------------
+inline void Mat3RotationQuaternion( Matrix3& out, const Quaternion& q )
+{
+	const float x = q.x, y = q.y, z = q.z, w = q.w;
+	out.m[ 0 ][ 0 ] = 1.0f - 2.0f * ( y * y + z * z );
+	out.m[ 0 ][ 1 ] = 2.0f * ( x * y + z * w );
+	out.m[ 0 ][ 2 ] = 2.0f * ( x * z - y * w );
+	out.m[ 1 ][ 0 ] = 2.0f * ( x * y - z * w );
+	out.m[ 1 ][ 1 ] = 1.0f - 2.0f * ( x * x + z * z );
+	out.m[ 1 ][ 2 ] = 2.0f * ( y * z + x * w );
+	out.m[ 2 ][ 0 ] = 2.0f * ( x * z + y * w );
+	out.m[ 2 ][ 1 ] = 2.0f * ( y * z - x * w );
+	out.m[ 2 ][ 2 ] = 1.0f - 2.0f * ( x * x + y * y );
+}
+
+//a turn about the y-axis, as D3DXMatrixRotationY() builds
+inline void Mat3RotationY( Matrix3& out, const float angle )
+{
+	const float cosAngle = cosf( angle );
+	const float sinAngle = sinf( angle );
+	out.m[ 0 ][ 0 ] = cosAngle;
+	out.m[ 0 ][ 1 ] = 0.0f;
+	out.m[ 0 ][ 2 ] = -sinAngle;
+	out.m[ 1 ][ 0 ] = 0.0f;
+	out.m[ 1 ][ 1 ] = 1.0f;
+	out.m[ 1 ][ 2 ] = 0.0f;
+	out.m[ 2 ][ 0 ] = sinAngle;
+	out.m[ 2 ][ 1 ] = 0.0f;
+	out.m[ 2 ][ 2 ] = cosAngle;
+}
+
+//------------------------------------------------------------------------------
+// Name: Affine functions
+// Desc: The output may be one of the inputs
+//------------------------------------------------------------------------------
+inline void AffineIdentity( Affine& out )
+{
+	for( int row = 0; row < 4; ++row )
+	{
+		for( int column = 0; column < 4; ++column )
+			out.m[ row ][ column ] = ( row == column ) ? 1.0f : 0.0f;
+	}
+}
+
+inline void AffineTranslation( Affine& out, const float x, const float y, const float z )
+{
+	AffineIdentity( out );
+	out.m[ 3 ][ 0 ] = x;
+	out.m[ 3 ][ 1 ] = y;
+	out.m[ 3 ][ 2 ] = z;
+}
+
+inline void AffineScaling( Affine& out, const float x, const float y, const float z )
+{
+	AffineIdentity( out );
+	out.m[ 0 ][ 0 ] = x;
+	out.m[ 1 ][ 1 ] = y;
+	out.m[ 2 ][ 2 ] = z;
+}
+
+//scales, then turns, then moves
+inline void AffineTransformation( Affine& out, const float scale, const Matrix3& matRotation,
+								  const Vector3& vTranslation )
+{
+	for( int row = 0; row < 3; ++row )
+	{
+		out.m[ row ][ 0 ] = matRotation.m[ row ][ 0 ] * scale;
+		out.m[ row ][ 1 ] = matRotation.m[ row ][ 1 ] * scale;
+		out.m[ row ][ 2 ] = matRotation.m[ row ][ 2 ] * scale;
+		out.m[ row ][ 3 ] = 0.0f;
+	}
+	out.m[ 3 ][ 0 ] = vTranslation.x;
+	out.m[ 3 ][ 1 ] = vTranslation.y;
+	out.m[ 3 ][ 2 ] = vTranslation.z;
+	out.m[ 3 ][ 3 ] = 1.0f;
+}
+
+//a then b - each row takes three multiplies instead of four, and only the
+//translation picks up b's
+inline void AffineMultiply( Affine& out, const Affine& a, const Affine& b )
+{
+	const Simd4 b0 = SimdLoad( b.m[ 0 ] );
+	const Simd4 b1 = SimdLoad( b.m[ 1 ] );
+	const Simd4 b2 = SimdLoad( b.m[ 2 ] );
+
+	Simd4 rows[ 4 ];
+	for( int row = 0; row < 4; ++row )
+	{
+		rows[ row ] = SimdMulAdd( SimdSplat( a.m[ row ][ 2 ] ), b2,
+								  SimdMulAdd( SimdSplat( a.m[ row ][ 1 ] ), b1,
+											  SimdMul( SimdSplat( a.m[ row ][ 0 ] ), b0 ) ) );
+	}
+	rows[ 3 ] = SimdAdd( rows[ 3 ], SimdLoad( b.m[ 3 ] ) );
+
+	for( int row = 0; row < 4; ++row )
+		SimdStore( out.m[ row ], rows[ row ] );
+}
+
+//the inverse of the 3x3 part by its cofactors, and the translation taken back
+//through it
+inline void AffineInverse( Affine& out, const Affine& a )
+{
+	const float c00 = a.m[ 1 ][ 1 ] * a.m[ 2 ][ 2 ] - a.m[ 1 ][ 2 ] * a.m[ 2 ][ 1 ];
+	const float c01 = a.m[ 0 ][ 2 ] * a.m[ 2 ][ 1 ] - a.m[ 0 ][ 1 ] * a.m[ 2 ][ 2 ];
+	const float c02 = a.m[ 0 ][ 1 ] * a.m[ 1 ][ 2 ] - a.m[ 0 ][ 2 ] * a.m[ 1 ][ 1 ];
+	const float c10 = a.m[ 1 ][ 2 ] * a.m[ 2 ][ 0 ] - a.m[ 1 ][ 0 ] * a.m[ 2 ][ 2 ];
+	const float c11 = a.m[ 0 ][ 0 ] * a.m[ 2 ][ 2 ] - a.m[ 0 ][ 2 ] * a.m[ 2 ][ 0 ];
+	const float c12 = a.m[ 0 ][ 2 ] * a.m[ 1 ][ 0 ] - a.m[ 0 ][ 0 ] * a.m[ 1 ][ 2 ];
+	const float c20 = a.m[ 1 ][ 0 ] * a.m[ 2 ][ 1 ] - a.m[ 1 ][ 1 ] * a.m[ 2 ][ 0 ];
+	const float c21 = a.m[ 0 ][ 1 ] * a.m[ 2 ][ 0 ] - a.m[ 0 ][ 0 ] * a.m[ 2 ][ 1 ];
+	const float c22 = a.m[ 0 ][ 0 ] * a.m[ 1 ][ 1 ] - a.m[ 0 ][ 1 ] * a.m[ 1 ][ 0 ];
+	const float inverseDet = 1.0f / ( a.m[ 0 ][ 0 ] * c00 + a.m[ 0 ][ 1 ] * c10 +
+									  a.m[ 0 ][ 2 ] * c20 );
+	const Vector3 vTranslation( a.m[ 3 ][ 0 ], a.m[ 3 ][ 1 ], a.m[ 3 ][ 2 ] );
+
+	out.m[ 0 ][ 0 ] = c00 * inverseDet;
+	out.m[ 0 ][ 1 ] = c01 * inverseDet;
+	out.m[ 0 ][ 2 ] = c02 * inverseDet;
+	out.m[ 0 ][ 3 ] = 0.0f;
+	out.m[ 1 ][ 0 ] = c10 * inverseDet;
+	out.m[ 1 ][ 1 ] = c11 * inverseDet;
+	out.m[ 1 ][ 2 ] = c12 * inverseDet;
+	out.m[ 1 ][ 3 ] = 0.0f;
+	out.m[ 2 ][ 0 ] = c20 * inverseDet;
+	out.m[ 2 ][ 1 ] = c21 * inverseDet;
+	out.m[ 2 ][ 2 ] = c22 * inverseDet;
+	out.m[ 2 ][ 3 ] = 0.0f;
+	out.m[ 3 ][ 0 ] = 0.0f;
+	out.m[ 3 ][ 1 ] = 0.0f;
+	out.m[ 3 ][ 2 ] = 0.0f;
+	out.m[ 3 ][ 3 ] = 1.0f;
+
+	const Vector3 vInverse = -Vec3TransformNormal( vTranslation, out );
+	out.m[ 3 ][ 0 ] = vInverse.x;
+	out.m[ 3 ][ 1 ] = vInverse.y;
+	out.m[ 3 ][ 2 ] = vInverse.z;
+}
+
+//a left-handed view transform, as D3DXMatrixLookAtLH() builds
+inline void AffineLookAtLH( Affine& out, const Vector3& vEye, const Vector3& vAt,
+							const Vector3& vUp )
+{
+	const Vector3 vZ = Vec3Normalize( vAt - vEye );
+	const Vector3 vX = Vec3Normalize( Vec3Cross( vUp, vZ ) );
+	const Vector3 vY = Vec3Cross( vZ, vX );
+
+	out.m[ 0 ][ 0 ] = vX.x;	out.m[ 0 ][ 1 ] = vY.x;	out.m[ 0 ][ 2 ] = vZ.x;	out.m[ 0 ][ 3 ] = 0.0f;
+	out.m[ 1 ][ 0 ] = vX.y;	out.m[ 1 ][ 1 ] = vY.y;	out.m[ 1 ][ 2 ] = vZ.y;	out.m[ 1 ][ 3 ] = 0.0f;
+	out.m[ 2 ][ 0 ] = vX.z;	out.m[ 2 ][ 1 ] = vY.z;	out.m[ 2 ][ 2 ] = vZ.z;	out.m[ 2 ][ 3 ] = 0.0f;
+	out.m[ 3 ][ 0 ] = -Vec3Dot( vX, vEye );
+	out.m[ 3 ][ 1 ] = -Vec3Dot( vY, vEye );
+	out.m[ 3 ][ 2 ] = -Vec3Dot( vZ, vEye );
+	out.m[ 3 ][ 3 ] = 1.0f;
+}
+
+//------------------------------------------------------------------------------
+// Name: Mat4 functions
+// Desc: The output may be one of the inputs
+//------------------------------------------------------------------------------
+inline void Mat4Identity( Matrix4& out )
+{
+	for( int row = 0; row < 4; ++row )
+	{
+		for( int column = 0; column < 4; ++column )
+			out.m[ row ][ column ] = ( row == column ) ? 1.0f : 0.0f;
+	}
+}
+
+inline void Mat4FromAffine( Matrix4& out, const Affine& a )
+{
+	for( int row = 0; row < 4; ++row )
+		SimdStore( out.m[ row ], SimdLoad( a.m[ row ] ) );
+}
+
+//a then b
+inline void Mat4Multiply( Matrix4& out, const Matrix4& a, const Matrix4& b )
+{
+	const Simd4 b0 = SimdLoad( b.m[ 0 ] );
+	const Simd4 b1 = SimdLoad( b.m[ 1 ] );
+	const Simd4 b2 = SimdLoad( b.m[ 2 ] );
+	const Simd4 b3 = SimdLoad( b.m[ 3 ] );
+
+	Simd4 rows[ 4 ];
+	for( int row = 0; row < 4; ++row )
+	{
+		rows[ row ] = SimdMulAdd( SimdSplat( a.m[ row ][ 3 ] ), b3,
+								  SimdMulAdd( SimdSplat( a.m[ row ][ 2 ] ), b2,
+											  SimdMulAdd( SimdSplat( a.m[ row ][ 1 ] ), b1,
+														  SimdMul( SimdSplat( a.m[ row ][ 0 ] ),
+																   b0 ) ) ) );
+	}
+
+	for( int row = 0; row < 4; ++row )
+		SimdStore( out.m[ row ], rows[ row ] );
+}
+
+//an affine transform then a projection, as a view then a projection are -
+//the affine's last column leaves a multiply out of each row
+inline void Mat4MultiplyAffine( Matrix4& out, const Affine& a, const Matrix4& b )
+{
+	const Simd4 b0 = SimdLoad( b.m[ 0 ] );
+	const Simd4 b1 = SimdLoad( b.m[ 1 ] );
+	const Simd4 b2 = SimdLoad( b.m[ 2 ] );
+
+	Simd4 rows[ 4 ];
+	for( int row = 0; row < 4; ++row )
+	{
+		rows[ row ] = SimdMulAdd( SimdSplat( a.m[ row ][ 2 ] ), b2,
+								  SimdMulAdd( SimdSplat( a.m[ row ][ 1 ] ), b1,
+											  SimdMul( SimdSplat( a.m[ row ][ 0 ] ), b0 ) ) );
+	}
+	rows[ 3 ] = SimdAdd( rows[ 3 ], SimdLoad( b.m[ 3 ] ) );
+
+	for( int row = 0; row < 4; ++row )
+		SimdStore( out.m[ row ], rows[ row ] );
+}
+
+inline void Mat4Transpose( Matrix4& out, const Matrix4& a )
+{
+	Matrix4 result;
+	for( int row = 0; row < 4; ++row )
+	{
+		for( int column = 0; column < 4; ++column )
+			result.m[ row ][ column ] = a.m[ column ][ row ];
+	}
+	out = result;
+}
+
+//a left-handed perspective projection, as D3DXMatrixPerspectiveFovLH() builds
+inline void Mat4PerspectiveFovLH( Matrix4& out, const float fovY, const float aspect,
+								  const float zNear, const float zFar )
+{
+	const float yScale = 1.0f / tanf( fovY / 2.0f );
+	const float xScale = yScale / aspect;
+
+	Mat4Identity( out );
+	out.m[ 0 ][ 0 ] = xScale;
+	out.m[ 1 ][ 1 ] = yScale;
+	out.m[ 2 ][ 2 ] = zFar / ( zFar - zNear );
+	out.m[ 2 ][ 3 ] = 1.0f;
+	out.m[ 3 ][ 2 ] = -zNear * zFar / ( zFar - zNear );
+	out.m[ 3 ][ 3 ] = 0.0f;
+}
+
+//------------------------------------------------------------------------------
+// Name: Plane functions
+//------------------------------------------------------------------------------
+inline Plane PlaneNormalize( const Plane& p )
+{
+	const float length = sqrtf( p.a * p.a + p.b * p.b + p.c * p.c );
+	return Plane( p.a / length, p.b / length, p.c / length, p.d / length );
+}
+
+inline float PlaneDotCoord( const Plane& p, const Vector3& v )
+{
+	return p.a * v.x + p.b * v.y + p.c * v.z + p.d;
+}
+
+
+#endif //INCLUSIONGUARD_VECTORMATH_H
@@ -11,11 +11,47 @@
 //------------------------------------------------------------------------------
 // Included files:
 //------------------------------------------------------------------------------
-#include "Scene.h"
 #include "Vehicle.h"
-#include "Resource.h"
 
-#include "DXUtil.h"
+#if !defined( HOVERCRAFT_HEADLESS )
+	#include "Resource.h"
+	#include "Scene.h"
+#endif
+
+
+//------------------------------------------------------------------------------
+// Constants:
+//------------------------------------------------------------------------------
+
+//simulation constants
+const float GRAVITY			= 100.0f;
+const float LINEAR_THRUST	= 40000.0f;
+const float ANGULAR_THRUST	= 500.0f;
+const float LINEAR_AR		= 30.0f;
+const float ANGULAR_AR		= 1000.0f;
+const float HOVER_HEIGHT	= 1.0f;
+const float SUPPORT_HEIGHT	= HOVER_HEIGHT - 0.5f;
+
+//a step is split when the collision points could reach the terrain during it,
+//so that none of them moves further than this between tests of the grid
+const float MAX_SWEEP_DISTANCE	= HOVER_HEIGHT / 2.0f;
+const int	MAX_SUBSTEPS		= 64;
+
+//a vehicle on the ground with no input goes to sleep once it has moved and
+//turned slower than these for SLEEP_STEPS steps in a row
+const float SLEEP_SPEED			= 0.25f;
+const float SLEEP_ANGULAR_SPEED	= 0.05f;
+const int	SLEEP_STEPS			= 120;
+
+//as reported by Vehicle::GetIntegratorName(), in the order of the Integrator
+//values
+const char* const INTEGRATOR_NAMES[ NUM_INTEGRATORS ] =
+{
+	"explicit Euler",
+	"symplectic Euler",
+	"velocity Verlet",
+	"RK2 (midpoint)",
+};
 
 
 //------------------------------------------------------------------------------
@@ -24,16 +60,7 @@
 const float Vehicle::SIZE_X = 6.0f;
 const float Vehicle::SIZE_Y = 1.0f;
 const float Vehicle::SIZE_Z = 6.0f;
-
-//------------------------------------------------------------------------------
-// Name: struct VehicleVertex
-// Desc: A single vertex in the vehicle mesh
-//------------------------------------------------------------------------------
-struct VehicleVertex
-{
-	D3DXVECTOR3 p;
-	D3DXVECTOR3 n;
-};
+const float Vehicle::MESH_SCALE = 0.2f;
 
 //------------------------------------------------------------------------------
 // Name: Vehicle()
@@ -42,6 +69,7 @@ struct VehicleVertex
 Vehicle::Vehicle()
 {
 	//initialise member variables
+	#if !defined( HOVERCRAFT_HEADLESS )
 	m_pd3dDevice	= NULL;
 	m_pMesh			= NULL;
 	m_numMaterials	= NULL;
@@ -50,35 +78,38 @@ Vehicle::Vehicle()
 	m_pVSDiffuse	= NULL;
 	m_pVSDecl		= NULL;
 	m_pPS			= NULL;
-	m_isOnGround	= false;
+	#endif
+	m_state.isOnGround	= false;
+	m_state.sleepSteps	= 0;
+	m_state.isAsleep	= false;
+	m_vMeshMin		= Vector3( 0.0f, 0.0f, 0.0f );
+	m_vMeshMax		= Vector3( 0.0f, 0.0f, 0.0f );
 
 	//initialise physics constants
 	m_mass				= 150.0f;
-	m_vPosition			= D3DXVECTOR4( 0.0f, 0.0f, 0.0f, 1.0f );
-	m_vLinearVelocity	= D3DXVECTOR4( 0.0f, 0.0f, 0.0f, 1.0f );
-	D3DXMatrixIdentity( &m_matRotation );
-	m_vAngularMomentum	= D3DXVECTOR4( 0.0f, 0.0f, 0.0f, 1.0f );
+	m_state.vPosition			= Vector3( 0.0f, 0.0f, 0.0f );
+	m_state.vLinearVelocity	= Vector3( 0.0f, 0.0f, 0.0f );
+	m_state.qOrientation		= QuaternionIdentity();
+	m_state.vAngularMomentum	= Vector3( 0.0f, 0.0f, 0.0f );
+
+	m_state.vPreviousPosition		= m_state.vPosition;
+	m_state.qPreviousOrientation	= m_state.qOrientation;
+	m_interpolation			= 1.0f;
+	m_substepping			= true;
+	SetIntegrator( INTEGRATOR_EXPLICIT_EULER );
 
 	//calculate inertia tensor
-	D3DXMatrixIdentity( &m_matInverseTensor );
 	const float m = m_mass / 12.0f;
 	const float x = SIZE_X * SIZE_X;
 	const float y = SIZE_Y * SIZE_Y;
 	const float z = SIZE_Z * SIZE_Z;
-	m_matInverseTensor( 0, 0 ) = m * ( y + z );	//x-axis
-	m_matInverseTensor( 1, 1 ) = m * ( x + z );	//y-axis
-	m_matInverseTensor( 2, 2 ) = m * ( x + y );	//z-axis
-	D3DXMatrixInverse( &m_matInverseTensor, NULL, &m_matInverseTensor );
+	m_vInverseInertia = Vector3( 1.0f / ( m * ( y + z ) ),		//x-axis
+								 1.0f / ( m * ( x + z ) ),		//y-axis
+								 1.0f / ( m * ( x + y ) ) );	//z-axis
 
-	//calculate auxiliary quanitites...
-	//world-space inertia tensor
-	D3DXMATRIX matRotationTranspose;
-	D3DXMatrixTranspose( &matRotationTranspose, &m_matRotation );
-	D3DXMatrixMultiply( &m_matWorldTensor, &m_matRotation, &m_matInverseTensor );
-	D3DXMatrixMultiply( &m_matWorldTensor, &m_matWorldTensor, &matRotationTranspose );
-
-	//angular velocity
-	D3DXVec4Transform( &m_vAngularVelocity, &m_vAngularMomentum, &m_matWorldTensor );
+	//calculate auxiliary quanitites
+	Mat3RotationQuaternion( m_state.matRotation, m_state.qOrientation );
+	UpdateAngularVelocity();
 
 	//create collision grid
 	const float halfX = SIZE_X / 2.0f;
@@ -91,18 +122,19 @@ Vehicle::Vehicle()
 	{
 		for( int z = 0; z < POINTS_PER_EDGE; ++z )
 		{
-			m_collisionVectors[ x ][ z ] = D3DXVECTOR3( halfX - ( x * stepX ),
-														halfY,
-														halfZ - ( z * stepZ ) );
-
-            m_collisionPoints[ x ][ z ] = D3DXVECTOR4( ( x * stepX ) - halfX,
-													   - halfY,
-													   ( z * stepZ ) - halfZ,
-													   1.0f );
+			m_collisionVectors[ x ][ z ] = Vector3( halfX - ( x * stepX ),
+													halfY,
+													halfZ - ( z * stepZ ) );
+
+            m_collisionPoints[ x ][ z ] = Vector3( ( x * stepX ) - halfX,
+												   - halfY,
+												   ( z * stepZ ) - halfZ );
 		}
 	}
 }
 
+#if !defined( HOVERCRAFT_HEADLESS )
+
 //------------------------------------------------------------------------------
 // Name: InitDeviceObjects()
 // Desc: Sets up device-specific data on startup and device change
@@ -225,6 +257,27 @@ HRESULT Vehicle::RestoreDeviceObjects()
 	}
 	SAFE_RELEASE( pD3DXMtrlBuffer );
 
+	//copy out the positions and faces, for the bounds and the shadow volume
+	BYTE* pVertices = NULL;
+	WORD* pIndices = NULL;
+	if( FAILED( m_pMesh->LockVertexBuffer( D3DLOCK_READONLY, (LPVOID*)&pVertices ) ) )
+		return E_FAIL;
+	if( FAILED( m_pMesh->LockIndexBuffer( D3DLOCK_READONLY, (LPVOID*)&pIndices ) ) )
+	{
+		m_pMesh->UnlockVertexBuffer();
+		return E_FAIL;
+	}
+
+	const int numVertices = int( m_pMesh->GetNumVertices() );
+	const DWORD stride = m_pMesh->GetNumBytesPerVertex();
+	std::vector<Vector3> positions( numVertices );
+	for( int i = 0; i < numVertices; ++i )
+		positions[ i ] = Vector3( (const float*)( pVertices + ( i * stride ) ) );
+	SetMesh( &positions[ 0 ], numVertices, pIndices, int( m_pMesh->GetNumFaces() ) );
+
+	m_pMesh->UnlockIndexBuffer();
+	m_pMesh->UnlockVertexBuffer();
+
 	OutputDebugString( "done\n" );
 
 	return S_OK;
@@ -268,27 +321,23 @@ HRESULT Vehicle::DeleteDeviceObjects()
 // Name: Render()
 // Desc: Renders the object
 //------------------------------------------------------------------------------
-HRESULT Vehicle::Render( const Scene& scene, const bool useLight,
+HRESULT Vehicle::Render( const Scene& scene, const bool useLight, const bool renderMesh,
 						 const bool renderShadowVolume ) const
 {
 	//set vertex shader constants...
 	//transform matrix
-	D3DXMATRIX matViewProj = scene.GetCamera().GetViewProj();
-	D3DXMATRIX matTranslate, matScale;
-	D3DXMatrixTranslation( &matTranslate, m_vPosition[0], m_vPosition[1], m_vPosition[2] );
-	D3DXMatrixScaling( &matScale, 0.2f, 0.2f, 0.2f );
+	Affine matWorld;
+	GetWorldMatrix( matWorld );
 
-	D3DXMATRIX matWorld;
-	D3DXMatrixMultiply( &matWorld, &matScale, &matTranslate );
-	D3DXMatrixMultiply( &matWorld, &m_matRotation, &matWorld );
-
-	D3DXMATRIX matResult;
-	D3DXMatrixMultiplyTranspose( &matResult, &matWorld, &matViewProj );
+	Matrix4 matResult;
+	Mat4MultiplyAffine( matResult, matWorld, scene.GetCamera().GetViewProj() );
+	Mat4Transpose( matResult, matResult );
 	m_pd3dDevice->SetVertexShaderConstantF( 0, (float*)&matResult, 4 );
 
 	//transposed inverse-transpose world matrix for transforming normals
-	D3DXMatrixInverse( &matResult, NULL, &matWorld );
-	m_pd3dDevice->SetVertexShaderConstantF( 4, (float*)&matResult, 4 );
+	Affine matInverse;
+	AffineInverse( matInverse, matWorld );
+	m_pd3dDevice->SetVertexShaderConstantF( 4, (float*)&matInverse, 4 );
 
 	//which lighting mode are we using?
 	if( useLight )
@@ -315,7 +364,7 @@ HRESULT Vehicle::Render( const Scene& scene, const bool useLight,
 	m_pd3dDevice->SetPixelShader( m_pPS );
 
 	//draw the object
-	for( DWORD i = 0; i < m_numMaterials; ++i )
+	for( DWORD i = 0; i < m_numMaterials && renderMesh; ++i )
 	{
 		m_pd3dDevice->SetVertexShaderConstantF( 8, (float*)&m_pMaterials[ i ], 1 );
 		m_pMesh->DrawSubset( i );
@@ -328,87 +377,418 @@ HRESULT Vehicle::Render( const Scene& scene, const bool useLight,
 	return S_OK;
 }
 
+#endif
+
+//------------------------------------------------------------------------------
+// Name: SetMesh()
+// Desc: Keeps a copy of the mesh's triangles, and finds its bounds
+//------------------------------------------------------------------------------
+void Vehicle::SetMesh( const Vector3* pVertices, const int numVertices, const WORD* pIndices,
+					   const int numFaces )
+{
+	m_meshVertices.assign( pVertices, pVertices + numVertices );
+	m_meshIndices.assign( pIndices, pIndices + ( numFaces * 3 ) );
+
+	m_vMeshMin = Vector3( 0.0f, 0.0f, 0.0f );
+	m_vMeshMax = Vector3( 0.0f, 0.0f, 0.0f );
+	for( int i = 0; i < numVertices; ++i )
+	{
+		if( i == 0 )
+		{
+			m_vMeshMin = pVertices[ i ];
+			m_vMeshMax = pVertices[ i ];
+		}
+		else
+		{
+			m_vMeshMin = Vec3Minimize( m_vMeshMin, pVertices[ i ] );
+			m_vMeshMax = Vec3Maximize( m_vMeshMax, pVertices[ i ] );
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: GetWorldMatrix()
+// Desc: Builds the transform from the mesh to the world, between the last two
+//		 physics states
+//------------------------------------------------------------------------------
+void Vehicle::GetWorldMatrix( Affine& matWorld ) const
+{
+	Matrix3 matRotation;
+	GetRenderRotation( matRotation );
+	AffineTransformation( matWorld, MESH_SCALE, matRotation, GetRenderPosition() );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetRenderRotation()
+// Desc: Blends the orientations before and after the last step
+//------------------------------------------------------------------------------
+void Vehicle::GetRenderRotation( Matrix3& matRotation ) const
+{
+	if( m_interpolation >= 1.0f )
+	{
+		matRotation = m_state.matRotation;
+		return;
+	}
+
+	const Quaternion qRotation = QuaternionSlerp( m_state.qPreviousOrientation,
+												  m_state.qOrientation, m_interpolation );
+	Mat3RotationQuaternion( matRotation, qRotation );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetBounds()
+// Desc: Finds a world-space box around the vehicle mesh
+//------------------------------------------------------------------------------
+void Vehicle::GetBounds( Vector3& vMin, Vector3& vMax ) const
+{
+	Affine matWorld;
+	GetWorldMatrix( matWorld );
+
+	for( int corner = 0; corner < 8; ++corner )
+	{
+		const Vector3 vCorner( ( corner & 1 ) ? m_vMeshMax.x : m_vMeshMin.x,
+							   ( corner & 2 ) ? m_vMeshMax.y : m_vMeshMin.y,
+							   ( corner & 4 ) ? m_vMeshMax.z : m_vMeshMin.z );
+		const Vector3 vWorld = Vec3TransformCoord( vCorner, matWorld );
+
+		if( corner == 0 )
+		{
+			vMin = vWorld;
+			vMax = vWorld;
+		}
+		else
+		{
+			vMin = Vec3Minimize( vMin, vWorld );
+			vMax = Vec3Maximize( vMax, vWorld );
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: GetShadowBounds()
+// Desc: Finds a world-space box around the vehicle and its shadow volume, which
+//		 is the mesh's silhouette pushed away from the light
+//------------------------------------------------------------------------------
+void Vehicle::GetShadowBounds( const Vector3& vLight, Vector3& vMin, Vector3& vMax ) const
+{
+	GetBounds( vMin, vMax );
+
+	//the volume is built from the light vector as it is, without normalising
+	//it, in mesh space - the world matrix rotates the extrusion back to the
+	//light's direction and scales it
+	const Vector3 vExtrusion = ShadowVolume::GetExtrusion( vLight ) * MESH_SCALE;
+
+	vMin = Vec3Minimize( vMin, vMin + vExtrusion );
+	vMax = Vec3Maximize( vMax, vMax + vExtrusion );
+}
+
 //------------------------------------------------------------------------------
 // Name: UpdateShadowVolume()
 // Desc: Rebuilds the shadow volume for the current position
 //------------------------------------------------------------------------------
-HRESULT Vehicle::UpdateShadowVolume( const Scene& scene, const bool showVolumes )
+HRESULT Vehicle::UpdateShadowVolume( const Vector3& vLight, const bool showVolumes )
 {
 	m_shadowVolume.ShowVolumes( showVolumes );
+	m_shadowVolume.Reset();
+	if( m_meshIndices.empty() )
+		return S_OK;
+
+	//transform light into object space - the inverse of a rotation is its
+	//transpose
+	Matrix3 matRotation;
+	GetRenderRotation( matRotation );
+	const Vector3 vObjectLight = Vec3TransformTranspose( vLight, matRotation );
+
+	return m_shadowVolume.BuildFromMesh( &m_meshVertices[ 0 ], &m_meshIndices[ 0 ],
+										 DWORD( m_meshIndices.size() / 3 ), vObjectLight );
+}
 
-	//transform light into object space
-	D3DXMATRIX m;
-	D3DXMatrixInverse( &m, NULL, &m_matRotation );
+//------------------------------------------------------------------------------
+// Name: SetIntegrator()
+// Desc: Picks the integrator DoPhysics() steps with. Those that need the forces
+//		 again part of the way through a step find them with the contact the
+//		 step started with.
+//------------------------------------------------------------------------------
+void Vehicle::SetIntegrator( const Integrator integrator )
+{
+	if( integrator < 0 || integrator >= NUM_INTEGRATORS )
+		m_integrator = INTEGRATOR_EXPLICIT_EULER;
+	else
+		m_integrator = integrator;
+}
 
-    D3DXVECTOR3 vL = scene.GetLight( 0 ).GetPosition();
-	D3DXVECTOR3 vLight;
-	vLight.x = vL.x*m._11 + vL.y*m._21 + vL.z*m._31 + m._41;
-	vLight.y = vL.x*m._12 + vL.y*m._22 + vL.z*m._32 + m._42;
-	vLight.z = vL.x*m._13 + vL.y*m._23 + vL.z*m._33 + m._43;
+//------------------------------------------------------------------------------
+// Name: GetIntegratorName()
+// Desc: Retrieves a name for an integrator, to report it by
+//------------------------------------------------------------------------------
+const char* Vehicle::GetIntegratorName( const Integrator integrator )
+{
+	if( integrator < 0 || integrator >= NUM_INTEGRATORS )
+		return "unknown";
+	return INTEGRATOR_NAMES[ integrator ];
+}
 
-	m_shadowVolume.Reset();
-	m_shadowVolume.BuildFromMesh( m_pMesh, vLight );
+//------------------------------------------------------------------------------
+// Name: struct Vehicle::ExplicitEulerPolicy
+// Desc: Steps with IntegrateExplicitEuler()
+//------------------------------------------------------------------------------
+struct Vehicle::ExplicitEulerPolicy
+{
+	static inline void Integrate( Vehicle& vehicle, const float timeInterval,
+								  const Vector3& vForce, const Vector3& vTorque )
+	{
+		vehicle.IntegrateExplicitEuler( timeInterval, vForce, vTorque );
+	}
+};
 
-	return S_OK;
-}
+//------------------------------------------------------------------------------
+// Name: struct Vehicle::SymplecticEulerPolicy
+// Desc: Steps with IntegrateSymplecticEuler()
+//------------------------------------------------------------------------------
+struct Vehicle::SymplecticEulerPolicy
+{
+	static inline void Integrate( Vehicle& vehicle, const float timeInterval,
+								  const Vector3& vForce, const Vector3& vTorque )
+	{
+		vehicle.IntegrateSymplecticEuler( timeInterval, vForce, vTorque );
+	}
+};
+
+//------------------------------------------------------------------------------
+// Name: struct Vehicle::VelocityVerletPolicy
+// Desc: Steps with IntegrateVelocityVerlet()
+//------------------------------------------------------------------------------
+struct Vehicle::VelocityVerletPolicy
+{
+	static inline void Integrate( Vehicle& vehicle, const float timeInterval,
+								  const Vector3& vForce, const Vector3& vTorque )
+	{
+		vehicle.IntegrateVelocityVerlet( timeInterval, vForce, vTorque );
+	}
+};
+
+//------------------------------------------------------------------------------
+// Name: struct Vehicle::RK2Policy
+// Desc: Steps with IntegrateRK2()
+//------------------------------------------------------------------------------
+struct Vehicle::RK2Policy
+{
+	static inline void Integrate( Vehicle& vehicle, const float timeInterval,
+								  const Vector3& vForce, const Vector3& vTorque )
+	{
+		vehicle.IntegrateRK2( timeInterval, vForce, vTorque );
+	}
+};
 
 //------------------------------------------------------------------------------
 // Name: DoPhysics()
-// Desc: Runs the physics simulation for the vehicle by one frame
+// Desc: Runs the physics simulation for the vehicle by one step
 //------------------------------------------------------------------------------
 void Vehicle::DoPhysics( const float timeInterval, const Terrain* pTerrain,
 						 const bool forwardThrust, const bool reverseThrust,
 						 const bool leftThrust, const bool rightThrust )
 {
-	//simulation constants
-	const static float GRAVITY = 100.0f;
-	const static float LINEAR_THRUST = 40000.0f;
-	const static float ANGULAR_THRUST = 500.0f;
-	const static float LINEAR_AR = 30.0f;
-	const static float ANGULAR_AR = 1000.0f;
-	const static float HOVER_HEIGHT = 1.0f;
-	const static float SUPPORT_HEIGHT = HOVER_HEIGHT - 0.5f;
+	//keep the state this step starts from, to draw between the two
+	m_state.vPreviousPosition		= m_state.vPosition;
+	m_state.qPreviousOrientation	= m_state.qOrientation;
 
-	//vectors needed for physics calculations, don't change these...
-	const static D3DXVECTOR4 vGravity( 0.0f, -GRAVITY, 0.0f, 1.0f );
+	//a sleeping vehicle stays exactly where it is until it is given input
+	const bool anyThrust = forwardThrust || reverseThrust || leftThrust || rightThrust;
+	if( m_state.isAsleep )
+	{
+		if( ! anyThrust )
+			return;
+		Wake();
+	}
 
-	const static D3DXVECTOR4 vLinearThrustBody( 0.0f, 0.0f, LINEAR_THRUST, 1.0f );
-	D3DXVECTOR4 vLinearThrust;
-	D3DXVec4Transform( &vLinearThrust, &vLinearThrustBody, &m_matRotation );
+	//the collision grid is only tested where each step starts, so a step that
+	//could carry it into the terrain is split into shorter ones
+	const int numSubsteps = m_substepping ? GetNumSubsteps( timeInterval, pTerrain ) : 1;
 
-	const static D3DXVECTOR4 vAngularThrustBody( ANGULAR_THRUST, 0.0f, 0.0f, 1.0f );
-	D3DXVECTOR4 vAngularThrust;
-	D3DXVec4Transform( &vAngularThrust, &vAngularThrustBody, &m_matRotation );
-	const static D3DXVECTOR4 vAngularTorque( 0.0f, 2.0f * ANGULAR_THRUST * SIZE_Z, 0.0f, 1.0f );
+	//the integrator is chosen once here, not for each substep
+	if( m_integrator == INTEGRATOR_SYMPLECTIC_EULER )
+	{
+		StepSubsteps<SymplecticEulerPolicy>( timeInterval, numSubsteps, pTerrain, forwardThrust,
+											 reverseThrust, leftThrust, rightThrust );
+	}
+	else if( m_integrator == INTEGRATOR_VELOCITY_VERLET )
+	{
+		StepSubsteps<VelocityVerletPolicy>( timeInterval, numSubsteps, pTerrain, forwardThrust,
+											reverseThrust, leftThrust, rightThrust );
+	}
+	else if( m_integrator == INTEGRATOR_RK2 )
+	{
+		StepSubsteps<RK2Policy>( timeInterval, numSubsteps, pTerrain, forwardThrust,
+								 reverseThrust, leftThrust, rightThrust );
+	}
+	else
+	{
+		StepSubsteps<ExplicitEulerPolicy>( timeInterval, numSubsteps, pTerrain, forwardThrust,
+										   reverseThrust, leftThrust, rightThrust );
+	}
 
-	const D3DXVECTOR4
-		vLinearVelocitySq(  m_vLinearVelocity[ 0 ] * fabsf( m_vLinearVelocity[ 0 ] ),
-							m_vLinearVelocity[ 1 ] * fabsf( m_vLinearVelocity[ 1 ] ),
-							m_vLinearVelocity[ 2 ] * fabsf( m_vLinearVelocity[ 2 ] ), 1.0f );
+	UpdateSleep( timeInterval, anyThrust );
+}
 
-	const static D3DXVECTOR3 vUp( 0.0f, 1.0f, 0.0f );
-	D3DXVECTOR4 vNormal;
-	D3DXVec3Transform( &vNormal, &vUp, &m_matRotation );
-	D3DXVECTOR3 vNormal3( vNormal[ 0 ], vNormal[ 1 ], vNormal[ 2 ] );
+//------------------------------------------------------------------------------
+// Name: StepSubsteps()
+// Desc: Steps the vehicle through the time interval in equal substeps, with
+//		 the integrator the policy type stands for
+//------------------------------------------------------------------------------
+template<class IntegratorPolicy>
+void Vehicle::StepSubsteps( const float timeInterval, const int numSubsteps,
+							const Terrain* pTerrain, const bool forwardThrust,
+							const bool reverseThrust, const bool leftThrust,
+							const bool rightThrust )
+{
+	const float substep = timeInterval / float( numSubsteps );
+	for( int step = 0; step < numSubsteps; ++step )
+	{
+		Step<IntegratorPolicy>( substep, pTerrain, forwardThrust, reverseThrust, leftThrust,
+								rightThrust );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: UpdateSleep()
+// Desc: Counts the steps the vehicle has been still for, and puts it to sleep
+//		 when there are enough. The distance it actually moved is used rather
+//		 than its velocity, as the velocity left after a step always holds the
+//		 gravity the supports take out again at the start of the next one.
+//------------------------------------------------------------------------------
+void Vehicle::UpdateSleep( const float timeInterval, const bool anyThrust )
+{
+	const Vector3 vMove = m_state.vPosition - m_state.vPreviousPosition;
+	const float moveSq = ( vMove.x * vMove.x ) + ( vMove.y * vMove.y ) + ( vMove.z * vMove.z );
+	const float maxMove = SLEEP_SPEED * timeInterval;
+
+	const Vector3& w = m_state.vAngularVelocity;
+	const float angularSpeedSq = ( w.x * w.x ) + ( w.y * w.y ) + ( w.z * w.z );
+
+	if( anyThrust || ! m_state.isOnGround || moveSq > maxMove * maxMove ||
+		angularSpeedSq > SLEEP_ANGULAR_SPEED * SLEEP_ANGULAR_SPEED )
+	{
+		m_state.sleepSteps = 0;
+		return;
+	}
 
-	//calculate forces...
-	D3DXVECTOR4 vForce( 0.0f, 0.0f, 0.0f, 1.0f );
-	D3DXVECTOR4 vTorque( 0.0f, 0.0f, 0.0f, 0.0f );
+	if( ++m_state.sleepSteps < SLEEP_STEPS )
+		return;
+
+	//so that it wakes from rest
+	m_state.isAsleep = true;
+	m_state.vLinearVelocity		= Vector3( 0.0f, 0.0f, 0.0f );
+	m_state.vAngularMomentum	= Vector3( 0.0f, 0.0f, 0.0f );
+	UpdateAngularVelocity();
+}
+
+//------------------------------------------------------------------------------
+// Name: GetNumSubsteps()
+// Desc: Conservative advancement - finds a box that holds every collision
+//		 point for the whole step and, only if the terrain under it rises to
+//		 within hover height of its bottom, splits the step by the distance
+//		 the points could move. The centre moves in a straight line at the
+//		 velocity it starts with; a point can be a little further from that
+//		 line for the vehicle turning and for thrust and gravity changing its
+//		 velocity in later substeps. Air resistance only ever slows it.
+//------------------------------------------------------------------------------
+int Vehicle::GetNumSubsteps( const float timeInterval, const Terrain* pTerrain ) const
+{
+	const float radius = 0.5f * sqrtf( ( SIZE_X * SIZE_X ) + ( SIZE_Y * SIZE_Y ) +
+									   ( SIZE_Z * SIZE_Z ) );
+	const Vector3& w = m_state.vAngularVelocity;
+	const float angularSpeed = sqrtf( ( w.x * w.x ) + ( w.y * w.y ) + ( w.z * w.z ) );
+	const float maxAcceleration = ( 2.0f * GRAVITY ) +
+								  ( ( LINEAR_THRUST + ANGULAR_THRUST ) / m_mass );
+	const float drift = ( angularSpeed * radius * timeInterval ) +
+						( 0.5f * maxAcceleration * timeInterval * timeInterval );
+	const float reach = radius + drift;
+
+	const Vector3 vStart = GetPosition();
+	const Vector3 vMove = GetVelocity() * timeInterval;
+	const Vector3 vEnd = vStart + vMove;
+
+	//at normal speeds there is nothing to split, and no need to look
+	const float distance = Vec3Length( vMove ) + drift;
+	if( distance <= MAX_SWEEP_DISTANCE )
+		return 1;
+
+	const float lowest = min( vStart.y, vEnd.y ) - reach;
+	const float terrainHeight = pTerrain->GetMaxHeight( min( vStart.x, vEnd.x ) - reach,
+														min( vStart.z, vEnd.z ) - reach,
+														max( vStart.x, vEnd.x ) + reach,
+														max( vStart.z, vEnd.z ) + reach );
+	if( lowest > terrainHeight + HOVER_HEIGHT )
+		return 1;
+
+	const int numSubsteps = int( ceilf( distance / MAX_SWEEP_DISTANCE ) );
+	return min( numSubsteps, MAX_SUBSTEPS );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetTerrainDepth()
+// Desc: Finds how deep the collision grid is in the terrain, as Step() would
+//		 find it at the start of the next step
+//------------------------------------------------------------------------------
+float Vehicle::GetTerrainDepth( const Terrain* pTerrain ) const
+{
+	float depth = 0.0f;
+	for( int x = 0; x < POINTS_PER_EDGE; ++x )
+	{
+		for( int z = 0; z < POINTS_PER_EDGE; ++z )
+		{
+			const Vector3 vPoint = Vec3Transform( m_collisionPoints[ x ][ z ], m_state.matRotation ) +
+								   m_state.vPosition;
+			const float terrainHeight = pTerrain->GetHeightMapPoint( vPoint[ 0 ], vPoint[ 2 ] );
+			depth = max( depth, terrainHeight - vPoint[ 1 ] );
+		}
+	}
 
-	//terrain collision forces for each point in the collision grid
+	return depth;
+}
+
+//------------------------------------------------------------------------------
+// Name: Step()
+// Desc: Tests the collision grid against the terrain where the vehicle is, then
+//		 integrates over the time interval with the policy type's integrator
+//------------------------------------------------------------------------------
+template<class IntegratorPolicy>
+void Vehicle::Step( const float timeInterval, const Terrain* pTerrain,
+					const bool forwardThrust, const bool reverseThrust,
+					const bool leftThrust, const bool rightThrust )
+{
+	//the vehicle's up vector is the second row of its rotation
+	const Matrix3& r = m_state.matRotation;
+	const Vector3 vNormal( r( 1, 0 ), r( 1, 1 ), r( 1, 2 ) );
+
+	//the hover force at each point - the tuning has always had a third of the
+	//mass taken off the weight the point holds up, which the four-component
+	//product this was first written with let in through the normal's w of 1
+	const float hover = ( ( GRAVITY * m_mass / float( POINTS_PER_EDGE ) ) * vNormal.y ) -
+						( m_mass / float( POINTS_PER_EDGE ) );
+
+	//the forces are found from the state the step starts in, before the
+	//collision grid changes it
+	const Vector3 vStartVelocity = m_state.vLinearVelocity;
+	const Matrix3 matStartRotation = m_state.matRotation;
+
+	m_controls.forwardThrust	= forwardThrust;
+	m_controls.reverseThrust	= reverseThrust;
+	m_controls.leftThrust		= leftThrust;
+	m_controls.rightThrust		= rightThrust;
+	m_controls.nearTerrain		= false;
+
+	//terrain collision for each point in the collision grid
 	float moveHeight = 0.0f;
-	bool haveAppliedUpthrust = false;
-	bool nearTerrain = false;
-	m_isOnGround = false;
+	m_state.isOnGround = false;
 
 	for( int x = 0; x < POINTS_PER_EDGE; ++x )
 	{
 		for( int z = 0; z < POINTS_PER_EDGE; ++z )
 		{
 			//translate this point to world space
-			D3DXVECTOR4 vPoint = m_collisionPoints[ x ][ z ];
-			D3DXVec4Transform( &vPoint, &vPoint, &m_matRotation );
-			vPoint += m_vPosition;
+			const Vector3 vPoint = Vec3Transform( m_collisionPoints[ x ][ z ], m_state.matRotation ) +
+								   m_state.vPosition;
 
 			//find the heightmap value at this point
 			float terrainHeight = pTerrain->GetHeightMapPoint( vPoint[ 0 ], vPoint[ 2 ] );
@@ -416,59 +796,32 @@ void Vehicle::DoPhysics( const float timeInterval, const Terrain* pTerrain,
 
 			if( terrainDistance < 1.0f )
 			{
-				nearTerrain = true;
+				m_controls.nearTerrain = true;
 			}
 			
 			//do physics on this point
 			if( terrainDistance < HOVER_HEIGHT )
 			{
-				m_isOnGround = true;
-
-				//within hover distance, add a hover force to counteract gravity
-				const static int NUM_POINTS = POINTS_PER_EDGE * POINTS_PER_EDGE;
-				D3DXVECTOR4 vTemp = -vGravity * m_mass / float( POINTS_PER_EDGE );
-                D3DXVECTOR4 vPointForce = vNormal * D3DXVec4Dot( &vTemp, &vNormal );
+				m_state.isOnGround = true;
 
-				//add linear force
-				if( ! haveAppliedUpthrust )
-				{
-                    vForce += vPointForce;
-					haveAppliedUpthrust = true;
-				}
+				//within hover distance, the hover force counteracts gravity
+				const Vector3 vPointForce = vNormal * hover;
 
 				//add an angular displacement
-				D3DXVECTOR3 vPointForce3( vPointForce[ 0 ], vPointForce[ 1 ],
-										  vPointForce[ 2 ] );
-				D3DXVECTOR3 vPointDisplacement3;
-				D3DXVec3Cross( &vPointDisplacement3, &m_collisionVectors[ x ][ z ],
-							   &vPointForce3 );
-				D3DXVECTOR4 vPointDisplacement( vPointDisplacement3[ 0 ],
-												vPointDisplacement3[ 1 ],
-												vPointDisplacement3[ 2 ], 0.0f );
+				Vector3 vPointDisplacement = Vec3Cross( m_collisionVectors[ x ][ z ], vPointForce );
 				
 				//scale displacement
 				vPointDisplacement *= timeInterval;
 				vPointDisplacement *= 0.0002f;
 
-				D3DXMATRIX matTemp;
-				memset( &matTemp, 0, sizeof( matTemp ) );
-				matTemp( 0, 1 ) = -vPointDisplacement[ 2 ];
-				matTemp( 0, 2 ) =  vPointDisplacement[ 1 ];
-				matTemp( 1, 0 ) =  vPointDisplacement[ 2 ];
-				matTemp( 1, 2 ) = -vPointDisplacement[ 0 ];
-				matTemp( 2, 0 ) = -vPointDisplacement[ 1 ];
-				matTemp( 2, 1 ) =  vPointDisplacement[ 0 ];
-				m_matRotation += matTemp * m_matRotation;
+				Rotate( vPointDisplacement );
 			}
 
 			//see if the supports are in contact with the ground
 			if( terrainDistance < SUPPORT_HEIGHT )
 			{
 				//kill velocity along the surface normal
-				D3DXVECTOR3 vVelocity3( - m_vLinearVelocity[ 0 ], - m_vLinearVelocity[ 1 ], - m_vLinearVelocity[ 2 ] );
-				D3DXVECTOR3 vKillVelocity3 = vNormal3 * D3DXVec3Dot( &vVelocity3, &vNormal3 );
-				D3DXVECTOR4 vKillVelocity( vKillVelocity3[ 0 ], vKillVelocity3[ 1 ], vKillVelocity3[ 2 ], 0.0f );
-				m_vLinearVelocity += vKillVelocity;
+				m_state.vLinearVelocity += vNormal * Vec3Dot( -m_state.vLinearVelocity, vNormal );
 			}
 
 			if( terrainDistance < 0.0f )
@@ -480,86 +833,302 @@ void Vehicle::DoPhysics( const float timeInterval, const Terrain* pTerrain,
 		}
 	}
 	//make sure we don't penetrate the terrain
-	m_vPosition -= D3DXVECTOR4( 0.0f, moveHeight, 0.0f, 0.0f );
+	m_state.vPosition.y -= moveHeight;
+
+	Vector3 vForce, vTorque;
+	GetForces( vStartVelocity, m_state.vAngularVelocity, matStartRotation, vForce, vTorque );
+	IntegratorPolicy::Integrate( *this, timeInterval, vForce, vTorque );
+
+	//cap position to keep vehicle on the terrain (relative to the floating origin)
+	float minX, minZ, maxX, maxZ;
+	pTerrain->GetLocalBounds( 5.0f, minX, minZ, maxX, maxZ );
+	if( m_state.vPosition[ 0 ] < minX ) m_state.vPosition[ 0 ] = minX;
+	if( m_state.vPosition[ 0 ] > maxX ) m_state.vPosition[ 0 ] = maxX;
+	if( m_state.vPosition[ 2 ] < minZ ) m_state.vPosition[ 2 ] = minZ;
+	if( m_state.vPosition[ 2 ] > maxZ ) m_state.vPosition[ 2 ] = maxZ;
+}
+
+//------------------------------------------------------------------------------
+// Name: GetForces()
+// Desc: Finds the force and torque on the vehicle moving and turning at the
+//		 given velocities, with the given rotation, and with the controls and
+//		 contact the step started with
+//------------------------------------------------------------------------------
+void Vehicle::GetForces( const Vector3& vVelocity, const Vector3& vAngularVelocity,
+						 const Matrix3& matRotation, Vector3& vForce, Vector3& vTorque ) const
+{
+	const StepControls& controls = m_controls;
+
+	//vectors needed for physics calculations, don't change these...
+	const static Vector3 vGravity( 0.0f, -GRAVITY, 0.0f );
+
+	//the thrusts act along the body's z- and x-axes, the third and first rows
+	//of the rotation
+	const Matrix3& r = matRotation;
+	Vector3 vLinearThrust( LINEAR_THRUST * r( 2, 0 ), LINEAR_THRUST * r( 2, 1 ),
+						   LINEAR_THRUST * r( 2, 2 ) );
+	const Vector3 vAngularThrust( ANGULAR_THRUST * r( 0, 0 ), ANGULAR_THRUST * r( 0, 1 ),
+								  ANGULAR_THRUST * r( 0, 2 ) );
+	const static Vector3 vAngularTorque( 0.0f, 2.0f * ANGULAR_THRUST * SIZE_Z, 0.0f );
+
+	const Vector3 vLinearVelocitySq( vVelocity.x * fabsf( vVelocity.x ),
+									 vVelocity.y * fabsf( vVelocity.y ),
+									 vVelocity.z * fabsf( vVelocity.z ) );
+
+	vForce = Vector3( 0.0f, 0.0f, 0.0f );
+	vTorque = Vector3( 0.0f, 0.0f, 0.0f );
+
+	//hover force, once for however many points are within hover distance,
+	//with the third of the mass off it that Step() explains
+	if( m_state.isOnGround )
+	{
+		const Vector3 vNormal( r( 1, 0 ), r( 1, 1 ), r( 1, 2 ) );
+		const float hover = ( ( GRAVITY * m_mass / float( POINTS_PER_EDGE ) ) * vNormal.y ) -
+							( m_mass / float( POINTS_PER_EDGE ) );
+		vForce += vNormal * hover;
+	}
 
 	//linear force
 	vForce += vGravity * m_mass;
-	if( !nearTerrain ) vLinearThrust[ 1 ] = 0.0f;
-	if( forwardThrust ) vForce += vLinearThrust;	//engine thrust
-	if( reverseThrust ) vForce -= vLinearThrust;
-	if( leftThrust ) vForce -= vAngularThrust;		//sideways thrust caused by turning
-	if( rightThrust ) vForce += vAngularThrust;
+	if( !controls.nearTerrain ) vLinearThrust.y = 0.0f;
+	if( controls.forwardThrust ) vForce += vLinearThrust;	//engine thrust
+	if( controls.reverseThrust ) vForce -= vLinearThrust;
+	if( controls.leftThrust ) vForce -= vAngularThrust;		//sideways thrust caused by turning
+	if( controls.rightThrust ) vForce += vAngularThrust;
 	vForce += ( -vLinearVelocitySq ) * LINEAR_AR;	//air resistance
 	
 	//torque
-	if( leftThrust ) vTorque += vAngularTorque;
-	if( rightThrust ) vTorque -= vAngularTorque;
-	vTorque += ( -m_vAngularVelocity ) * ANGULAR_AR;	//air resistance
+	if( controls.leftThrust ) vTorque += vAngularTorque;
+	if( controls.rightThrust ) vTorque -= vAngularTorque;
+	vTorque += ( -vAngularVelocity ) * ANGULAR_AR;	//air resistance
+}
+
+//------------------------------------------------------------------------------
+// Name: IntegrateExplicitEuler()
+// Desc: Moves at the velocities the step starts with, then changes them
+//------------------------------------------------------------------------------
+void Vehicle::IntegrateExplicitEuler( const float timeInterval, const Vector3& vForce,
+									  const Vector3& vTorque )
+{
+	Drift( timeInterval, m_state.vLinearVelocity, m_state.vAngularVelocity );
+	Kick( timeInterval, vForce, vTorque );
+}
+
+//------------------------------------------------------------------------------
+// Name: IntegrateSymplecticEuler()
+// Desc: Changes the velocities, then moves at the new ones
+//------------------------------------------------------------------------------
+void Vehicle::IntegrateSymplecticEuler( const float timeInterval, const Vector3& vForce,
+										const Vector3& vTorque )
+{
+	Kick( timeInterval, vForce, vTorque );
+	Drift( timeInterval, m_state.vLinearVelocity, m_state.vAngularVelocity );
+	UpdateAngularVelocity();
+}
+
+//------------------------------------------------------------------------------
+// Name: IntegrateVelocityVerlet()
+// Desc: Half the change in velocity from the forces at the start, the move at
+//		 the velocities halfway, and the other half from the forces at the end
+//------------------------------------------------------------------------------
+void Vehicle::IntegrateVelocityVerlet( const float timeInterval, const Vector3& vForce,
+									   const Vector3& vTorque )
+{
+	Kick( timeInterval * 0.5f, vForce, vTorque );
+	Drift( timeInterval, m_state.vLinearVelocity, m_state.vAngularVelocity );
+	UpdateAngularVelocity();
+
+	Vector3 vEndForce, vEndTorque;
+	GetForces( m_state.vLinearVelocity, m_state.vAngularVelocity, m_state.matRotation,
+			   vEndForce, vEndTorque );
+	Kick( timeInterval * 0.5f, vEndForce, vEndTorque );
+}
+
+//------------------------------------------------------------------------------
+// Name: IntegrateRK2()
+// Desc: The midpoint method - a trial half step finds the velocities and forces
+//		 halfway, and the whole step is taken from the start with those
+//------------------------------------------------------------------------------
+void Vehicle::IntegrateRK2( const float timeInterval, const Vector3& vForce,
+							const Vector3& vTorque )
+{
+	const VehiclePhysicsState start = m_state;
+	Drift( timeInterval * 0.5f, m_state.vLinearVelocity, m_state.vAngularVelocity );
+	Kick( timeInterval * 0.5f, vForce, vTorque );
+
+	Vector3 vMidForce, vMidTorque;
+	GetForces( m_state.vLinearVelocity, m_state.vAngularVelocity, m_state.matRotation,
+			   vMidForce, vMidTorque );
+	const Vector3 vMidVelocity = m_state.vLinearVelocity;
+	const Vector3 vMidAngularVelocity = m_state.vAngularVelocity;
+
+	m_state = start;
+	Drift( timeInterval, vMidVelocity, vMidAngularVelocity );
+	Kick( timeInterval, vMidForce, vMidTorque );
+}
+
+//------------------------------------------------------------------------------
+// Name: Drift()
+// Desc: Moves and turns the vehicle at the given velocities. The angular
+//		 velocity is left as it was, for the caller to bring up to date.
+//------------------------------------------------------------------------------
+void Vehicle::Drift( const float timeInterval, const Vector3& vVelocity,
+					 const Vector3& vAngularVelocity )
+{
+	m_state.vPosition += vVelocity * timeInterval;
 
-	//integrate quantities...
-	//linear velocity
-	D3DXVECTOR4 vTemp = m_vLinearVelocity * timeInterval;
-	m_vPosition += vTemp;
-	m_vPosition[ 3 ] = 1.0f;
+	Rotate( vAngularVelocity * timeInterval );
+}
 
+//------------------------------------------------------------------------------
+// Name: Kick()
+// Desc: Changes the velocity and angular momentum by the given force and
+//		 torque over the time interval
+//------------------------------------------------------------------------------
+void Vehicle::Kick( const float timeInterval, const Vector3& vForce, const Vector3& vTorque )
+{
 	//linear acceleration
-	vTemp = vForce / m_mass;
+	Vector3 vTemp = vForce / m_mass;
 	vTemp *= timeInterval;
-    m_vLinearVelocity += vTemp;
-	m_vLinearVelocity[ 3 ] = 1.0f;
-
-	//angular velocity
-	D3DXMATRIX matTemp;
-	memset( &matTemp, 0, sizeof( matTemp ) );
-	matTemp( 0, 1 ) = -m_vAngularVelocity[ 2 ];
-	matTemp( 0, 2 ) = m_vAngularVelocity[ 1 ];
-	matTemp( 1, 0 ) = m_vAngularVelocity[ 2 ];
-	matTemp( 1, 2 ) = -m_vAngularVelocity[ 0 ];
-	matTemp( 2, 0 ) = -m_vAngularVelocity[ 1 ];
-	matTemp( 2, 1 ) = m_vAngularVelocity[ 0 ];
-	matTemp *= timeInterval;
-	m_matRotation += matTemp * m_matRotation;
+	m_state.vLinearVelocity += vTemp;
 
 	//torque
 	vTemp = vTorque * timeInterval;
-	m_vAngularMomentum += vTemp;
-	m_vAngularMomentum[ 3 ] = 1.0f;
-
-	//reorthogonalise the rotation matrix
-	D3DXVECTOR3 row0( m_matRotation( 0, 0 ), m_matRotation( 0, 1 ), m_matRotation( 0, 2 ) );
-	D3DXVECTOR3 row1( m_matRotation( 1, 0 ), m_matRotation( 1, 1 ), m_matRotation( 1, 2 ) );
-	D3DXVECTOR3 row2( m_matRotation( 2, 0 ), m_matRotation( 2, 1 ), m_matRotation( 2, 2 ) );
-
-	D3DXVec3Normalize( &row0, &row0 );
-	D3DXVec3Cross( &row2, &row0, &row1 );
-	D3DXVec3Normalize( &row2, &row2 );
-	D3DXVec3Cross( &row1, &row2, &row0 );
-	D3DXVec3Normalize( &row1, &row1 );
-
-	m_matRotation( 0, 0 ) = row0[ 0 ];
-	m_matRotation( 0, 1 ) = row0[ 1 ];
-	m_matRotation( 0, 2 ) = row0[ 2 ];
-	m_matRotation( 1, 0 ) = row1[ 0 ];
-	m_matRotation( 1, 1 ) = row1[ 1 ];
-	m_matRotation( 1, 2 ) = row1[ 2 ];
-	m_matRotation( 2, 0 ) = row2[ 0 ];
-	m_matRotation( 2, 1 ) = row2[ 1 ];
-	m_matRotation( 2, 2 ) = row2[ 2 ];
-
-	//calculate auxiliary quanitites...
-	//world-space inertia tensor
-	D3DXMATRIX matRotationTranspose;
-	D3DXMatrixTranspose( &matRotationTranspose, &m_matRotation );
-	D3DXMatrixMultiply( &m_matWorldTensor, &m_matRotation, &m_matInverseTensor );
-	D3DXMatrixMultiply( &m_matWorldTensor, &m_matWorldTensor, &matRotationTranspose );
-
-	//angular velocity
-	D3DXVec4Transform( &m_vAngularVelocity, &m_vAngularMomentum, &m_matWorldTensor );
-
-	//cap position to keep vehicle on the terrain
-	float maxDisplacement = pTerrain->GetTerrainSize() - 5.0f;
-	if( m_vPosition[ 0 ] < 5.0f ) m_vPosition[ 0 ] = 5.0f;
-	if( m_vPosition[ 0 ] > maxDisplacement ) m_vPosition[ 0 ] = maxDisplacement;
-	if( m_vPosition[ 2 ] < 5.0f ) m_vPosition[ 2 ] = 5.0f;
-	if( m_vPosition[ 2 ] > maxDisplacement ) m_vPosition[ 2 ] = maxDisplacement;
+	m_state.vAngularMomentum += vTemp;
+
+	//calculate auxiliary quanitites
+	UpdateAngularVelocity();
+}
+
+//------------------------------------------------------------------------------
+// Name: Rotate()
+// Desc: Turns the vehicle through a rotation vector (the axis scaled by the
+//		 angle) with the exponential map. The turn is in the same sense as the
+//		 first-order skew-symmetric matrix update this replaces, which D3DX's
+//		 quaternions see as minus the angle.
+//------------------------------------------------------------------------------
+void Vehicle::Rotate( const Vector3& vRotation )
+{
+	const float angleSq = ( vRotation.x * vRotation.x ) + ( vRotation.y * vRotation.y ) +
+						  ( vRotation.z * vRotation.z );
+
+	//cos( angle / 2 ) and sin( angle / 2 ) / angle - for the small turns of a
+	//step the series are exact to float precision, and need no square root
+	float cosHalf, sinHalf;
+	if( angleSq < 0.01f )
+	{
+		cosHalf = 1.0f - ( angleSq / 8.0f ) + ( angleSq * angleSq / 384.0f );
+		sinHalf = 0.5f - ( angleSq / 48.0f ) + ( angleSq * angleSq / 3840.0f );
+	}
+	else
+	{
+		const float angle = sqrtf( angleSq );
+		cosHalf = cosf( angle * 0.5f );
+		sinHalf = sinf( angle * 0.5f ) / angle;
+	}
+
+	const Quaternion qTurn( - vRotation.x * sinHalf, - vRotation.y * sinHalf,
+							- vRotation.z * sinHalf, cosHalf );
+	m_state.qOrientation = QuaternionMultiply( qTurn, m_state.qOrientation );
+
+	//rounding errors only change the length of the quaternion, so there is no
+	//need to reorthogonalise anything
+	m_state.qOrientation = QuaternionNormalize( m_state.qOrientation );
+	Mat3RotationQuaternion( m_state.matRotation, m_state.qOrientation );
+}
+
+//------------------------------------------------------------------------------
+// Name: UpdateAngularVelocity()
+// Desc: Finds the angular velocity from the momentum. The world-space inverse
+//		 inertia tensor is R * I^-1 * R^T, and I^-1 is diagonal, so the
+//		 momentum is taken through the three parts in turn instead of building
+//		 the tensor.
+//------------------------------------------------------------------------------
+void Vehicle::UpdateAngularVelocity()
+{
+	const Matrix3& r = m_state.matRotation;
+	const Vector3& l = m_state.vAngularMomentum;
+
+	const Vector3 vBody(
+		m_vInverseInertia.x * ( ( l.x * r( 0, 0 ) ) + ( l.y * r( 1, 0 ) ) + ( l.z * r( 2, 0 ) ) ),
+		m_vInverseInertia.y * ( ( l.x * r( 0, 1 ) ) + ( l.y * r( 1, 1 ) ) + ( l.z * r( 2, 1 ) ) ),
+		m_vInverseInertia.z * ( ( l.x * r( 0, 2 ) ) + ( l.y * r( 1, 2 ) ) + ( l.z * r( 2, 2 ) ) ) );
+
+	m_state.vAngularVelocity = Vector3(
+		( vBody.x * r( 0, 0 ) ) + ( vBody.y * r( 0, 1 ) ) + ( vBody.z * r( 0, 2 ) ),
+		( vBody.x * r( 1, 0 ) ) + ( vBody.y * r( 1, 1 ) ) + ( vBody.z * r( 1, 2 ) ),
+		( vBody.x * r( 2, 0 ) ) + ( vBody.y * r( 2, 1 ) ) + ( vBody.z * r( 2, 2 ) ) );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetCollisionBox()
+// Desc: Gets the box the vehicle collides with other vehicles as
+//------------------------------------------------------------------------------
+void Vehicle::GetCollisionBox( Vector3& vCentre, Vector3 vAxes[ 3 ],
+							   Vector3& vHalfSize ) const
+{
+	vCentre = m_state.vPosition;
+	for( int axis = 0; axis < 3; ++axis )
+	{
+		vAxes[ axis ] = Vector3( m_state.matRotation( axis, 0 ),
+								 m_state.matRotation( axis, 1 ),
+								 m_state.matRotation( axis, 2 ) );
+	}
+	vHalfSize = Vector3( SIZE_X / 2.0f, SIZE_Y / 2.0f, SIZE_Z / 2.0f );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetPointVelocity()
+// Desc: Finds the world-space velocity of a world-space point on the vehicle.
+//		 Rotate() turns the vehicle the opposite way to its angular velocity,
+//		 about the axis taken through the rotation, so the world-space spin is
+//		 minus that.
+//------------------------------------------------------------------------------
+Vector3 Vehicle::GetPointVelocity( const Vector3& vPoint ) const
+{
+	const Vector3 vSpin = Vec3Transform( m_state.vAngularVelocity, m_state.matRotation );
+	const Vector3 vArm = vPoint - GetPosition();
+
+	return GetVelocity() + Vec3Cross( vArm, vSpin );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetInverseMass()
+// Desc: Finds how much an impulse of 1 along vNormal at vPoint changes the
+//		 velocity of that point along vNormal. In world space the spin is
+//		 m_vInverseInertia times the momentum, on the world axes.
+//------------------------------------------------------------------------------
+float Vehicle::GetInverseMass( const Vector3& vPoint, const Vector3& vNormal ) const
+{
+	const Vector3 vArm = vPoint - GetPosition();
+	const Vector3 vMomentum = Vec3Cross( vArm, vNormal );
+
+	const Vector3 vSpin( vMomentum.x * m_vInverseInertia.x,
+						 vMomentum.y * m_vInverseInertia.y,
+						 vMomentum.z * m_vInverseInertia.z );
+	const Vector3 vTurn = Vec3Cross( vSpin, vArm );
+
+	return ( 1.0f / m_mass ) + Vec3Dot( vTurn, vNormal );
+}
+
+//------------------------------------------------------------------------------
+// Name: ApplyImpulse()
+// Desc: Pushes the vehicle with a world-space impulse at a world-space point.
+//		 The angular momentum is kept in the sense GetPointVelocity() describes,
+//		 so the world-space change is taken back through the rotation, negated.
+//------------------------------------------------------------------------------
+void Vehicle::ApplyImpulse( const Vector3& vImpulse, const Vector3& vPoint )
+{
+	m_state.vLinearVelocity += vImpulse / m_mass;
+
+	const Vector3 vArm = vPoint - GetPosition();
+	const Vector3 vMomentum = Vec3Cross( vArm, vImpulse );
+
+	const Matrix3& r = m_state.matRotation;
+	m_state.vAngularMomentum -= Vector3(
+		( r( 0, 0 ) * vMomentum.x ) + ( r( 0, 1 ) * vMomentum.y ) + ( r( 0, 2 ) * vMomentum.z ),
+		( r( 1, 0 ) * vMomentum.x ) + ( r( 1, 1 ) * vMomentum.y ) + ( r( 1, 2 ) * vMomentum.z ),
+		( r( 2, 0 ) * vMomentum.x ) + ( r( 2, 1 ) * vMomentum.y ) + ( r( 2, 2 ) * vMomentum.z ) );
+
+	UpdateAngularVelocity();
 }
@@ -15,8 +15,11 @@
 //------------------------------------------------------------------------------
 // Included files:
 //------------------------------------------------------------------------------
+#include <vector>
+
 #include "ShadowVolume.h"
 #include "Terrain.h"
+#include "VectorMath.h"
 
 
 //------------------------------------------------------------------------------
@@ -24,6 +27,49 @@
 //------------------------------------------------------------------------------
 class Scene;
 
+//------------------------------------------------------------------------------
+// Name: enum Integrator
+// Desc: The integrators Vehicle::DoPhysics() can step with - its substeps are
+//		 built once for each, and Vehicle::SetIntegrator() picks the one it
+//		 runs. VehicleFleet's kernel only has explicit euler.
+//------------------------------------------------------------------------------
+enum Integrator
+{
+	INTEGRATOR_EXPLICIT_EULER,
+	INTEGRATOR_SYMPLECTIC_EULER,
+	INTEGRATOR_VELOCITY_VERLET,
+	INTEGRATOR_RK2,
+	NUM_INTEGRATORS
+};
+
+//------------------------------------------------------------------------------
+// Name: struct VehiclePhysicsState
+// Desc: Everything a physics step changes, with no pointers or device objects,
+//		 so saving and restoring it is a plain copy
+//------------------------------------------------------------------------------
+struct VehiclePhysicsState
+{
+	Vector3		vPosition;
+	Vector3		vLinearVelocity;
+	Quaternion	qOrientation;
+	Vector3		vAngularMomentum;
+
+	//auxiliary quantities
+	Matrix3	matRotation;		//built from qOrientation
+	Vector3	vAngularVelocity;
+
+	bool isOnGround;	//is the vehicle currently on the ground
+
+	//a vehicle that has sat still for long enough is not stepped until
+	//something wakes it
+	int		sleepSteps;		//steps in a row it has been still for
+	bool	isAsleep;
+
+	//state before the last step, for drawing between steps
+	Vector3		vPreviousPosition;
+	Quaternion	qPreviousOrientation;
+};
+
 //------------------------------------------------------------------------------
 // Name: class Vehicle
 // Desc: The hovercraft object
@@ -33,51 +79,168 @@ class Vehicle
 public:
 	Vehicle();
 
+	#if !defined( HOVERCRAFT_HEADLESS )
 	HRESULT InitDeviceObjects( const LPDIRECT3DDEVICE9 pd3dDevice, const bool dx9Shaders,
 							   const bool twoSidedStencil );
 	HRESULT RestoreDeviceObjects();
 	HRESULT InvalidateDeviceObjects();
 	HRESULT DeleteDeviceObjects();
 
-	HRESULT Render( const Scene& scene, const bool useLight,
+	HRESULT Render( const Scene& scene, const bool useLight, const bool renderMesh,
 					const bool renderShadowVolume ) const;
+	#endif
+
+	//the triangles the shadow volume and bounds are found from, in mesh space -
+	//RestoreDeviceObjects() sets them from the loaded mesh, and a headless
+	//build has to set them itself
+	void SetMesh( const Vector3* pVertices, const int numVertices, const WORD* pIndices,
+				  const int numFaces );
 
-	HRESULT UpdateShadowVolume( const Scene& scene, const bool showVolumes );
+	//vLight is the light's direction, as Light::GetPosition() gives it
+	HRESULT UpdateShadowVolume( const Vector3& vLight, const bool showVolumes );
 
 	void DoPhysics( const float timeInterval, const Terrain* pTerrain,
 					const bool forwardThrust, const bool reverseThrust,
 					const bool leftThrust, const bool rightThrust );
 
-	inline void SetPosition( const D3DXVECTOR3 vPos )
+	//DoPhysics() splits a step that could carry the vehicle into the terrain
+	//unless this is turned off, to see how the integrator does on its own
+	inline void SetSubstepping( const bool substepping ) { m_substepping = substepping; }
+
+	//explicit euler unless this is changed
+	void SetIntegrator( const Integrator integrator );
+	inline Integrator GetIntegrator() const { return m_integrator; }
+	static const char* GetIntegratorName( const Integrator integrator );
+
+	//the vehicle is drawn this fraction of the way from the state before the
+	//last DoPhysics() call to the state after it
+	inline void SetInterpolation( const float interpolation )
+	{
+		m_interpolation = interpolation;
+	}
+
+	inline void SetPosition( const Vector3 vPos )
+	{
+		m_state.vPosition = vPos;
+		m_state.vPreviousPosition = m_state.vPosition;
+	}
+
+	inline Vector3 GetPosition() const { return m_state.vPosition; }
+
+	//the position the vehicle is drawn at
+	inline Vector3 GetRenderPosition() const
 	{
-		m_vPosition = D3DXVECTOR4( vPos[ 0 ], vPos[ 1 ], vPos[ 2 ], 1.0f );
+		return Vec3Lerp( m_state.vPreviousPosition, m_state.vPosition, m_interpolation );
 	}
 
-	inline D3DXVECTOR3 GetPosition() const
+	//called when the floating origin moves by vShift
+	inline void Rebase( const Vector3& vShift )
 	{
-		return D3DXVECTOR3( m_vPosition[ 0 ], m_vPosition[ 1 ], m_vPosition[ 2 ] );
+		m_state.vPosition -= vShift;
+		m_state.vPreviousPosition -= vShift;
 	}
 
-	inline D3DXVECTOR3 GetVelocity() const
+	inline Vector3 GetVelocity() const { return m_state.vLinearVelocity; }
+
+	inline const Quaternion& GetOrientation() const { return m_state.qOrientation; }
+
+	//the body's z-axis, which is the third row of the rotation
+	inline Vector3 GetDirection() const
 	{
-		return D3DXVECTOR3( m_vLinearVelocity[ 0 ],
-							m_vLinearVelocity[ 1 ],
-							m_vLinearVelocity[ 2 ] );
+		const Matrix3& r = m_state.matRotation;
+		return Vec3Normalize( Vector3( r( 2, 0 ), r( 2, 1 ), r( 2, 2 ) ) );
 	}
 
-	inline D3DXVECTOR3 GetDirection() const
+	inline bool IsOnGround() { return m_state.isOnGround; }
+
+	//how far the lowest point of the collision grid is below the terrain, or 0
+	//if none of them is
+	float GetTerrainDepth( const Terrain* pTerrain ) const;
+
+	//a sleeping vehicle wakes by itself on input; anything else that moves it,
+	//or edits the terrain under it, has to wake it
+	inline bool IsAsleep() const { return m_state.isAsleep; }
+	inline void Wake()
 	{
-		D3DXVECTOR4 vTemp( 0.0f, 0.0f, 1.0f, 1.0f );
-		D3DXVec4Transform( &vTemp, &vTemp, &m_matRotation );
-		D3DXVECTOR3 vDirection( vTemp[ 0 ], vTemp[ 1 ], vTemp[ 2 ] );
-		D3DXVec3Normalize( &vDirection, &vDirection );
-		return vDirection;
+		m_state.isAsleep = false;
+		m_state.sleepSteps = 0;
 	}
 
-	inline bool IsOnGround() { return m_isOnGround; }
+	//for snapshots - the state is restored as it was saved, drawing included
+	inline const VehiclePhysicsState& GetPhysicsState() const { return m_state; }
+	inline void SetPhysicsState( const VehiclePhysicsState& state ) { m_state = state; }
+
+	//world-space boxes around the mesh, and the mesh plus its shadow volume
+	void GetBounds( Vector3& vMin, Vector3& vMax ) const;
+	void GetShadowBounds( const Vector3& vLight, Vector3& vMin, Vector3& vMax ) const;
+
+	//the transform from the mesh, and the shadow volume built in mesh space
+	void GetWorldMatrix( Affine& matWorld ) const;
+	inline const ShadowVolume& GetShadowVolume() const { return m_shadowVolume; }
+
+	//contact with other vehicles - the collision box is its centre, its axes,
+	//and half its size along each of them
+	void GetCollisionBox( Vector3& vCentre, Vector3 vAxes[ 3 ], Vector3& vHalfSize ) const;
+	Vector3 GetPointVelocity( const Vector3& vPoint ) const;
+	float GetInverseMass( const Vector3& vPoint, const Vector3& vNormal ) const;
+	void ApplyImpulse( const Vector3& vImpulse, const Vector3& vPoint );
+
+	//moves the vehicle, leaving the state it is drawn from alone
+	inline void Move( const Vector3& vShift ) { m_state.vPosition += vShift; }
 
 private:
+	void GetRenderRotation( Matrix3& matRotation ) const;
+
+	//what a step holds fixed for however many times the integrator finds
+	//the forces
+	struct StepControls
+	{
+		bool forwardThrust, reverseThrust;
+		bool leftThrust, rightThrust;
+		bool nearTerrain;
+	};
+
+	//the integrators as policy types, so the substeps are built once for each
+	//integrator with it inlined - DoPhysics() picks one each call
+	struct ExplicitEulerPolicy;
+	struct SymplecticEulerPolicy;
+	struct VelocityVerletPolicy;
+	struct RK2Policy;
+
+	int GetNumSubsteps( const float timeInterval, const Terrain* pTerrain ) const;
+	template<class IntegratorPolicy>
+	void StepSubsteps( const float timeInterval, const int numSubsteps,
+					   const Terrain* pTerrain, const bool forwardThrust,
+					   const bool reverseThrust, const bool leftThrust,
+					   const bool rightThrust );
+	template<class IntegratorPolicy>
+	void Step( const float timeInterval, const Terrain* pTerrain,
+			   const bool forwardThrust, const bool reverseThrust,
+			   const bool leftThrust, const bool rightThrust );
+	void GetForces( const Vector3& vVelocity, const Vector3& vAngularVelocity,
+					const Matrix3& matRotation, Vector3& vForce, Vector3& vTorque ) const;
+
+	//each integrator advances the vehicle over the time interval from the
+	//forces at the start of the step
+	void IntegrateExplicitEuler( const float timeInterval, const Vector3& vForce,
+								 const Vector3& vTorque );
+	void IntegrateSymplecticEuler( const float timeInterval, const Vector3& vForce,
+								   const Vector3& vTorque );
+	void IntegrateVelocityVerlet( const float timeInterval, const Vector3& vForce,
+								  const Vector3& vTorque );
+	void IntegrateRK2( const float timeInterval, const Vector3& vForce,
+					   const Vector3& vTorque );
+	void Drift( const float timeInterval, const Vector3& vVelocity,
+				const Vector3& vAngularVelocity );
+	void Kick( const float timeInterval, const Vector3& vForce, const Vector3& vTorque );
+
+	void UpdateSleep( const float timeInterval, const bool anyThrust );
+
+	void Rotate( const Vector3& vRotation );
+	void UpdateAngularVelocity();
+
 	//direct3d objects
+	#if !defined( HOVERCRAFT_HEADLESS )
 	LPDIRECT3DDEVICE9		m_pd3dDevice;
 	LPD3DXMESH				m_pMesh;
 	DWORD					m_numMaterials;
@@ -86,10 +249,21 @@ private:
 	LPDIRECT3DVERTEXSHADER9	m_pVSDiffuse;
 	LPDIRECT3DVERTEXDECLARATION9 m_pVSDecl;
 	LPDIRECT3DPIXELSHADER9	m_pPS;
+	#endif
 
 	//stencil shadow volume
 	ShadowVolume m_shadowVolume;
 
+	//scale from the mesh to the world, and the mesh's bounds before it
+	const static float MESH_SCALE;
+	Vector3 m_vMeshMin;
+	Vector3 m_vMeshMax;
+
+	//a copy of the mesh's positions and faces, so the shadow volume can be
+	//built without locking the mesh
+	std::vector<Vector3> m_meshVertices;
+	std::vector<WORD> m_meshIndices;
+
 	//bounding box size
 	const static float SIZE_X;
 	const static float SIZE_Y;
@@ -97,23 +271,24 @@ private:
 
 	//physics simulation
 	float		m_mass;
-    D3DXMATRIX	m_matInverseTensor;	//inverse of the body-space inertia tensor
+	Vector3		m_vInverseInertia;	//the body-space inertia tensor is diagonal
 
-	D3DXVECTOR4	m_vPosition;
-	D3DXVECTOR4	m_vLinearVelocity;
-	D3DXMATRIX	m_matRotation;
-	D3DXVECTOR4	m_vAngularMomentum;
+	VehiclePhysicsState m_state;
+	bool m_substepping;
 
-	//auxiliary quantities
-	D3DXVECTOR4 m_vAngularVelocity;
-	D3DXMATRIX	m_matWorldTensor;	//world-space inertia tensor
+	Integrator m_integrator;
+
+	//what the step in progress holds fixed, for integrators that find the
+	//forces again part of the way through it
+	StepControls m_controls;
 
-	bool m_isOnGround;	//is the vehicle currently on the ground
+	//fraction of the way from the state before the last step to the state after
+	float m_interpolation;
 
 	//collision grid on the base of the object
 	const static int POINTS_PER_EDGE = 3;
-	D3DXVECTOR4 m_collisionPoints[ POINTS_PER_EDGE ][ POINTS_PER_EDGE ];
-	D3DXVECTOR3 m_collisionVectors[ POINTS_PER_EDGE ][ POINTS_PER_EDGE ];
+	Vector3 m_collisionPoints[ POINTS_PER_EDGE ][ POINTS_PER_EDGE ];
+	Vector3 m_collisionVectors[ POINTS_PER_EDGE ][ POINTS_PER_EDGE ];
 
 };
 
@@ -0,0 +1,332 @@
+//------------------------------------------------------------------------------
+// File: VehicleCollisions.cpp
+// Desc: Contact between vehicles, with a sweep-and-prune broadphase
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <float.h>
+#include <math.h>
+
+#include "Vehicle.h"
+#include "VehicleCollisions.h"
+
+
+//------------------------------------------------------------------------------
+// Constants:
+//------------------------------------------------------------------------------
+
+//an edge-edge axis only replaces a face axis when it is this much shallower,
+//so boxes that are nearly lined up keep a face normal from step to step
+const float EDGE_AXIS_BIAS = 0.95f;
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+const float VehicleCollisions::RESTITUTION = 0.3f;
+
+//------------------------------------------------------------------------------
+// Name: ProjectBox()
+// Desc: Finds the radius of a box's projection onto an axis
+//------------------------------------------------------------------------------
+static inline float ProjectBox( const Vector3 vAxes[ 3 ], const Vector3& vHalfSize,
+								const Vector3& vAxis )
+{
+	return ( vHalfSize.x * fabsf( Vec3Dot( vAxes[ 0 ], vAxis ) ) ) +
+		   ( vHalfSize.y * fabsf( Vec3Dot( vAxes[ 1 ], vAxis ) ) ) +
+		   ( vHalfSize.z * fabsf( Vec3Dot( vAxes[ 2 ], vAxis ) ) );
+}
+
+//------------------------------------------------------------------------------
+// Name: FindSupport()
+// Desc: Finds the point of a box furthest along a direction - the middle of a
+//		 face or an edge when one lies square to it
+//------------------------------------------------------------------------------
+static inline Vector3 FindSupport( const Vector3& vCentre, const Vector3 vAxes[ 3 ],
+								   const Vector3& vHalfSize,
+								   const Vector3& vDirection )
+{
+	Vector3 vSupport = vCentre;
+	for( int axis = 0; axis < 3; ++axis )
+	{
+		const float along = Vec3Dot( vAxes[ axis ], vDirection );
+		if( along > 0.01f )
+			vSupport += vAxes[ axis ] * vHalfSize[ axis ];
+		else if( along < -0.01f )
+			vSupport -= vAxes[ axis ] * vHalfSize[ axis ];
+	}
+	return vSupport;
+}
+
+//------------------------------------------------------------------------------
+// Name: VehicleCollisions()
+// Desc: Constructor
+//------------------------------------------------------------------------------
+VehicleCollisions::VehicleCollisions()
+{
+	m_numAxisPairs = 0;
+	m_numBoxPairs = 0;
+	m_numContacts = 0;
+	m_numWakes = 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: Insert()
+// Desc: Adds a vehicle, and returns its handle. It goes on the end of the
+//		 sorted list, and the next update's sort moves it into place.
+//------------------------------------------------------------------------------
+int VehicleCollisions::Insert( Vehicle* pVehicle )
+{
+	int handle;
+	if( m_freeHandles.empty() )
+	{
+		handle = (int)( m_boxes.size() );
+		m_boxes.push_back( Box() );
+	}
+	else
+	{
+		handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	}
+
+	Box& box = m_boxes[ handle ];
+	box.pVehicle = pVehicle;
+	UpdateBox( box );
+
+	Entry entry;
+	entry.minX = box.vMin.x;
+	entry.maxX = box.vMax.x;
+	entry.minZ = box.vMin.z;
+	entry.maxZ = box.vMax.z;
+	entry.handle = handle;
+	m_sorted.push_back( entry );
+
+	return handle;
+}
+
+//------------------------------------------------------------------------------
+// Name: Remove()
+// Desc: Removes a vehicle
+//------------------------------------------------------------------------------
+void VehicleCollisions::Remove( const int handle )
+{
+	for( std::vector<Entry>::iterator it = m_sorted.begin(); it != m_sorted.end(); ++it )
+	{
+		if( it->handle == handle )
+		{
+			m_sorted.erase( it );
+			break;
+		}
+	}
+
+	m_boxes[ handle ].pVehicle = NULL;
+	m_freeHandles.push_back( handle );
+}
+
+//------------------------------------------------------------------------------
+// Name: Update()
+// Desc: Brings the boxes up to date, restores the order of the sorted list,
+//		 and sweeps it for pairs to test
+//------------------------------------------------------------------------------
+void VehicleCollisions::Update()
+{
+	m_numAxisPairs = 0;
+	m_numBoxPairs = 0;
+	m_numContacts = 0;
+	m_numWakes = 0;
+
+	const int numEntries = (int)( m_sorted.size() );
+	for( int i = 0; i < numEntries; ++i )
+	{
+		Box& box = m_boxes[ m_sorted[ i ].handle ];
+		UpdateBox( box );
+		m_sorted[ i ].minX = box.vMin.x;
+		m_sorted[ i ].maxX = box.vMax.x;
+		m_sorted[ i ].minZ = box.vMin.z;
+		m_sorted[ i ].maxZ = box.vMax.z;
+	}
+
+	//insertion sort - the vehicles have barely moved since the last step, so
+	//each entry is at most a few places from where it belongs
+	for( int i = 1; i < numEntries; ++i )
+	{
+		const Entry entry = m_sorted[ i ];
+		int j = i - 1;
+		while( j >= 0 && m_sorted[ j ].minX > entry.minX )
+		{
+			m_sorted[ j + 1 ] = m_sorted[ j ];
+			--j;
+		}
+		m_sorted[ j + 1 ] = entry;
+	}
+
+	//each entry only needs testing against those that start before it ends
+	for( int i = 0; i < numEntries; ++i )
+	{
+		const Entry& entryA = m_sorted[ i ];
+		for( int j = i + 1; j < numEntries && m_sorted[ j ].minX <= entryA.maxX; ++j )
+		{
+			++m_numAxisPairs;
+
+			const Entry& entryB = m_sorted[ j ];
+			if( entryA.minZ > entryB.maxZ || entryB.minZ > entryA.maxZ )
+				continue;
+
+			Box& boxA = m_boxes[ entryA.handle ];
+			Box& boxB = m_boxes[ entryB.handle ];
+			if( boxA.vMin.y > boxB.vMax.y || boxB.vMin.y > boxA.vMax.y )
+				continue;
+
+			//two sleeping vehicles were left apart when they went to sleep
+			if( boxA.pVehicle->IsAsleep() && boxB.pVehicle->IsAsleep() )
+				continue;
+
+			++m_numBoxPairs;
+
+			Vector3 vNormal;
+			float depth;
+			if( FindContact( boxA, boxB, vNormal, depth ) )
+			{
+				++m_numContacts;
+
+				//a vehicle that is hit wakes up
+				if( boxA.pVehicle->IsAsleep() )
+				{
+					boxA.pVehicle->Wake();
+					++m_numWakes;
+				}
+				if( boxB.pVehicle->IsAsleep() )
+				{
+					boxB.pVehicle->Wake();
+					++m_numWakes;
+				}
+
+				ResolveContact( boxA, boxB, vNormal, depth );
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: UpdateBox()
+// Desc: Reads a vehicle's collision box, and finds the world-space box
+//		 around it
+//------------------------------------------------------------------------------
+void VehicleCollisions::UpdateBox( Box& box ) const
+{
+	box.pVehicle->GetCollisionBox( box.vCentre, box.vAxes, box.vHalfSize );
+
+	Vector3 vExtent( 0.0f, 0.0f, 0.0f );
+	for( int axis = 0; axis < 3; ++axis )
+	{
+		const Vector3& vAxis = box.vAxes[ axis ];
+		const float halfSize = box.vHalfSize[ axis ];
+		vExtent += Vector3( fabsf( vAxis.x ), fabsf( vAxis.y ), fabsf( vAxis.z ) ) * halfSize;
+	}
+
+	box.vMin = box.vCentre - vExtent;
+	box.vMax = box.vCentre + vExtent;
+}
+
+//------------------------------------------------------------------------------
+// Name: FindContact()
+// Desc: Tests two boxes against the fifteen axes that could separate them -
+//		 the face normals of each, and the cross products of an edge from each.
+//		 If none do, gives the axis they overlap least on, pointing from A to
+//		 B, and how far they overlap along it.
+//------------------------------------------------------------------------------
+bool VehicleCollisions::FindContact( const Box& boxA, const Box& boxB, Vector3& vNormal,
+									 float& depth ) const
+{
+	const Vector3 vOffset = boxB.vCentre - boxA.vCentre;
+	depth = FLT_MAX;
+
+	for( int test = 0; test < 15; ++test )
+	{
+		Vector3 vAxis;
+		float bias = 1.0f;
+		if( test < 3 )
+		{
+			vAxis = boxA.vAxes[ test ];
+		}
+		else if( test < 6 )
+		{
+			vAxis = boxB.vAxes[ test - 3 ];
+		}
+		else
+		{
+			const int edgeA = ( test - 6 ) / 3;
+			const int edgeB = ( test - 6 ) % 3;
+			vAxis = Vec3Cross( boxA.vAxes[ edgeA ], boxB.vAxes[ edgeB ] );
+
+			//parallel edges give no axis, and their faces have been tested
+			const float lengthSq = Vec3LengthSq( vAxis );
+			if( lengthSq < 1e-6f )
+				continue;
+			vAxis /= sqrtf( lengthSq );
+			bias = EDGE_AXIS_BIAS;
+		}
+
+		const float distance = Vec3Dot( vOffset, vAxis );
+		const float overlap = ProjectBox( boxA.vAxes, boxA.vHalfSize, vAxis ) +
+							  ProjectBox( boxB.vAxes, boxB.vHalfSize, vAxis ) -
+							  fabsf( distance );
+		if( overlap < 0.0f )
+			return false;
+
+		if( overlap < depth * bias )
+		{
+			depth = overlap;
+			vNormal = ( distance < 0.0f ) ? -vAxis : vAxis;
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: ResolveContact()
+// Desc: Stops two touching vehicles closing along the contact normal, and
+//		 moves them apart. The contact point is taken halfway between the
+//		 deepest points of the two boxes.
+//------------------------------------------------------------------------------
+void VehicleCollisions::ResolveContact( Box& boxA, Box& boxB, const Vector3& vNormal,
+										const float depth ) const
+{
+	const Vector3 vSupportA = FindSupport( boxA.vCentre, boxA.vAxes, boxA.vHalfSize, vNormal );
+	const Vector3 vSupportB = FindSupport( boxB.vCentre, boxB.vAxes, boxB.vHalfSize, -vNormal );
+	const Vector3 vPoint = ( vSupportA + vSupportB ) * 0.5f;
+
+	//only an impulse if they are closing - vehicles already moving apart are
+	//just separated
+	const Vector3 vRelative = boxB.pVehicle->GetPointVelocity( vPoint ) -
+								  boxA.pVehicle->GetPointVelocity( vPoint );
+	const float closing = Vec3Dot( vRelative, vNormal );
+	if( closing < 0.0f )
+	{
+		const float inverseMass = boxA.pVehicle->GetInverseMass( vPoint, vNormal ) +
+								  boxB.pVehicle->GetInverseMass( vPoint, vNormal );
+		const Vector3 vImpulse = vNormal * ( - ( 1.0f + RESTITUTION ) * closing / inverseMass );
+		boxA.pVehicle->ApplyImpulse( -vImpulse, vPoint );
+		boxB.pVehicle->ApplyImpulse( vImpulse, vPoint );
+	}
+
+	//the vehicles weigh the same, so each moves half the overlap, and their
+	//boxes follow so later pairs in this sweep see them where they are
+	const Vector3 vShift = vNormal * ( depth * 0.5f );
+	boxA.pVehicle->Move( -vShift );
+	boxB.pVehicle->Move( vShift );
+	boxA.vCentre -= vShift;
+	boxA.vMin -= vShift;
+	boxA.vMax -= vShift;
+	boxB.vCentre += vShift;
+	boxB.vMin += vShift;
+	boxB.vMax += vShift;
+}
@@ -0,0 +1,101 @@
+//------------------------------------------------------------------------------
+// File: VehicleCollisions.h
+// Desc: Contact between vehicles, with a sweep-and-prune broadphase
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_VEHICLECOLLISIONS_H
+#define INCLUSIONGUARD_VEHICLECOLLISIONS_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <vector>
+
+#include "VectorMath.h"
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+class Vehicle;
+
+//------------------------------------------------------------------------------
+// Name: class VehicleCollisions
+// Desc: Finds the vehicles whose collision boxes touch, and pushes them apart.
+//		 The broadphase keeps the vehicles sorted along the x-axis between
+//		 updates, so the insertion sort that restores the order only has the
+//		 few swaps the last step caused to make, and a sweep down the list
+//		 finds every pair whose boxes overlap on that axis. Those pairs are
+//		 tested box against box with the separating axis theorem. Vehicles
+//		 are looked up by the handle Insert() returns.
+//------------------------------------------------------------------------------
+class VehicleCollisions
+{
+public:
+	VehicleCollisions();
+
+	int Insert( Vehicle* pVehicle );
+	void Remove( const int handle );
+
+	//called after each physics step
+	void Update();
+
+	inline unsigned int GetNumVehicles() const { return (unsigned int)( m_sorted.size() ); }
+
+	//from the last Update() - pairs overlapping on the sort axis, pairs given to
+	//the narrowphase, pairs found touching, and sleeping vehicles those woke
+	inline unsigned int GetNumAxisPairs() const { return m_numAxisPairs; }
+	inline unsigned int GetNumBoxPairs() const { return m_numBoxPairs; }
+	inline unsigned int GetNumContacts() const { return m_numContacts; }
+	inline unsigned int GetNumWakes() const { return m_numWakes; }
+
+private:
+	//fraction of the closing speed kept after a contact
+	const static float RESTITUTION;
+
+	//a vehicle's collision box, and the world-space box around it
+	struct Box
+	{
+		Vehicle*	pVehicle;	//NULL if the handle is free
+		Vector3	vCentre;
+		Vector3	vAxes[ 3 ];
+		Vector3	vHalfSize;
+		Vector3	vMin;
+		Vector3	vMax;
+	};
+
+	//the sorted list keeps each vehicle's extent on the sort axis and across
+	//it next to its handle, so the sort and the sweep read nothing else until
+	//a pair overlaps on both
+	struct Entry
+	{
+		float minX, maxX;
+		float minZ, maxZ;
+		int handle;
+	};
+
+	void UpdateBox( Box& box ) const;
+	bool FindContact( const Box& boxA, const Box& boxB, Vector3& vNormal,
+					  float& depth ) const;
+	void ResolveContact( Box& boxA, Box& boxB, const Vector3& vNormal,
+						 const float depth ) const;
+
+	std::vector<Box> m_boxes;
+	std::vector<int> m_freeHandles;
+	std::vector<Entry> m_sorted;
+
+	unsigned int m_numAxisPairs;
+	unsigned int m_numBoxPairs;
+	unsigned int m_numContacts;
+	unsigned int m_numWakes;
+
+};
+
+
+#endif //INCLUSIONGUARD_VEHICLECOLLISIONS_H
@@ -0,0 +1,1312 @@
+//------------------------------------------------------------------------------
+// File: VehicleFleet.cpp
+// Desc: Physics for many hovercraft at once, stored as structure-of-arrays
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <math.h>
+
+#include "Terrain.h"
+#include "VehicleFleet.h"
+#include "WorkerPool.h"
+
+#ifdef FLEET_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+
+//------------------------------------------------------------------------------
+// Constants:
+//------------------------------------------------------------------------------
+
+//the same vehicle and simulation constants as Vehicle and Vehicle::DoPhysics()
+const float FLEET_SIZE_X			= 6.0f;
+const float FLEET_SIZE_Y			= 1.0f;
+const float FLEET_SIZE_Z			= 6.0f;
+const float FLEET_MASS				= 150.0f;
+const float FLEET_GRAVITY			= 100.0f;
+const float FLEET_LINEAR_THRUST		= 40000.0f;
+const float FLEET_ANGULAR_THRUST	= 500.0f;
+const float FLEET_LINEAR_AR			= 30.0f;
+const float FLEET_ANGULAR_AR		= 1000.0f;
+const float FLEET_HOVER_HEIGHT		= 1.0f;
+const float FLEET_SUPPORT_HEIGHT	= FLEET_HOVER_HEIGHT - 0.5f;
+const float FLEET_NEAR_DISTANCE		= 1.0f;
+const float FLEET_DISPLACEMENT		= 0.0002f;
+const float FLEET_SLEEP_SPEED		= 0.25f;
+const float FLEET_SLEEP_ANGULAR_SPEED	= 0.05f;
+const int	FLEET_SLEEP_STEPS		= 120;
+
+//steps between the times each tier is stepped - each is a multiple of the one
+//before, so the tiers stepped are always the nearest few
+const int	TIER_PERIODS[ VehicleFleet::NUM_TIERS ] = { 1, 2, 4 };
+
+//how much of a vehicle's offset from where it is is left after each step,
+//and the offset small enough to drop - a 5m pop fades over about a second,
+//moving it 0.1m a step at first
+const float	POP_FADE		= 0.98f;
+const float	POP_MIN_OFFSET	= 0.001f;
+
+//the four corners of the grid stand in for the edges and centre between them
+//when a mid-range vehicle is turned by the hover force
+const float	MID_TURN_SCALE	= 1.5f;
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+const float VehicleFleet::NEAR_DISTANCE = 100.0f;
+const float VehicleFleet::MID_DISTANCE	= 250.0f;
+
+#ifdef FLEET_USE_SSE
+//------------------------------------------------------------------------------
+// Name: RotationFromQuaternions()
+// Desc: Builds the rows of four rotation matrices, as
+//		 D3DXMatrixRotationQuaternion() does
+//------------------------------------------------------------------------------
+static inline void RotationFromQuaternions( const __m128 q[ 4 ], __m128 r[ 9 ] )
+{
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 x2 = _mm_add_ps( q[ 0 ], q[ 0 ] );
+	const __m128 y2 = _mm_add_ps( q[ 1 ], q[ 1 ] );
+	const __m128 z2 = _mm_add_ps( q[ 2 ], q[ 2 ] );
+	const __m128 xx = _mm_mul_ps( q[ 0 ], x2 );
+	const __m128 yy = _mm_mul_ps( q[ 1 ], y2 );
+	const __m128 zz = _mm_mul_ps( q[ 2 ], z2 );
+	const __m128 xy = _mm_mul_ps( q[ 0 ], y2 );
+	const __m128 xz = _mm_mul_ps( q[ 0 ], z2 );
+	const __m128 yz = _mm_mul_ps( q[ 1 ], z2 );
+	const __m128 xw = _mm_mul_ps( q[ 3 ], x2 );
+	const __m128 yw = _mm_mul_ps( q[ 3 ], y2 );
+	const __m128 zw = _mm_mul_ps( q[ 3 ], z2 );
+
+	r[ 0 ] = _mm_sub_ps( one, _mm_add_ps( yy, zz ) );
+	r[ 1 ] = _mm_add_ps( xy, zw );
+	r[ 2 ] = _mm_sub_ps( xz, yw );
+	r[ 3 ] = _mm_sub_ps( xy, zw );
+	r[ 4 ] = _mm_sub_ps( one, _mm_add_ps( xx, zz ) );
+	r[ 5 ] = _mm_add_ps( yz, xw );
+	r[ 6 ] = _mm_add_ps( xz, yw );
+	r[ 7 ] = _mm_sub_ps( yz, xw );
+	r[ 8 ] = _mm_sub_ps( one, _mm_add_ps( xx, yy ) );
+}
+
+//------------------------------------------------------------------------------
+// Name: TurnQuaternions()
+// Desc: Turns four orientations through rotation vectors as Vehicle::Rotate()
+//		 does. Only the series is used - a step would need an angular velocity
+//		 of 24 radians a second to leave the range it is exact over.
+//------------------------------------------------------------------------------
+static inline void TurnQuaternions( __m128 q[ 4 ], const __m128 v[ 3 ] )
+{
+	const __m128 angleSq = _mm_add_ps( _mm_add_ps( _mm_mul_ps( v[ 0 ], v[ 0 ] ),
+						   _mm_mul_ps( v[ 1 ], v[ 1 ] ) ), _mm_mul_ps( v[ 2 ], v[ 2 ] ) );
+	const __m128 angleQuad = _mm_mul_ps( angleSq, angleSq );
+	const __m128 cosHalf = _mm_add_ps( _mm_sub_ps( _mm_set1_ps( 1.0f ),
+						   _mm_div_ps( angleSq, _mm_set1_ps( 8.0f ) ) ),
+						   _mm_div_ps( angleQuad, _mm_set1_ps( 384.0f ) ) );
+	const __m128 negSinHalf = _mm_sub_ps( _mm_add_ps( _mm_set1_ps( -0.5f ),
+							  _mm_div_ps( angleSq, _mm_set1_ps( 48.0f ) ) ),
+							  _mm_div_ps( angleQuad, _mm_set1_ps( 3840.0f ) ) );
+
+	//the turn, negated as in Vehicle::Rotate(), then turn * q as D3DX multiplies
+	const __m128 tx = _mm_mul_ps( v[ 0 ], negSinHalf );
+	const __m128 ty = _mm_mul_ps( v[ 1 ], negSinHalf );
+	const __m128 tz = _mm_mul_ps( v[ 2 ], negSinHalf );
+	const __m128 tw = cosHalf;
+
+	__m128 x = _mm_sub_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( q[ 3 ], tx ), _mm_mul_ps( q[ 0 ], tw ) ),
+						   _mm_mul_ps( q[ 1 ], tz ) ), _mm_mul_ps( q[ 2 ], ty ) );
+	__m128 y = _mm_add_ps( _mm_add_ps( _mm_sub_ps( _mm_mul_ps( q[ 3 ], ty ), _mm_mul_ps( q[ 0 ], tz ) ),
+						   _mm_mul_ps( q[ 1 ], tw ) ), _mm_mul_ps( q[ 2 ], tx ) );
+	__m128 z = _mm_add_ps( _mm_sub_ps( _mm_add_ps( _mm_mul_ps( q[ 3 ], tz ), _mm_mul_ps( q[ 0 ], ty ) ),
+						   _mm_mul_ps( q[ 1 ], tx ) ), _mm_mul_ps( q[ 2 ], tw ) );
+	__m128 w = _mm_sub_ps( _mm_sub_ps( _mm_sub_ps( _mm_mul_ps( q[ 3 ], tw ), _mm_mul_ps( q[ 0 ], tx ) ),
+						   _mm_mul_ps( q[ 1 ], ty ) ), _mm_mul_ps( q[ 2 ], tz ) );
+
+	const __m128 length = _mm_sqrt_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) ),
+						  _mm_add_ps( _mm_mul_ps( z, z ), _mm_mul_ps( w, w ) ) ) );
+	q[ 0 ] = _mm_div_ps( x, length );
+	q[ 1 ] = _mm_div_ps( y, length );
+	q[ 2 ] = _mm_div_ps( z, length );
+	q[ 3 ] = _mm_div_ps( w, length );
+}
+#else
+//------------------------------------------------------------------------------
+// Name: RotationFromQuaternion()
+// Desc: Builds the rows of a rotation matrix, as D3DXMatrixRotationQuaternion()
+//		 does
+//------------------------------------------------------------------------------
+static inline void RotationFromQuaternion( const float q[ 4 ], float r[ 9 ] )
+{
+	const float x2 = q[ 0 ] + q[ 0 ];
+	const float y2 = q[ 1 ] + q[ 1 ];
+	const float z2 = q[ 2 ] + q[ 2 ];
+
+	r[ 0 ] = 1.0f - ( ( q[ 1 ] * y2 ) + ( q[ 2 ] * z2 ) );
+	r[ 1 ] = ( q[ 0 ] * y2 ) + ( q[ 3 ] * z2 );
+	r[ 2 ] = ( q[ 0 ] * z2 ) - ( q[ 3 ] * y2 );
+	r[ 3 ] = ( q[ 0 ] * y2 ) - ( q[ 3 ] * z2 );
+	r[ 4 ] = 1.0f - ( ( q[ 0 ] * x2 ) + ( q[ 2 ] * z2 ) );
+	r[ 5 ] = ( q[ 1 ] * z2 ) + ( q[ 3 ] * x2 );
+	r[ 6 ] = ( q[ 0 ] * z2 ) + ( q[ 3 ] * y2 );
+	r[ 7 ] = ( q[ 1 ] * z2 ) - ( q[ 3 ] * x2 );
+	r[ 8 ] = 1.0f - ( ( q[ 0 ] * x2 ) + ( q[ 1 ] * y2 ) );
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+// Name: TurnQuaternion()
+// Desc: Turns an orientation through a rotation vector as the sse kernel does,
+//		 for the scalar kernel and for vehicles between their steps
+//------------------------------------------------------------------------------
+static inline void TurnQuaternion( float q[ 4 ], const float v[ 3 ] )
+{
+	const float angleSq = ( v[ 0 ] * v[ 0 ] ) + ( v[ 1 ] * v[ 1 ] ) + ( v[ 2 ] * v[ 2 ] );
+	const float cosHalf = 1.0f - ( angleSq / 8.0f ) + ( angleSq * angleSq / 384.0f );
+	const float sinHalf = 0.5f - ( angleSq / 48.0f ) + ( angleSq * angleSq / 3840.0f );
+
+	const Quaternion qStart( q[ 0 ], q[ 1 ], q[ 2 ], q[ 3 ] );
+	const Quaternion qTurn( - v[ 0 ] * sinHalf, - v[ 1 ] * sinHalf,
+							- v[ 2 ] * sinHalf, cosHalf );
+	const Quaternion qOrientation = QuaternionNormalize( QuaternionMultiply( qTurn, qStart ) );
+
+	q[ 0 ] = qOrientation.x;
+	q[ 1 ] = qOrientation.y;
+	q[ 2 ] = qOrientation.z;
+	q[ 3 ] = qOrientation.w;
+}
+
+//------------------------------------------------------------------------------
+// Name: class VehicleFleet::StepJob
+// Desc: Steps the vehicles of one tier in one item of the fleet
+//------------------------------------------------------------------------------
+class VehicleFleet::StepJob : public WorkerJob
+{
+public:
+	StepJob( VehicleFleet& fleet, const int tier, const float timeInterval,
+			 const Terrain* pTerrain, const StepBounds& bounds, const int firstVehicle,
+			 const int numVehicles )
+		: m_fleet( fleet ), m_tier( tier ), m_timeInterval( timeInterval ),
+		  m_pTerrain( pTerrain ), m_bounds( bounds ), m_firstVehicle( firstVehicle ),
+		  m_numVehicles( numVehicles ) {}
+
+	virtual void Execute( const int item )
+	{
+		const int offset = item * VEHICLES_PER_ITEM;
+		int numVehicles = m_numVehicles - offset;
+		if( numVehicles > VEHICLES_PER_ITEM )
+			numVehicles = VEHICLES_PER_ITEM;
+
+		m_fleet.StepVehicles( m_tier, m_timeInterval, m_pTerrain, m_bounds,
+							  m_firstVehicle + offset, numVehicles );
+	}
+
+private:
+	VehicleFleet& m_fleet;
+	const int m_tier;
+	const float m_timeInterval;
+	const Terrain* m_pTerrain;
+	const StepBounds m_bounds;
+	const int m_firstVehicle;
+	const int m_numVehicles;
+};
+
+//------------------------------------------------------------------------------
+// Name: VehicleFleet()
+// Desc: Constructor for the fleet class - room is made for maxVehicles, and a
+//		 batch more, as the last batch of a tier can start in any slot
+//------------------------------------------------------------------------------
+VehicleFleet::VehicleFleet( const int maxVehicles )
+{
+	m_maxVehicles = maxVehicles;
+	m_numVehicles = 0;
+	for( int tier = 0; tier < NUM_TIERS; ++tier )
+		m_tierEnd[ tier ] = 0;
+	m_numSleeps = 0;
+	m_numWakes = 0;
+	m_numStepped = 0;
+	m_vLodCentre = Vector3( 0.0f, 0.0f, 0.0f );
+	m_stepCount = 0;
+	m_timeInterval = 0.0f;
+
+	const int capacity = ( ( maxVehicles + BATCH_SIZE - 1 ) & ~( BATCH_SIZE - 1 ) ) + BATCH_SIZE;
+	m_posX.resize( capacity, 0.0f );
+	m_posY.resize( capacity, 0.0f );
+	m_posZ.resize( capacity, 0.0f );
+	m_velX.resize( capacity, 0.0f );
+	m_velY.resize( capacity, 0.0f );
+	m_velZ.resize( capacity, 0.0f );
+	for( int element = 0; element < 4; ++element )
+		m_orientation[ element ].resize( capacity, ( element == 3 ) ? 1.0f : 0.0f );
+	m_momentumX.resize( capacity, 0.0f );
+	m_momentumY.resize( capacity, 0.0f );
+	m_momentumZ.resize( capacity, 0.0f );
+	m_angVelX.resize( capacity, 0.0f );
+	m_angVelY.resize( capacity, 0.0f );
+	m_angVelZ.resize( capacity, 0.0f );
+	m_controls.resize( capacity, 0 );
+	m_onGround.resize( capacity, 0 );
+	m_sleepSteps.resize( capacity, 0 );
+	m_lastStep.resize( capacity, 0 );
+	m_slots.resize( maxVehicles, -1 );
+	m_vPopOffsets.resize( maxVehicles, Vector3( 0.0f, 0.0f, 0.0f ) );
+	m_vehicles.resize( capacity, -1 );
+
+	//inertia tensor of a box
+	const float m = FLEET_MASS / 12.0f;
+	const float x = FLEET_SIZE_X * FLEET_SIZE_X;
+	const float y = FLEET_SIZE_Y * FLEET_SIZE_Y;
+	const float z = FLEET_SIZE_Z * FLEET_SIZE_Z;
+	m_inverseTensor[ 0 ] = 1.0f / ( m * ( y + z ) );
+	m_inverseTensor[ 1 ] = 1.0f / ( m * ( x + z ) );
+	m_inverseTensor[ 2 ] = 1.0f / ( m * ( x + y ) );
+
+	//collision grid, in the same order as Vehicle's - mid-range vehicles use
+	//its corners, and far ones the point in the middle
+	const float halfX = FLEET_SIZE_X / 2.0f;
+	const float halfY = FLEET_SIZE_Y / 2.0f;
+	const float halfZ = FLEET_SIZE_Z / 2.0f;
+	const float stepX = FLEET_SIZE_X / ( POINTS_PER_EDGE - 1 );
+	const float stepZ = FLEET_SIZE_Z / ( POINTS_PER_EDGE - 1 );
+
+	for( int tier = 0; tier < NUM_TIERS; ++tier )
+		m_numPoints[ tier ] = 0;
+
+	for( int pointX = 0; pointX < POINTS_PER_EDGE; ++pointX )
+	{
+		for( int pointZ = 0; pointZ < POINTS_PER_EDGE; ++pointZ )
+		{
+			const Vector3 vVector( halfX - ( pointX * stepX ), halfY,
+								  halfZ - ( pointZ * stepZ ) );
+			const Vector3 vPoint( ( pointX * stepX ) - halfX, - halfY,
+								 ( pointZ * stepZ ) - halfZ );
+
+			const bool isCorner = ( pointX % ( POINTS_PER_EDGE - 1 ) ) == 0 &&
+								  ( pointZ % ( POINTS_PER_EDGE - 1 ) ) == 0;
+			const bool isCentre = ( pointX * 2 ) == ( POINTS_PER_EDGE - 1 ) &&
+								  ( pointZ * 2 ) == ( POINTS_PER_EDGE - 1 );
+
+			for( int tier = 0; tier < NUM_TIERS; ++tier )
+			{
+				if( ( tier == TIER_MID && ! isCorner ) || ( tier == TIER_FAR && ! isCentre ) )
+					continue;
+
+				const int point = m_numPoints[ tier ]++;
+				m_collisionVectors[ tier ][ point ] = vVector;
+				m_collisionPoints[ tier ][ point ] = vPoint;
+			}
+		}
+	}
+
+	//a single point under the centre has no lever arm to turn the vehicle
+	m_turnScale[ TIER_NEAR ] = 1.0f;
+	m_turnScale[ TIER_MID ] = MID_TURN_SCALE;
+	m_turnScale[ TIER_FAR ] = 0.0f;
+}
+
+//------------------------------------------------------------------------------
+// Name: AddVehicle()
+// Desc: Adds a vehicle at rest, level, at the given position. It starts awake,
+//		 in the tier for its distance from the centre.
+//------------------------------------------------------------------------------
+int VehicleFleet::AddVehicle( const Vector3& vPosition )
+{
+	if( m_numVehicles >= m_maxVehicles )
+		return -1;
+
+	const int vehicle = m_numVehicles++;
+
+	SlotState state;
+	state.pos[ 0 ] = vPosition.x;
+	state.pos[ 1 ] = vPosition.y;
+	state.pos[ 2 ] = vPosition.z;
+	for( int axis = 0; axis < 3; ++axis )
+		state.vel[ axis ] = state.momentum[ axis ] = state.angVel[ axis ] = 0.0f;
+	for( int element = 0; element < 4; ++element )
+		state.orientation[ element ] = ( element == 3 ) ? 1.0f : 0.0f;
+	state.controls = 0;
+	state.onGround = 0;
+	state.sleepSteps = 0;
+	state.lastStep = m_stepCount;
+	state.vehicle = vehicle;
+	SetSlot( vehicle, state );
+
+	MoveToTier( vehicle, GetTier( vehicle ) );
+
+	return vehicle;
+}
+
+//------------------------------------------------------------------------------
+// Name: GetRotation()
+// Desc: Builds a vehicle's rotation as a matrix like Vehicle's, turned on at
+//		 its angular velocity since it was last stepped
+//------------------------------------------------------------------------------
+void VehicleFleet::GetRotation( const int vehicle, Matrix3& matRotation ) const
+{
+	const int slot = m_slots[ vehicle ];
+	float q[ 4 ] = { m_orientation[ 0 ][ slot ], m_orientation[ 1 ][ slot ],
+					 m_orientation[ 2 ][ slot ], m_orientation[ 3 ][ slot ] };
+
+	const float lag = GetLag( slot );
+	if( lag > 0.0f )
+	{
+		const float turn[ 3 ] = { m_angVelX[ slot ] * lag, m_angVelY[ slot ] * lag,
+								  m_angVelZ[ slot ] * lag };
+		TurnQuaternion( q, turn );
+	}
+
+	Mat3RotationQuaternion( matRotation, Quaternion( q[ 0 ], q[ 1 ], q[ 2 ], q[ 3 ] ) );
+}
+
+//------------------------------------------------------------------------------
+// Name: Wake()
+// Desc: Moves a sleeping vehicle into the tier for its distance. It was at
+//		 rest, so its state holds for now.
+//------------------------------------------------------------------------------
+void VehicleFleet::Wake( const int vehicle )
+{
+	const int slot = m_slots[ vehicle ];
+	m_sleepSteps[ slot ] = 0;
+	if( ! IsAsleep( vehicle ) )
+		return;
+
+	m_lastStep[ slot ] = m_stepCount;
+	MoveToTier( vehicle, GetTier( slot ) );
+	++m_numWakes;
+}
+
+//------------------------------------------------------------------------------
+// Name: WakeInBox()
+// Desc: Wakes every sleeping vehicle whose collision grid could be over the
+//		 box. The slot a vehicle is woken from is given the first sleeping
+//		 vehicle, which has already been looked at, and the vehicles it moves
+//		 on its way to its tier are all awake.
+//------------------------------------------------------------------------------
+void VehicleFleet::WakeInBox( const float minX, const float minZ, const float maxX,
+							  const float maxZ )
+{
+	const float reach = 0.5f * sqrtf( ( FLEET_SIZE_X * FLEET_SIZE_X ) +
+									  ( FLEET_SIZE_Z * FLEET_SIZE_Z ) );
+
+	for( int slot = m_tierEnd[ NUM_TIERS - 1 ]; slot < m_numVehicles; ++slot )
+	{
+		if( m_posX[ slot ] + reach < minX || m_posX[ slot ] - reach > maxX ||
+			m_posZ[ slot ] + reach < minZ || m_posZ[ slot ] - reach > maxZ )
+			continue;
+
+		Wake( m_vehicles[ slot ] );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: GetTier()
+// Desc: Finds the tier for a slot's distance from the centre
+//------------------------------------------------------------------------------
+int VehicleFleet::GetTier( const int slot ) const
+{
+	const float dx = m_posX[ slot ] - m_vLodCentre.x;
+	const float dy = m_posY[ slot ] - m_vLodCentre.y;
+	const float dz = m_posZ[ slot ] - m_vLodCentre.z;
+	const float distanceSq = ( dx * dx ) + ( dy * dy ) + ( dz * dz );
+
+	if( distanceSq < NEAR_DISTANCE * NEAR_DISTANCE )
+		return TIER_NEAR;
+	if( distanceSq < MID_DISTANCE * MID_DISTANCE )
+		return TIER_MID;
+	return TIER_FAR;
+}
+
+//------------------------------------------------------------------------------
+// Name: GetSlotTier()
+// Desc: Finds the tier a slot is in, TIER_ASLEEP past the far vehicles
+//------------------------------------------------------------------------------
+int VehicleFleet::GetSlotTier( const int slot ) const
+{
+	for( int tier = 0; tier < NUM_TIERS; ++tier )
+	{
+		if( slot < m_tierEnd[ tier ] )
+			return tier;
+	}
+	return TIER_ASLEEP;
+}
+
+//------------------------------------------------------------------------------
+// Name: MoveToTier()
+// Desc: Moves a vehicle through the tiers between the one it is in and the
+//		 one it goes to. Going further out it is swapped into the last slot of
+//		 each tier it leaves, and that tier ends a slot earlier; coming in it
+//		 is swapped into the first slot of each tier it enters, and that tier
+//		 ends a slot later.
+//------------------------------------------------------------------------------
+void VehicleFleet::MoveToTier( const int vehicle, const int tier )
+{
+	int slot = m_slots[ vehicle ];
+	int from = GetSlotTier( slot );
+
+	while( from < tier )
+	{
+		const int last = m_tierEnd[ from ] - 1;
+		SwapSlots( slot, last );
+		slot = last;
+		--m_tierEnd[ from ];
+		++from;
+	}
+
+	while( from > tier )
+	{
+		--from;
+		const int first = m_tierEnd[ from ];
+		SwapSlots( slot, first );
+		slot = first;
+		++m_tierEnd[ from ];
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: GetSlot()
+// Desc: Copies out everything kept in a slot
+//------------------------------------------------------------------------------
+void VehicleFleet::GetSlot( const int slot, SlotState& state ) const
+{
+	state.pos[ 0 ] = m_posX[ slot ];
+	state.pos[ 1 ] = m_posY[ slot ];
+	state.pos[ 2 ] = m_posZ[ slot ];
+	state.vel[ 0 ] = m_velX[ slot ];
+	state.vel[ 1 ] = m_velY[ slot ];
+	state.vel[ 2 ] = m_velZ[ slot ];
+	for( int element = 0; element < 4; ++element )
+		state.orientation[ element ] = m_orientation[ element ][ slot ];
+	state.momentum[ 0 ] = m_momentumX[ slot ];
+	state.momentum[ 1 ] = m_momentumY[ slot ];
+	state.momentum[ 2 ] = m_momentumZ[ slot ];
+	state.angVel[ 0 ] = m_angVelX[ slot ];
+	state.angVel[ 1 ] = m_angVelY[ slot ];
+	state.angVel[ 2 ] = m_angVelZ[ slot ];
+	state.controls = m_controls[ slot ];
+	state.onGround = m_onGround[ slot ];
+	state.sleepSteps = m_sleepSteps[ slot ];
+	state.lastStep = m_lastStep[ slot ];
+	state.vehicle = m_vehicles[ slot ];
+}
+
+//------------------------------------------------------------------------------
+// Name: SetSlot()
+// Desc: Fills a slot, and points the vehicle in it at it
+//------------------------------------------------------------------------------
+void VehicleFleet::SetSlot( const int slot, const SlotState& state )
+{
+	m_posX[ slot ] = state.pos[ 0 ];
+	m_posY[ slot ] = state.pos[ 1 ];
+	m_posZ[ slot ] = state.pos[ 2 ];
+	m_velX[ slot ] = state.vel[ 0 ];
+	m_velY[ slot ] = state.vel[ 1 ];
+	m_velZ[ slot ] = state.vel[ 2 ];
+	for( int element = 0; element < 4; ++element )
+		m_orientation[ element ][ slot ] = state.orientation[ element ];
+	m_momentumX[ slot ] = state.momentum[ 0 ];
+	m_momentumY[ slot ] = state.momentum[ 1 ];
+	m_momentumZ[ slot ] = state.momentum[ 2 ];
+	m_angVelX[ slot ] = state.angVel[ 0 ];
+	m_angVelY[ slot ] = state.angVel[ 1 ];
+	m_angVelZ[ slot ] = state.angVel[ 2 ];
+	m_controls[ slot ] = state.controls;
+	m_onGround[ slot ] = state.onGround;
+	m_sleepSteps[ slot ] = state.sleepSteps;
+	m_lastStep[ slot ] = state.lastStep;
+	m_vehicles[ slot ] = state.vehicle;
+	if( state.vehicle >= 0 )
+		m_slots[ state.vehicle ] = slot;
+}
+
+//------------------------------------------------------------------------------
+// Name: SwapSlots()
+// Desc: Exchanges the vehicles in two slots
+//------------------------------------------------------------------------------
+void VehicleFleet::SwapSlots( const int slotA, const int slotB )
+{
+	if( slotA == slotB )
+		return;
+
+	SlotState stateA, stateB;
+	GetSlot( slotA, stateA );
+	GetSlot( slotB, stateB );
+	SetSlot( slotA, stateB );
+	SetSlot( slotB, stateA );
+}
+
+//------------------------------------------------------------------------------
+// Name: CheckSlots()
+// Desc: Checks that each vehicle's slot holds it and no slot past the last
+//		 vehicle holds one, that the tiers end in order, that sleeping vehicles
+//		 are at rest, and that each awake vehicle was stepped within its tier's
+//		 period
+//------------------------------------------------------------------------------
+bool VehicleFleet::CheckSlots() const
+{
+	int tierStart = 0;
+	for( int tier = 0; tier < NUM_TIERS; ++tier )
+	{
+		if( m_tierEnd[ tier ] < tierStart || m_tierEnd[ tier ] > m_numVehicles )
+			return false;
+		tierStart = m_tierEnd[ tier ];
+	}
+
+	for( int vehicle = 0; vehicle < m_numVehicles; ++vehicle )
+	{
+		const int slot = m_slots[ vehicle ];
+		if( slot < 0 || slot >= m_numVehicles || m_vehicles[ slot ] != vehicle )
+			return false;
+	}
+
+	for( int slot = m_numVehicles; slot < int( m_vehicles.size() ); ++slot )
+	{
+		if( m_vehicles[ slot ] != -1 )
+			return false;
+	}
+
+	for( int slot = 0; slot < m_numVehicles; ++slot )
+	{
+		const int tier = GetSlotTier( slot );
+		if( tier == TIER_ASLEEP )
+		{
+			if( m_velX[ slot ] != 0.0f || m_velY[ slot ] != 0.0f || m_velZ[ slot ] != 0.0f )
+				return false;
+		}
+		else if( m_stepCount - m_lastStep[ slot ] >= TIER_PERIODS[ tier ] )
+			return false;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: Rebase()
+// Desc: Moves every vehicle by -vShift
+//------------------------------------------------------------------------------
+void VehicleFleet::Rebase( const Vector3& vShift )
+{
+	for( int vehicle = 0; vehicle < m_numVehicles; ++vehicle )
+	{
+		m_posX[ vehicle ] -= vShift.x;
+		m_posY[ vehicle ] -= vShift.y;
+		m_posZ[ vehicle ] -= vShift.z;
+	}
+
+	for( unsigned int promotion = 0; promotion < m_promotions.size(); ++promotion )
+		m_promotions[ promotion ].vPosition = m_promotions[ promotion ].vPosition - vShift;
+}
+
+//------------------------------------------------------------------------------
+// Name: Step()
+// Desc: Runs the simulation by one step for the tiers that are due, then moves
+//		 the vehicles that were stepped to the tier for where they are now, or
+//		 to sleep if they have been still for long enough. Only the awake slots
+//		 are stepped, so the cost is that of the awake vehicles alone, and most
+//		 of that is the near ones'.
+//------------------------------------------------------------------------------
+void VehicleFleet::Step( const float timeInterval, const Terrain* pTerrain, WorkerPool* pPool )
+{
+	++m_stepCount;
+	m_timeInterval = timeInterval;
+
+	//keep the vehicles on the terrain (relative to the floating origin)
+	StepBounds bounds;
+	pTerrain->GetLocalBounds( 5.0f, bounds.minX, bounds.minZ, bounds.maxX, bounds.maxZ );
+
+	//each tier's period is a multiple of the one before's, so the tiers due
+	//are the first few
+	m_numStepped = 0;
+	for( int tier = 0; tier < NUM_TIERS && ( m_stepCount % TIER_PERIODS[ tier ] ) == 0; ++tier )
+	{
+		StepTier( tier, timeInterval, pTerrain, bounds, pPool );
+		m_numStepped = m_tierEnd[ tier ];
+	}
+
+	FadePops();
+
+	//a vehicle goes to sleep at rest - the moves are found first, as moving a
+	//vehicle moves others between slots
+	m_moves.clear();
+	for( int slot = 0; slot < m_numStepped; ++slot )
+	{
+		int tier;
+		if( m_sleepSteps[ slot ] >= FLEET_SLEEP_STEPS )
+		{
+			m_velX[ slot ] = m_velY[ slot ] = m_velZ[ slot ] = 0.0f;
+			m_momentumX[ slot ] = m_momentumY[ slot ] = m_momentumZ[ slot ] = 0.0f;
+			m_angVelX[ slot ] = m_angVelY[ slot ] = m_angVelZ[ slot ] = 0.0f;
+			tier = TIER_ASLEEP;
+			++m_numSleeps;
+		}
+		else
+		{
+			tier = GetTier( slot );
+			if( tier == GetSlotTier( slot ) )
+				continue;
+		}
+
+		m_moves.push_back( m_vehicles[ slot ] );
+		m_moves.push_back( tier );
+	}
+
+	for( unsigned int move = 0; move < m_moves.size(); move += 2 )
+	{
+		const int vehicle = m_moves[ move ];
+		const int tier = m_moves[ move + 1 ];
+		const int from = GetSlotTier( m_slots[ vehicle ] );
+		MoveToTier( vehicle, tier );
+		if( tier > from )
+			continue;
+
+		const int slot = m_slots[ vehicle ];
+		Promotion promotion;
+		promotion.vehicle = vehicle;
+		promotion.step = m_stepCount;
+		promotion.vPosition = Vector3( m_posX[ slot ], m_posY[ slot ], m_posZ[ slot ] );
+		promotion.vVelocity = Vector3( m_velX[ slot ], m_velY[ slot ], m_velZ[ slot ] );
+		m_promotions.push_back( promotion );
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: FadePops()
+// Desc: Fades the offsets vehicles are reported at, then gives each vehicle
+//		 stepped for the first time since it moved into a nearer tier an
+//		 offset back to where its old tier's velocity would have taken it
+//------------------------------------------------------------------------------
+void VehicleFleet::FadePops()
+{
+	for( unsigned int fading = 0; fading < m_fading.size(); )
+	{
+		Vector3& vOffset = m_vPopOffsets[ m_fading[ fading ] ];
+		vOffset = vOffset * POP_FADE;
+		if( Vec3LengthSq( vOffset ) > POP_MIN_OFFSET * POP_MIN_OFFSET )
+		{
+			++fading;
+			continue;
+		}
+
+		vOffset = Vector3( 0.0f, 0.0f, 0.0f );
+		m_fading[ fading ] = m_fading.back();
+		m_fading.pop_back();
+	}
+
+	for( unsigned int promotion = 0; promotion < m_promotions.size(); )
+	{
+		const Promotion& moved = m_promotions[ promotion ];
+		const int slot = m_slots[ moved.vehicle ];
+		if( m_lastStep[ slot ] == moved.step )
+		{
+			++promotion;
+			continue;
+		}
+
+		const float time = float( m_lastStep[ slot ] - moved.step ) * m_timeInterval;
+		Vector3& vOffset = m_vPopOffsets[ moved.vehicle ];
+		if( Vec3LengthSq( vOffset ) == 0.0f )
+			m_fading.push_back( moved.vehicle );
+		vOffset = vOffset + moved.vPosition + ( moved.vVelocity * time ) -
+				  Vector3( m_posX[ slot ], m_posY[ slot ], m_posZ[ slot ] );
+
+		m_promotions[ promotion ] = m_promotions.back();
+		m_promotions.pop_back();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: StepTier()
+// Desc: Steps the vehicles of one tier. Its last batch can hold vehicles of
+//		 the tiers after it, or sleeping ones, which are put back afterwards as
+//		 they were.
+//------------------------------------------------------------------------------
+void VehicleFleet::StepTier( const int tier, const float timeInterval, const Terrain* pTerrain,
+							 const StepBounds& bounds, WorkerPool* pPool )
+{
+	const int firstVehicle = ( tier > 0 ) ? m_tierEnd[ tier - 1 ] : 0;
+	const int numVehicles = ( m_tierEnd[ tier ] - firstVehicle + BATCH_SIZE - 1 ) & ~( BATCH_SIZE - 1 );
+	if( numVehicles == 0 )
+		return;
+
+	const int endVehicle = firstVehicle + numVehicles;
+	const int numOthers = ( ( endVehicle < m_numVehicles ) ? endVehicle : m_numVehicles ) -
+						  m_tierEnd[ tier ];
+	SlotState others[ BATCH_SIZE ];
+	for( int other = 0; other < numOthers; ++other )
+		GetSlot( m_tierEnd[ tier ] + other, others[ other ] );
+
+	StepJob job( *this, tier, timeInterval, pTerrain, bounds, firstVehicle, numVehicles );
+	const int numItems = ( numVehicles + VEHICLES_PER_ITEM - 1 ) / VEHICLES_PER_ITEM;
+
+	if( pPool != NULL )
+		pPool->Run( job, numItems );
+	else
+	{
+		for( int item = 0; item < numItems; ++item )
+			job.Execute( item );
+	}
+
+	for( int other = 0; other < numOthers; ++other )
+		SetSlot( m_tierEnd[ tier ] + other, others[ other ] );
+}
+
+//------------------------------------------------------------------------------
+// Name: StepVehicles()
+// Desc: Steps a run of whole batches, with the same forces and integration as
+//		 Vehicle::DoPhysics(). The small turn the hover force gives at each
+//		 collision point moves the points after it, so the points are placed
+//		 one at a time, and the terrain is sampled under each point of every
+//		 vehicle in the item in one call. Each vehicle's count of still steps
+//		 is kept as Vehicle::UpdateSleep() keeps it, from the distance it
+//		 actually moved. A vehicle is stepped over the time since it was last
+//		 stepped, which is more than one step for the tiers further out, or for
+//		 a vehicle that has just moved into a tier stepped less often.
+//------------------------------------------------------------------------------
+void VehicleFleet::StepVehicles( const int tier, const float timeInterval,
+								 const Terrain* pTerrain, const StepBounds& bounds,
+								 const int firstVehicle, const int numVehicles )
+{
+	//one collision point for each vehicle in the item
+	float pointX[ VEHICLES_PER_ITEM ];
+	float pointY[ VEHICLES_PER_ITEM ];
+	float pointZ[ VEHICLES_PER_ITEM ];
+	float heights[ VEHICLES_PER_ITEM ];
+
+	//lane controls, as multiples of the thrusts
+	float thrustSign[ VEHICLES_PER_ITEM ];
+	float turnSign[ VEHICLES_PER_ITEM ];
+
+	//lane time steps, and the steps each one covers
+	float stepTime[ VEHICLES_PER_ITEM ];
+	int numSteps[ VEHICLES_PER_ITEM ];
+
+	for( int v = 0; v < numVehicles; ++v )
+	{
+		numSteps[ v ] = m_stepCount - m_lastStep[ firstVehicle + v ];
+		stepTime[ v ] = float( numSteps[ v ] ) * timeInterval;
+		m_lastStep[ firstVehicle + v ] = m_stepCount;
+
+		const unsigned char controls = m_controls[ firstVehicle + v ];
+		thrustSign[ v ] = ( ( controls & CONTROL_FORWARD ) ? 1.0f : 0.0f ) -
+						  ( ( controls & CONTROL_REVERSE ) ? 1.0f : 0.0f );
+		turnSign[ v ] = ( ( controls & CONTROL_RIGHT ) ? 1.0f : 0.0f ) -
+						( ( controls & CONTROL_LEFT ) ? 1.0f : 0.0f );
+	}
+
+	//DoPhysics() scales the hover force at each point by the 4d dot product of
+	//the normal, whose w is 1, and ( 0, weight, 0, -mass ) / POINTS_PER_EDGE
+	const float hoverWeight = FLEET_GRAVITY * FLEET_MASS / float( POINTS_PER_EDGE );
+	const float hoverMass = FLEET_MASS / float( POINTS_PER_EDGE );
+	const float turnTorque = 2.0f * FLEET_ANGULAR_THRUST * FLEET_SIZE_Z;
+
+	const int numPoints = m_numPoints[ tier ];
+	const Vector3* pPoints = m_collisionPoints[ tier ];
+	const Vector3* pArms = m_collisionVectors[ tier ];
+	const float turnScale = m_turnScale[ tier ];
+
+#ifdef FLEET_USE_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 signMask = _mm_set1_ps( -0.0f );
+
+	const __m128 mass = _mm_set1_ps( FLEET_MASS );
+	const __m128 gravityForce = _mm_set1_ps( -FLEET_GRAVITY * FLEET_MASS );
+	const __m128 linearThrust = _mm_set1_ps( FLEET_LINEAR_THRUST );
+	const __m128 angularThrust = _mm_set1_ps( FLEET_ANGULAR_THRUST );
+	const __m128 linearAR = _mm_set1_ps( FLEET_LINEAR_AR );
+	const __m128 angularAR = _mm_set1_ps( FLEET_ANGULAR_AR );
+	const __m128 hoverHeight = _mm_set1_ps( FLEET_HOVER_HEIGHT );
+	const __m128 supportHeight = _mm_set1_ps( FLEET_SUPPORT_HEIGHT );
+	const __m128 nearDistance = _mm_set1_ps( FLEET_NEAR_DISTANCE );
+	const __m128 sleepSpeed = _mm_set1_ps( FLEET_SLEEP_SPEED );
+	const __m128 maxAngularSpeedSq = _mm_set1_ps( FLEET_SLEEP_ANGULAR_SPEED *
+												  FLEET_SLEEP_ANGULAR_SPEED );
+	const __m128 inverseTensor[ 3 ] = { _mm_set1_ps( m_inverseTensor[ 0 ] ),
+										_mm_set1_ps( m_inverseTensor[ 1 ] ),
+										_mm_set1_ps( m_inverseTensor[ 2 ] ) };
+
+	//what each batch carries from placing its collision points to integrating
+	struct BatchState
+	{
+		__m128 q[ 4 ];
+		__m128 r[ 9 ];
+		__m128 pos[ 3 ];
+		__m128 vel[ 3 ];
+		__m128 velocitySq[ 3 ];
+		__m128 startRows[ 9 ];
+		__m128 normal[ 3 ];
+		__m128 pointForce[ 3 ];
+		__m128 moveHeight;
+		__m128 nearTerrain;
+		__m128 onGround;
+	};
+	BatchState batches[ VEHICLES_PER_ITEM / BATCH_SIZE ];
+	const int numBatches = numVehicles / BATCH_SIZE;
+
+	for( int b = 0; b < numBatches; ++b )
+	{
+		const int i = firstVehicle + ( b * BATCH_SIZE );
+		BatchState& batch = batches[ b ];
+
+		for( int element = 0; element < 4; ++element )
+			batch.q[ element ] = _mm_loadu_ps( &m_orientation[ element ][ i ] );
+		RotationFromQuaternions( batch.q, batch.r );
+		batch.pos[ 0 ] = _mm_loadu_ps( &m_posX[ i ] );
+		batch.pos[ 1 ] = _mm_loadu_ps( &m_posY[ i ] );
+		batch.pos[ 2 ] = _mm_loadu_ps( &m_posZ[ i ] );
+		batch.vel[ 0 ] = _mm_loadu_ps( &m_velX[ i ] );
+		batch.vel[ 1 ] = _mm_loadu_ps( &m_velY[ i ] );
+		batch.vel[ 2 ] = _mm_loadu_ps( &m_velZ[ i ] );
+
+		//the forces are found from the rotation and velocity the step starts
+		//with, before the collision grid changes them
+		for( int element = 0; element < 9; ++element )
+			batch.startRows[ element ] = batch.r[ element ];
+
+		//velocity squared, keeping the sign, before the supports change it
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			batch.velocitySq[ axis ] = _mm_mul_ps( batch.vel[ axis ],
+												   _mm_andnot_ps( signMask, batch.vel[ axis ] ) );
+		}
+
+		//the vehicle's up vector is the second row of its rotation
+		for( int axis = 0; axis < 3; ++axis )
+			batch.normal[ axis ] = batch.r[ 3 + axis ];
+		const __m128 hover = _mm_sub_ps( _mm_mul_ps( _mm_set1_ps( hoverWeight ), batch.normal[ 1 ] ),
+										 _mm_set1_ps( hoverMass ) );
+		for( int axis = 0; axis < 3; ++axis )
+			batch.pointForce[ axis ] = _mm_mul_ps( batch.normal[ axis ], hover );
+
+		batch.moveHeight = zero;
+		batch.nearTerrain = zero;
+		batch.onGround = zero;
+	}
+
+	//terrain collision for each point in the collision grid
+	for( int point = 0; point < numPoints; ++point )
+	{
+		//translate this point to world space for every vehicle in the item
+		const Vector3& vPoint = pPoints[ point ];
+		const __m128 cx = _mm_set1_ps( vPoint.x );
+		const __m128 cy = _mm_set1_ps( vPoint.y );
+		const __m128 cz = _mm_set1_ps( vPoint.z );
+		for( int b = 0; b < numBatches; ++b )
+		{
+			const __m128* r = batches[ b ].r;
+			const __m128* pos = batches[ b ].pos;
+			const int v = b * BATCH_SIZE;
+			_mm_storeu_ps( &pointX[ v ], _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, r[ 0 ] ),
+						   _mm_mul_ps( cy, r[ 3 ] ) ), _mm_mul_ps( cz, r[ 6 ] ) ), pos[ 0 ] ) );
+			_mm_storeu_ps( &pointZ[ v ], _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, r[ 2 ] ),
+						   _mm_mul_ps( cy, r[ 5 ] ) ), _mm_mul_ps( cz, r[ 8 ] ) ), pos[ 2 ] ) );
+			_mm_storeu_ps( &pointY[ v ], _mm_add_ps( _mm_add_ps( _mm_add_ps( _mm_mul_ps( cx, r[ 1 ] ),
+						   _mm_mul_ps( cy, r[ 4 ] ) ), _mm_mul_ps( cz, r[ 7 ] ) ), pos[ 1 ] ) );
+		}
+
+		pTerrain->GetHeightMapPoints( pointX, pointZ, heights, numVehicles );
+
+		for( int b = 0; b < numBatches; ++b )
+		{
+			BatchState& batch = batches[ b ];
+			const int v = b * BATCH_SIZE;
+			const __m128 terrainDistance = _mm_sub_ps( _mm_loadu_ps( &pointY[ v ] ),
+													   _mm_loadu_ps( &heights[ v ] ) );
+
+			batch.nearTerrain = _mm_or_ps( batch.nearTerrain, _mm_cmplt_ps( terrainDistance, nearDistance ) );
+
+			//within hover distance the hover force turns the vehicle a little
+			const __m128 hovering = _mm_cmplt_ps( terrainDistance, hoverHeight );
+			batch.onGround = _mm_or_ps( batch.onGround, hovering );
+			if( turnScale != 0.0f && _mm_movemask_ps( hovering ) != 0 )
+			{
+				const __m128* pointForce = batch.pointForce;
+				const __m128 displacementScale = _mm_mul_ps( _mm_loadu_ps( &stepTime[ v ] ),
+															 _mm_set1_ps( FLEET_DISPLACEMENT * turnScale ) );
+				const Vector3& vArm = pArms[ point ];
+				const __m128 armX = _mm_set1_ps( vArm.x );
+				const __m128 armY = _mm_set1_ps( vArm.y );
+				const __m128 armZ = _mm_set1_ps( vArm.z );
+				const __m128 scale = _mm_and_ps( hovering, displacementScale );
+				const __m128 d[ 3 ] = {
+					_mm_mul_ps( scale, _mm_sub_ps( _mm_mul_ps( armY, pointForce[ 2 ] ),
+												   _mm_mul_ps( armZ, pointForce[ 1 ] ) ) ),
+					_mm_mul_ps( scale, _mm_sub_ps( _mm_mul_ps( armZ, pointForce[ 0 ] ),
+												   _mm_mul_ps( armX, pointForce[ 2 ] ) ) ),
+					_mm_mul_ps( scale, _mm_sub_ps( _mm_mul_ps( armX, pointForce[ 1 ] ),
+												   _mm_mul_ps( armY, pointForce[ 0 ] ) ) ) };
+
+				//only the hovering lanes are turned, so the others are not
+				//renormalised when Vehicle would leave them alone
+				__m128 turned[ 4 ] = { batch.q[ 0 ], batch.q[ 1 ], batch.q[ 2 ], batch.q[ 3 ] };
+				TurnQuaternions( turned, d );
+				for( int element = 0; element < 4; ++element )
+				{
+					batch.q[ element ] = _mm_or_ps( _mm_and_ps( hovering, turned[ element ] ),
+													_mm_andnot_ps( hovering, batch.q[ element ] ) );
+				}
+				RotationFromQuaternions( batch.q, batch.r );
+			}
+
+			//kill velocity along the surface normal where the supports touch
+			const __m128 supported = _mm_cmplt_ps( terrainDistance, supportHeight );
+			if( _mm_movemask_ps( supported ) != 0 )
+			{
+				const __m128* normal = batch.normal;
+				__m128* vel = batch.vel;
+				const __m128 kill = _mm_and_ps( supported, _mm_sub_ps( zero, _mm_add_ps( _mm_add_ps(
+										_mm_mul_ps( vel[ 0 ], normal[ 0 ] ),
+										_mm_mul_ps( vel[ 1 ], normal[ 1 ] ) ),
+										_mm_mul_ps( vel[ 2 ], normal[ 2 ] ) ) ) );
+				for( int axis = 0; axis < 3; ++axis )
+					vel[ axis ] = _mm_add_ps( vel[ axis ], _mm_mul_ps( normal[ axis ], kill ) );
+			}
+
+			batch.moveHeight = _mm_min_ps( batch.moveHeight, terrainDistance );
+		}
+	}
+
+	for( int b = 0; b < numBatches; ++b )
+	{
+		const int v = b * BATCH_SIZE;
+		const int i = firstVehicle + v;
+
+		BatchState& batch = batches[ b ];
+		__m128* q = batch.q;
+		__m128* r = batch.r;
+		const __m128* startRows = batch.startRows;
+		__m128* pos = batch.pos;
+		__m128* vel = batch.vel;
+		const __m128* velocitySq = batch.velocitySq;
+		const __m128* pointForce = batch.pointForce;
+		const __m128 nearTerrain = batch.nearTerrain;
+		const __m128 onGround = batch.onGround;
+
+		const __m128 dt = _mm_loadu_ps( &stepTime[ v ] );
+		const __m128 maxMove = _mm_mul_ps( dt, sleepSpeed );
+		const __m128 maxMoveSq = _mm_mul_ps( maxMove, maxMove );
+
+		const __m128 start[ 3 ] = { _mm_loadu_ps( &m_posX[ i ] ), _mm_loadu_ps( &m_posY[ i ] ),
+									_mm_loadu_ps( &m_posZ[ i ] ) };
+		__m128 momentum[ 3 ] = { _mm_loadu_ps( &m_momentumX[ i ] ),
+								 _mm_loadu_ps( &m_momentumY[ i ] ),
+								 _mm_loadu_ps( &m_momentumZ[ i ] ) };
+		const __m128 angVel[ 3 ] = { _mm_loadu_ps( &m_angVelX[ i ] ),
+									 _mm_loadu_ps( &m_angVelY[ i ] ),
+									 _mm_loadu_ps( &m_angVelZ[ i ] ) };
+
+		//make sure we don't penetrate the terrain
+		pos[ 1 ] = _mm_sub_ps( pos[ 1 ], batch.moveHeight );
+
+		//linear force
+		const __m128 thrust = _mm_mul_ps( linearThrust, _mm_loadu_ps( &thrustSign[ v ] ) );
+		const __m128 turn = _mm_loadu_ps( &turnSign[ v ] );
+		const __m128 sideThrust = _mm_mul_ps( angularThrust, turn );
+		__m128 force[ 3 ];
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			__m128 engine = _mm_mul_ps( startRows[ 6 + axis ], thrust );
+			if( axis == 1 )
+				engine = _mm_and_ps( engine, nearTerrain );
+
+			force[ axis ] = _mm_and_ps( onGround, pointForce[ axis ] );
+			force[ axis ] = _mm_add_ps( force[ axis ], engine );
+			force[ axis ] = _mm_add_ps( force[ axis ], _mm_mul_ps( startRows[ axis ], sideThrust ) );
+			force[ axis ] = _mm_sub_ps( force[ axis ], _mm_mul_ps( velocitySq[ axis ], linearAR ) );
+		}
+		force[ 1 ] = _mm_add_ps( force[ 1 ], gravityForce );
+
+		//torque
+		__m128 torque[ 3 ];
+		for( int axis = 0; axis < 3; ++axis )
+			torque[ axis ] = _mm_sub_ps( zero, _mm_mul_ps( angVel[ axis ], angularAR ) );
+		torque[ 1 ] = _mm_sub_ps( torque[ 1 ], _mm_mul_ps( _mm_set1_ps( turnTorque ), turn ) );
+
+		//integrate quantities
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			pos[ axis ] = _mm_add_ps( pos[ axis ], _mm_mul_ps( vel[ axis ], dt ) );
+			vel[ axis ] = _mm_add_ps( vel[ axis ], _mm_mul_ps( _mm_div_ps( force[ axis ], mass ), dt ) );
+			momentum[ axis ] = _mm_add_ps( momentum[ axis ], _mm_mul_ps( torque[ axis ], dt ) );
+		}
+
+		const __m128 step[ 3 ] = { _mm_mul_ps( angVel[ 0 ], dt ), _mm_mul_ps( angVel[ 1 ], dt ),
+								   _mm_mul_ps( angVel[ 2 ], dt ) };
+		TurnQuaternions( q, step );
+		RotationFromQuaternions( q, r );
+
+		//angular velocity = momentum * rotation * inverse tensor * rotation^T
+		__m128 body[ 3 ];
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			body[ axis ] = _mm_mul_ps( inverseTensor[ axis ], _mm_add_ps( _mm_add_ps(
+							_mm_mul_ps( momentum[ 0 ], r[ axis ] ),
+							_mm_mul_ps( momentum[ 1 ], r[ 3 + axis ] ) ),
+							_mm_mul_ps( momentum[ 2 ], r[ 6 + axis ] ) ) );
+		}
+
+		__m128 newAngVel[ 3 ];
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			const int row = axis * 3;
+			newAngVel[ axis ] = _mm_add_ps( _mm_add_ps( _mm_mul_ps( body[ 0 ], r[ row ] ),
+							   _mm_mul_ps( body[ 1 ], r[ row + 1 ] ) ),
+							   _mm_mul_ps( body[ 2 ], r[ row + 2 ] ) );
+		}
+
+		//cap position to keep the vehicles on the terrain
+		pos[ 0 ] = _mm_max_ps( _mm_min_ps( pos[ 0 ], _mm_set1_ps( bounds.maxX ) ),
+							   _mm_set1_ps( bounds.minX ) );
+		pos[ 2 ] = _mm_max_ps( _mm_min_ps( pos[ 2 ], _mm_set1_ps( bounds.maxZ ) ),
+							   _mm_set1_ps( bounds.minZ ) );
+
+		//store the batch
+		for( int element = 0; element < 4; ++element )
+			_mm_storeu_ps( &m_orientation[ element ][ i ], q[ element ] );
+		_mm_storeu_ps( &m_posX[ i ], pos[ 0 ] );
+		_mm_storeu_ps( &m_posY[ i ], pos[ 1 ] );
+		_mm_storeu_ps( &m_posZ[ i ], pos[ 2 ] );
+		_mm_storeu_ps( &m_velX[ i ], vel[ 0 ] );
+		_mm_storeu_ps( &m_velY[ i ], vel[ 1 ] );
+		_mm_storeu_ps( &m_velZ[ i ], vel[ 2 ] );
+		_mm_storeu_ps( &m_momentumX[ i ], momentum[ 0 ] );
+		_mm_storeu_ps( &m_momentumY[ i ], momentum[ 1 ] );
+		_mm_storeu_ps( &m_momentumZ[ i ], momentum[ 2 ] );
+		_mm_storeu_ps( &m_angVelX[ i ], newAngVel[ 0 ] );
+		_mm_storeu_ps( &m_angVelY[ i ], newAngVel[ 1 ] );
+		_mm_storeu_ps( &m_angVelZ[ i ], newAngVel[ 2 ] );
+
+		//still on the ground, moving and turning slowly
+		__m128 moveSq = zero;
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			const __m128 move = _mm_sub_ps( pos[ axis ], start[ axis ] );
+			moveSq = _mm_add_ps( moveSq, _mm_mul_ps( move, move ) );
+		}
+		const __m128 angularSpeedSq = _mm_add_ps( _mm_add_ps(
+									  _mm_mul_ps( newAngVel[ 0 ], newAngVel[ 0 ] ),
+									  _mm_mul_ps( newAngVel[ 1 ], newAngVel[ 1 ] ) ),
+									  _mm_mul_ps( newAngVel[ 2 ], newAngVel[ 2 ] ) );
+		const __m128 still = _mm_and_ps( onGround, _mm_and_ps( _mm_cmple_ps( moveSq, maxMoveSq ),
+										 _mm_cmple_ps( angularSpeedSq, maxAngularSpeedSq ) ) );
+
+		const int groundMask = _mm_movemask_ps( onGround );
+		const int stillMask = _mm_movemask_ps( still );
+		for( int lane = 0; lane < BATCH_SIZE; ++lane )
+		{
+			m_onGround[ i + lane ] = (unsigned char)( ( groundMask >> lane ) & 1 );
+			if( ( ( stillMask >> lane ) & 1 ) != 0 && m_controls[ i + lane ] == 0 )
+				m_sleepSteps[ i + lane ] += numSteps[ v + lane ];
+			else
+				m_sleepSteps[ i + lane ] = 0;
+		}
+	}
+#else
+	//what each vehicle carries from placing its collision points to integrating
+	struct LaneState
+	{
+		float q[ 4 ];
+		float r[ 9 ];
+		float startRows[ 9 ];
+		float pos[ 3 ];
+		float vel[ 3 ];
+		float velocitySq[ 3 ];
+		float normal[ 3 ];
+		float pointForce[ 3 ];
+		float moveHeight;
+		bool nearTerrain;
+		bool onGround;
+	};
+	LaneState lanes[ VEHICLES_PER_ITEM ];
+
+	for( int v = 0; v < numVehicles; ++v )
+	{
+		const int i = firstVehicle + v;
+		LaneState& lane = lanes[ v ];
+
+		for( int element = 0; element < 4; ++element )
+			lane.q[ element ] = m_orientation[ element ][ i ];
+		RotationFromQuaternion( lane.q, lane.r );
+		for( int element = 0; element < 9; ++element )
+			lane.startRows[ element ] = lane.r[ element ];
+		lane.pos[ 0 ] = m_posX[ i ];
+		lane.pos[ 1 ] = m_posY[ i ];
+		lane.pos[ 2 ] = m_posZ[ i ];
+		lane.vel[ 0 ] = m_velX[ i ];
+		lane.vel[ 1 ] = m_velY[ i ];
+		lane.vel[ 2 ] = m_velZ[ i ];
+
+		for( int axis = 0; axis < 3; ++axis )
+			lane.velocitySq[ axis ] = lane.vel[ axis ] * fabsf( lane.vel[ axis ] );
+
+		for( int axis = 0; axis < 3; ++axis )
+			lane.normal[ axis ] = lane.r[ 3 + axis ];
+		const float hover = ( hoverWeight * lane.normal[ 1 ] ) - hoverMass;
+		for( int axis = 0; axis < 3; ++axis )
+			lane.pointForce[ axis ] = lane.normal[ axis ] * hover;
+
+		lane.moveHeight = 0.0f;
+		lane.nearTerrain = false;
+		lane.onGround = false;
+	}
+
+	for( int point = 0; point < numPoints; ++point )
+	{
+		const Vector3& vPoint = pPoints[ point ];
+		for( int v = 0; v < numVehicles; ++v )
+		{
+			const float* r = lanes[ v ].r;
+			const float* pos = lanes[ v ].pos;
+			pointX[ v ] = ( vPoint.x * r[ 0 ] ) + ( vPoint.y * r[ 3 ] ) + ( vPoint.z * r[ 6 ] ) + pos[ 0 ];
+			pointZ[ v ] = ( vPoint.x * r[ 2 ] ) + ( vPoint.y * r[ 5 ] ) + ( vPoint.z * r[ 8 ] ) + pos[ 2 ];
+			pointY[ v ] = ( vPoint.x * r[ 1 ] ) + ( vPoint.y * r[ 4 ] ) + ( vPoint.z * r[ 7 ] ) + pos[ 1 ];
+		}
+
+		pTerrain->GetHeightMapPoints( pointX, pointZ, heights, numVehicles );
+
+		for( int v = 0; v < numVehicles; ++v )
+		{
+			LaneState& lane = lanes[ v ];
+			const float terrainDistance = pointY[ v ] - heights[ v ];
+
+			if( terrainDistance < FLEET_NEAR_DISTANCE )
+				lane.nearTerrain = true;
+
+			if( terrainDistance < FLEET_HOVER_HEIGHT )
+			{
+				lane.onGround = true;
+
+				if( turnScale != 0.0f )
+				{
+					const float* pointForce = lane.pointForce;
+					const Vector3& vArm = pArms[ point ];
+					const float scale = stepTime[ v ] * FLEET_DISPLACEMENT * turnScale;
+					const float d[ 3 ] = {
+						scale * ( ( vArm.y * pointForce[ 2 ] ) - ( vArm.z * pointForce[ 1 ] ) ),
+						scale * ( ( vArm.z * pointForce[ 0 ] ) - ( vArm.x * pointForce[ 2 ] ) ),
+						scale * ( ( vArm.x * pointForce[ 1 ] ) - ( vArm.y * pointForce[ 0 ] ) ) };
+
+					TurnQuaternion( lane.q, d );
+					RotationFromQuaternion( lane.q, lane.r );
+				}
+			}
+
+			if( terrainDistance < FLEET_SUPPORT_HEIGHT )
+			{
+				const float* normal = lane.normal;
+				float* vel = lane.vel;
+				const float kill = - ( ( vel[ 0 ] * normal[ 0 ] ) + ( vel[ 1 ] * normal[ 1 ] ) +
+									   ( vel[ 2 ] * normal[ 2 ] ) );
+				for( int axis = 0; axis < 3; ++axis )
+					vel[ axis ] += normal[ axis ] * kill;
+			}
+
+			if( terrainDistance < lane.moveHeight )
+				lane.moveHeight = terrainDistance;
+		}
+	}
+
+	for( int v = 0; v < numVehicles; ++v )
+	{
+		const int i = firstVehicle + v;
+		const float dt = stepTime[ v ];
+
+		LaneState& lane = lanes[ v ];
+		float* q = lane.q;
+		float* r = lane.r;
+		const float* startRows = lane.startRows;
+		float* pos = lane.pos;
+		float* vel = lane.vel;
+		const float* velocitySq = lane.velocitySq;
+		const float* pointForce = lane.pointForce;
+		const bool nearTerrain = lane.nearTerrain;
+		const bool onGround = lane.onGround;
+
+		const float start[ 3 ] = { m_posX[ i ], m_posY[ i ], m_posZ[ i ] };
+		float momentum[ 3 ] = { m_momentumX[ i ], m_momentumY[ i ], m_momentumZ[ i ] };
+		const float angVel[ 3 ] = { m_angVelX[ i ], m_angVelY[ i ], m_angVelZ[ i ] };
+
+		pos[ 1 ] -= lane.moveHeight;
+
+		const float thrust = FLEET_LINEAR_THRUST * thrustSign[ v ];
+		const float sideThrust = FLEET_ANGULAR_THRUST * turnSign[ v ];
+		float force[ 3 ];
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			float engine = startRows[ 6 + axis ] * thrust;
+			if( axis == 1 && ! nearTerrain )
+				engine = 0.0f;
+
+			force[ axis ] = onGround ? pointForce[ axis ] : 0.0f;
+			force[ axis ] += engine;
+			force[ axis ] += startRows[ axis ] * sideThrust;
+			force[ axis ] -= velocitySq[ axis ] * FLEET_LINEAR_AR;
+		}
+		force[ 1 ] += -FLEET_GRAVITY * FLEET_MASS;
+
+		float torque[ 3 ];
+		for( int axis = 0; axis < 3; ++axis )
+			torque[ axis ] = - angVel[ axis ] * FLEET_ANGULAR_AR;
+		torque[ 1 ] -= turnTorque * turnSign[ v ];
+
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			pos[ axis ] += vel[ axis ] * dt;
+			vel[ axis ] += ( force[ axis ] / FLEET_MASS ) * dt;
+			momentum[ axis ] += torque[ axis ] * dt;
+		}
+
+		const float step[ 3 ] = { angVel[ 0 ] * dt, angVel[ 1 ] * dt, angVel[ 2 ] * dt };
+		TurnQuaternion( q, step );
+		RotationFromQuaternion( q, r );
+
+		float body[ 3 ];
+		for( int axis = 0; axis < 3; ++axis )
+		{
+			body[ axis ] = m_inverseTensor[ axis ] * ( ( momentum[ 0 ] * r[ axis ] ) +
+						   ( momentum[ 1 ] * r[ 3 + axis ] ) + ( momentum[ 2 ] * r[ 6 + axis ] ) );
+		}
+
+		if( pos[ 0 ] < bounds.minX ) pos[ 0 ] = bounds.minX;
+		if( pos[ 0 ] > bounds.maxX ) pos[ 0 ] = bounds.maxX;
+		if( pos[ 2 ] < bounds.minZ ) pos[ 2 ] = bounds.minZ;
+		if( pos[ 2 ] > bounds.maxZ ) pos[ 2 ] = bounds.maxZ;
+
+		for( int element = 0; element < 4; ++element )
+			m_orientation[ element ][ i ] = q[ element ];
+		m_posX[ i ] = pos[ 0 ];
+		m_posY[ i ] = pos[ 1 ];
+		m_posZ[ i ] = pos[ 2 ];
+		m_velX[ i ] = vel[ 0 ];
+		m_velY[ i ] = vel[ 1 ];
+		m_velZ[ i ] = vel[ 2 ];
+		m_momentumX[ i ] = momentum[ 0 ];
+		m_momentumY[ i ] = momentum[ 1 ];
+		m_momentumZ[ i ] = momentum[ 2 ];
+		m_angVelX[ i ] = ( body[ 0 ] * r[ 0 ] ) + ( body[ 1 ] * r[ 1 ] ) + ( body[ 2 ] * r[ 2 ] );
+		m_angVelY[ i ] = ( body[ 0 ] * r[ 3 ] ) + ( body[ 1 ] * r[ 4 ] ) + ( body[ 2 ] * r[ 5 ] );
+		m_angVelZ[ i ] = ( body[ 0 ] * r[ 6 ] ) + ( body[ 1 ] * r[ 7 ] ) + ( body[ 2 ] * r[ 8 ] );
+		m_onGround[ i ] = onGround ? 1 : 0;
+
+		float moveSq = 0.0f;
+		for( int axis = 0; axis < 3; ++axis )
+			moveSq += ( pos[ axis ] - start[ axis ] ) * ( pos[ axis ] - start[ axis ] );
+		const float angularSpeedSq = ( m_angVelX[ i ] * m_angVelX[ i ] ) +
+									 ( m_angVelY[ i ] * m_angVelY[ i ] ) +
+									 ( m_angVelZ[ i ] * m_angVelZ[ i ] );
+		const float maxMove = FLEET_SLEEP_SPEED * dt;
+		if( onGround && m_controls[ i ] == 0 && moveSq <= maxMove * maxMove &&
+			angularSpeedSq <= FLEET_SLEEP_ANGULAR_SPEED * FLEET_SLEEP_ANGULAR_SPEED )
+			m_sleepSteps[ i ] += numSteps[ v ];
+		else
+			m_sleepSteps[ i ] = 0;
+	}
+#endif
+}
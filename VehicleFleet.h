@@ -0,0 +1,281 @@
+//------------------------------------------------------------------------------
+// File: VehicleFleet.h
+// Desc: Physics for many hovercraft at once, stored as structure-of-arrays
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_VEHICLEFLEET_H
+#define INCLUSIONGUARD_VEHICLEFLEET_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include <vector>
+
+#include "VectorMath.h"
+
+//the physics kernel uses sse where the maths does - there is no neon version,
+//so on arm it steps each lane of a batch with plain floats
+#if defined( MATHS_USE_SSE )
+	#define FLEET_USE_SSE
+#endif
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+class Terrain;
+class WorkerPool;
+
+//------------------------------------------------------------------------------
+// Name: class VehicleFleet
+// Desc: Runs the same simulation as Vehicle::DoPhysics() on a whole fleet. Each
+//		 quantity is kept in an array of its own, so the kernel steps four
+//		 vehicles at a time, and the fleet is split into items of a few dozen
+//		 vehicles that can be run on a worker pool. Vehicles that have come to
+//		 rest are moved behind the awake ones and left out of the step, so a
+//		 vehicle's index is a handle for the slot its state is kept in.
+//
+//		 The awake vehicles are also kept in tiers by their distance from a
+//		 centre, usually the camera. Near vehicles are stepped every time
+//		 with the whole collision grid, mid-range ones every other time with
+//		 its four corners, and far ones every fourth time with a single
+//		 point under their centre. Between its steps a vehicle is reported
+//		 moved on at the velocities it was left with, which is exactly where
+//		 the next step will take it short of any contact with the terrain.
+//		 A vehicle moved into a nearer tier can be pushed metres out of the
+//		 terrain by its first step with more points, so it is reported where
+//		 its old tier would have taken it, fading to where it is over the
+//		 next second or so.
+//
+//		 Unlike Vehicle::DoPhysics(), a step is never split into substeps
+//		 where it could carry a vehicle into the terrain, as the lanes of a
+//		 batch all step over the same time. At the app's 240 steps a second
+//		 that only matters near the ground above about 120m/s, or 60m/s and
+//		 30m/s in the mid and far tiers with their longer steps, where a
+//		 vehicle can end a step deeper in the terrain than Vehicle would let
+//		 it.
+//
+//		 The fleet's vehicles touch nothing but the terrain. VehicleCollisions
+//		 only takes Vehicles, so they pass through each other and through the
+//		 player's craft, and nothing they do wakes a sleeping one.
+//------------------------------------------------------------------------------
+class VehicleFleet
+{
+public:
+	//vehicles stepped together by the kernel, and by each item of a pool job
+	const static int BATCH_SIZE = 4;
+	const static int VEHICLES_PER_ITEM = 64;
+
+	//physics level of detail, and the vehicles stepped less often than every
+	//time for being further from the centre
+	const static int TIER_NEAR	= 0;
+	const static int TIER_MID	= 1;
+	const static int TIER_FAR	= 2;
+	const static int NUM_TIERS	= 3;
+	const static float NEAR_DISTANCE;
+	const static float MID_DISTANCE;
+
+	//bits of the controls for each vehicle
+	const static unsigned char CONTROL_FORWARD	= 1;
+	const static unsigned char CONTROL_REVERSE	= 2;
+	const static unsigned char CONTROL_LEFT		= 4;
+	const static unsigned char CONTROL_RIGHT	= 8;
+
+	VehicleFleet( const int maxVehicles );
+
+	//returns the new vehicle's index, or -1 if the fleet is full
+	int AddVehicle( const Vector3& vPosition );
+	inline int GetNumVehicles() const { return m_numVehicles; }
+
+	//any input wakes a sleeping vehicle
+	inline void SetControls( const int vehicle, const unsigned char controls )
+	{
+		m_controls[ m_slots[ vehicle ] ] = controls;
+		if( controls != 0 )
+			Wake( vehicle );
+	}
+
+	//the point the tiers are measured from
+	inline void SetLodCentre( const Vector3& vCentre ) { m_vLodCentre = vCentre; }
+
+	//pPool may be NULL to step everything on the calling thread - the time
+	//interval must be the same every step
+	void Step( const float timeInterval, const Terrain* pTerrain, WorkerPool* pPool );
+
+	//where the vehicle is now, even if it was last stepped a few steps ago
+	inline Vector3 GetPosition( const int vehicle ) const
+	{
+		const int slot = m_slots[ vehicle ];
+		const float lag = GetLag( slot );
+		const Vector3& vOffset = m_vPopOffsets[ vehicle ];
+		return Vector3( m_posX[ slot ] + ( m_velX[ slot ] * lag ) + vOffset.x,
+						m_posY[ slot ] + ( m_velY[ slot ] * lag ) + vOffset.y,
+						m_posZ[ slot ] + ( m_velZ[ slot ] * lag ) + vOffset.z );
+	}
+
+	inline Vector3 GetVelocity( const int vehicle ) const
+	{
+		const int slot = m_slots[ vehicle ];
+		return Vector3( m_velX[ slot ], m_velY[ slot ], m_velZ[ slot ] );
+	}
+
+	inline bool IsOnGround( const int vehicle ) const
+	{
+		return m_onGround[ m_slots[ vehicle ] ] != 0;
+	}
+
+	void GetRotation( const int vehicle, Matrix3& matRotation ) const;
+
+	//called when the floating origin moves by vShift
+	void Rebase( const Vector3& vShift );
+
+	//sleeping vehicles are not stepped - Wake() one that something else has
+	//moved, and WakeInBox() the ones over terrain that has been edited
+	inline bool IsAsleep( const int vehicle ) const
+	{
+		return m_slots[ vehicle ] >= m_tierEnd[ NUM_TIERS - 1 ];
+	}
+	void Wake( const int vehicle );
+	void WakeInBox( const float minX, const float minZ, const float maxX, const float maxZ );
+
+	//vehicles awake now, and vehicles put to sleep and woken since the start
+	inline int GetNumAwake() const { return m_tierEnd[ NUM_TIERS - 1 ]; }
+	inline unsigned int GetNumSleeps() const { return m_numSleeps; }
+	inline unsigned int GetNumWakes() const { return m_numWakes; }
+
+	//awake vehicles in each tier, and vehicles the last Step() stepped
+	inline int GetNumInTier( const int tier ) const
+	{
+		return m_tierEnd[ tier ] - ( ( tier > 0 ) ? m_tierEnd[ tier - 1 ] : 0 );
+	}
+	inline int GetNumStepped() const { return m_numStepped; }
+
+	//false if the slots and the vehicles in them have come apart, the tiers
+	//are out of order, or an awake vehicle is behind the steps of its tier
+	bool CheckSlots() const;
+
+private:
+	class StepJob;
+	friend class StepJob;
+
+	//collision grid on the base of each vehicle, as in Vehicle
+	const static int POINTS_PER_EDGE = 3;
+	const static int NUM_POINTS = POINTS_PER_EDGE * POINTS_PER_EDGE;
+
+	//the tier that stands for the sleeping vehicles, behind the far ones
+	const static int TIER_ASLEEP = NUM_TIERS;
+
+	//the limits the vehicles are kept within for one step
+	struct StepBounds
+	{
+		float minX, minZ;
+		float maxX, maxZ;
+	};
+
+	//a vehicle moved into a nearer tier, and where it was and how fast it was
+	//going when it was, to tell how far its first step there pushes it aside
+	struct Promotion
+	{
+		int vehicle;
+		int step;
+		Vector3 vPosition;
+		Vector3 vVelocity;
+	};
+
+	//everything kept in a vehicle's slot, for moving it to another
+	struct SlotState
+	{
+		float pos[ 3 ];
+		float vel[ 3 ];
+		float orientation[ 4 ];
+		float momentum[ 3 ];
+		float angVel[ 3 ];
+		unsigned char controls;
+		unsigned char onGround;
+		int sleepSteps;
+		int lastStep;
+		int vehicle;		//-1 for a slot past the last vehicle
+	};
+
+	void StepTier( const int tier, const float timeInterval, const Terrain* pTerrain,
+				   const StepBounds& bounds, WorkerPool* pPool );
+	void StepVehicles( const int tier, const float timeInterval, const Terrain* pTerrain,
+					   const StepBounds& bounds, const int firstVehicle,
+					   const int numVehicles );
+
+	//time since the state in a slot was stepped to
+	inline float GetLag( const int slot ) const
+	{
+		return float( m_stepCount - m_lastStep[ slot ] ) * m_timeInterval;
+	}
+
+	int GetTier( const int slot ) const;
+	int GetSlotTier( const int slot ) const;
+	void MoveToTier( const int vehicle, const int tier );
+	void FadePops();
+
+	void GetSlot( const int slot, SlotState& state ) const;
+	void SetSlot( const int slot, const SlotState& state );
+	void SwapSlots( const int slotA, const int slotB );
+
+	int m_maxVehicles;
+	int m_numVehicles;
+
+	//the slot after the last of each tier - near, mid and far vehicles are in
+	//that order before the sleeping ones
+	int m_tierEnd[ NUM_TIERS ];
+
+	unsigned int m_numSleeps;
+	unsigned int m_numWakes;
+	int m_numStepped;
+
+	Vector3 m_vLodCentre;
+	int m_stepCount;
+	float m_timeInterval;
+
+	//vehicles found changing tier after a step, and the tiers they go to
+	std::vector<int> m_moves;
+
+	//vehicles moved into a nearer tier and not stepped there yet, how far
+	//each vehicle is reported from where it is, and the vehicles with an
+	//offset still fading
+	std::vector<Promotion> m_promotions;
+	std::vector<Vector3> m_vPopOffsets;
+	std::vector<int> m_fading;
+
+	//the slot each vehicle is in, and the vehicle in each slot
+	std::vector<int> m_slots;
+	std::vector<int> m_vehicles;
+
+	//per-slot state, padded to a whole number of batches - the unused slots
+	//in the last batch are stepped too, and ignored
+	std::vector<float> m_posX, m_posY, m_posZ;
+	std::vector<float> m_velX, m_velY, m_velZ;
+	std::vector<float> m_orientation[ 4 ];		//x, y, z and w of the orientation quaternion
+	std::vector<float> m_momentumX, m_momentumY, m_momentumZ;
+	std::vector<float> m_angVelX, m_angVelY, m_angVelZ;
+	std::vector<unsigned char> m_controls;
+	std::vector<unsigned char> m_onGround;
+	std::vector<int> m_sleepSteps;		//steps in a row the vehicle has been still for
+	std::vector<int> m_lastStep;		//the step its state was last stepped to
+
+	//inverse of the body-space inertia tensor, which is diagonal
+	float m_inverseTensor[ 3 ];
+
+	//body-space collision points for each tier, the lever arms used for
+	//their torque, and how much each point's turn counts for
+	int m_numPoints[ NUM_TIERS ];
+	Vector3 m_collisionPoints[ NUM_TIERS ][ NUM_POINTS ];
+	Vector3 m_collisionVectors[ NUM_TIERS ][ NUM_POINTS ];
+	float m_turnScale[ NUM_TIERS ];
+
+};
+
+
+#endif //INCLUSIONGUARD_VEHICLEFLEET_H
@@ -0,0 +1,301 @@
+//------------------------------------------------------------------------------
+// File: WorkerPool.cpp
+// Desc: A fixed set of worker threads that share out the items of a job
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include "WorkerPool.h"
+
+#if defined( _WIN32 )
+	#include <process.h>
+#else
+	#include <unistd.h>
+#endif
+
+
+//------------------------------------------------------------------------------
+// Definitions:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: AtomicIncrement()
+// Desc: Adds one to a value shared between threads, and returns the result
+//------------------------------------------------------------------------------
+static inline long AtomicIncrement( volatile long* pValue )
+{
+	#if defined( _WIN32 )
+	return InterlockedIncrement( pValue );
+	#else
+	return __sync_add_and_fetch( pValue, 1 );
+	#endif
+}
+
+#if defined( _WIN32 )
+
+//------------------------------------------------------------------------------
+// Name: WorkerPool()
+// Desc: Constructor for the worker pool class - starts the threads, which wait
+//		 for the first job. If a thread cannot be started the pool makes do
+//		 with the ones it has.
+//------------------------------------------------------------------------------
+WorkerPool::WorkerPool( const int numThreads )
+{
+	m_hStart	= CreateSemaphore( NULL, 0, MAX_THREADS, NULL );
+	m_hFinished	= CreateEvent( NULL, FALSE, FALSE, NULL );
+	m_quit		= false;
+
+	m_pJob			= NULL;
+	m_numItems		= 0;
+	m_nextItem		= 0;
+	m_threadsBusy	= 0;
+
+	m_numThreads = 0;
+	if( m_hStart == NULL || m_hFinished == NULL )
+		return;
+
+	//the crt needs threads that use it to be started by _beginthreadex
+	const int wantedThreads = ( numThreads < MAX_THREADS ) ? numThreads : MAX_THREADS;
+	while( m_numThreads < wantedThreads )
+	{
+		HANDLE hThread = (HANDLE)_beginthreadex( NULL, 0, ThreadProc, this, 0, NULL );
+		if( hThread == 0 )
+			break;
+
+		m_threads[ m_numThreads++ ] = hThread;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: ~WorkerPool()
+// Desc: Destructor for the worker pool class - wakes the threads to tell them
+//		 to stop, and waits for them to finish
+//------------------------------------------------------------------------------
+WorkerPool::~WorkerPool()
+{
+	if( m_numThreads > 0 )
+	{
+		m_quit = true;
+		ReleaseSemaphore( m_hStart, m_numThreads, NULL );
+		WaitForMultipleObjects( m_numThreads, m_threads, TRUE, INFINITE );
+
+		for( int thread = 0; thread < m_numThreads; ++thread )
+			CloseHandle( m_threads[ thread ] );
+	}
+
+	if( m_hStart != NULL )
+		CloseHandle( m_hStart );
+	if( m_hFinished != NULL )
+		CloseHandle( m_hFinished );
+}
+
+//------------------------------------------------------------------------------
+// Name: Run()
+// Desc: Runs items 0 to numItems - 1 of a job, and returns once all of them are
+//		 done. Items are taken in order, but may finish in any order.
+//------------------------------------------------------------------------------
+void WorkerPool::Run( WorkerJob& job, const int numItems )
+{
+	m_pJob		= &job;
+	m_numItems	= numItems;
+	m_nextItem	= 0;
+
+	if( m_numThreads == 0 || numItems <= 1 )
+	{
+		RunItems();
+		return;
+	}
+
+	//a thread that finishes early may take a second wake-up meant for another,
+	//but each one is counted off exactly once either way
+	m_threadsBusy = m_numThreads;
+	ReleaseSemaphore( m_hStart, m_numThreads, NULL );
+
+	RunItems();
+
+	WaitForSingleObject( m_hFinished, INFINITE );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetNumProcessors()
+// Desc: Gets the number of processors in the machine
+//------------------------------------------------------------------------------
+int WorkerPool::GetNumProcessors()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	return int( info.dwNumberOfProcessors );
+}
+
+//------------------------------------------------------------------------------
+// Name: ThreadProc()
+// Desc: The body of each worker thread
+//------------------------------------------------------------------------------
+unsigned int __stdcall WorkerPool::ThreadProc( void* pParameter )
+{
+	WorkerPool* pPool = static_cast<WorkerPool*>( pParameter );
+
+	for( ;; )
+	{
+		WaitForSingleObject( pPool->m_hStart, INFINITE );
+		if( pPool->m_quit )
+			break;
+
+		pPool->RunItems();
+
+		if( InterlockedDecrement( &pPool->m_threadsBusy ) == 0 )
+			SetEvent( pPool->m_hFinished );
+	}
+
+	return 0;
+}
+
+#else
+
+//------------------------------------------------------------------------------
+// Name: WorkerPool()
+// Desc: Constructor for the worker pool class - starts the threads, which wait
+//		 for the first job. If a thread cannot be started the pool makes do
+//		 with the ones it has.
+//------------------------------------------------------------------------------
+WorkerPool::WorkerPool( const int numThreads )
+{
+	pthread_mutex_init( &m_mutex, NULL );
+	pthread_cond_init( &m_start, NULL );
+	pthread_cond_init( &m_finished, NULL );
+	m_jobNumber	= 0;
+	m_quit		= false;
+
+	m_pJob			= NULL;
+	m_numItems		= 0;
+	m_nextItem		= 0;
+	m_threadsBusy	= 0;
+
+	m_numThreads = 0;
+	const int wantedThreads = ( numThreads < MAX_THREADS ) ? numThreads : MAX_THREADS;
+	while( m_numThreads < wantedThreads )
+	{
+		if( pthread_create( &m_threads[ m_numThreads ], NULL, ThreadProc, this ) != 0 )
+			break;
+
+		++m_numThreads;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: ~WorkerPool()
+// Desc: Destructor for the worker pool class - wakes the threads to tell them
+//		 to stop, and waits for them to finish
+//------------------------------------------------------------------------------
+WorkerPool::~WorkerPool()
+{
+	pthread_mutex_lock( &m_mutex );
+	m_quit = true;
+	pthread_cond_broadcast( &m_start );
+	pthread_mutex_unlock( &m_mutex );
+
+	for( int thread = 0; thread < m_numThreads; ++thread )
+		pthread_join( m_threads[ thread ], NULL );
+
+	pthread_cond_destroy( &m_finished );
+	pthread_cond_destroy( &m_start );
+	pthread_mutex_destroy( &m_mutex );
+}
+
+//------------------------------------------------------------------------------
+// Name: Run()
+// Desc: Runs items 0 to numItems - 1 of a job, and returns once all of them are
+//		 done. Items are taken in order, but may finish in any order.
+//------------------------------------------------------------------------------
+void WorkerPool::Run( WorkerJob& job, const int numItems )
+{
+	m_pJob		= &job;
+	m_numItems	= numItems;
+	m_nextItem	= 0;
+
+	if( m_numThreads == 0 || numItems <= 1 )
+	{
+		RunItems();
+		return;
+	}
+
+	pthread_mutex_lock( &m_mutex );
+	m_threadsBusy = m_numThreads;
+	++m_jobNumber;
+	pthread_cond_broadcast( &m_start );
+	pthread_mutex_unlock( &m_mutex );
+
+	RunItems();
+
+	pthread_mutex_lock( &m_mutex );
+	while( m_threadsBusy != 0 )
+		pthread_cond_wait( &m_finished, &m_mutex );
+	pthread_mutex_unlock( &m_mutex );
+}
+
+//------------------------------------------------------------------------------
+// Name: GetNumProcessors()
+// Desc: Gets the number of processors in the machine
+//------------------------------------------------------------------------------
+int WorkerPool::GetNumProcessors()
+{
+	const long numProcessors = sysconf( _SC_NPROCESSORS_ONLN );
+	return ( numProcessors > 0 ) ? int( numProcessors ) : 1;
+}
+
+//------------------------------------------------------------------------------
+// Name: ThreadProc()
+// Desc: The body of each worker thread - it runs each job once, however
+//		 late it wakes for it
+//------------------------------------------------------------------------------
+void* WorkerPool::ThreadProc( void* pParameter )
+{
+	WorkerPool* pPool = static_cast<WorkerPool*>( pParameter );
+	unsigned int jobNumber = 0;
+
+	for( ;; )
+	{
+		pthread_mutex_lock( &pPool->m_mutex );
+		while( pPool->m_jobNumber == jobNumber && ! pPool->m_quit )
+			pthread_cond_wait( &pPool->m_start, &pPool->m_mutex );
+		jobNumber = pPool->m_jobNumber;
+		const bool quit = pPool->m_quit;
+		pthread_mutex_unlock( &pPool->m_mutex );
+
+		if( quit )
+			break;
+
+		pPool->RunItems();
+
+		pthread_mutex_lock( &pPool->m_mutex );
+		if( --pPool->m_threadsBusy == 0 )
+			pthread_cond_signal( &pPool->m_finished );
+		pthread_mutex_unlock( &pPool->m_mutex );
+	}
+
+	return NULL;
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+// Name: RunItems()
+// Desc: Takes items from the current job until there are none left
+//------------------------------------------------------------------------------
+void WorkerPool::RunItems()
+{
+	for( ;; )
+	{
+		const long item = AtomicIncrement( &m_nextItem ) - 1;
+		if( item >= m_numItems )
+			break;
+
+		m_pJob->Execute( int( item ) );
+	}
+}
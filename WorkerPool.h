@@ -0,0 +1,94 @@
+//------------------------------------------------------------------------------
+// File: WorkerPool.h
+// Desc: A fixed set of worker threads that share out the items of a job
+//
+// Created: 19 October 2026
+//
+// (c)2026 Neil Wakefield
+//------------------------------------------------------------------------------
+
+
+#ifndef INCLUSIONGUARD_WORKERPOOL_H
+#define INCLUSIONGUARD_WORKERPOOL_H
+
+
+//------------------------------------------------------------------------------
+// Included files:
+//------------------------------------------------------------------------------
+#include "Platform.h"
+
+#if !defined( _WIN32 )
+	#include <pthread.h>
+#endif
+
+
+//------------------------------------------------------------------------------
+// Prototypes and declarations:
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// Name: class WorkerJob
+// Desc: Work that can be split into numbered items, any of which may be run on
+//		 any thread at the same time as the others
+//------------------------------------------------------------------------------
+class WorkerJob
+{
+public:
+	virtual ~WorkerJob() {}
+	virtual void Execute( const int item ) = 0;
+};
+
+//------------------------------------------------------------------------------
+// Name: class WorkerPool
+// Desc: The threads sleep until Run() is called, then take items from the job
+//		 one at a time until there are none left. The calling thread takes items
+//		 too, so a pool with no threads runs everything in order on the caller.
+//------------------------------------------------------------------------------
+class WorkerPool
+{
+public:
+	const static int MAX_THREADS = 32;
+
+	WorkerPool( const int numThreads );
+	~WorkerPool();
+
+	void Run( WorkerJob& job, const int numItems );
+
+	inline int GetNumThreads() const { return m_numThreads; }
+
+	static int GetNumProcessors();
+
+private:
+	void RunItems();
+
+	int		m_numThreads;
+	volatile bool m_quit;
+
+	#if defined( _WIN32 )
+	static unsigned int __stdcall ThreadProc( void* pParameter );
+
+	HANDLE	m_threads[ MAX_THREADS ];
+	HANDLE	m_hStart;		//semaphore with a count for each thread to wake
+	HANDLE	m_hFinished;	//set when the last thread has run out of items
+	#else
+	static void* ThreadProc( void* pParameter );
+
+	//the threads wait for the job number to change, and Run() for the busy
+	//count to reach zero, both under the one mutex
+	pthread_t		m_threads[ MAX_THREADS ];
+	pthread_mutex_t	m_mutex;
+	pthread_cond_t	m_start;
+	pthread_cond_t	m_finished;
+	unsigned int	m_jobNumber;
+	#endif
+
+	//the job being run
+	WorkerJob*		m_pJob;
+	int				m_numItems;
+	volatile long	m_nextItem;
+	volatile long	m_threadsBusy;
+
+};
+
+
+#endif //INCLUSIONGUARD_WORKERPOOL_H